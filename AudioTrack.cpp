@@ -0,0 +1,283 @@
+#include "AudioTrack.h"
+#include "TimestampEngine.h"
+#include <gpac/constants.h>
+#include <gpac/mpeg4_odf.h>
+#include <gpac/avparse.h>
+#include <iostream>
+#include <cstring>
+
+namespace {
+
+// 交织缓冲最多保留的时长（90kHz），视频长时间没有到达时丢弃最早的音频
+const int64_t MAX_PENDING_TICKS = 2 * 90000;
+
+// 时间戳跳变超过1秒时重新对齐
+const int64_t RESYNC_SECONDS = 1;
+
+} // namespace
+
+AudioTrack::AudioTrack(const Config& config)
+    : m_config(config)
+    , m_useTimestamps(false)
+    , m_clockSamples(0)
+    , m_fileStarted(false)
+    , m_fileDTS(0)
+    , m_markDecodeTime(false)
+    , m_framesWritten(0)
+    , m_framesDropped(0)
+{
+}
+
+bool AudioTrack::isValid(const Config& config)
+{
+    if (config.sampleRate == 0 || config.channels == 0 || config.channels > 8) {
+        return false;
+    }
+
+    if (config.codec == CODEC_PCM) {
+        return config.bitsPerSample == 8 || config.bitsPerSample == 16;
+    }
+
+    if (config.codec == CODEC_AAC) {
+        // 采样率必须是AAC标准采样率之一
+        for (size_t i = 0; i < sizeof(GF_M4ASampleRates) / sizeof(GF_M4ASampleRates[0]); i++) {
+            if (GF_M4ASampleRates[i] == config.sampleRate) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    return config.codec == CODEC_G711A || config.codec == CODEC_G711U;
+}
+
+bool AudioTrack::createTrack(GF_ISOFile* file, bool fragmented, int& trackId) const
+{
+    trackId = gf_isom_new_track(file, 0, GF_ISOM_MEDIA_AUDIO, m_config.sampleRate);
+    if (!trackId) {
+        std::cerr << "Failed to create audio track" << std::endl;
+        return false;
+    }
+    gf_isom_set_track_enabled(file, trackId, 1);
+
+    GF_Err err;
+    u32 descIndex = 0;
+    if (m_config.codec == CODEC_AAC) {
+        // AAC-LC的AudioSpecificConfig
+        GF_M4ADecSpecInfo asc;
+        memset(&asc, 0, sizeof(asc));
+        asc.base_object_type = 2;
+        asc.base_sr = m_config.sampleRate;
+        for (u32 i = 0; i < sizeof(GF_M4ASampleRates) / sizeof(GF_M4ASampleRates[0]); i++) {
+            if (GF_M4ASampleRates[i] == m_config.sampleRate) {
+                asc.base_sr_index = i;
+                break;
+            }
+        }
+        asc.nb_chan = gf_m4a_get_channel_cfg(m_config.channels);
+
+        GF_ESD* esd = gf_odf_desc_esd_new(2);
+        esd->decoderConfig->streamType = GF_STREAM_AUDIO;
+        esd->decoderConfig->objectTypeIndication = GPAC_OTI_AUDIO_AAC_MPEG4;
+        esd->slConfig->timestampResolution = m_config.sampleRate;
+        err = gf_m4a_write_config(&asc, &esd->decoderConfig->decoderSpecificInfo->data,
+                                  &esd->decoderConfig->decoderSpecificInfo->dataLength);
+        if (err == GF_OK) {
+            err = gf_isom_new_mpeg4_description(file, trackId, esd, NULL, NULL, &descIndex);
+        }
+        gf_odf_desc_del((GF_Descriptor*)esd);
+        if (err == GF_OK) {
+            err = gf_isom_set_audio_info(file, trackId, descIndex, m_config.sampleRate, m_config.channels, 16);
+        }
+    } else {
+        // G.711和PCM使用QuickTime兼容的alaw/ulaw/sowt采样描述
+        GF_GenericSampleDescription desc;
+        memset(&desc, 0, sizeof(desc));
+        switch (m_config.codec) {
+        case CODEC_G711A:
+            desc.codec_tag = GF_4CC('a', 'l', 'a', 'w');
+            desc.bits_per_sample = 8;
+            break;
+        case CODEC_G711U:
+            desc.codec_tag = GF_4CC('u', 'l', 'a', 'w');
+            desc.bits_per_sample = 8;
+            break;
+        default:
+            desc.codec_tag = (m_config.bitsPerSample == 8) ? GF_4CC('r', 'a', 'w', ' ') : GF_4CC('s', 'o', 'w', 't');
+            desc.bits_per_sample = static_cast<u16>(m_config.bitsPerSample);
+            break;
+        }
+        desc.samplerate = m_config.sampleRate;
+        desc.nb_channels = static_cast<u16>(m_config.channels);
+        err = gf_isom_new_generic_sample_description(file, trackId, NULL, NULL, &desc, &descIndex);
+    }
+
+    if (err != GF_OK) {
+        std::cerr << "Failed to set audio config: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+
+    // 分片文件：默认时长取一帧的采样数，音频样本都是同步样本
+    if (fragmented) {
+        u32 defaultDuration = (m_config.codec == CODEC_AAC) ? 1024 : m_config.sampleRate / 50;
+        err = gf_isom_setup_track_fragment(file, trackId, 1, defaultDuration, 0, 1, 0, 0);
+        if (err != GF_OK) {
+            std::cerr << "Failed to setup audio track fragment: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool AudioTrack::push(const uint8_t* data, size_t size, int64_t timestamp)
+{
+    if (!data || size == 0) {
+        return false;
+    }
+
+    if (m_config.codec != CODEC_AAC || size < 7 || data[0] != 0xFF || (data[1] & 0xF0) != 0xF0) {
+        pushPayload(data, size, timestamp);
+        return true;
+    }
+
+    // ADTS：去除帧头，一次送入的多个ADTS帧依次缓冲，时间按1024采样递增
+    const uint8_t* end = data + size;
+    while (end - data >= 7 && data[0] == 0xFF && (data[1] & 0xF0) == 0xF0) {
+        size_t headerSize = (data[1] & 0x01) ? 7 : 9;
+        size_t frameSize = ((data[3] & 0x03) << 11) | (data[4] << 3) | (data[5] >> 5);
+        if (frameSize <= headerSize || frameSize > static_cast<size_t>(end - data)) {
+            std::cerr << "Invalid ADTS frame" << std::endl;
+            return false;
+        }
+
+        pushPayload(data + headerSize, frameSize - headerSize, timestamp);
+        if (timestamp >= 0) {
+            timestamp += TimestampEngine::rescale(1024, 90000, m_config.sampleRate);
+        }
+        data += frameSize;
+    }
+
+    return true;
+}
+
+void AudioTrack::pushPayload(const uint8_t* data, size_t size, int64_t timestamp)
+{
+    Pending frame;
+    if (!m_freeBuffers.empty()) {
+        frame.data.swap(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+    }
+    frame.data.assign(data, data + size);
+    frame.timestamp = timestamp;
+    frame.clock = TimestampEngine::rescale(static_cast<int64_t>(m_clockSamples), 90000, m_config.sampleRate);
+    frame.samples = samplesPerFrame(size);
+    m_clockSamples += frame.samples;
+    m_pending.push_back(std::move(frame));
+
+    // 视频长时间没有到达时只保留最近的音频
+    while (m_pending.size() > 1 && frameTime(m_pending.back()) - frameTime(m_pending.front()) > MAX_PENDING_TICKS) {
+        m_freeBuffers.push_back(std::move(m_pending.front().data));
+        m_pending.pop_front();
+        m_framesDropped++;
+    }
+}
+
+bool AudioTrack::flush(GF_ISOFile* file, int trackId, bool fragmented, int64_t fileBase, int64_t until)
+{
+    while (!m_pending.empty()) {
+        Pending& frame = m_pending.front();
+        int64_t time = frameTime(frame);
+        if (time > until) {
+            break;
+        }
+
+        // 文件内时间：第一帧按与视频的时间差对齐，之后按采样数连续累加
+        int64_t target = TimestampEngine::rescale(time - fileBase, m_config.sampleRate, 90000);
+        bool drop = false;
+        if (!m_fileStarted) {
+            if (target < 0) {
+                // 早于文件中第一个视频帧
+                drop = true;
+            } else {
+                m_fileDTS = static_cast<uint64_t>(target);
+                m_fileStarted = true;
+            }
+        } else if (target > static_cast<int64_t>(m_fileDTS + m_config.sampleRate * RESYNC_SECONDS)) {
+            // 音频中断后重新对齐（只向后跳，DTS不回退）
+            m_fileDTS = static_cast<uint64_t>(target);
+        }
+
+        if (!drop) {
+            GF_ISOSample sample;
+            memset(&sample, 0, sizeof(GF_ISOSample));
+            sample.data = reinterpret_cast<char*>(frame.data.data());
+            sample.dataLength = static_cast<u32>(frame.data.size());
+            sample.DTS = m_fileDTS;
+            sample.IsRAP = RAP;
+
+            GF_Err err;
+            if (fragmented) {
+                // 分段中的第一个样本同时设置tfdt
+                if (m_markDecodeTime) {
+                    gf_isom_set_traf_base_media_decode_time(file, trackId, sample.DTS);
+                    m_markDecodeTime = false;
+                }
+                err = gf_isom_fragment_add_sample(file, trackId, &sample, 1, frame.samples, 0, 0, GF_FALSE);
+            } else {
+                err = gf_isom_add_sample(file, trackId, 1, &sample);
+            }
+            if (err != GF_OK) {
+                std::cerr << "Failed to add audio sample: " << gf_error_to_string(err) << std::endl;
+                return false;
+            }
+
+            m_fileDTS += frame.samples;
+            m_framesWritten++;
+        } else {
+            m_framesDropped++;
+        }
+
+        m_freeBuffers.push_back(std::move(frame.data));
+        m_pending.pop_front();
+    }
+
+    return true;
+}
+
+int64_t AudioTrack::newestTime() const
+{
+    return m_pending.empty() ? -1 : frameTime(m_pending.back());
+}
+
+void AudioTrack::reset()
+{
+    while (!m_pending.empty()) {
+        m_freeBuffers.push_back(std::move(m_pending.front().data));
+        m_pending.pop_front();
+    }
+    m_clockSamples = 0;
+    m_fileStarted = false;
+    m_fileDTS = 0;
+    m_markDecodeTime = false;
+    m_framesWritten = 0;
+    m_framesDropped = 0;
+}
+
+uint32_t AudioTrack::samplesPerFrame(size_t payloadSize) const
+{
+    switch (m_config.codec) {
+    case CODEC_AAC:
+        return 1024;
+    case CODEC_PCM:
+        return static_cast<uint32_t>(payloadSize / (m_config.channels * (m_config.bitsPerSample / 8)));
+    default:
+        // G.711每个采样1字节
+        return static_cast<uint32_t>(payloadSize / m_config.channels);
+    }
+}
+
+int64_t AudioTrack::frameTime(const Pending& frame) const
+{
+    return (m_useTimestamps && frame.timestamp >= 0) ? frame.timestamp : frame.clock;
+}
@@ -0,0 +1,137 @@
+#ifndef AUDIO_TRACK_H
+#define AUDIO_TRACK_H
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+#include "gpac/isomedia.h"
+
+/**
+ * AudioTrack - 音频轨道的样本描述、时间计算和交织缓冲
+ *
+ * 支持G.711 A律/μ律、16位小端PCM和AAC（ADTS或裸帧）。音频帧先进入
+ * 交织缓冲，由视频写入时按时间顺序取出写入同一mdat，普通MP4中音视频
+ * 样本按时间交替排列，顺序读取即可播放，无需来回寻址。
+ *
+ * 文件内音频时间按采样数连续累加，只在调用方时间戳跳变超过1秒时重新对齐。
+ */
+class AudioTrack {
+public:
+    // 音频编码类型
+    enum Codec {
+        CODEC_G711A = 0,    // G.711 A律
+        CODEC_G711U,        // G.711 μ律
+        CODEC_PCM,          // 线性PCM（小端）
+        CODEC_AAC           // AAC-LC（ADTS或裸帧）
+    };
+
+    // 音频参数
+    struct Config {
+        Codec codec;
+        uint32_t sampleRate;        // 采样率
+        uint32_t channels;          // 声道数
+        uint32_t bitsPerSample;     // 采样位数（仅PCM，8或16）
+
+        Config() : codec(CODEC_G711A), sampleRate(8000), channels(1), bitsPerSample(16) {}
+    };
+
+    explicit AudioTrack(const Config& config);
+
+    /**
+     * 检查音频参数是否有效
+     *
+     * @param config 音频参数
+     * @return 是否有效
+     */
+    static bool isValid(const Config& config);
+
+    const Config& config() const { return m_config; }
+
+    /**
+     * 在文件中创建音频轨道
+     *
+     * @param file 目标文件
+     * @param fragmented 是否为分片文件（同时设置轨道分片默认值）
+     * @param trackId 输出轨道ID
+     * @return 是否成功
+     */
+    bool createTrack(GF_ISOFile* file, bool fragmented, int& trackId) const;
+
+    /**
+     * 缓冲一个音频帧（AAC会去除ADTS头，一帧中有多个ADTS帧时拆开）
+     *
+     * @param data 帧数据
+     * @param size 数据大小
+     * @param timestamp 时间戳（90kHz，负数表示未提供）
+     * @return 是否已缓冲
+     */
+    bool push(const uint8_t* data, size_t size, int64_t timestamp);
+
+    /**
+     * 写入时间不晚于until的缓冲帧
+     *
+     * @param file 目标文件
+     * @param trackId 音频轨道ID
+     * @param fragmented 是否写入当前分片
+     * @param fileBase 文件起始时间（90kHz，与视频第一帧DTS相同）
+     * @param until 截止时间（90kHz）
+     * @return 是否成功
+     */
+    bool flush(GF_ISOFile* file, int trackId, bool fragmented, int64_t fileBase, int64_t until);
+
+    /**
+     * 选择时间来源：调用方时间戳（与视频同一时钟）或按采样数计算的时间
+     *
+     * @param useTimestamps 视频帧是否带有时间戳
+     */
+    void setUseTimestamps(bool useTimestamps) { m_useTimestamps = useTimestamps; }
+
+    // 最新缓冲帧的时间（90kHz，没有缓冲帧时为-1）
+    int64_t newestTime() const;
+
+    // 新分段开始：下一个写入的样本同时设置分段的tfdt
+    void markFragmentStart() { m_markDecodeTime = true; }
+
+    // 开始写入新文件（文件内时间重新对齐）
+    void resetFile() { m_fileStarted = false; m_markDecodeTime = false; }
+
+    // 开始新的录制（清空缓冲和采样时钟）
+    void reset();
+
+    // 统计
+    uint64_t framesWritten() const { return m_framesWritten; }
+    uint64_t framesDropped() const { return m_framesDropped; }
+
+private:
+    // 一帧包含的采样数
+    uint32_t samplesPerFrame(size_t payloadSize) const;
+
+    // 缓冲一个去除封装后的帧
+    void pushPayload(const uint8_t* data, size_t size, int64_t timestamp);
+
+    struct Pending {
+        std::vector<uint8_t> data;  // 帧数据（缓冲区复用）
+        int64_t timestamp;          // 调用方时间戳（90kHz，负数表示未提供）
+        int64_t clock;              // 按采样数计算的时间（90kHz）
+        uint32_t samples;           // 采样数
+    };
+
+    // 按当前时间来源取帧时间
+    int64_t frameTime(const Pending& frame) const;
+
+private:
+    Config m_config;
+    std::deque<Pending> m_pending;                  // 等待交织写入的帧
+    std::vector<std::vector<uint8_t>> m_freeBuffers;// 已写入帧的缓冲区，供复用
+    bool m_useTimestamps;
+    uint64_t m_clockSamples;        // 本次录制已缓冲的采样数
+    bool m_fileStarted;             // 当前文件是否已写入音频
+    uint64_t m_fileDTS;             // 当前文件下一个音频样本的DTS（采样率单位）
+    bool m_markDecodeTime;          // 下一个样本是否为分段中的第一个
+    uint64_t m_framesWritten;
+    uint64_t m_framesDropped;
+};
+
+#endif // AUDIO_TRACK_H
@@ -0,0 +1,40 @@
+#include "CodecTraits.h"
+
+namespace {
+const uint8_t VCL = NAL_VCL;
+const uint8_t VCL_NONREF = NAL_VCL | NAL_SUBLAYER_NONREF;
+const uint8_t VCL_RAP = NAL_VCL | NAL_RAP;
+}
+
+constexpr size_t H264Traits::NAL_HEADER_SIZE;
+constexpr size_t H264Traits::NAL_TYPE_COUNT;
+constexpr int H264Traits::POC_STEP;
+constexpr unsigned H264Traits::REQUIRED_PARAM_SETS;
+
+constexpr size_t H265Traits::NAL_HEADER_SIZE;
+constexpr size_t H265Traits::NAL_TYPE_COUNT;
+constexpr int H265Traits::POC_STEP;
+constexpr unsigned H265Traits::REQUIRED_PARAM_SETS;
+
+const uint8_t H264Traits::NAL_INFO[H264Traits::NAL_TYPE_COUNT] = {
+    // 0 未定义，1 非IDR条带，2~4 数据分区A/B/C，5 IDR条带，6 SEI，7 SPS
+    0, VCL, VCL, VCL, VCL, VCL_RAP, 0, nalParamSet(PARAM_SET_SPS),
+    // 8 PPS，9 AUD，10~12 序列/码流结束、填充
+    nalParamSet(PARAM_SET_PPS), 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0
+};
+
+const uint8_t H265Traits::NAL_INFO[H265Traits::NAL_TYPE_COUNT] = {
+    // 0~15 TRAIL/TSA/STSA/RADL/RASL及保留类型，偶数为子层非参考
+    VCL_NONREF, VCL, VCL_NONREF, VCL, VCL_NONREF, VCL, VCL_NONREF, VCL,
+    VCL_NONREF, VCL, VCL_NONREF, VCL, VCL_NONREF, VCL, VCL_NONREF, VCL,
+    // 16~21 BLA/IDR/CRA，22~23 保留IRAP，24~31 保留VCL
+    VCL_RAP, VCL_RAP, VCL_RAP, VCL_RAP, VCL_RAP, VCL_RAP, VCL, VCL,
+    VCL, VCL, VCL, VCL, VCL, VCL, VCL, VCL,
+    // 32 VPS，33 SPS，34 PPS，35 AUD，39~40 SEI
+    nalParamSet(PARAM_SET_VPS), nalParamSet(PARAM_SET_SPS), nalParamSet(PARAM_SET_PPS), 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0
+};
@@ -0,0 +1,91 @@
+#ifndef CODEC_TRAITS_H
+#define CODEC_TRAITS_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * CodecTraits - 各编码的NALU规则（编译期常量）
+ *
+ * 每种编码一个traits类：NALU头长度、类型字段的取法、参数集类型，以及
+ * 按NALU类型索引的属性表。NALU处理循环以traits为模板参数实例化，
+ * 检测到编码类型后每路码流只选择一次，循环内部不再判断编码。
+ * 增加新编码（如H.266）只需增加一个traits类和它的属性表。
+ */
+
+// NALU属性表的标志
+enum NalFlag {
+    NAL_VCL = 0x01,             // 图像数据
+    NAL_RAP = 0x02,             // 随机访问点（H264的IDR，H265的IRAP）
+    NAL_SUBLAYER_NONREF = 0x04, // 子层非参考图像
+    NAL_PARAM_SET = 0x08        // 参数集，槽位+1保存在bit4~5
+};
+
+// 参数集槽位（同时是带内参数集的写入顺序）
+enum ParamSetSlot {
+    PARAM_SET_VPS = 0,
+    PARAM_SET_SPS,
+    PARAM_SET_PPS,
+    PARAM_SET_SLOTS
+};
+
+// 参数集在属性表中的取值
+constexpr uint8_t nalParamSet(int slot)
+{
+    return static_cast<uint8_t>(NAL_PARAM_SET | ((slot + 1) << 4));
+}
+
+/**
+ * 按属性表实现的通用判断，Codec为具体的traits类
+ */
+template <typename Codec>
+struct NalTraitsBase {
+    static uint8_t info(uint8_t header) { return Codec::NAL_INFO[Codec::nalType(header)]; }
+
+    static bool isVCL(uint8_t header) { return (info(header) & NAL_VCL) != 0; }
+    static bool isRAP(uint8_t header) { return (info(header) & NAL_RAP) != 0; }
+    static bool isParameterSet(uint8_t header) { return (info(header) & NAL_PARAM_SET) != 0; }
+
+    // 参数集槽位，不是参数集时返回-1
+    static int paramSetSlot(uint8_t header) { return ((info(header) >> 4) & 0x3) - 1; }
+};
+
+struct H264Traits : NalTraitsBase<H264Traits> {
+    enum { SPS = 7, PPS = 8, IDR = 5 };
+
+    static constexpr size_t NAL_HEADER_SIZE = 1;
+    static constexpr size_t NAL_TYPE_COUNT = 32;
+    static constexpr int POC_STEP = 2;          // 相邻帧的POC差
+    static constexpr unsigned REQUIRED_PARAM_SETS = (1u << PARAM_SET_SPS) | (1u << PARAM_SET_PPS);
+
+    static const uint8_t NAL_INFO[NAL_TYPE_COUNT];
+
+    static const char* name() { return "H264"; }
+    static constexpr uint8_t nalType(uint8_t header) { return header & 0x1F; }
+
+    // nal_ref_idc为0表示非参考帧
+    static bool isReference(uint8_t header) { return (header & 0x60) != 0; }
+};
+
+struct H265Traits : NalTraitsBase<H265Traits> {
+    enum { VPS = 32, SPS = 33, PPS = 34 };
+
+    static constexpr size_t NAL_HEADER_SIZE = 2;
+    static constexpr size_t NAL_TYPE_COUNT = 64;
+    static constexpr int POC_STEP = 1;
+    static constexpr unsigned REQUIRED_PARAM_SETS =
+        (1u << PARAM_SET_VPS) | (1u << PARAM_SET_SPS) | (1u << PARAM_SET_PPS);
+
+    static const uint8_t NAL_INFO[NAL_TYPE_COUNT];
+
+    static const char* name() { return "H265"; }
+    static constexpr uint8_t nalType(uint8_t header) { return (header & 0x7E) >> 1; }
+
+    // 类型0~14中的偶数为子层非参考图像
+    static bool isReference(uint8_t header) { return (info(header) & NAL_SUBLAYER_NONREF) == 0; }
+
+    // 是否为VPS（只有H265有VPS，用于自动检测编码类型）
+    static bool isVPS(uint8_t header) { return nalType(header) == VPS; }
+};
+
+#endif // CODEC_TRAITS_H
@@ -0,0 +1,139 @@
+#include "DashPackager.h"
+#include <gpac/tools.h>
+#include <gpac/media_tools.h>
+#include <chrono>
+#include <iostream>
+#include <cstring>
+
+namespace {
+
+// GPAC的进度回调是进程级的，按调用线程转发给当前任务
+thread_local const DashPackager::ProgressCallback* t_onProgress = nullptr;
+
+void onGpacProgress(const void* /*cbk*/, const char* /*title*/, u64 done, u64 total)
+{
+    if (t_onProgress && *t_onProgress && total > 0) {
+        (*t_onProgress)(done >= total ? 1.0 : static_cast<double>(done) / total);
+    }
+}
+
+} // namespace
+
+DashPackager::Job::Job(const std::string& mp4Path, const std::string& mpdPath)
+    : m_mp4Path(mp4Path)
+    , m_mpdPath(mpdPath)
+    , m_state(STATE_PENDING)
+    , m_progress(0.0)
+    , m_elapsedMs(0)
+{
+}
+
+bool DashPackager::Job::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return m_state == STATE_DONE || m_state == STATE_FAILED; });
+    return m_state == STATE_DONE;
+}
+
+void DashPackager::Job::finish(bool success, uint64_t elapsedMs)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_elapsedMs = elapsedMs;
+        if (success) {
+            m_progress = 1.0;
+        }
+        m_state = success ? STATE_DONE : STATE_FAILED;
+    }
+    m_cond.notify_all();
+}
+
+DashPackager::DashPackager(size_t threadCount)
+    : m_pool(new WorkerPool(threadCount == 0 ? 1 : threadCount))
+{
+}
+
+DashPackager::~DashPackager()
+{
+    // WorkerPool析构时执行完队列中剩余的任务
+    m_pool.reset();
+}
+
+bool DashPackager::package(const std::string& mp4Path, const std::string& mpdPath, const Options& options,
+                           const ProgressCallback& onProgress)
+{
+    if (options.segmentDuration <= 0) {
+        std::cerr << "Invalid DASH segment duration" << std::endl;
+        return false;
+    }
+
+    GF_DASHSegmenter* dasher = gf_dasher_new(mpdPath.c_str(), GF_DASH_PROFILE_FULL, NULL, 1000, NULL);
+    if (!dasher) {
+        std::cerr << "Failed to create DASH segmenter" << std::endl;
+        return false;
+    }
+
+    double fragmentDuration = (options.fragmentDuration > 0) ? options.fragmentDuration : options.segmentDuration;
+    GF_Err err = gf_dasher_set_durations(dasher, options.segmentDuration, GF_FALSE, fragmentDuration);
+    if (err == GF_OK) {
+        err = gf_dasher_enable_rap_splitting(dasher, options.segmentsStartWithRAP ? GF_TRUE : GF_FALSE, GF_FALSE);
+    }
+    if (err == GF_OK) {
+        // 与-segment-name相同：不使用URL模板，按前缀命名分段文件
+        err = gf_dasher_enable_url_template(dasher, GF_FALSE, options.segmentName.c_str(), NULL);
+    }
+    if (err == GF_OK) {
+        GF_DashSegmenterInput input;
+        memset(&input, 0, sizeof(input));
+        input.file_name = const_cast<char*>(mp4Path.c_str());
+        err = gf_dasher_add_input(dasher, &input);
+    }
+
+    if (err == GF_OK) {
+        t_onProgress = &onProgress;
+        gf_set_progress_callback(NULL, onGpacProgress);
+        err = gf_dasher_process(dasher, 0);
+        t_onProgress = nullptr;
+    }
+
+    gf_dasher_del(dasher);
+
+    if (err != GF_OK) {
+        std::cerr << "Failed to segment MP4 file " << mp4Path << ": " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<DashPackager::Job> DashPackager::submit(const std::string& mp4Path, const std::string& mpdPath,
+                                                        const Options& options, const ProgressCallback& onProgress,
+                                                        const DoneCallback& onDone)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>(mp4Path, mpdPath);
+
+    m_pool->submit([job, options, onProgress, onDone]() {
+        job->m_state = STATE_RUNNING;
+        auto start = std::chrono::steady_clock::now();
+
+        // 先更新任务进度，再转发给调用方
+        ProgressCallback progress = [&job, &onProgress](double value) {
+            job->m_progress = value;
+            if (onProgress) {
+                onProgress(value);
+            }
+        };
+        bool success = package(job->mp4Path(), job->mpdPath(), options, progress);
+
+        uint64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        // 完成回调先于唤醒等待者，wait返回时回调已执行完
+        if (onDone) {
+            onDone(success);
+        }
+        job->finish(success, elapsedMs);
+    });
+
+    return job;
+}
@@ -0,0 +1,124 @@
+#ifndef DASH_PACKAGER_H
+#define DASH_PACKAGER_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+#include "WorkerPool.h"
+
+/**
+ * DashPackager - 进程内的DASH分段（替代调用MP4Box命令行）
+ *
+ * 直接调用libgpac的gf_dasher_*接口，参数与原先的
+ * "MP4Box -dash D -frag D -rap -segment-name segment_"一致；
+ * 可以同步执行，也可以提交到后台工作线程并查询进度。
+ */
+class DashPackager {
+public:
+    // 分段参数
+    struct Options {
+        float segmentDuration;      // 分段时长（秒）
+        float fragmentDuration;     // 分片时长（秒），0表示与分段时长相同
+        bool segmentsStartWithRAP;  // 分段从随机访问点开始
+        std::string segmentName;    // 分段文件名前缀
+
+        Options()
+            : segmentDuration(4.0f), fragmentDuration(0.0f), segmentsStartWithRAP(true), segmentName("segment_") {}
+    };
+
+    // 任务状态
+    enum State {
+        STATE_PENDING = 0,  // 排队中
+        STATE_RUNNING,      // 分段中
+        STATE_DONE,         // 完成
+        STATE_FAILED        // 失败
+    };
+
+    // 进度回调（0.0~1.0，在工作线程中调用）
+    typedef std::function<void(double progress)> ProgressCallback;
+
+    // 完成回调（在工作线程中调用）
+    typedef std::function<void(bool success)> DoneCallback;
+
+    // 后台分段任务
+    class Job {
+    public:
+        Job(const std::string& mp4Path, const std::string& mpdPath);
+
+        const std::string& mp4Path() const { return m_mp4Path; }
+        const std::string& mpdPath() const { return m_mpdPath; }
+        State state() const { return static_cast<State>(m_state.load()); }
+        double progress() const { return m_progress.load(); }
+
+        // 分段耗时（毫秒，完成前为0）
+        uint64_t elapsedMs() const { return m_elapsedMs.load(); }
+
+        /**
+         * 等待任务结束
+         *
+         * @return 是否成功
+         */
+        bool wait();
+
+    private:
+        friend class DashPackager;
+
+        // 更新状态并唤醒等待者
+        void finish(bool success, uint64_t elapsedMs);
+
+        std::string m_mp4Path;
+        std::string m_mpdPath;
+        std::atomic<int> m_state;
+        std::atomic<double> m_progress;
+        std::atomic<uint64_t> m_elapsedMs;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param threadCount 后台分段线程数（分段以磁盘IO为主，默认1个）
+     */
+    explicit DashPackager(size_t threadCount = 1);
+
+    // 等待已提交的任务全部完成
+    ~DashPackager();
+
+    /**
+     * 在当前线程中完成分段
+     *
+     * @param mp4Path 源MP4文件
+     * @param mpdPath 输出MPD文件（分段写入同一目录）
+     * @param options 分段参数
+     * @param onProgress 进度回调（可为空）
+     * @return 是否成功
+     */
+    static bool package(const std::string& mp4Path, const std::string& mpdPath, const Options& options,
+                        const ProgressCallback& onProgress = ProgressCallback());
+
+    /**
+     * 提交后台分段任务
+     *
+     * @param mp4Path 源MP4文件
+     * @param mpdPath 输出MPD文件
+     * @param options 分段参数
+     * @param onProgress 进度回调（可为空）
+     * @param onDone 完成回调（可为空）
+     * @return 任务句柄，可查询状态、进度或等待完成
+     */
+    std::shared_ptr<Job> submit(const std::string& mp4Path, const std::string& mpdPath, const Options& options,
+                                const ProgressCallback& onProgress = ProgressCallback(),
+                                const DoneCallback& onDone = DoneCallback());
+
+private:
+    std::unique_ptr<WorkerPool> m_pool;
+};
+
+#endif // DASH_PACKAGER_H
@@ -1,11 +1,16 @@
 #include "DashServer.h"
+#include "GpacRuntime.h"
 
 #include <chrono>
+#include <ctime>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -22,22 +27,115 @@
 
 // 定义HTTP响应头
 const char* HTTP_200_OK = "HTTP/1.1 200 OK\r\n";
+const char* HTTP_206_PARTIAL_CONTENT = "HTTP/1.1 206 Partial Content\r\n";
 const char* HTTP_404_NOT_FOUND = "HTTP/1.1 404 Not Found\r\n";
+const char* HTTP_416_RANGE_NOT_SATISFIABLE = "HTTP/1.1 416 Range Not Satisfiable\r\n";
 const char* HTTP_500_ERROR = "HTTP/1.1 500 Internal Server Error\r\n";
+const char* HTTP_503_UNAVAILABLE = "HTTP/1.1 503 Service Unavailable\r\n";
 const char* CONTENT_TYPE_MPD = "Content-Type: application/dash+xml\r\n";
 const char* CONTENT_TYPE_MP4 = "Content-Type: video/mp4\r\n";
 const char* CONTENT_TYPE_HTML = "Content-Type: text/html\r\n";
+const char* CONTENT_TYPE_TEXT = "Content-Type: text/plain\r\n";
 const char* CORS_HEADER = "Access-Control-Allow-Origin: *\r\n";
+const char* NO_CACHE_HEADER = "Cache-Control: no-cache\r\n";
+const char* ACCEPT_RANGES_HEADER = "Accept-Ranges: bytes\r\n";
+const char* CHUNKED_HEADER = "Transfer-Encoding: chunked\r\n";
+const char* CONNECTION_CLOSE_HEADER = "Connection: close\r\n";
+const char* CONNECTION_KEEP_ALIVE_HEADER = "Connection: keep-alive\r\n";
+
+// 监听队列长度
+const int LISTEN_BACKLOG = 1024;
+
+// 直播分段：等待分段出现或数据增长的最长时间，以及轮询间隔（毫秒）
+const int LIVE_SEGMENT_WAIT_MS = 5000;
+const int LIVE_SEGMENT_POLL_MS = 5;
+
+// 发送的文件不被子进程继承
+#ifdef O_CLOEXEC
+const int OPEN_FLAGS = O_RDONLY | O_CLOEXEC;
+#else
+const int OPEN_FLAGS = O_RDONLY;
+#endif
+
+// 响应后是否保持连接由HttpReactor根据请求决定
+static const char* connectionHeader(const HttpExchange& exchange) {
+    return exchange.keepAlive() ? CONNECTION_KEEP_ALIVE_HEADER : CONNECTION_CLOSE_HEADER;
+}
 
-DashServer::DashServer() : m_running(false), m_serverSocket(-1), m_port(8080), m_segmentDuration(4.0f) {
-    // 初始化GPAC
-    gf_sys_init(GF_MemTrackerNone);
+// 生成响应头
+static std::string responseHeader(const HttpExchange& exchange, const char* status, const char* contentType, const char* extraHeaders,
+                                  uint64_t contentLength) {
+    std::ostringstream header;
+    header << status;
+    header << contentType;
+    header << CORS_HEADER;
+    header << extraHeaders;
+    header << connectionHeader(exchange);
+    header << "Content-Length: " << contentLength << "\r\n";
+    header << "\r\n";
+    return header.str();
+}
+
+// 流式响应头：HTTP/1.1用chunked编码；HTTP/1.0不支持chunked，正文以关闭连接表示结束
+static std::string streamingHeader(HttpExchange& exchange) {
+    if (!exchange.chunkedAllowed()) {
+        exchange.closeAfterResponse();
+    }
+    std::ostringstream header;
+    header << HTTP_200_OK << CONTENT_TYPE_MP4 << CORS_HEADER << NO_CACHE_HEADER
+           << (exchange.chunkedAllowed() ? CHUNKED_HEADER : "") << connectionHeader(exchange) << "\r\n";
+    return header.str();
+}
+
+// Content-Range响应头
+static std::string contentRangeHeader(const HttpRange::Span& span, uint64_t size) {
+    std::ostringstream header;
+    header << "Content-Range: bytes " << span.first << "-" << (span.first + span.length - 1) << "/" << size << "\r\n";
+    return header.str();
+}
+
+// 多部分响应的分隔符（不与正文内容冲突即可，每个响应不同）
+static std::string multipartBoundary() {
+    static std::atomic<uint64_t> counter(0);
+    uint64_t value = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) * 31 + ++counter;
+    char boundary[24];
+    snprintf(boundary, sizeof(boundary), "%016llx", static_cast<unsigned long long>(value));
+    return boundary;
+}
+
+// 文件直播分段的发送进度（在文件线程池中逐步推进，同一时刻只有一个任务访问）
+struct DashServer::LiveSegment {
+    std::string streamName;
+    std::string segmentPath;
+    std::string partPath;
+    std::string range;                  // Range请求头（只用于已完成的分段）
+    std::shared_ptr<HttpFile> file;     // 写入中的.part（改名后仍指向同一文件）
+    uint64_t offset = 0;                // 已发送的长度
+    bool finished = false;              // .part已改名，发完剩余数据即结束
+    std::chrono::steady_clock::time_point deadline;     // 等待分段出现的截止时间
+    std::chrono::steady_clock::time_point lastData;     // 最近一次有新数据的时间
+};
+
+// 内存直播分段的发送进度（在I/O线程中逐步推进）
+struct DashServer::MemorySegment {
+    std::shared_ptr<MemorySink> sink;
+    std::string fileName;
+    size_t offset = 0;              // 已发送的长度
+    bool chunked = false;
+    std::chrono::steady_clock::time_point lastData;     // 请求开始或最近一次拿到数据的时间
+};
+
+DashServer::DashServer() : m_running(false), m_serverSocket(-1), m_port(8080), m_segmentDuration(4.0f),
+                           m_ioThreads(2), m_fileThreads(4), m_segmentCache(new SegmentCache()), m_packager(new DashPackager()) {
+    // 初始化GPAC（与H264MP4Writer共享进程内引用计数）
+    GpacRuntime::acquire();
 }
 
 DashServer::~DashServer() {
     stop();
-    // 清理GPAC
-    gf_sys_close();
+    // 等待后台分段结束后再清理GPAC
+    m_packager.reset();
+    GpacRuntime::release();
 }
 
     // 初始化服务器
@@ -85,26 +183,130 @@ DashServer::~DashServer() {
         system(("mkdir -p \"" + streamDir + "\"").c_str());
 #endif
 
-        // 使用GPAC的MP4Box工具进行DASH分段
-        std::string cmd = "MP4Box -dash " + std::to_string((int)(m_segmentDuration * 1000)) +
-                         " -frag " + std::to_string((int)(m_segmentDuration * 1000)) +
-                         " -rap -segment-name segment_ -out \"" + streamDir + "/manifest.mpd\" \"" +
-                         mp4FilePath + "\"";
+        std::lock_guard<std::mutex> lock(m_streamsMutex);
+        auto it = m_jobs.find(streamName);
+        if (it != m_jobs.end() && (it->second->state() == DashPackager::STATE_PENDING ||
+                                   it->second->state() == DashPackager::STATE_RUNNING)) {
+            std::cerr << "流正在分段: " << streamName << std::endl;
+            return false;
+        }
+
+        // 进程内DASH分段，在后台线程中执行，完成后加入流列表
+        DashPackager::Options options;
+        options.segmentDuration = m_segmentDuration;
+        m_jobs[streamName] = m_packager->submit(mp4FilePath, streamDir + "/manifest.mpd", options,
+            DashPackager::ProgressCallback(),
+            [this, mp4FilePath, streamName](bool success) {
+                if (!success) {
+                    std::cerr << "分段MP4文件失败: " << mp4FilePath << std::endl;
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(m_streamsMutex);
+                m_streams[streamName] = mp4FilePath;
+            });
 
-        std::cout << "执行命令: " << cmd << std::endl;
-        int result = system(cmd.c_str());
-        if (result != 0) {
-            std::cerr << "分段MP4文件失败: " << mp4FilePath << std::endl;
+        return true;
+    }
+
+    // 添加直播流
+    bool DashServer::addLiveStream(const std::string& streamName, const std::string& mpdName) {
+        if (streamName.empty() || mpdName.empty()) {
+            std::cerr << "无效的直播流参数" << std::endl;
             return false;
         }
 
-        // 添加到流列表
+        // 创建流输出目录（写入端也会创建）
+        std::string streamDir = m_outputDir + "/" + streamName;
+#ifdef _WIN32
+        system(("mkdir \"" + streamDir + "\" 2>nul").c_str());
+#else
+        system(("mkdir -p \"" + streamDir + "\"").c_str());
+#endif
+
         std::lock_guard<std::mutex> lock(m_streamsMutex);
-        m_streams[streamName] = mp4FilePath;
+        if (m_streams.find(streamName) != m_streams.end() || m_jobs.find(streamName) != m_jobs.end()) {
+            std::cerr << "流名称已存在: " << streamName << std::endl;
+            return false;
+        }
+        m_liveStreams[streamName] = mpdName;
+
+        return true;
+    }
+
+    // 添加内存直播流
+    bool DashServer::addLiveStream(const std::string& streamName, const std::shared_ptr<MemorySink>& sink,
+                                   const std::string& mpdName) {
+        if (streamName.empty() || mpdName.empty() || !sink) {
+            std::cerr << "无效的直播流参数" << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_streamsMutex);
+        if (m_streams.find(streamName) != m_streams.end() || m_jobs.find(streamName) != m_jobs.end() ||
+            m_liveStreams.find(streamName) != m_liveStreams.end()) {
+            std::cerr << "流名称已存在: " << streamName << std::endl;
+            return false;
+        }
+        m_liveStreams[streamName] = mpdName;
+        m_memoryStreams[streamName] = sink;
 
         return true;
     }
 
+    // 获取流的分段进度
+    double DashServer::getPackagingProgress(const std::string& streamName) {
+        std::lock_guard<std::mutex> lock(m_streamsMutex);
+        if (m_streams.find(streamName) != m_streams.end()) {
+            return 1.0;
+        }
+        auto it = m_jobs.find(streamName);
+        if (it == m_jobs.end() || it->second->state() == DashPackager::STATE_FAILED) {
+            return -1.0;
+        }
+        // 完成回调执行前进度可能已到1.0，此时流还不可访问
+        return std::min(it->second->progress(), 0.99);
+    }
+
+    // 等待流分段完成
+    bool DashServer::waitForStream(const std::string& streamName) {
+        std::shared_ptr<DashPackager::Job> job;
+        {
+            std::lock_guard<std::mutex> lock(m_streamsMutex);
+            auto it = m_jobs.find(streamName);
+            if (it == m_jobs.end()) {
+                return m_streams.find(streamName) != m_streams.end();
+            }
+            job = it->second;
+        }
+        return job->wait();
+    }
+
+    // 设置线程数
+    void DashServer::setThreadCounts(size_t ioThreads, size_t fileThreads) {
+        if (m_running) {
+            std::cerr << "服务器运行中，线程数在下次启动时生效" << std::endl;
+        }
+        m_ioThreads = ioThreads > 0 ? ioThreads : 1;
+        m_fileThreads = fileThreads > 0 ? fileThreads : 1;
+    }
+
+    // 设置分段缓存的容量
+    void DashServer::setCacheLimits(size_t capacityBytes, size_t streamQuotaBytes) {
+        if (m_running) {
+            std::cerr << "服务器运行中，无法修改分段缓存容量" << std::endl;
+            return;
+        }
+        SegmentCache::Config config;
+        config.capacity = capacityBytes;
+        config.streamQuota = streamQuotaBytes;
+        m_segmentCache.reset(new SegmentCache(config));
+    }
+
+    // 获取分段缓存统计
+    SegmentCache::Stats DashServer::getCacheStats() const {
+        return m_segmentCache->stats();
+    }
+
     // 启动服务器
     bool DashServer::start() {
         if (m_running) {
@@ -166,8 +368,8 @@ DashServer::~DashServer() {
             return false;
         }
 
-        // 监听连接
-        if (listen(m_serverSocket, 10) < 0) {
+        // 监听连接（大量播放器同时请求时队列不能太短，实际长度受somaxconn限制）
+        if (listen(m_serverSocket, LISTEN_BACKLOG) < 0) {
             std::cerr << "监听套接字失败" << std::endl;
 #ifdef _WIN32
             closesocket(m_serverSocket);
@@ -178,11 +380,34 @@ DashServer::~DashServer() {
             return false;
         }
 
-        // 启动服务器线程
+        // 读文件的线程池先于I/O线程启动，I/O线程中的请求会向它提交任务
+        // （请求之间相互独立，按到达顺序处理，避免排队时后到的请求插队拉高尾延迟）
         m_running = true;
-        m_serverThread = std::thread(&DashServer::serverLoop, this);
+        m_filePool.reset(new WorkerPool(m_fileThreads, WorkerPool::ORDER_FIFO));
+        m_reactor.reset(new HttpReactor());
+
+        HttpReactor::Config config;
+        config.ioThreads = m_ioThreads;
+        if (!m_reactor->start(m_serverSocket,
+                              [this](const HttpRequest& request, const std::shared_ptr<HttpExchange>& exchange) {
+                                  handleClient(request, exchange);
+                              },
+                              config)) {
+            std::cerr << "启动I/O线程失败" << std::endl;
+            m_running = false;
+            m_reactor.reset();
+            m_filePool.reset();
+#ifdef _WIN32
+            closesocket(m_serverSocket);
+            WSACleanup();
+#else
+            close(m_serverSocket);
+#endif
+            return false;
+        }
 
-        std::cout << "DASH服务器已启动，监听端口: " << m_port << std::endl;
+        std::cout << "DASH服务器已启动，监听端口: " << m_port << "（I/O线程 " << m_ioThreads
+                  << "，文件线程 " << m_fileThreads << "）" << std::endl;
         std::cout << "访问地址: http://localhost:" << m_port << "/" << std::endl;
 
         return true;
@@ -196,6 +421,12 @@ DashServer::~DashServer() {
 
         m_running = false;
 
+        // 先停止I/O线程并关闭所有连接，再等待文件线程池中的任务结束
+        // （文件任务只向连接投递数据，不再提交新任务，之后不会再访问this）
+        m_reactor->stop();
+        m_reactor.reset();
+        m_filePool.reset();
+
         // 关闭服务器套接字
 #ifdef _WIN32
         closesocket(m_serverSocket);
@@ -204,110 +435,44 @@ DashServer::~DashServer() {
         close(m_serverSocket);
 #endif
 
-        // 等待服务器线程结束
-        if (m_serverThread.joinable()) {
-            m_serverThread.join();
-        }
-
         std::cout << "DASH服务器已停止" << std::endl;
     }
 
-
-    // 服务器主循环
-    void DashServer::serverLoop() {
-        while (m_running) {
-            // 接受连接
-            struct sockaddr_in clientAddr;
-            socklen_t clientAddrLen = sizeof(clientAddr);
-
-#ifdef _WIN32
-            SOCKET clientSocket = accept(m_serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
-            if (clientSocket == INVALID_SOCKET) {
-                if (m_running) {
-                    std::cerr << "接受连接失败: " << WSAGetLastError() << std::endl;
-                }
-                continue;
-            }
-#else
-            int clientSocket = accept(m_serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
-            if (clientSocket < 0) {
-                if (m_running) {
-                    std::cerr << "接受连接失败" << std::endl;
-                }
-                continue;
-            }
-#endif
-
-            // 创建客户端处理线程
-            std::thread clientThread(&DashServer::handleClient, this, clientSocket);
-            clientThread.detach();
-        }
-    }
-
     // 处理客户端请求
-    void DashServer::handleClient(int clientSocket) {
-        // 接收HTTP请求
-        char buffer[4096] = {0};
-        int bytesRead;
-
-#ifdef _WIN32
-        bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-#else
-        bytesRead = read(clientSocket, buffer, sizeof(buffer) - 1);
-#endif
-
-        if (bytesRead <= 0) {
-#ifdef _WIN32
-            closesocket(clientSocket);
-#else
-            close(clientSocket);
-#endif
-            return;
-        }
-
-        // 解析HTTP请求
-        std::string request(buffer);
-        std::string method, path, version;
-        std::istringstream requestStream(request);
-        requestStream >> method >> path >> version;
+    void DashServer::handleClient(const HttpRequest& request, const std::shared_ptr<HttpExchange>& exchange) {
+        const std::string& path = request.path;
+        std::string range = request.header("range");
 
         // 只处理GET请求
-        if (method != "GET") {
-            sendResponse(clientSocket, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1></body></html>");
-#ifdef _WIN32
-            closesocket(clientSocket);
-#else
-            close(clientSocket);
-#endif
+        if (request.method != "GET") {
+            sendResponse(exchange, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1></body></html>");
             return;
         }
 
         // 处理根路径请求
         if (path == "/") {
-            handleRootRequest(clientSocket);
+            handleRootRequest(exchange);
+        }
+        // 处理时钟同步请求
+        else if (path == "/time") {
+            handleTimeRequest(exchange);
         }
         // 处理MPD请求
         else if (path.find(".mpd") != std::string::npos) {
-            handleMPDRequest(clientSocket, path);
+            handleMPDRequest(exchange, path, range);
         }
         // 处理分段请求
         else if (path.find(".m4s") != std::string::npos || path.find(".mp4") != std::string::npos) {
-            handleSegmentRequest(clientSocket, path);
+            handleSegmentRequest(exchange, path, range);
         }
         // 处理未知请求
         else {
-            sendResponse(clientSocket, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1></body></html>");
+            sendResponse(exchange, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1></body></html>");
         }
-
-#ifdef _WIN32
-        closesocket(clientSocket);
-#else
-        close(clientSocket);
-#endif
     }
 
     // 处理根路径请求
-    void DashServer::handleRootRequest(int clientSocket) {
+    void DashServer::handleRootRequest(const std::shared_ptr<HttpExchange>& exchange) {
         // 生成可用流列表
         std::ostringstream html;
         html << "<!DOCTYPE html>\n"
@@ -332,6 +497,15 @@ DashServer::~DashServer() {
         for (const auto& stream : m_streams) {
             html << "<li><a href='/" << stream.first << "/manifest.mpd'>" << stream.first << "</a></li>\n";
         }
+        for (const auto& stream : m_liveStreams) {
+            html << "<li><a href='/" << stream.first << "/" << stream.second << "'>" << stream.first << "</a>（直播）</li>\n";
+        }
+        for (const auto& job : m_jobs) {
+            DashPackager::State state = job.second->state();
+            if (state == DashPackager::STATE_PENDING || state == DashPackager::STATE_RUNNING) {
+                html << "<li>" << job.first << "（分段中 " << (int)(job.second->progress() * 100) << "%）</li>\n";
+            }
+        }
 
         html << "</ul>\n"
              << "<div style='margin-top: 30px;'>\n"
@@ -345,11 +519,11 @@ DashServer::~DashServer() {
              << "</body>\n"
              << "</html>\n";
 
-        sendResponse(clientSocket, HTTP_200_OK, CONTENT_TYPE_HTML, html.str());
+        sendResponse(exchange, HTTP_200_OK, CONTENT_TYPE_HTML, html.str());
     }
 
     // 处理MPD请求
-    void DashServer::handleMPDRequest(int clientSocket, const std::string& path) {
+    void DashServer::handleMPDRequest(const std::shared_ptr<HttpExchange>& exchange, const std::string& path, const std::string& range) {
         // 解析路径，获取流名称
         std::string streamName;
         size_t pos = path.find('/');
@@ -357,34 +531,47 @@ DashServer::~DashServer() {
             streamName = path.substr(1, path.find('/', pos + 1) - 1);
         }
 
-        // 检查流是否存在
         std::lock_guard<std::mutex> lock(m_streamsMutex);
-        if (m_streams.find(streamName) == m_streams.end()) {
-            sendResponse(clientSocket, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Stream not found</p></body></html>");
-            return;
-        }
 
-        // MPD文件路径
-        std::string mpdPath = m_outputDir + "/" + streamName + "/manifest.mpd";
+        // 直播MPD由写入端原子替换，读取当前版本并禁止缓存（尚未开始直播时返回503）
+        auto live = m_liveStreams.find(streamName);
+        if (live != m_liveStreams.end()) {
+            auto memory = m_memoryStreams.find(streamName);
+            if (memory != m_memoryStreams.end()) {
+                std::string content;
+                bool complete = false;
+                if (!memory->second->read(live->second, 0, content, complete, 0)) {
+                    sendResponse(exchange, HTTP_503_UNAVAILABLE, CONTENT_TYPE_HTML, "<html><body><h1>503 Service Unavailable</h1><p>Live stream not started</p></body></html>");
+                    return;
+                }
+                sendResponse(exchange, HTTP_200_OK, CONTENT_TYPE_MPD, std::move(content), NO_CACHE_HEADER);
+                return;
+            }
 
-        // 读取MPD文件
-        std::ifstream file(mpdPath, std::ios::binary);
-        if (!file) {
-            sendResponse(clientSocket, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>MPD file not found</p></body></html>");
+            sendFile(exchange, m_outputDir + "/" + streamName + "/" + live->second, CONTENT_TYPE_MPD, NO_CACHE_HEADER,
+                     HTTP_503_UNAVAILABLE, "<html><body><h1>503 Service Unavailable</h1><p>Live stream not started</p></body></html>", range);
             return;
         }
 
-        // 读取文件内容
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string content = buffer.str();
+        // 检查流是否存在（仍在分段时返回503，播放器稍后重试）
+        if (m_streams.find(streamName) == m_streams.end()) {
+            auto it = m_jobs.find(streamName);
+            if (it != m_jobs.end() && it->second->state() != DashPackager::STATE_FAILED) {
+                sendResponse(exchange, HTTP_503_UNAVAILABLE, CONTENT_TYPE_HTML, "<html><body><h1>503 Service Unavailable</h1><p>Stream is being packaged</p></body></html>");
+                return;
+            }
+            sendResponse(exchange, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Stream not found</p></body></html>");
+            return;
+        }
 
-        // 发送MPD文件
-        sendResponse(clientSocket, HTTP_200_OK, CONTENT_TYPE_MPD, content);
+        // 在文件线程池中读取并发送MPD文件
+        std::string mpdPath = m_outputDir + "/" + streamName + "/manifest.mpd";
+        sendFile(exchange, mpdPath, CONTENT_TYPE_MPD, "",
+                 HTTP_404_NOT_FOUND, "<html><body><h1>404 Not Found</h1><p>MPD file not found</p></body></html>", range);
     }
 
     // 处理分段请求
-    void DashServer::handleSegmentRequest(int clientSocket, const std::string& path) {
+    void DashServer::handleSegmentRequest(const std::shared_ptr<HttpExchange>& exchange, const std::string& path, const std::string& range) {
         // 解析路径，获取流名称和文件名
         std::string streamName;
         std::string fileName;
@@ -396,51 +583,380 @@ DashServer::~DashServer() {
         }
 
         // 检查流是否存在
-        std::lock_guard<std::mutex> lock(m_streamsMutex);
-        if (m_streams.find(streamName) == m_streams.end()) {
-            sendResponse(clientSocket, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Stream not found</p></body></html>");
-            return;
+        bool live = false;
+        std::shared_ptr<MemorySink> memory;
+        {
+            std::lock_guard<std::mutex> lock(m_streamsMutex);
+            live = m_liveStreams.find(streamName) != m_liveStreams.end();
+            auto it = m_memoryStreams.find(streamName);
+            if (it != m_memoryStreams.end()) {
+                memory = it->second;
+            }
+            if (!live && m_streams.find(streamName) == m_streams.end()) {
+                sendResponse(exchange, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Stream not found</p></body></html>");
+                return;
+            }
         }
 
         // 分段文件路径
         std::string segmentPath = m_outputDir + "/" + streamName + "/" + fileName;
 
-        // 读取分段文件
-        std::ifstream file(segmentPath, std::ios::binary);
-        if (!file) {
-            sendResponse(clientSocket, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Segment file not found</p></body></html>");
+        // 内存直播流直接从写入端交出的数据发送
+        if (memory) {
+            streamMemorySegment(exchange, memory, fileName);
             return;
         }
 
-        // 获取文件大小
-        file.seekg(0, std::ios::end);
-        size_t fileSize = file.tellg();
-        file.seekg(0, std::ios::beg);
-
-        // 读取文件内容
-        std::vector<char> buffer(fileSize);
-        file.read(buffer.data(), fileSize);
+        // 直播分段可能仍在写入，或播放器按availabilityTimeOffset提前请求
+        if (live) {
+            streamLiveSegment(exchange, streamName, segmentPath, range);
+            return;
+        }
 
-        // 发送分段文件
-        sendResponse(clientSocket, HTTP_200_OK, CONTENT_TYPE_MP4, std::string(buffer.data(), fileSize));
+        // 在文件线程池中从缓存取得并发送分段文件（录像等大文件直接以sendfile发送请求的范围）
+        m_filePool->submit([this, exchange, streamName, segmentPath, range]() {
+            if (exchange->closed()) {
+                return;
+            }
+            sendCachedSegment(exchange, streamName, segmentPath, range);
+        });
     }
 
-    // 发送HTTP响应
-    void DashServer::sendResponse(int clientSocket, const char* status, const char* contentType, const std::string& content) {
-        std::ostringstream response;
-        response << status;
-        response << contentType;
-        response << CORS_HEADER;
-        response << "Content-Length: " << content.size() << "\r\n";
-        response << "\r\n";
-        response << content;
-
-        std::string responseStr = response.str();
+    // 处理时钟同步请求
+    void DashServer::handleTimeRequest(const std::shared_ptr<HttpExchange>& exchange) {
+        // 当前UTC时间（ISO 8601，毫秒精度）
+        int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::time_t seconds = static_cast<std::time_t>(nowMs / 1000);
+        std::tm tm;
 #ifdef _WIN32
-        send(clientSocket, responseStr.c_str(), responseStr.size(), 0);
+        gmtime_s(&tm, &seconds);
 #else
-        write(clientSocket, responseStr.c_str(), responseStr.size());
+        gmtime_r(&seconds, &tm);
 #endif
+
+        char buffer[32];
+        strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+        char millis[8];
+        snprintf(millis, sizeof(millis), ".%03dZ", static_cast<int>(nowMs % 1000));
+
+        sendResponse(exchange, HTTP_200_OK, CONTENT_TYPE_TEXT, std::string(buffer) + millis, NO_CACHE_HEADER);
+    }
+
+    // 直播分段
+    void DashServer::streamLiveSegment(const std::shared_ptr<HttpExchange>& exchange, const std::string& streamName,
+                                       const std::string& segmentPath, const std::string& range) {
+        std::shared_ptr<LiveSegment> segment = std::make_shared<LiveSegment>();
+        segment->streamName = streamName;
+        segment->segmentPath = segmentPath;
+        segment->range = range;
+        segment->partPath = segmentPath + ".part";
+        segment->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(LIVE_SEGMENT_WAIT_MS);
+
+        m_filePool->submit([this, exchange, segment]() {
+            pumpLiveSegment(exchange, segment);
+        });
+    }
+
+    // 直播分段的一步（在文件线程池中执行）
+    void DashServer::pumpLiveSegment(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<LiveSegment>& segment) {
+        if (!m_running || exchange->closed()) {
+            return;
+        }
+
+        // 下一步重新提交到文件线程池（回调在I/O线程中执行，服务器停止后不再执行）
+        auto next = [this, exchange, segment]() {
+            m_filePool->submit([this, exchange, segment]() {
+                pumpLiveSegment(exchange, segment);
+            });
+        };
+
+        // 等待分段出现：已完成的分段优先（同时请求最新分段的观众共享缓存中的同一份），其次是写入中的.part
+        if (!segment->file) {
+            struct stat st;
+            if (stat(segment->segmentPath.c_str(), &st) == 0) {
+                sendCachedSegment(exchange, segment->streamName, segment->segmentPath, segment->range);
+                return;
+            }
+            int fd = open(segment->partPath.c_str(), OPEN_FLAGS);
+            if (fd < 0) {
+                if (std::chrono::steady_clock::now() >= segment->deadline) {
+                    sendResponse(exchange, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Segment file not found</p></body></html>");
+                    return;
+                }
+                exchange->after(LIVE_SEGMENT_POLL_MS, next);
+                return;
+            }
+            segment->file = std::make_shared<HttpFile>(fd);
+            segment->lastData = std::chrono::steady_clock::now();
+
+            // 写入中的分段：每次把新写出的部分作为一个chunk发送，.part改名后发完剩余数据再结束
+            exchange->send(streamingHeader(*exchange));
+        }
+
+        while (true) {
+            // 新写出的数据以sendfile发送，发送完再检查下一块，慢速客户端不会让数据堆积在内存中
+            struct stat st;
+            if (fstat(segment->file->fd(), &st) == 0 && static_cast<uint64_t>(st.st_size) > segment->offset) {
+                uint64_t length = static_cast<uint64_t>(st.st_size) - segment->offset;
+                bool chunked = exchange->chunkedAllowed();
+                if (chunked) {
+                    char sizeLine[24];
+                    snprintf(sizeLine, sizeof(sizeLine), "%llx\r\n", static_cast<unsigned long long>(length));
+                    exchange->send(sizeLine);
+                }
+                exchange->sendFile(segment->file, segment->offset, length);
+                if (chunked) {
+                    exchange->send("\r\n");
+                }
+                segment->offset += length;
+                segment->lastData = std::chrono::steady_clock::now();
+                exchange->whenDrained(next);
+                return;
+            }
+
+            if (segment->finished) {
+                finishStream(exchange);
+                return;
+            }
+
+            // 没有新数据：.part不存在说明写入端已写完并改名，再检查一轮剩余数据
+            if (stat(segment->partPath.c_str(), &st) != 0) {
+                segment->finished = true;
+                continue;
+            }
+            break;
+        }
+
+        // 写入端停止时不发送结束块，播放器按请求失败处理
+        if (std::chrono::steady_clock::now() - segment->lastData > std::chrono::milliseconds(LIVE_SEGMENT_WAIT_MS)) {
+            std::cerr << "直播分段写入超时: " << segment->segmentPath << std::endl;
+            exchange->abort();
+            return;
+        }
+        exchange->after(LIVE_SEGMENT_POLL_MS, next);
+    }
+
+    // 内存直播分段
+    void DashServer::streamMemorySegment(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<MemorySink>& sink,
+                                         const std::string& fileName) {
+        std::shared_ptr<MemorySegment> segment = std::make_shared<MemorySegment>();
+        segment->sink = sink;
+        segment->fileName = fileName;
+        segment->lastData = std::chrono::steady_clock::now();
+        pumpMemorySegment(exchange, segment);
+    }
+
+    // 内存直播分段的一步
+    void DashServer::pumpMemorySegment(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<MemorySegment>& segment) {
+        if (!m_running || exchange->closed()) {
+            return;
+        }
+
+        auto next = [this, exchange, segment]() {
+            pumpMemorySegment(exchange, segment);
+        };
+
+        std::string content;
+        bool complete = false;
+        bool found = segment->sink->read(segment->fileName, segment->offset, content, complete, 0);
+        bool waitedTooLong = std::chrono::steady_clock::now() - segment->lastData > std::chrono::milliseconds(LIVE_SEGMENT_WAIT_MS);
+
+        if (!segment->chunked) {
+            // 等待分段出现（播放器可能按availabilityTimeOffset提前请求）
+            if (!found) {
+                if (waitedTooLong) {
+                    sendResponse(exchange, HTTP_404_NOT_FOUND, CONTENT_TYPE_HTML, "<html><body><h1>404 Not Found</h1><p>Segment file not found</p></body></html>");
+                } else {
+                    exchange->after(LIVE_SEGMENT_POLL_MS, next);
+                }
+                return;
+            }
+
+            // 已完成的分段整体发送
+            if (complete) {
+                sendResponse(exchange, HTTP_200_OK, CONTENT_TYPE_MP4, std::move(content));
+                return;
+            }
+
+            // 写入中的分段：每拿到新写出的块就发送一个chunk，分段完成后发送结束块
+            exchange->send(streamingHeader(*exchange));
+            segment->chunked = true;
+        } else if (!found) {
+            // 分段已移出窗口时不发送结束块，播放器按请求失败处理
+            std::cerr << "直播分段已移出窗口: " << segment->fileName << std::endl;
+            exchange->abort();
+            return;
+        }
+
+        if (!content.empty()) {
+            segment->offset += content.size();
+            segment->lastData = std::chrono::steady_clock::now();
+            sendChunk(exchange, std::move(content));
+        }
+        if (complete) {
+            finishStream(exchange);
+            return;
+        }
+        if (!content.empty()) {
+            exchange->whenDrained(next);
+            return;
+        }
+
+        // 写入端停止时不发送结束块
+        if (waitedTooLong) {
+            std::cerr << "直播分段写入超时: " << segment->fileName << std::endl;
+            exchange->abort();
+            return;
+        }
+        exchange->after(LIVE_SEGMENT_POLL_MS, next);
+    }
+
+    // 在文件线程池中打开文件并发送
+    void DashServer::sendFile(const std::shared_ptr<HttpExchange>& exchange, const std::string& filePath, const char* contentType,
+                              const char* extraHeaders, const char* missingStatus, const char* missingBody, const std::string& range) {
+        m_filePool->submit([this, exchange, filePath, contentType, extraHeaders, missingStatus, missingBody, range]() {
+            if (exchange->closed()) {
+                return;
+            }
+            openAndSendFile(exchange, filePath, contentType, extraHeaders, missingStatus, missingBody, range);
+        });
+    }
+
+    // 打开文件并发送（在文件线程池中执行）
+    void DashServer::openAndSendFile(const std::shared_ptr<HttpExchange>& exchange, const std::string& filePath, const char* contentType,
+                                     const char* extraHeaders, const char* missingStatus, const char* missingBody, const std::string& range) {
+        int fd = open(filePath.c_str(), OPEN_FLAGS);
+        if (fd < 0) {
+            sendResponse(exchange, missingStatus, CONTENT_TYPE_HTML, missingBody);
+            return;
+        }
+        std::shared_ptr<HttpFile> file = std::make_shared<HttpFile>(fd);
+
+        // 获取文件大小
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            sendResponse(exchange, missingStatus, CONTENT_TYPE_HTML, missingBody);
+            return;
+        }
+
+        sendOpenFile(exchange, file, static_cast<uint64_t>(st.st_size), contentType, extraHeaders, range);
+    }
+
+    // 从缓存发送已完成的分段（在文件线程池中执行）
+    void DashServer::sendCachedSegment(const std::shared_ptr<HttpExchange>& exchange, const std::string& streamName,
+                                       const std::string& segmentPath, const std::string& range) {
+        // 未命中时本线程读盘，同一分段的其他请求等待它读完后在本线程中一起回调
+        m_segmentCache->fetch(streamName, segmentPath, [this, exchange, segmentPath, range](const SegmentCache::Buffer& data) {
+            if (exchange->closed()) {
+                return;
+            }
+            if (data) {
+                sendContent(exchange, data->size(), CONTENT_TYPE_MP4, "", range, [&exchange, &data](uint64_t offset, uint64_t length) {
+                    exchange->send(data, static_cast<size_t>(offset), static_cast<size_t>(length));
+                });
+                return;
+            }
+            // 不缓存的文件（太大或已不存在）直接发送
+            openAndSendFile(exchange, segmentPath, CONTENT_TYPE_MP4, "",
+                            HTTP_404_NOT_FOUND, "<html><body><h1>404 Not Found</h1><p>Segment file not found</p></body></html>", range);
+        });
+    }
+
+    // 发送已打开的文件
+    void DashServer::sendOpenFile(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<HttpFile>& file, uint64_t size,
+                                  const char* contentType, const char* extraHeaders, const std::string& range) {
+        // 响应头和正文同一轮写出：响应头带MSG_MORE，正文由sendfile直接从页缓存发送
+        sendContent(exchange, size, contentType, extraHeaders, range, [&exchange, &file](uint64_t offset, uint64_t length) {
+#ifdef POSIX_FADV_WILLNEED
+            // 在文件线程中提前预读（只读请求的范围，拖动大文件时不会预读整个文件），I/O线程sendfile时尽量不等待磁盘
+            posix_fadvise(file->fd(), static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#endif
+            exchange->sendFile(file, offset, length);
+        });
+    }
+
+    // 按Range请求头发送正文
+    void DashServer::sendContent(const std::shared_ptr<HttpExchange>& exchange, uint64_t size, const char* contentType, const char* extraHeaders,
+                                 const std::string& range, const std::function<void(uint64_t offset, uint64_t length)>& sendBody) {
+        std::vector<HttpRange::Span> spans;
+        HttpRange::Result result = HttpRange::parse(range, size, spans);
+
+        if (result == HttpRange::UNSATISFIABLE) {
+            std::string headers = "Content-Range: bytes */" + std::to_string(size) + "\r\n";
+            sendResponse(exchange, HTTP_416_RANGE_NOT_SATISFIABLE, CONTENT_TYPE_HTML,
+                         "<html><body><h1>416 Range Not Satisfiable</h1></body></html>", headers.c_str());
+            return;
+        }
+
+        std::string headers = std::string(ACCEPT_RANGES_HEADER) + extraHeaders;
+        if (result == HttpRange::IGNORED) {
+            exchange->send(responseHeader(*exchange, HTTP_200_OK, contentType, headers.c_str(), size));
+            sendBody(0, size);
+            exchange->finish();
+            return;
+        }
+
+        if (spans.size() == 1) {
+            headers += contentRangeHeader(spans[0], size);
+            exchange->send(responseHeader(*exchange, HTTP_206_PARTIAL_CONTENT, contentType, headers.c_str(), spans[0].length));
+            sendBody(spans[0].first, spans[0].length);
+            exchange->finish();
+            return;
+        }
+
+        // 多个范围：每个部分的头部之后是该范围的正文，总长度事先算出
+        std::string boundary = multipartBoundary();
+        std::vector<std::string> parts;
+        uint64_t length = 0;
+        for (const HttpRange::Span& span : spans) {
+            parts.push_back("\r\n--" + boundary + "\r\n" + contentType + contentRangeHeader(span, size) + "\r\n");
+            length += parts.back().size() + span.length;
+        }
+        std::string closing = "\r\n--" + boundary + "--\r\n";
+        length += closing.size();
+
+        std::string multipartType = "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n";
+        exchange->send(responseHeader(*exchange, HTTP_206_PARTIAL_CONTENT, multipartType.c_str(), headers.c_str(), length));
+        for (size_t i = 0; i < spans.size(); i++) {
+            exchange->send(std::move(parts[i]));
+            sendBody(spans[i].first, spans[i].length);
+        }
+        exchange->send(std::move(closing));
+        exchange->finish();
+    }
+
+    // 发送HTTP响应
+    void DashServer::sendResponse(const std::shared_ptr<HttpExchange>& exchange, const char* status, const char* contentType,
+                                  std::string content, const char* extraHeaders) {
+        exchange->send(responseHeader(*exchange, status, contentType, extraHeaders, content.size()));
+        exchange->send(std::move(content));
+        exchange->finish();
+    }
+
+    // 发送一个chunk（长度行、数据和结尾作为相邻的iovec一次写出）
+    void DashServer::sendChunk(const std::shared_ptr<HttpExchange>& exchange, std::string data) {
+        // HTTP/1.0直接发送正文
+        if (!exchange->chunkedAllowed()) {
+            exchange->send(std::move(data));
+            return;
+        }
+
+        char sizeLine[24];
+        snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", data.size());
+
+        exchange->send(sizeLine);
+        exchange->send(std::move(data));
+        exchange->send("\r\n");
+    }
+
+    // 结束流式响应
+    void DashServer::finishStream(const std::shared_ptr<HttpExchange>& exchange) {
+        // HTTP/1.0没有结束块，发送完后关闭连接即表示正文结束
+        if (exchange->chunkedAllowed()) {
+            exchange->send("0\r\n\r\n");
+        }
+        exchange->finish();
     }
 
 
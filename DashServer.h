@@ -11,7 +11,16 @@
 #include <mutex>
 #include <atomic>
 #include <map>
+#include <memory>
 #include <iostream>
+
+#include "DashPackager.h"
+#include "OutputSink.h"
+#include "HttpReactor.h"
+#include "HttpRange.h"
+#include "SegmentCache.h"
+#include "WorkerPool.h"
+
 // DASH服务器类
 class DashServer {
 public:
@@ -24,9 +33,31 @@ public:
     // 初始化服务器
     bool init(uint16_t port = 8080, float segmentDuration = 4.0f, const std::string& outputDir = "./dash");
 
-    // 添加MP4文件
+    // 添加MP4文件（在后台线程中分段，完成后才可访问）
     bool addMP4File(const std::string& mp4FilePath, const std::string& streamName);
 
+    // 添加直播流（H264MP4Writer直播DASH输出到<输出目录>/<流名称>，写入中的分段以chunked编码边写边发）
+    bool addLiveStream(const std::string& streamName, const std::string& mpdName = "live.mpd");
+
+    // 添加内存直播流（H264MP4Writer通过addOutputSink写入同一个MemorySink，不经过磁盘）
+    bool addLiveStream(const std::string& streamName, const std::shared_ptr<MemorySink>& sink,
+                       const std::string& mpdName = "live.mpd");
+
+    // 获取流的分段进度（0.0~1.0，1.0表示可访问，流不存在或分段失败时返回-1）
+    double getPackagingProgress(const std::string& streamName);
+
+    // 等待流分段完成，返回是否成功
+    bool waitForStream(const std::string& streamName);
+
+    // 设置I/O线程数和文件线程数（启动前调用，默认2和4）
+    void setThreadCounts(size_t ioThreads, size_t fileThreads);
+
+    // 设置分段缓存的总容量和每个流的上限（启动前调用，默认256MB和64MB，容量为0表示不缓存）
+    void setCacheLimits(size_t capacityBytes, size_t streamQuotaBytes);
+
+    // 获取分段缓存统计（命中率、淘汰数、省去的读盘字节数等）
+    SegmentCache::Stats getCacheStats() const;
+
     // 启动服务器
     bool start();
 
@@ -34,33 +65,94 @@ public:
     void stop();
 
 private:
-    // 服务器主循环
-    void serverLoop();
+    // 直播分段的发送进度（见DashServer.cpp）
+    struct LiveSegment;
+    struct MemorySegment;
 
-    // 处理客户端请求
-    void handleClient(int clientSocket);
+    // 处理客户端请求（在I/O线程中调用，不能阻塞）
+    void handleClient(const HttpRequest& request, const std::shared_ptr<HttpExchange>& exchange);
 
     // 处理根路径请求
-    void handleRootRequest(int clientSocket);
+    void handleRootRequest(const std::shared_ptr<HttpExchange>& exchange);
+
+    // 处理MPD请求（range为Range请求头，文件形式的MPD按它发送部分内容）
+    void handleMPDRequest(const std::shared_ptr<HttpExchange>& exchange, const std::string& path, const std::string& range);
+
+    // 处理分段请求（已完成的分段和点播文件按Range请求头发送部分内容）
+    void handleSegmentRequest(const std::shared_ptr<HttpExchange>& exchange, const std::string& path, const std::string& range);
+
+    // 处理时钟同步请求（MPD中的UTCTiming）
+    void handleTimeRequest(const std::shared_ptr<HttpExchange>& exchange);
+
+    // 直播分段：文件写入完成前以chunked编码边读边发（读文件在文件线程池中进行，写入中的分段忽略Range请求头）
+    void streamLiveSegment(const std::shared_ptr<HttpExchange>& exchange, const std::string& streamName,
+                           const std::string& segmentPath, const std::string& range);
+
+    // 直播分段的一步：打开文件或发送一次新增的数据，然后等待发送完或数据增长后再继续
+    void pumpLiveSegment(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<LiveSegment>& segment);
+
+    // 内存直播分段：写入完成前以chunked编码边写边发
+    void streamMemorySegment(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<MemorySink>& sink,
+                             const std::string& fileName);
+
+    // 内存直播分段的一步（在I/O线程中执行，读取不等待）
+    void pumpMemorySegment(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<MemorySegment>& segment);
+
+    // 在文件线程池中打开文件，正文由I/O线程以sendfile发送（文件不存在时发送missingStatus和missingBody）
+    void sendFile(const std::shared_ptr<HttpExchange>& exchange, const std::string& filePath, const char* contentType,
+                  const char* extraHeaders, const char* missingStatus, const char* missingBody, const std::string& range);
+
+    // 打开文件并发送（在文件线程池中执行）
+    void openAndSendFile(const std::shared_ptr<HttpExchange>& exchange, const std::string& filePath, const char* contentType,
+                         const char* extraHeaders, const char* missingStatus, const char* missingBody, const std::string& range);
+
+    // 从分段缓存发送已完成的分段，不缓存的文件以sendfile发送（在文件线程池中执行）
+    void sendCachedSegment(const std::shared_ptr<HttpExchange>& exchange, const std::string& streamName,
+                           const std::string& segmentPath, const std::string& range);
+
+    // 发送已打开的文件（只预读和发送请求的范围）
+    void sendOpenFile(const std::shared_ptr<HttpExchange>& exchange, const std::shared_ptr<HttpFile>& file, uint64_t size,
+                      const char* contentType, const char* extraHeaders, const std::string& range);
+
+    /**
+     * 按Range请求头发送整个正文（200）、一个范围（206）或多个范围（206 multipart/byteranges），
+     * 范围都在正文之外时发送416
+     *
+     * @param size 正文长度
+     * @param contentType 正文的Content-Type（多个范围时用于每个部分）
+     * @param range Range请求头（空表示发送整个正文）
+     * @param sendBody 把正文中的一段交给发送队列（文件以sendfile、缓存以引用发送，都不拷贝）
+     */
+    void sendContent(const std::shared_ptr<HttpExchange>& exchange, uint64_t size, const char* contentType, const char* extraHeaders,
+                     const std::string& range, const std::function<void(uint64_t offset, uint64_t length)>& sendBody);
 
-    // 处理MPD请求
-    void handleMPDRequest(int clientSocket, const std::string& path);
+    // 发送HTTP响应（响应头和正文分别交给发送队列，一次写出，正文不再拷贝）
+    void sendResponse(const std::shared_ptr<HttpExchange>& exchange, const char* status, const char* contentType,
+                      std::string content, const char* extraHeaders = "");
 
-    // 处理分段请求
-    void handleSegmentRequest(int clientSocket, const std::string& path);
+    // 发送流式响应的一段数据（HTTP/1.1时作为一个chunk）
+    void sendChunk(const std::shared_ptr<HttpExchange>& exchange, std::string data);
 
-    // 发送HTTP响应
-    void sendResponse(int clientSocket, const char* status, const char* contentType, const std::string& content);
+    // 结束流式响应（HTTP/1.1时发送结束块）
+    void finishStream(const std::shared_ptr<HttpExchange>& exchange);
 
 private:
     std::atomic<bool> m_running;       // 服务器运行状态
-    std::thread m_serverThread;        // 服务器线程
     int m_serverSocket;                // 服务器套接字
     uint16_t m_port;                   // 服务器端口
     float m_segmentDuration;           // 分段时长（秒）
     std::string m_outputDir;           // 输出目录
     std::map<std::string, std::string> m_streams;  // 流列表 <流名称, MP4文件路径>
-    std::mutex m_streamsMutex;         // 流列表互斥锁
+    std::map<std::string, std::string> m_liveStreams;  // 直播流 <流名称, MPD文件名>
+    std::map<std::string, std::shared_ptr<MemorySink>> m_memoryStreams;  // 内存直播流 <流名称, 数据>
+    std::map<std::string, std::shared_ptr<DashPackager::Job>> m_jobs;  // 分段任务 <流名称, 任务>
+    std::mutex m_streamsMutex;         // 流列表和分段任务互斥锁
+    size_t m_ioThreads;                // I/O线程数
+    size_t m_fileThreads;              // 文件线程数
+    std::unique_ptr<WorkerPool> m_filePool;    // 读文件等阻塞操作
+    std::unique_ptr<SegmentCache> m_segmentCache;  // 已完成分段的内存缓存（直播和点播共享）
+    std::unique_ptr<HttpReactor> m_reactor;    // 连接处理（运行期间存在）
+    std::unique_ptr<DashPackager> m_packager;  // 后台分段（最后声明，最先析构）
 };
 
 #endif // DASH_SERVER_H
\ No newline at end of file
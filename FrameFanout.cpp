@@ -0,0 +1,178 @@
+#include "FrameFanout.h"
+#include "H264MP4Writer.h"
+#include "TimestampEngine.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+FrameFanout::FrameFanout(const Config& config)
+    : m_config(config)
+    , m_timebaseMul(90)
+    , m_timebaseDiv(1)
+    , m_isH265(config.isH265)
+    , m_nextId(1)
+{
+    if (config.timebaseNum > 0 && config.timebaseDen > 0) {
+        uint64_t g = TimestampEngine::gcd(90000ULL * config.timebaseNum, config.timebaseDen);
+        m_timebaseMul = 90000ULL * config.timebaseNum / g;
+        m_timebaseDiv = config.timebaseDen / g;
+    } else {
+        std::cerr << "Invalid fanout timebase, using 1/1000" << std::endl;
+    }
+
+    m_stats = Stats();
+    m_pool.reserve(config.poolFrames);
+}
+
+int FrameFanout::addConsumer(const Consumer& consumer, bool replayPreRecord)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 补录预录像：缓冲区总是从关键帧开始
+    if (replayPreRecord) {
+        for (const auto& entry : m_preRecord) {
+            if (consumer(entry.frame)) {
+                m_stats.framesReplayed++;
+            } else {
+                m_stats.consumerErrors++;
+            }
+        }
+    }
+
+    int id = m_nextId++;
+    m_consumers[id] = consumer;
+
+    return id;
+}
+
+int FrameFanout::addWriter(H264MP4Writer& writer, bool replayPreRecord)
+{
+    H264MP4Writer* target = &writer;
+    return addConsumer([target](const std::shared_ptr<const ParsedFrame>& frame) {
+        return target->writeParsedFrame(frame);
+    }, replayPreRecord);
+}
+
+bool FrameFanout::removeConsumer(int id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_consumers.erase(id) > 0;
+}
+
+bool FrameFanout::publish(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp)
+{
+    // 毫秒 -> 轨道时间（90kHz）
+    int64_t pts = (timestamp >= 0) ? TimestampEngine::rescale(timestamp, 90, 1) : ParsedFrame::NO_TIMESTAMP;
+
+    return dispatch(frameData, frameSize, isKeyFrame, pts, ParsedFrame::NO_TIMESTAMP);
+}
+
+bool FrameFanout::publishTimed(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    if (pts != ParsedFrame::NO_TIMESTAMP) {
+        pts = TimestampEngine::rescale(pts, m_timebaseMul, m_timebaseDiv);
+    }
+    if (dts != ParsedFrame::NO_TIMESTAMP) {
+        dts = TimestampEngine::rescale(dts, m_timebaseMul, m_timebaseDiv);
+    }
+
+    return dispatch(frameData, frameSize, isKeyFrame, pts, dts);
+}
+
+bool FrameFanout::dispatch(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 只解析一次，所有消费者共享
+    std::shared_ptr<ParsedFrame> frame = acquireFrame();
+    if (!frame->parse(frameData, frameSize, isKeyFrame, pts, dts, m_isH265)) {
+        m_stats.framesRejected++;
+        return false;
+    }
+
+    // 自动检测：按第一个带参数集的关键帧确定编码（VPS为H265，H264的SPS为H264），之后的帧按确定的编码解析
+    if (m_isH265 < 0 && frame->isKeyFrame() && frame->detectedCodec() >= 0) {
+        m_isH265 = frame->detectedCodec();
+    }
+
+    std::shared_ptr<const ParsedFrame> shared = frame;
+    frame.reset();
+
+    for (const auto& consumer : m_consumers) {
+        if (!consumer.second(shared)) {
+            m_stats.consumerErrors++;
+        }
+    }
+
+    if (m_config.preRecordMs > 0) {
+        pushPreRecord(shared);
+    }
+
+    m_stats.framesPublished++;
+
+    return true;
+}
+
+std::shared_ptr<ParsedFrame> FrameFanout::acquireFrame()
+{
+    // 只有池中持有引用的帧对象可以复用（消费者和预录像都已释放）
+    for (const auto& frame : m_pool) {
+        if (frame.use_count() == 1) {
+            // use_count是relaxed读取：与消费者线程释放最后一个引用时的release递减配对，
+            // 保证它对帧的读取先于这里的覆盖
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return frame;
+        }
+    }
+
+    m_stats.frameAllocs++;
+    std::shared_ptr<ParsedFrame> frame = std::make_shared<ParsedFrame>();
+    if (m_pool.size() < m_config.poolFrames) {
+        m_pool.push_back(frame);
+    }
+
+    return frame;
+}
+
+void FrameFanout::pushPreRecord(const std::shared_ptr<const ParsedFrame>& frame)
+{
+    // 时间戳未提供时按到达时间计算时长
+    int64_t timeMs = frame->pts() != ParsedFrame::NO_TIMESTAMP ? frame->pts() / 90 :
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // 缓冲区从关键帧开始
+    if (frame->isKeyFrame()) {
+        m_gopStarts.push_back(timeMs);
+    } else if (m_preRecord.empty()) {
+        return;
+    }
+
+    PreRecordEntry entry = { frame, timeMs };
+    m_preRecord.push_back(entry);
+
+    // 去掉最早的GOP后仍能覆盖预录像时长时才淘汰
+    while (m_gopStarts.size() > 1 && timeMs - m_gopStarts[1] >= static_cast<int64_t>(m_config.preRecordMs)) {
+        m_preRecord.pop_front();
+        while (!m_preRecord.empty() && !m_preRecord.front().frame->isKeyFrame()) {
+            m_preRecord.pop_front();
+        }
+        m_gopStarts.pop_front();
+    }
+}
+
+void FrameFanout::clearPreRecord()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_preRecord.clear();
+    m_gopStarts.clear();
+}
+
+FrameFanout::Stats FrameFanout::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.consumers = m_consumers.size();
+    stats.preRecordFrames = m_preRecord.size();
+    return stats;
+}
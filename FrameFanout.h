@@ -0,0 +1,142 @@
+#ifndef FRAME_FANOUT_H
+#define FRAME_FANOUT_H
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "ParsedFrame.h"
+
+class H264MP4Writer;
+
+/**
+ * FrameFanout - 单次解析、多路分发的视频接入
+ *
+ * 同一路码流同时录像和直播时，每帧只查找一次起始码、转换一次格式，
+ * 得到的ParsedFrame以引用计数在所有消费者（录像写入器、直播写入器等）
+ * 之间共享，不再各自解析和拷贝。所有消费者都释放引用后帧对象回收复用，
+ * 稳态下不分配内存。
+ *
+ * 内置预录像：保留最近preRecordMs的完整GOP（只保存引用），新加入的
+ * 消费者可以先收到这些帧。消费者在publish的线程中按加入顺序依次调用，
+ * 应尽快返回（H264MP4Writer的异步模式只入队引用）。
+ */
+class FrameFanout {
+public:
+    // 消费者：返回是否处理成功（失败只计数，不影响其他消费者）
+    typedef std::function<bool(const std::shared_ptr<const ParsedFrame>& frame)> Consumer;
+
+    struct Config {
+        int isH265;                 // 编码类型（0 H264，1 H265，-1 按VPS自动检测）
+        uint32_t timebaseNum;       // publishTimed时间戳的时间基分子
+        uint32_t timebaseDen;       // publishTimed时间戳的时间基分母（默认1/1000秒）
+        uint32_t preRecordMs;       // 预录像时长（毫秒），0表示不缓冲
+        size_t poolFrames;          // 回收复用的帧对象数
+
+        Config()
+            : isH265(-1), timebaseNum(1), timebaseDen(1000), preRecordMs(0), poolFrames(64) {}
+    };
+
+    struct Stats {
+        uint64_t framesPublished;   // 已分发的帧数
+        uint64_t framesRejected;    // 解析失败的帧数
+        uint64_t framesReplayed;    // 补录给新消费者的预录像帧数
+        uint64_t consumerErrors;    // 消费者返回失败的次数
+        uint64_t frameAllocs;       // 新建帧对象的次数（其余为回收复用）
+        size_t consumers;           // 当前消费者数
+        size_t preRecordFrames;     // 预录像缓冲的帧数
+    };
+
+    explicit FrameFanout(const Config& config = Config());
+
+    /**
+     * 添加消费者
+     *
+     * @param consumer 消费者
+     * @param replayPreRecord 是否先把预录像缓冲的帧交给该消费者
+     * @return 消费者ID（用于removeConsumer）
+     */
+    int addConsumer(const Consumer& consumer, bool replayPreRecord = false);
+
+    /**
+     * 添加写入器（通过writeParsedFrame写入；需要补录预录像时应先开始录制）
+     *
+     * @param writer 写入器，移除前必须保持有效
+     * @param replayPreRecord 是否先写入预录像缓冲的帧
+     * @return 消费者ID
+     */
+    int addWriter(H264MP4Writer& writer, bool replayPreRecord = false);
+
+    /**
+     * 移除消费者
+     *
+     * @param id addConsumer/addWriter返回的ID
+     * @return 是否存在
+     */
+    bool removeConsumer(int id);
+
+    /**
+     * 解析一帧并分发给所有消费者
+     *
+     * @param frameData 帧数据（包含起始码）
+     * @param frameSize 数据大小
+     * @param isKeyFrame 是否是关键帧
+     * @param timestamp 时间戳（毫秒，-1表示未提供）
+     * @return 是否解析成功
+     */
+    bool publish(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp = -1);
+
+    /**
+     * 按显示/解码时间戳解析并分发一帧（时间戳单位由Config的时间基指定）
+     *
+     * @param frameData 帧数据（包含起始码）
+     * @param frameSize 数据大小
+     * @param isKeyFrame 是否是关键帧
+     * @param pts 显示时间戳（ParsedFrame::NO_TIMESTAMP表示未提供）
+     * @param dts 解码时间戳（ParsedFrame::NO_TIMESTAMP表示未提供）
+     * @return 是否解析成功
+     */
+    bool publishTimed(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts,
+                      int64_t dts = ParsedFrame::NO_TIMESTAMP);
+
+    // 清空预录像缓冲
+    void clearPreRecord();
+
+    // 统计信息
+    Stats stats();
+
+private:
+    struct PreRecordEntry {
+        std::shared_ptr<const ParsedFrame> frame;
+        int64_t timeMs;             // 计算时长用的时间（时间戳或到达时间）
+    };
+
+    // 解析并分发（时间戳为轨道时间）
+    bool dispatch(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    // 取一个没有其他引用的帧对象，没有时新建
+    std::shared_ptr<ParsedFrame> acquireFrame();
+
+    // 加入预录像缓冲并淘汰过期的GOP
+    void pushPreRecord(const std::shared_ptr<const ParsedFrame>& frame);
+
+private:
+    Config m_config;
+    uint64_t m_timebaseMul;                     // publishTimed时间戳 -> 轨道时间
+    uint64_t m_timebaseDiv;
+    int m_isH265;                               // 已确定的编码类型（-1表示尚未检测到）
+    std::map<int, Consumer> m_consumers;
+    int m_nextId;
+    std::vector<std::shared_ptr<ParsedFrame>> m_pool;   // 可回收的帧对象
+    std::deque<PreRecordEntry> m_preRecord;     // 预录像帧，总是从关键帧开始
+    std::deque<int64_t> m_gopStarts;            // 每个GOP第一帧的timeMs
+    Stats m_stats;
+    std::mutex m_mutex;
+};
+
+#endif // FRAME_FANOUT_H
@@ -0,0 +1,498 @@
+#include "FramePool.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <iostream>
+
+namespace {
+// 缓冲区大小按缓存行对齐
+const size_t BUFFER_ALIGN = 64;
+
+// 后备堆缓冲区：引用计数放在数据前面
+const size_t HEAP_HEADER_SIZE = 16;
+
+// gpac分配器使用的池
+std::atomic<FramePool*> g_defaultPool(nullptr);
+
+size_t alignSize(size_t size)
+{
+    return (size + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+}
+}
+
+FrameBuffer::FrameBuffer()
+    : m_pool(nullptr)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_capacity(0)
+    , m_refs(nullptr)
+{
+}
+
+FrameBuffer::FrameBuffer(FramePool* pool, uint8_t* data, size_t size, size_t capacity, std::atomic<uint32_t>* refs)
+    : m_pool(pool)
+    , m_data(data)
+    , m_size(size)
+    , m_capacity(capacity)
+    , m_refs(refs)
+{
+}
+
+FrameBuffer::FrameBuffer(const FrameBuffer& other)
+    : m_pool(other.m_pool)
+    , m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+    , m_refs(other.m_refs)
+{
+    if (m_refs) {
+        m_refs->fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer&& other)
+    : m_pool(other.m_pool)
+    , m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+    , m_refs(other.m_refs)
+{
+    other.m_pool = nullptr;
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_capacity = 0;
+    other.m_refs = nullptr;
+}
+
+FrameBuffer& FrameBuffer::operator=(const FrameBuffer& other)
+{
+    if (this != &other) {
+        FrameBuffer copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other)
+{
+    if (this != &other) {
+        reset();
+        m_pool = other.m_pool;
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        m_refs = other.m_refs;
+        other.m_pool = nullptr;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_capacity = 0;
+        other.m_refs = nullptr;
+    }
+    return *this;
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    reset();
+}
+
+bool FrameBuffer::setSize(size_t size)
+{
+    if (size > m_capacity) {
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+void FrameBuffer::reset()
+{
+    if (!m_refs) {
+        return;
+    }
+
+    // 最后一个引用负责归还；acq_rel保证其他线程对数据的访问都已完成
+    if (m_refs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (m_pool) {
+            m_pool->release(m_data);
+        } else {
+            m_refs->~atomic();
+            free(m_data - HEAP_HEADER_SIZE);
+        }
+    }
+
+    m_pool = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_capacity = 0;
+    m_refs = nullptr;
+}
+
+uint32_t FrameBuffer::useCount() const
+{
+    return m_refs ? m_refs->load(std::memory_order_relaxed) : 0;
+}
+
+FramePool::Config FramePool::forStream(size_t maxFrameSize, size_t frames)
+{
+    Config config;
+    size_t small = maxFrameSize / 16;
+    if (small < 4096) {
+        small = 4096;
+    }
+    size_t medium = maxFrameSize / 4;
+
+    // 大帧（I帧）只占少数，大等级的个数按比例减少
+    if (small < medium) {
+        config.classSizes.push_back(small);
+        config.classCounts.push_back(frames);
+    }
+    if (medium < maxFrameSize) {
+        config.classSizes.push_back(medium);
+        config.classCounts.push_back(frames / 4 > 2 ? frames / 4 : 2);
+    }
+    config.classSizes.push_back(maxFrameSize);
+    config.classCounts.push_back(frames / 8 > 2 ? frames / 8 : 2);
+
+    return config;
+}
+
+FramePool::FramePool(const Config& config)
+    : m_slab(nullptr)
+    , m_slabBytes(0)
+    , m_heapFallback(config.heapFallback)
+    , m_heapAllocations(0)
+    , m_failures(0)
+{
+    size_t classCount = config.classSizes.size() < config.classCounts.size() ?
+        config.classSizes.size() : config.classCounts.size();
+
+    for (size_t i = 0; i < classCount; i++) {
+        size_t bufferSize = alignSize(config.classSizes[i]);
+        size_t count = config.classCounts[i];
+        if (bufferSize == 0 || count == 0 || count >= 0xFFFFFFFFu) {
+            std::cerr << "Invalid frame pool class: " << config.classSizes[i] << " x " << count << std::endl;
+            continue;
+        }
+        if (!m_classes.empty() && bufferSize <= m_classes.back()->bufferSize) {
+            std::cerr << "Frame pool class sizes must be increasing: " << config.classSizes[i] << std::endl;
+            continue;
+        }
+
+        std::unique_ptr<SizeClass> sizeClass(new SizeClass());
+        sizeClass->bufferSize = bufferSize;
+        sizeClass->count = count;
+        sizeClass->base = nullptr;
+        m_slabBytes += bufferSize * count;
+        m_classes.push_back(std::move(sizeClass));
+    }
+
+    // 所有等级共用一块连续内存，owns只需比较一次地址范围
+    if (m_slabBytes > 0) {
+        m_slab = static_cast<uint8_t*>(malloc(m_slabBytes));
+        if (!m_slab) {
+            std::cerr << "Failed to allocate frame pool: " << m_slabBytes << " bytes" << std::endl;
+            m_classes.clear();
+            m_slabBytes = 0;
+        }
+    }
+
+    uint8_t* base = m_slab;
+    for (auto& sizeClass : m_classes) {
+        sizeClass->base = base;
+        base += sizeClass->bufferSize * sizeClass->count;
+
+        sizeClass->refs.reset(new std::atomic<uint32_t>[sizeClass->count]);
+        sizeClass->next.reset(new std::atomic<uint32_t>[sizeClass->count]);
+        for (size_t i = 0; i < sizeClass->count; i++) {
+            sizeClass->refs[i].store(0, std::memory_order_relaxed);
+            // 空闲栈初始按地址顺序排列
+            sizeClass->next[i].store(i + 1 < sizeClass->count ? static_cast<uint32_t>(i + 2) : 0,
+                                     std::memory_order_relaxed);
+        }
+        sizeClass->freeHead.store(1, std::memory_order_relaxed);
+        sizeClass->inUse.store(0, std::memory_order_relaxed);
+        sizeClass->highWater.store(0, std::memory_order_relaxed);
+        sizeClass->allocations.store(0, std::memory_order_relaxed);
+        sizeClass->exhausted.store(0, std::memory_order_relaxed);
+    }
+}
+
+FramePool::~FramePool()
+{
+    FramePool* self = this;
+    g_defaultPool.compare_exchange_strong(self, nullptr);
+
+    for (const auto& sizeClass : m_classes) {
+        size_t inUse = sizeClass->inUse.load(std::memory_order_relaxed);
+        if (inUse > 0) {
+            std::cerr << "Frame pool destroyed with " << inUse << " buffers of "
+                      << sizeClass->bufferSize << " bytes in use" << std::endl;
+        }
+    }
+
+    free(m_slab);
+}
+
+long FramePool::popFree(SizeClass& sizeClass)
+{
+    uint64_t head = sizeClass.freeHead.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0) {
+            return -1;
+        }
+
+        // 版本号每次加1，避免ABA：栈顶被取走又放回时CAS失败
+        uint32_t next = sizeClass.next[top - 1].load(std::memory_order_relaxed);
+        uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+        if (sizeClass.freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel,
+                                                     std::memory_order_acquire)) {
+            return static_cast<long>(top - 1);
+        }
+    }
+}
+
+void FramePool::pushFree(SizeClass& sizeClass, uint32_t index)
+{
+    uint64_t head = sizeClass.freeHead.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do {
+        sizeClass.next[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        newHead = (((head >> 32) + 1) << 32) | (index + 1);
+    } while (!sizeClass.freeHead.compare_exchange_weak(head, newHead, std::memory_order_release,
+                                                       std::memory_order_relaxed));
+}
+
+uint8_t* FramePool::take(size_t size, SizeClass** owner, uint32_t* index)
+{
+    // 从能容纳的最小等级开始，用完时借用更大的等级
+    for (auto& item : m_classes) {
+        SizeClass& sizeClass = *item;
+        if (sizeClass.bufferSize < size) {
+            continue;
+        }
+
+        long slot = popFree(sizeClass);
+        if (slot < 0) {
+            sizeClass.exhausted.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        sizeClass.allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t inUse = sizeClass.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t highWater = sizeClass.highWater.load(std::memory_order_relaxed);
+        while (inUse > highWater &&
+               !sizeClass.highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed)) {
+        }
+
+        *owner = &sizeClass;
+        *index = static_cast<uint32_t>(slot);
+        return sizeClass.base + sizeClass.bufferSize * static_cast<size_t>(slot);
+    }
+
+    return nullptr;
+}
+
+FramePool::SizeClass* FramePool::locate(const void* ptr, uint32_t* index) const
+{
+    if (!owns(ptr)) {
+        return nullptr;
+    }
+
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    for (const auto& sizeClass : m_classes) {
+        const uint8_t* end = sizeClass->base + sizeClass->bufferSize * sizeClass->count;
+        if (p >= sizeClass->base && p < end) {
+            *index = static_cast<uint32_t>((p - sizeClass->base) / sizeClass->bufferSize);
+            return sizeClass.get();
+        }
+    }
+
+    return nullptr;
+}
+
+void FramePool::release(const void* ptr)
+{
+    uint32_t index = 0;
+    SizeClass* sizeClass = locate(ptr, &index);
+    if (!sizeClass) {
+        std::cerr << "Releasing buffer not owned by frame pool" << std::endl;
+        return;
+    }
+
+    sizeClass->inUse.fetch_sub(1, std::memory_order_relaxed);
+    pushFree(*sizeClass, index);
+}
+
+FrameBuffer FramePool::allocate(size_t size)
+{
+    SizeClass* sizeClass = nullptr;
+    uint32_t index = 0;
+    uint8_t* data = take(size, &sizeClass, &index);
+    if (data) {
+        sizeClass->refs[index].store(1, std::memory_order_relaxed);
+        return FrameBuffer(this, data, size, sizeClass->bufferSize, &sizeClass->refs[index]);
+    }
+
+    if (!m_heapFallback) {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        return FrameBuffer();
+    }
+
+    // 后备：堆上分配，引用计数放在数据前的头部
+    uint8_t* block = static_cast<uint8_t*>(malloc(HEAP_HEADER_SIZE + size));
+    if (!block) {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        return FrameBuffer();
+    }
+    m_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    std::atomic<uint32_t>* refs = new (block) std::atomic<uint32_t>(1);
+    return FrameBuffer(nullptr, block + HEAP_HEADER_SIZE, size, size, refs);
+}
+
+FrameBuffer FramePool::copy(const uint8_t* data, size_t size)
+{
+    FrameBuffer buffer = allocate(size);
+    if (buffer && size > 0) {
+        memcpy(buffer.data(), data, size);
+    }
+    return buffer;
+}
+
+bool FramePool::owns(const void* ptr) const
+{
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    return m_slab && p >= m_slab && p < m_slab + m_slabBytes;
+}
+
+size_t FramePool::maxBufferSize() const
+{
+    return m_classes.empty() ? 0 : m_classes.back()->bufferSize;
+}
+
+FramePool::Stats FramePool::stats() const
+{
+    Stats stats;
+    stats.slabBytes = m_slabBytes;
+    stats.heapAllocations = m_heapAllocations.load(std::memory_order_relaxed);
+    stats.failures = m_failures.load(std::memory_order_relaxed);
+
+    for (const auto& sizeClass : m_classes) {
+        ClassStats classStats;
+        classStats.bufferSize = sizeClass->bufferSize;
+        classStats.buffers = sizeClass->count;
+        classStats.inUse = sizeClass->inUse.load(std::memory_order_relaxed);
+        classStats.highWater = sizeClass->highWater.load(std::memory_order_relaxed);
+        classStats.allocations = sizeClass->allocations.load(std::memory_order_relaxed);
+        classStats.exhausted = sizeClass->exhausted.load(std::memory_order_relaxed);
+        stats.classes.push_back(classStats);
+    }
+
+    return stats;
+}
+
+void FramePool::setDefault(FramePool* pool)
+{
+    g_defaultPool.store(pool, std::memory_order_release);
+}
+
+FramePool* FramePool::getDefault()
+{
+    return g_defaultPool.load(std::memory_order_acquire);
+}
+
+void* FramePool::gpacMalloc(size_t size)
+{
+    FramePool* pool = getDefault();
+    if (pool && size > 0 && size <= pool->maxBufferSize()) {
+        SizeClass* sizeClass = nullptr;
+        uint32_t index = 0;
+        uint8_t* data = pool->take(size, &sizeClass, &index);
+        if (data) {
+            return data;
+        }
+    }
+
+    return malloc(size);
+}
+
+void* FramePool::gpacCalloc(size_t num, size_t size)
+{
+    if (size > 0 && num > static_cast<size_t>(-1) / size) {
+        return nullptr;
+    }
+
+    void* ptr = gpacMalloc(num * size);
+    if (ptr) {
+        memset(ptr, 0, num * size);
+    }
+    return ptr;
+}
+
+void* FramePool::gpacRealloc(void* ptr, size_t size)
+{
+    if (!ptr) {
+        return gpacMalloc(size);
+    }
+
+    FramePool* pool = getDefault();
+    uint32_t index = 0;
+    SizeClass* sizeClass = pool ? pool->locate(ptr, &index) : nullptr;
+    if (!sizeClass) {
+        return realloc(ptr, size);
+    }
+
+    // 原缓冲区放得下时原地返回
+    if (size <= sizeClass->bufferSize) {
+        return ptr;
+    }
+
+    void* grown = gpacMalloc(size);
+    if (grown) {
+        memcpy(grown, ptr, sizeClass->bufferSize);
+        pool->release(ptr);
+    }
+    return grown;
+}
+
+void FramePool::gpacFree(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    FramePool* pool = getDefault();
+    if (pool && pool->owns(ptr)) {
+        pool->release(ptr);
+        return;
+    }
+
+    free(ptr);
+}
+
+#ifdef FRAME_POOL_WRAP_GPAC
+// 链接时用-Wl,--wrap把libgpac中对gf_malloc等的调用转到这里（见CMakeLists.txt）
+extern "C" {
+void* __wrap_gf_malloc(size_t size)
+{
+    return FramePool::gpacMalloc(size);
+}
+
+void* __wrap_gf_calloc(size_t num, size_t size)
+{
+    return FramePool::gpacCalloc(num, size);
+}
+
+void* __wrap_gf_realloc(void* ptr, size_t size)
+{
+    return FramePool::gpacRealloc(ptr, size);
+}
+
+void __wrap_gf_free(void* ptr)
+{
+    FramePool::gpacFree(ptr);
+}
+}
+#endif
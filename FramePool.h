@@ -0,0 +1,209 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+class FramePool;
+
+/**
+ * FrameBuffer - 引用计数的帧缓冲区
+ *
+ * 从FramePool分配，拷贝只增加引用计数，最后一个引用释放时缓冲区
+ * 无锁归还到所属的池。可以在采集、录像、转发等线程之间传递，各环节
+ * 共享同一份数据，不再各自拷贝。池中没有合适的缓冲区时从堆上分配
+ * （同样带引用计数），释放时直接归还给系统。
+ *
+ * 引用计数是线程安全的，但缓冲区内容不是：写入完成后再交给其他线程，
+ * 之后只读。缓冲区存活期间所属的池必须保持有效。
+ */
+class FrameBuffer {
+public:
+    FrameBuffer();
+    FrameBuffer(const FrameBuffer& other);
+    FrameBuffer(FrameBuffer&& other);
+    FrameBuffer& operator=(const FrameBuffer& other);
+    FrameBuffer& operator=(FrameBuffer&& other);
+    ~FrameBuffer();
+
+    // 是否持有缓冲区
+    explicit operator bool() const { return m_data != nullptr; }
+
+    uint8_t* data() { return m_data; }
+    const uint8_t* data() const { return m_data; }
+
+    // 有效数据长度
+    size_t size() const { return m_size; }
+
+    // 缓冲区容量
+    size_t capacity() const { return m_capacity; }
+
+    /**
+     * 设置有效数据长度
+     *
+     * @param size 数据长度（不能超过容量）
+     * @return 是否设置成功
+     */
+    bool setSize(size_t size);
+
+    // 释放引用
+    void reset();
+
+    // 当前引用数（仅用于统计和调试）
+    uint32_t useCount() const;
+
+    // 是否来自池（false表示堆上分配的后备缓冲区）
+    bool pooled() const { return m_pool != nullptr; }
+
+private:
+    friend class FramePool;
+
+    FrameBuffer(FramePool* pool, uint8_t* data, size_t size, size_t capacity, std::atomic<uint32_t>* refs);
+
+    FramePool* m_pool;                  // 所属的池，堆上分配时为nullptr
+    uint8_t* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    std::atomic<uint32_t>* m_refs;      // 引用计数
+};
+
+/**
+ * FramePool - 按尺寸分级的帧缓冲区池
+ *
+ * 每个尺寸等级预先分配一块连续内存（slab），切分为固定大小的缓冲区，
+ * 空闲缓冲区用带版本号的无锁栈管理，任意线程分配和归还都不加锁。
+ * 内存在构造时一次分配，运行中不增长，每路码流占用的内存可以预先确定；
+ * forStream按单帧最大长度（如APP_SYS_AV_VIDEO_FRAME_SIZE_100K）生成配置。
+ *
+ * 同一个池还可以作为gpac的分配器（见gpacMalloc），让封装时gpac内部的
+ * 样本缓冲区也从池中分配。
+ */
+class FramePool {
+public:
+    struct Config {
+        std::vector<size_t> classSizes;     // 各等级缓冲区大小（从小到大）
+        std::vector<size_t> classCounts;    // 各等级缓冲区个数
+        bool heapFallback;                  // 池中没有空闲缓冲区时是否从堆上分配
+
+        Config() : heapFallback(true) {}
+    };
+
+    // 单个等级的统计
+    struct ClassStats {
+        size_t bufferSize;                  // 缓冲区大小
+        size_t buffers;                     // 缓冲区个数
+        size_t inUse;                       // 使用中的个数
+        size_t highWater;                   // 使用中个数的历史最大值
+        uint64_t allocations;               // 分配次数
+        uint64_t exhausted;                 // 本等级已用完的次数
+    };
+
+    struct Stats {
+        std::vector<ClassStats> classes;
+        size_t slabBytes;                   // 预分配的内存总量
+        uint64_t heapAllocations;           // 后备堆分配次数
+        uint64_t failures;                  // 分配失败次数（池已用完且不允许堆分配，或堆分配失败）
+    };
+
+    /**
+     * 按单路码流的帧长上限生成配置
+     *
+     * 分为三个等级：max/16（不小于4KB，P帧）frames个、max/4有frames/4个、
+     * max（I帧）有frames/8个（都不少于2个）。小等级用完时借用大等级。
+     *
+     * @param maxFrameSize 单帧最大长度
+     * @param frames 同时在途的最大帧数
+     * @return 配置
+     */
+    static Config forStream(size_t maxFrameSize, size_t frames);
+
+    explicit FramePool(const Config& config);
+    ~FramePool();
+
+    /**
+     * 分配缓冲区（有效长度为size，内容未初始化）
+     *
+     * @param size 需要的长度
+     * @return 缓冲区，失败时为空
+     */
+    FrameBuffer allocate(size_t size);
+
+    /**
+     * 分配缓冲区并拷贝数据
+     *
+     * @param data 数据
+     * @param size 数据长度
+     * @return 缓冲区，失败时为空
+     */
+    FrameBuffer copy(const uint8_t* data, size_t size);
+
+    // 指针是否位于本池的slab内
+    bool owns(const void* ptr) const;
+
+    // 最大等级的缓冲区大小
+    size_t maxBufferSize() const;
+
+    // 统计信息
+    Stats stats() const;
+
+    /**
+     * 设置gpac分配器使用的池（nullptr表示全部使用系统分配）
+     *
+     * 池必须在gpac释放完从中分配的内存后才能销毁，通常在程序启动时设置一次。
+     *
+     * @param pool 池
+     */
+    static void setDefault(FramePool* pool);
+    static FramePool* getDefault();
+
+    // 与gf_malloc/gf_calloc/gf_realloc/gf_free兼容的分配函数：
+    // 不超过默认池最大等级的请求从池中分配，其余交给系统
+    static void* gpacMalloc(size_t size);
+    static void* gpacCalloc(size_t num, size_t size);
+    static void* gpacRealloc(void* ptr, size_t size);
+    static void gpacFree(void* ptr);
+
+private:
+    friend class FrameBuffer;
+
+    struct SizeClass {
+        size_t bufferSize;
+        size_t count;
+        uint8_t* base;                                      // 本等级在slab中的起始位置
+        std::unique_ptr<std::atomic<uint32_t>[]> refs;      // 每个缓冲区的引用计数
+        std::unique_ptr<std::atomic<uint32_t>[]> next;      // 空闲栈：下一个空闲缓冲区（序号+1，0表示没有）
+        std::atomic<uint64_t> freeHead;                     // 空闲栈顶：高32位版本号，低32位序号+1
+        std::atomic<size_t> inUse;
+        std::atomic<size_t> highWater;
+        std::atomic<uint64_t> allocations;
+        std::atomic<uint64_t> exhausted;
+    };
+
+    // 从等级中取一个空闲缓冲区，返回序号（-1表示已用完）
+    long popFree(SizeClass& sizeClass);
+
+    // 把缓冲区放回空闲栈
+    void pushFree(SizeClass& sizeClass, uint32_t index);
+
+    // 从池中取一个能容纳size的缓冲区，返回数据指针（失败返回nullptr）
+    uint8_t* take(size_t size, SizeClass** owner, uint32_t* index);
+
+    // 查找指针所在的等级和序号
+    SizeClass* locate(const void* ptr, uint32_t* index) const;
+
+    // 归还slab内的缓冲区
+    void release(const void* ptr);
+
+private:
+    std::vector<std::unique_ptr<SizeClass>> m_classes;
+    uint8_t* m_slab;
+    size_t m_slabBytes;
+    bool m_heapFallback;
+    std::atomic<uint64_t> m_heapAllocations;
+    std::atomic<uint64_t> m_failures;
+};
+
+#endif // FRAME_POOL_H
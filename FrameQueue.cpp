@@ -0,0 +1,45 @@
+#include "FrameQueue.h"
+
+FrameQueue::FrameQueue(size_t capacity)
+    : m_slots(capacity ? capacity : 1)
+    , m_head(0)
+    , m_tail(0)
+{
+}
+
+FrameQueue::Entry* FrameQueue::beginWrite()
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
+    if (tail - head >= m_slots.size()) {
+        return nullptr;
+    }
+    return &m_slots[tail % m_slots.size()];
+}
+
+void FrameQueue::commitWrite()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+FrameQueue::Entry* FrameQueue::front()
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    if (head == tail) {
+        return nullptr;
+    }
+    return &m_slots[head % m_slots.size()];
+}
+
+void FrameQueue::pop()
+{
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+size_t FrameQueue::size() const
+{
+    size_t head = m_head.load(std::memory_order_acquire);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    return tail - head;
+}
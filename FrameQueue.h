@@ -0,0 +1,89 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include "ParsedFrame.h"
+#include "FramePool.h"
+
+/**
+ * FrameQueue - 单生产者单消费者的无锁帧队列
+ *
+ * 固定容量的环形队列，生产者（采集回调线程）写入，消费者（封装线程）读取。
+ * 每个槽位的数据缓冲区跨帧复用，稳态下入队不分配内存。
+ */
+class FrameQueue {
+public:
+    // 队列条目类型
+    enum EntryType {
+        ENTRY_FRAME = 0,          // 视频帧
+        ENTRY_FRAGMENT_START,     // 开始分段
+        ENTRY_FRAGMENT_END,       // 结束分段
+        ENTRY_AUDIO,              // 音频帧
+        ENTRY_METADATA            // 元数据（param为事件类型）
+    };
+
+    // 队列条目
+    struct Entry {
+        EntryType type;
+        std::vector<uint8_t> data;                              // 帧数据（缓冲区复用）
+        std::shared_ptr<const ParsedFrame> frame;               // 已解析的帧（非空时代替data，处理后释放）
+        FrameBuffer buffer;                                     // 池中的帧缓冲区（非空时代替data，处理后释放）
+        bool isKeyFrame;                                        // 是否关键帧
+        int64_t pts;                                            // 显示时间戳
+        int64_t dts;                                            // 解码时间戳
+        uint32_t param;                                         // 附加参数（分段时长等）
+        std::chrono::steady_clock::time_point enqueueTime;      // 入队时间
+
+        Entry() : type(ENTRY_FRAME), isKeyFrame(false), pts(-1), dts(-1), param(0) {}
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param capacity 队列容量（条目数）
+     */
+    explicit FrameQueue(size_t capacity);
+
+    /**
+     * 获取可写入的槽位（仅生产者调用）
+     *
+     * @return 槽位指针，队列已满时返回nullptr
+     */
+    Entry* beginWrite();
+
+    /**
+     * 提交beginWrite获取的槽位（仅生产者调用）
+     */
+    void commitWrite();
+
+    /**
+     * 获取队首条目（仅消费者调用）
+     *
+     * @return 条目指针，队列为空时返回nullptr
+     */
+    Entry* front();
+
+    /**
+     * 弹出队首条目（仅消费者调用）
+     */
+    void pop();
+
+    // 当前队列深度
+    size_t size() const;
+
+    // 队列容量
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    std::vector<Entry> m_slots;
+    std::atomic<size_t> m_head;   // 消费者位置（单调递增）
+    std::atomic<size_t> m_tail;   // 生产者位置（单调递增）
+};
+
+#endif // FRAME_QUEUE_H
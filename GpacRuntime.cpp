@@ -0,0 +1,24 @@
+#include "GpacRuntime.h"
+#include <gpac/tools.h>
+#include <mutex>
+
+namespace {
+std::mutex g_runtimeMutex;
+int g_runtimeRefCount = 0;
+}
+
+void GpacRuntime::acquire()
+{
+    std::lock_guard<std::mutex> lock(g_runtimeMutex);
+    if (g_runtimeRefCount++ == 0) {
+        gf_sys_init(GF_MemTrackerNone);
+    }
+}
+
+void GpacRuntime::release()
+{
+    std::lock_guard<std::mutex> lock(g_runtimeMutex);
+    if (g_runtimeRefCount > 0 && --g_runtimeRefCount == 0) {
+        gf_sys_close();
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef GPAC_RUNTIME_H
+#define GPAC_RUNTIME_H
+
+/**
+ * GpacRuntime - 进程级GPAC初始化的引用计数
+ *
+ * 第一个使用者调用gf_sys_init，最后一个使用者退出时调用gf_sys_close，
+ * 避免每个H264MP4Writer/DashServer实例都重复初始化和清理GPAC。
+ */
+class GpacRuntime {
+public:
+    // 增加引用，必要时初始化GPAC
+    static void acquire();
+
+    // 减少引用，最后一个引用释放时清理GPAC
+    static void release();
+};
+
+#endif // GPAC_RUNTIME_H
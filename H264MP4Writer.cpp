@@ -1,30 +1,189 @@
 #include "H264MP4Writer.h"
+#include "StartCodeScanner.h"
+#include "GpacRuntime.h"
+#include "DashPackager.h"
 #include <gpac/internal/isomedia_dev.h>
+// media_dev.h没有extern "C"声明
+extern "C" {
+#include <gpac/internal/media_dev.h>
+}
+#include <gpac/avparse.h>
 #include <gpac/constants.h>
 #include <gpac/tools.h>
 #include <gpac/mpeg4_odf.h>
+#include <gpac/media_tools.h>
 #include <iostream>
 #include <sys/stat.h>
 #include <iomanip>
 #include <sstream>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <cmath>
+#include <algorithm>
+
+const int64_t H264MP4Writer::NO_TIMESTAMP;
+
+namespace {
+
+// FNV-1a哈希，用于在每个IDR上快速判断参数集是否变化
+uint64_t hashParameterSet(uint64_t hash, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    // 分隔符，避免相邻参数集拼接后哈希相同
+    hash ^= 0xFF;
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+// 预计切换前多少秒创建下一个文件
+const int NEXT_FILE_LEAD_SECONDS = 10;
+
+// RFC 6381 AVC编码字符串：样本描述类型.profile.兼容标志.level
+std::string avcCodecString(const GF_AVCConfig& config, bool inband)
+{
+    char codec[32];
+    snprintf(codec, sizeof(codec), "%s.%02X%02X%02X", inband ? "avc3" : "avc1",
+             config.AVCProfileIndication, config.profile_compatibility, config.AVCLevelIndication);
+    return codec;
+}
+
+// RFC 6381 HEVC编码字符串（ISO/IEC 14496-15附录E），格式与GPAC一致
+std::string hevcCodecString(const GF_HEVCConfig& config, bool inband)
+{
+    std::string codec = inband ? "hev1." : "hvc1.";
+    if (config.profile_space >= 1 && config.profile_space <= 3) {
+        codec += static_cast<char>('A' + config.profile_space - 1);
+    }
+    
+    // 兼容标志按位反转后用十六进制表示
+    u32 flags = config.general_profile_compatibility_flags;
+    u32 reversed = 0;
+    for (int i = 0; i < 32; i++) {
+        reversed = (reversed << 1) | (flags & 1);
+        flags >>= 1;
+    }
+    
+    char part[64];
+    snprintf(part, sizeof(part), "%u.%X.%c%u", config.profile_idc, reversed,
+             config.tier_flag ? 'H' : 'L', config.level_idc);
+    codec += part;
+    
+    // 6字节约束标志，省略末尾的零字节
+    uint8_t constraints[6];
+    constraints[0] = static_cast<uint8_t>((config.progressive_source_flag << 7) | (config.interlaced_source_flag << 6) |
+                                          (config.non_packed_constraint_flag << 5) | (config.frame_only_constraint_flag << 4) |
+                                          ((config.constraint_indicator_flags >> 40) & 0x0F));
+    for (int i = 1; i < 6; i++) {
+        constraints[i] = static_cast<uint8_t>(config.constraint_indicator_flags >> (40 - 8 * i));
+    }
+    int count = 6;
+    while (count > 0 && constraints[count - 1] == 0) {
+        count--;
+    }
+    for (int i = 0; i < count; i++) {
+        snprintf(part, sizeof(part), ".%X", constraints[i]);
+        codec += part;
+    }
+    
+    return codec;
+}
+
+} // namespace
 
 H264MP4Writer::H264MP4Writer()
     : m_width(0)
     , m_height(0)
     , m_frameRate(0.0f)
     , m_isH265(false)
+    , m_configuredCodec(-1)
+    , m_codec(codecOps<H264Traits>())
     , m_isRecording(false)
     , m_hasParameterSets(false)
     , m_mp4File(nullptr)
     , m_trackId(0)
+    , m_sampleDescIndex(1)
     , m_sampleDuration(0)
     , m_currentDTS(0)
+    , m_timebaseMul(90)
+    , m_timebaseDiv(1)
+    , m_frameTicksMul(3600)
+    , m_frameTicksDiv(1)
+    , m_frameIndex(0)
+    , m_reorderKnown(false)
+    , m_gopPocBase(0)
+    , m_gopIndexBase(0)
+    , m_lastFileDTS(-1)
+    , m_ctsClampCount(0)
+    , m_paramSetHash(0)
+    , m_inbandParameterSets(false)
+    , m_paramSetChangeCount(0)
     , m_isFragmented(false)
     , m_fragmentCount(0)
     , m_fragmentDuration(0)
+    , m_autoFragmentEnabled(false)
+    , m_fragmentOpen(false)
+    , m_fragmentInfo()
+    , m_compactFragments(false)
+    , m_liveEnabled(false)
+    , m_liveSegmentNumber(0)
+    , m_liveSegmentOpen(false)
+    , m_liveSegmentStart(-1)
+    , m_liveMarkDecodeTime(false)
+    , m_liveChunkFrames(0)
+    , m_liveChunkCount(0)
+    , m_liveChunkPending(false)
+    , m_liveSegmentBytes(0)
+    , m_lastPublishUs(0)
+    , m_sampleBuffer(nullptr)
+    , m_sampleBufferSize(0)
+    , m_heldBuffer(nullptr)
+    , m_heldBufferSize(0)
+    , m_hasHeldSample(false)
+    , m_heldDescIndex(1)
+    , m_lastSampleDuration(0)
+    , m_sampleAllocCount(0)
+    , m_framesWritten(0)
+    , m_durableEnabled(false)
+    , m_durableStarted(false)
+    , m_durableFragmentOpen(false)
+    , m_durableFragmentDTS(0)
+    , m_rotationEnabled(false)
+    , m_rotationCount(0)
+    , m_fileBytes(0)
+    , m_fileBaseTimestamp(NO_TIMESTAMP)
+    , m_nextFile(nullptr)
+    , m_nextTrackId(0)
+    , m_nextAudioTrackId(0)
+    , m_nextMetaTrackId(0)
+    , m_finalizeRunning(false)
+    , m_audioTrackId(0)
+    , m_metaTrackId(0)
+    , m_metaIndexSaved(0)
+    , m_lastVideoTime(NO_TIMESTAMP)
+    , m_asyncEnabled(false)
+    , m_overflowPolicy(OVERFLOW_BLOCK)
+    , m_muxRunning(false)
+    , m_dropUntilIDR(false)
+    , m_producerCodec(-1)
+    , m_maxQueueDepth(0)
+    , m_framesQueued(0)
+    , m_framesDropped(0)
+    , m_lastLatencyUs(0)
+    , m_maxLatencyUs(0)
+    , m_latencySumUs(0)
+    , m_latencyCount(0)
 {
-    // 初始化GPAC
-    gf_sys_init(GF_MemTrackerNone);
+    memset(&m_heldSample, 0, sizeof(GF_ISOSample));
+    
+    // 初始化GPAC（进程内引用计数，只有第一个实例真正初始化）
+    GpacRuntime::acquire();
 }
 
 H264MP4Writer::~H264MP4Writer()
@@ -34,8 +193,18 @@ H264MP4Writer::~H264MP4Writer()
         stopRecording();
     }
     
-    // 清理GPAC
-    gf_sys_close();
+    // 释放样本缓冲区
+    if (m_sampleBuffer) {
+        gf_free(m_sampleBuffer);
+        m_sampleBuffer = nullptr;
+    }
+    if (m_heldBuffer) {
+        gf_free(m_heldBuffer);
+        m_heldBuffer = nullptr;
+    }
+    
+    // 清理GPAC（最后一个实例退出时才真正清理）
+    GpacRuntime::release();
 }
 
 bool H264MP4Writer::init(int width, int height, float frameRate, int isH265)
@@ -48,11 +217,28 @@ bool H264MP4Writer::init(int width, int height, float frameRate, int isH265)
     m_width = width;
     m_height = height;
     m_frameRate = frameRate;
-    m_isH265 = (isH265 == -1) ? false : (isH265 != 0); // 默认为H264，等待自动检测
+    selectCodec(isH265 != -1 && isH265 != 0); // 默认为H264，等待自动检测
+    m_configuredCodec = (isH265 == -1) ? -1 : (isH265 != 0 ? 1 : 0);
     m_hasParameterSets = false;
     
-    // 计算采样持续时间 (timescale=1000 表示毫秒)
-    m_sampleDuration = static_cast<uint64_t>(90000 / frameRate);
+    // 帧率转为有理数（29.97等NTSC帧率按N*1000/1001处理），按帧序号换算时间戳不累计误差
+    uint64_t rateNum;
+    uint64_t rateDen;
+    double ntscRate = frameRate * 1.001;
+    if (std::fabs(frameRate - std::floor(frameRate + 0.5)) > 0.001 &&
+        std::fabs(ntscRate - std::floor(ntscRate + 0.5)) < 0.001) {
+        rateNum = static_cast<uint64_t>(std::floor(ntscRate + 0.5)) * 1000;
+        rateDen = 1001;
+    } else {
+        rateNum = static_cast<uint64_t>(std::floor(frameRate * 1000.0 + 0.5));
+        rateDen = 1000;
+    }
+    uint64_t g = TimestampEngine::gcd(90000 * rateDen, rateNum);
+    m_frameTicksMul = 90000 * rateDen / g;
+    m_frameTicksDiv = rateNum / g;
+    
+    // 采样持续时间（轨道timescale=90000）
+    m_sampleDuration = static_cast<uint64_t>(frameIndexToTicks(1));
     
     return true;
 }
@@ -101,67 +287,55 @@ bool H264MP4Writer::startRecording(const std::string& outputDir)
         #endif
     }
     
-    // 生成文件名
-    m_currentFilePath = outputDir + "/" + generateFileName();
+    // 防断电模式下moov在收到参数集后即写出，参数集变化只能带内传输
+    m_inbandParameterSets = m_durableEnabled;
+    m_sampleDescIndex = 1;
+    m_paramSetChangeCount = 0;
     
-    // 创建MP4文件
-    m_mp4File = gf_isom_open(m_currentFilePath.c_str(), GF_ISOM_OPEN_WRITE, NULL);
-    GF_Err err = m_mp4File ? GF_OK : GF_IO_ERR;
-    if (err != GF_OK) {
-        std::cerr << "Failed to create MP4 file: " << gf_error_to_string(err) << std::endl;
+    // 生成文件名并创建MP4文件
+    std::string filePath = uniqueFilePath();
+    m_mp4File = openRecordingFile(filePath, m_trackId, m_audioTrackId, m_metaTrackId);
+    if (!m_mp4File) {
         return false;
     }
-    
-    // 添加视频轨道
-    m_trackId = gf_isom_new_track(m_mp4File, 0, GF_ISOM_MEDIA_VISUAL, 90000);
-    if (!m_trackId) {
-        std::cerr << "Failed to create video track" << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(m_pathMutex);
+        m_currentFilePath = filePath;
     }
-    gf_isom_set_track_enabled(m_mp4File, m_trackId, 1);
+    m_durableStarted = false;
+    m_durableFragmentOpen = false;
     
+    // 记录开始时间
+    m_startTime = std::chrono::system_clock::now();
+    m_fileBytes = 0;
+    m_rotationCount = 0;
+    m_frameIndex = 0;
+    // 时间线按录制重新开始，切换文件时保持连续
+    m_tsEngine = TimestampEngine();
+    m_tsEngine.reset(static_cast<int64_t>(m_sampleDuration));
+    m_reorderKnown = false;
+    m_ctsClampCount = 0;
+    if (m_audio) {
+        m_audio->reset();
+    }
+    if (m_metadata) {
+        m_metadata->reset();
+    }
+    m_lastVideoTime = NO_TIMESTAMP;
+    resetFileTimestamps();
+    m_isRecording = true;
     
-    // 设置编解码器类型
-    if (m_isH265) {
-        // 使用临时空配置，后续会更新
-        GF_HEVCConfig *hevc_cfg = gf_odf_hevc_cfg_new();
-        u32 trackId = m_trackId;
-        err = gf_isom_hevc_config_new(m_mp4File, m_trackId, hevc_cfg, NULL, NULL, &trackId);
-        m_trackId = trackId;
-        gf_odf_hevc_cfg_del(hevc_cfg);
-    } else {
-        // 使用临时空配置，后续会更新
-        GF_AVCConfig *avc_cfg = gf_odf_avc_cfg_new();
-        u32 trackId = m_trackId;
-        err = gf_isom_avc_config_new(m_mp4File, m_trackId, avc_cfg, NULL, NULL, &trackId);
-        m_trackId = trackId;
-        gf_odf_avc_cfg_del(avc_cfg);
+    if (m_rotationEnabled) {
+        m_nextAlignedTime = nextAlignedRotation(m_startTime);
+        startFinalizeThread();
     }
     
-    if (err != GF_OK) {
-        std::cerr << "Failed to set codec config: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
-        return false;
-    }
-
+    // 封装线程启动前写入预录像，保证在实时帧之前
+    flushPreRecord();
     
-    // 设置视频参数
-    err = gf_isom_set_visual_info(m_mp4File, m_trackId, 1, m_width, m_height);
-    if (err != GF_OK) {
-        std::cerr << "Failed to set visual info: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
-        return false;
+    if (m_asyncEnabled) {
+        startMuxThread();
     }
-
-    
-    // 记录开始时间
-    m_startTime = std::chrono::system_clock::now();
-    m_currentDTS = 0;
-    m_isRecording = true;
     
     return true;
 }
@@ -172,32 +346,70 @@ bool H264MP4Writer::stopRecording()
         return false;
     }
     
+    // 异步模式下先写完队列中剩余的帧
+    stopMuxThread();
+    
     GF_Err err = GF_OK;
     
     // 如果是分段MP4，需要特殊处理
-    if (m_isFragmented) {
-        // 结束当前分段
+    if (m_isFragmented && m_liveEnabled) {
+        // 直播：发布最后一个分段，MPD标记为结束
+        publishLiveSegment(true);
+        reportFragment();
+        
+        err = gf_isom_close(m_mp4File);
+        if (err != GF_OK) {
+            std::cerr << "Failed to close MP4 file: " << gf_error_to_string(err) << std::endl;
+        }
+        saveMetadataIndex(m_metaIndex, getCurrentFilePath());
+        m_liveManifest.reset();
+        
+        // 内存流在文件关闭后才能释放
+        m_liveStream.reset();
+        m_liveSinks.clear();
+    } else if (m_isFragmented) {
+        // 结束当前分段（最后一帧沿用上一帧的时长）
         if (m_fragmentCount > 0) {
+            writeHeldSample(NO_TIMESTAMP);
             err = gf_isom_flush_fragments(m_mp4File, GF_TRUE);
             if (err != GF_OK) {
                 std::cerr << "Failed to flush fragments: " << gf_error_to_string(err) << std::endl;
             }
+            reportFragment();
         }
         
         // 完成分段MP4文件
         err = gf_isom_close(m_mp4File);
+        if (err != GF_OK) {
+            std::cerr << "Failed to close MP4 file: " << gf_error_to_string(err) << std::endl;
+        }
+        inspectFragments(getCurrentFilePath());
+        saveMetadataIndex(m_metaIndex, getCurrentFilePath());
     } else {
-        // 普通MP4文件直接关闭
-        err = gf_isom_close(m_mp4File);
+        // 写入暂存的最后一帧和剩余的音频、元数据（防断电模式下需在未写入的分片中）
+        if (!m_durableEnabled || m_durableFragmentOpen) {
+            writeHeldSample(NO_TIMESTAMP);
+            flushAudio(INT64_MAX);
+            flushMetadata(INT64_MAX);
+        }
+        
+        // 普通MP4文件直接关闭（防断电模式下先写入最后一个分片）
+        ClosingFile closing = { m_mp4File, getCurrentFilePath(), m_durableEnabled && m_durableStarted, m_durableFragmentOpen, m_metaIndex };
+        finalizeFile(closing);
     }
     
-    if (err != GF_OK) {
-        std::cerr << "Failed to close MP4 file: " << gf_error_to_string(err) << std::endl;
-    }
+    // 等待后台线程关闭之前切换下来的文件，删除未使用的预创建文件
+    stopFinalizeThread();
+    discardNextFile();
     
     m_mp4File = nullptr;
+    m_audioTrackId = 0;
+    m_metaTrackId = 0;
+    m_metaIndex.reset();
     m_isRecording = false;
     m_hasParameterSets = false;
+    m_durableStarted = false;
+    m_durableFragmentOpen = false;
     m_avcConfig.reset();
     m_hevcConfig.reset();
     m_isFragmented = false;
@@ -207,290 +419,1808 @@ bool H264MP4Writer::stopRecording()
 
 bool H264MP4Writer::writeFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp)
 {
-    if (!m_isRecording || !m_mp4File || !frameData || frameSize == 0) {
+    // 毫秒 -> 轨道时间（90kHz）
+    int64_t pts = (timestamp >= 0) ? TimestampEngine::rescale(timestamp, 90, 1) : NO_TIMESTAMP;
+    
+    return dispatchFrame(frameData, frameSize, isKeyFrame, pts, NO_TIMESTAMP);
+}
+
+bool H264MP4Writer::writeFrameTimed(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    if (pts != NO_TIMESTAMP) {
+        pts = TimestampEngine::rescale(pts, m_timebaseMul, m_timebaseDiv);
+    }
+    if (dts != NO_TIMESTAMP) {
+        dts = TimestampEngine::rescale(dts, m_timebaseMul, m_timebaseDiv);
+    }
+    
+    return dispatchFrame(frameData, frameSize, isKeyFrame, pts, dts);
+}
+
+bool H264MP4Writer::setTimebase(uint32_t num, uint32_t den)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change timebase while recording" << std::endl;
         return false;
     }
     
-    // 解析NALU
-    std::vector<std::pair<const uint8_t*, size_t>> nalus;
-    if (!parseNALU(frameData, frameSize, nalus) || nalus.empty()) {
-        std::cerr << "Failed to parse NALUs" << std::endl;
+    if (num == 0 || den == 0) {
+        std::cerr << "Invalid timebase" << std::endl;
         return false;
     }
     
-    // 自动检测编码类型（如果需要）
-    if (!m_hasParameterSets) {
-        // 检查是否需要自动检测
-        bool needDetect = false;
-        if (!m_hasParameterSets) {
-            // 检查第一个NALU的类型来判断是H264还是H265
-            bool isH265Detected = detectCodecType(frameData, frameSize);
-            
-            // 如果检测结果与当前设置不同，更新编码类型
-            if (isH265Detected != m_isH265) {
-                std::cout << "Auto-detected " << (isH265Detected ? "H265" : "H264") << " codec" << std::endl;
-                m_isH265 = isH265Detected;
-                
-                // 如果已经开始录制，需要重新配置编解码器
-                if (m_isRecording) {
-                    GF_Err err;
-                    if (m_isH265) {
-                        // 重新配置为H265编解码器
-                        GF_HEVCConfig *hevc_cfg = gf_odf_hevc_cfg_new();
-                        u32 trackId = m_trackId;
-                        err = gf_isom_hevc_config_new(m_mp4File, m_trackId, hevc_cfg, NULL, NULL, &trackId);
-                        m_trackId = trackId;
-                        gf_odf_hevc_cfg_del(hevc_cfg);
-                    } else {
-                        // 重新配置为H264编解码器
-                        GF_AVCConfig *avc_cfg = gf_odf_avc_cfg_new();
-                        u32 trackId = m_trackId;
-                        err = gf_isom_avc_config_new(m_mp4File, m_trackId, avc_cfg, NULL, NULL, &trackId);
-                        m_trackId = trackId;
-                        gf_odf_avc_cfg_del(avc_cfg);
-                    }
-                    
-                    if (err != GF_OK) {
-                        std::cerr << "Failed to set codec config: " << gf_error_to_string(err) << std::endl;
-                        return false;
-                    }
-                }
-            }
-        }
+    uint64_t g = TimestampEngine::gcd(90000ULL * num, den);
+    m_timebaseMul = 90000ULL * num / g;
+    m_timebaseDiv = den / g;
+    
+    return true;
+}
+
+bool H264MP4Writer::enableAudio(const AudioTrack::Config& config)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change audio track while recording" << std::endl;
+        return false;
     }
     
-    // 处理参数集
-    if (!m_hasParameterSets) {
-        if (m_isH265) {
-            // 查找VPS, SPS, PPS
-            const uint8_t* vps = nullptr;
-            size_t vpsSize = 0;
-            const uint8_t* sps = nullptr;
-            size_t spsSize = 0;
-            const uint8_t* pps = nullptr;
-            size_t ppsSize = 0;
-            
-            for (const auto& nalu : nalus) {
-                // 获取NALU类型 (H265: (nalu[0] & 0x7E) >> 1)
-                
-                uint8_t naluType = (nalu.first[0] & 0x7E) >> 1;
-                std::cout << "naluType = " << static_cast<int>(naluType) << std::endl;
-                if (naluType == 32) { // VPS
-                    vps = nalu.first;
-                    vpsSize = nalu.second;
-                } else if (naluType == 33) { // SPS
-                    sps = nalu.first;
-                    spsSize = nalu.second;
-                } else if (naluType == 34) { // PPS
-                    pps = nalu.first;
-                    ppsSize = nalu.second;
-                }
-            }
-            
-            if (vps && sps && pps) {
-                if (!processH265ParameterSets(vps, vpsSize, sps, spsSize, pps, ppsSize)) {
-                    std::cerr << "Failed to process H265 parameter sets" << std::endl;
-                    return false;
-                }
-                m_hasParameterSets = true;
-            }
-        } else {
-            // 查找SPS, PPS
-            const uint8_t* sps = nullptr;
-            size_t spsSize = 0;
-            const uint8_t* pps = nullptr;
-            size_t ppsSize = 0;
-            
-            for (const auto& nalu : nalus) {
-                // 获取NALU类型 (H264: nalu[0] & 0x1F)
-                uint8_t naluType = nalu.first[0] & 0x1F;
-                if (naluType == 7) { // SPS
-                    sps = nalu.first;
-                    spsSize = nalu.second;
-                } else if (naluType == 8) { // PPS
-                    pps = nalu.first;
-                    ppsSize = nalu.second;
-                }
-            }
-            
-            if (sps && pps) {
-                if (!processH264ParameterSets(sps, spsSize, pps, ppsSize)) {
-                    std::cerr << "Failed to process H264 parameter sets" << std::endl;
-                    return false;
-                }
-                m_hasParameterSets = true;
-            }
-        }
-        
-        // 如果没有找到参数集，返回等待下一帧
-        if (!m_hasParameterSets) {
-            return true;
-        }
+    if (!AudioTrack::isValid(config)) {
+        std::cerr << "Invalid audio config" << std::endl;
+        return false;
     }
     
-    // 准备样本数据
-    GF_ISOSample sample;
-    memset(&sample, 0, sizeof(GF_ISOSample));
+    m_audio.reset(new AudioTrack(config));
     
-    // 计算时间戳
-    if (timestamp >= 0) {
-        sample.DTS = timestamp;
-    } else {
-        sample.DTS = m_currentDTS;
-        m_currentDTS += m_sampleDuration;
+    return true;
+}
+
+void H264MP4Writer::disableAudio()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change audio track while recording" << std::endl;
+        return;
     }
     
-    sample.CTS_Offset = 0;
-    sample.IsRAP = isKeyFrame ? RAP : RAP_NO;
+    m_audio.reset();
+}
+
+bool H264MP4Writer::writeAudioFrame(const uint8_t* frameData, size_t frameSize, int64_t timestamp)
+{
+    if (!m_audio) {
+        std::cerr << "Audio track not enabled" << std::endl;
+        return false;
+    }
     
-    // 准备样本数据
-    size_t totalSize = 0;
-    for (const auto& nalu : nalus) {
-        // 跳过参数集NALU
-        uint8_t naluType;
-        if (m_isH265) {
-            naluType = (nalu.first[0] & 0x7E) >> 1;
-            if (naluType == 32 || naluType == 33 || naluType == 34) { // VPS, SPS, PPS
-                continue;
-            }
-        } else {
-            naluType = nalu.first[0] & 0x1F;
-            if (naluType == 7 || naluType == 8) { // SPS, PPS
-                continue;
-            }
-        }
-        
-        totalSize += nalu.second + 4; // 4字节为NALU长度前缀
+    if (!m_isRecording || !frameData || frameSize == 0) {
+        return false;
     }
     
-    if (totalSize == 0) {
-        // 只有参数集，没有实际数据
-        return true;
+    // 毫秒 -> 90kHz（与视频时间戳同一时间基，便于交织比较）
+    int64_t ts = (timestamp >= 0) ? TimestampEngine::rescale(timestamp, 90, 1) : NO_TIMESTAMP;
+    
+    if (m_muxRunning) {
+        return enqueueSideData(FrameQueue::ENTRY_AUDIO, frameData, frameSize, 0, ts);
     }
     
-    // 分配样本数据内存
-    sample.data = static_cast<char*>(gf_malloc(totalSize));
-    if (!sample.data) {
-        std::cerr << "Failed to allocate sample data memory" << std::endl;
+    return muxAudio(frameData, frameSize, ts);
+}
+
+bool H264MP4Writer::enableMetadata()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change metadata track while recording" << std::endl;
         return false;
     }
     
-    sample.dataLength = totalSize;
+    m_metadata.reset(new MetadataTrack());
     
-    // 填充样本数据
-    u8* ptr = reinterpret_cast<u8*>(sample.data);
-    for (const auto& nalu : nalus) {
-        // 跳过参数集NALU
-        uint8_t naluType;
-        if (m_isH265) {
-            naluType = (nalu.first[0] & 0x7E) >> 1;
-            if (naluType == 32 || naluType == 33 || naluType == 34) { // VPS, SPS, PPS
-                continue;
-            }
-        } else {
-            naluType = nalu.first[0] & 0x1F;
-            if (naluType == 7 || naluType == 8) { // SPS, PPS
-                continue;
-            }
-        }
-        
-        // 写入NALU长度前缀 (4字节大端)
-        uint32_t naluSize = nalu.second;
-        ptr[0] = (naluSize >> 24) & 0xFF;
-        ptr[1] = (naluSize >> 16) & 0xFF;
-        ptr[2] = (naluSize >> 8) & 0xFF;
-        ptr[3] = naluSize & 0xFF;
-        ptr += 4;
-        
-        // 写入NALU数据
-        memcpy(ptr, nalu.first, naluSize);
-        ptr += naluSize;
+    return true;
+}
+
+void H264MP4Writer::disableMetadata()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change metadata track while recording" << std::endl;
+        return;
     }
     
-    // 添加样本到轨道
-    GF_Err err;
-    if (m_isFragmented) {
-        // 使用分段MP4的添加样本方法
-        err = gf_isom_fragment_add_sample(m_mp4File, m_trackId, &sample,
-                                         1, // StreamDescriptionIndex
-                                         m_sampleDuration, // Duration
-                                         0, // PaddingBits
-                                         0, // DegradationPriority
-                                         GF_FALSE); // redundantCoding
-    } else {
-        // 使用普通MP4的添加样本方法
-        err = gf_isom_add_sample(m_mp4File, m_trackId, 1, &sample);
+    m_metadata.reset();
+}
+
+bool H264MP4Writer::writeMetadata(const uint8_t* data, size_t size, uint32_t eventType, int64_t timestamp)
+{
+    if (!m_metadata) {
+        std::cerr << "Metadata track not enabled" << std::endl;
+        return false;
     }
     
-    if (err != GF_OK) {
-        std::cerr << "Failed to add sample: " << gf_error_to_string(err) << std::endl;
-        gf_free(sample.data);
+    if (!m_isRecording || !data || size == 0) {
+        return false;
+    }
+    
+    // 毫秒 -> 90kHz（与视频时间戳同一时间基）
+    int64_t ts = (timestamp >= 0) ? TimestampEngine::rescale(timestamp, 90, 1) : NO_TIMESTAMP;
+    
+    if (m_muxRunning) {
+        return enqueueSideData(FrameQueue::ENTRY_METADATA, data, size, eventType, ts);
+    }
+    
+    return muxMetadata(data, size, eventType, ts);
+}
+
+bool H264MP4Writer::muxMetadata(const uint8_t* data, size_t size, uint32_t eventType, int64_t timestamp)
+{
+    if (!m_isRecording || !m_mp4File || !m_metadata) {
         return false;
     }
     
-    // 释放样本数据内存
-    gf_free(sample.data);
+    // 在下一帧视频写入前交织写入
+    m_metadata->push(data, size, eventType, timestamp, m_lastVideoTime);
     
     return true;
 }
 
-std::string H264MP4Writer::getCurrentFilePath() const
+bool H264MP4Writer::flushMetadata(int64_t until)
 {
-    return m_currentFilePath;
+    if (!m_metadata || !m_metaTrackId || m_fileBaseTimestamp == NO_TIMESTAMP) {
+        return true;
+    }
+    
+    return m_metadata->flush(m_mp4File, m_metaTrackId, m_isFragmented || m_durableEnabled, m_fileBaseTimestamp, until,
+                             m_metaIndex.get());
 }
 
-bool H264MP4Writer::initFragmentedMP4(int width, int height, float frameRate, int isH265, const std::string& outputDir)
+void H264MP4Writer::saveMetadataIndex(const std::shared_ptr<MetadataIndex>& index, const std::string& mp4Path)
 {
-    if (m_isRecording) {
-        std::cerr << "Already recording" << std::endl;
+    if (!index || index->empty()) {
+        return;
+    }
+    
+    if (!index->save(MetadataIndex::pathFor(mp4Path))) {
+        std::cerr << "Failed to save metadata index: " << MetadataIndex::pathFor(mp4Path) << std::endl;
+    }
+}
+
+bool H264MP4Writer::muxAudio(const uint8_t* frameData, size_t frameSize, int64_t timestamp)
+{
+    if (!m_isRecording || !m_mp4File || !m_audio) {
         return false;
     }
     
-    // 初始化基本参数
-    if (!init(width, height, frameRate, isH265)) {
+    if (!m_audio->push(frameData, frameSize, timestamp)) {
         return false;
     }
     
-    // 设置分段MP4标志
-    m_isFragmented = true;
-    m_fragmentCount = 0;
-    m_dashOutputDir = outputDir;
+    // 视频落后超过1秒时不再等待，直接写入；
+    // 分段模式下音频只能随视频写入调用方打开的分段
+    if (m_isFragmented || (m_durableEnabled && !m_durableFragmentOpen)) {
+        return true;
+    }
     
-    // 确保输出目录存在
-    struct stat st;
-    if (stat(outputDir.c_str(), &st) != 0) {
-        // 目录不存在，创建目录
-        #ifdef _WIN32
-        // Windows平台
-        if (system(("mkdir \"" + outputDir + "\"").c_str()) != 0) {
-            std::cerr << "Failed to create output directory: " << outputDir << std::endl;
-            return false;
-        }
-        #else
-        // Linux/Unix平台
-        if (system(("mkdir -p \"" + outputDir + "\"").c_str()) != 0) {
-            std::cerr << "Failed to create output directory: " << outputDir << std::endl;
-            return false;
+    return flushAudio(m_audio->newestTime() - 90000);
+}
+
+bool H264MP4Writer::flushAudio(int64_t until)
+{
+    // 文件从第一个视频帧开始，此前的音频留在缓冲中
+    if (!m_audio || !m_audioTrackId || m_fileBaseTimestamp == NO_TIMESTAMP) {
+        return true;
+    }
+    
+    return m_audio->flush(m_mp4File, m_audioTrackId, m_isFragmented || m_durableEnabled, m_fileBaseTimestamp, until);
+}
+
+bool H264MP4Writer::dispatchFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    // 未录制时写入预录像缓冲区
+    if (!m_isRecording) {
+        std::lock_guard<std::mutex> lock(m_preRecordMutex);
+        if (m_preRecord) {
+            return m_preRecord->push(frameData, frameSize, isKeyFrame, pts, dts);
         }
-        #endif
     }
     
-    // 生成文件名
-    m_currentFilePath = outputDir + "/" + generateFileName();
+    if (m_muxRunning) {
+        return enqueueFrame(frameData, frameSize, isKeyFrame, pts, dts);
+    }
     
-    // 创建分段MP4文件
-    m_mp4File = gf_isom_open(m_currentFilePath.c_str(), GF_ISOM_OPEN_WRITE, NULL);
-    GF_Err err = m_mp4File ? GF_OK : GF_IO_ERR;
-    if (err != GF_OK) {
-        std::cerr << "Failed to create fragmented MP4 file: " << gf_error_to_string(err) << std::endl;
+    return muxFrame(frameData, frameSize, isKeyFrame, pts, dts);
+}
+
+bool H264MP4Writer::writeParsedFrame(const std::shared_ptr<const ParsedFrame>& frame)
+{
+    if (!frame || !m_isRecording) {
         return false;
     }
     
-    // 设置为分段模式
-    // 注意：gf_isom_set_fragmented函数在当前GPAC版本中不存在
-    // 我们使用GF_ISOM_WRITE_EDIT标志来创建可编辑的MP4文件，这是分段MP4所必需的
-    // GF_ISOM_OPEN_WRITE和GF_ISOM_WRITE_EDIT是互斥的文件打开模式，不应该通过位运算组合使用
-    /*err = gf_isom_set_fragmented(m_mp4File, 1);*/
+    if (m_muxRunning) {
+        return enqueueParsedFrame(frame);
+    }
+    
+    return muxParsedFrame(*frame);
+}
+
+bool H264MP4Writer::writeFrameBuffer(const FrameBuffer& buffer, bool isKeyFrame, int64_t timestamp)
+{
+    if (!buffer || buffer.size() == 0) {
+        return false;
+    }
+    
+    // 毫秒 -> 轨道时间（90kHz）
+    int64_t pts = (timestamp >= 0) ? TimestampEngine::rescale(timestamp, 90, 1) : NO_TIMESTAMP;
+    
+    // 异步模式只入队引用；其余情况写入时就用完了数据，与writeFrame相同
+    if (m_isRecording && m_muxRunning) {
+        return enqueueFrameBuffer(buffer, isKeyFrame, pts, NO_TIMESTAMP);
+    }
+    
+    return dispatchFrame(buffer.data(), buffer.size(), isKeyFrame, pts, NO_TIMESTAMP);
+}
+
+bool H264MP4Writer::muxFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    if (!m_isRecording || !m_mp4File || !frameData || frameSize == 0) {
+        return false;
+    }
+    
+    // 解析NALU（复用成员列表，容量不足时才会分配）
+    std::vector<NALUnit>& nalus = m_nalus;
+    size_t naluCapacity = nalus.capacity();
+    if (!parseNALU(frameData, frameSize, nalus) || nalus.empty()) {
+        std::cerr << "Failed to parse NALUs" << std::endl;
+        return false;
+    }
+    if (nalus.capacity() != naluCapacity) {
+        m_sampleAllocCount++;
+    }
+    
+    bool ready = false;
+    if (!prepareFrame(nalus, isKeyFrame, ready)) {
+        return false;
+    }
+    if (!ready) {
+        return true;
+    }
+    
+    // 准备样本数据（长度前缀格式拷贝到样本缓冲区）
+    GF_ISOSample sample;
+    memset(&sample, 0, sizeof(GF_ISOSample));
+    bool hasSliceData = false;
+    if (!(this->*m_codec.buildSample)(nalus, isKeyFrame, sample, hasSliceData)) {
+        return false;
+    }
+    if (!hasSliceData) {
+        return true;
+    }
+    
+    return writeVideoSample(sample, nalus, isKeyFrame, pts, dts);
+}
+
+bool H264MP4Writer::muxParsedFrame(const ParsedFrame& frame)
+{
+    if (!m_isRecording || !m_mp4File) {
+        return false;
+    }
+    
+    const std::vector<NALUnit>& nalus = frame.nalus();
+    bool isKeyFrame = frame.isKeyFrame();
+    bool ready = false;
+    if (!prepareFrame(nalus, isKeyFrame, ready)) {
+        return false;
+    }
+    if (!ready || !frame.hasSliceData()) {
+        return true;
+    }
+    
+    // 帧已是长度前缀格式且参数集在前：去掉参数集的样本就是缓冲区尾部，直接交给GPAC；
+    // 编码判断不一致或带内参数集需要补前缀时按普通帧拷贝
+    GF_ISOSample sample;
+    memset(&sample, 0, sizeof(GF_ISOSample));
+    bool needPrefix = m_inbandParameterSets && isKeyFrame && !frame.hasParamSets();
+    if (frame.isH265() == m_isH265 && !needPrefix) {
+        const uint8_t* data = m_inbandParameterSets ? frame.data() : frame.sampleData();
+        sample.data = const_cast<char*>(reinterpret_cast<const char*>(data));
+        sample.dataLength = static_cast<u32>(m_inbandParameterSets ? frame.size() : frame.sampleSize());
+    } else {
+        bool hasSliceData = false;
+        if (!(this->*m_codec.buildSample)(nalus, isKeyFrame, sample, hasSliceData)) {
+            return false;
+        }
+        if (!hasSliceData) {
+            return true;
+        }
+    }
+    
+    return writeVideoSample(sample, nalus, isKeyFrame, frame.pts(), frame.dts());
+}
+
+bool H264MP4Writer::prepareFrame(const std::vector<NALUnit>& nalus, bool isKeyFrame, bool& ready)
+{
+    ready = true;
+    
+    // 自动检测编码类型（如果需要）
+    if (!m_hasParameterSets) {
+        // 根据已解析的NALU类型判断是H264还是H265
+        bool isH265Detected = detectCodecType(nalus);
+        
+        // 如果检测结果与当前设置不同，更新编码类型
+        if (isH265Detected != m_isH265) {
+            std::cout << "Auto-detected " << (isH265Detected ? "H265" : "H264") << " codec" << std::endl;
+            selectCodec(isH265Detected);
+            
+            // 如果已经开始录制，需要重新配置编解码器（新增样本描述，后续样本使用它）
+            if (m_isRecording) {
+                GF_Err err;
+                u32 descIndex = 0;
+                if (m_isH265) {
+                    GF_HEVCConfig *hevc_cfg = gf_odf_hevc_cfg_new();
+                    err = gf_isom_hevc_config_new(m_mp4File, m_trackId, hevc_cfg, NULL, NULL, &descIndex);
+                    gf_odf_hevc_cfg_del(hevc_cfg);
+                } else {
+                    GF_AVCConfig *avc_cfg = gf_odf_avc_cfg_new();
+                    err = gf_isom_avc_config_new(m_mp4File, m_trackId, avc_cfg, NULL, NULL, &descIndex);
+                    gf_odf_avc_cfg_del(avc_cfg);
+                }
+                
+                if (err != GF_OK) {
+                    std::cerr << "Failed to set codec config: " << gf_error_to_string(err) << std::endl;
+                    return false;
+                }
+                m_sampleDescIndex = descIndex;
+            }
+        }
+    }
+    
+    // 处理参数集：首次收到时配置轨道，之后在每个IDR处检查是否变化
+    if (!m_hasParameterSets || isKeyFrame) {
+        if (!updateParameterSets(nalus)) {
+            return false;
+        }
+        
+        // 如果没有找到参数集，等待下一帧
+        if (!m_hasParameterSets) {
+            ready = false;
+            return true;
+        }
+    }
+    
+    // 文件切换在writeVideoSample中IDR处进行；临近切换时在非关键帧提前
+    // 创建下一个文件，避免在IDR处打开文件
+    if (m_rotationEnabled && !m_nextFile && !isKeyFrame &&
+        expectedRotationTime() - std::chrono::system_clock::now() <= std::chrono::seconds(NEXT_FILE_LEAD_SECONDS)) {
+        prepareNextFile();
+    }
+    
+    return true;
+}
+
+template <typename Traits>
+bool H264MP4Writer::buildSample(const std::vector<NALUnit>& nalus, bool isKeyFrame, GF_ISOSample& sample, bool& hasSliceData)
+{
+    // 计算样本总长度（跳过参数集NALU，带内参数集模式下保留）
+    bool stripParamSets = !m_inbandParameterSets;
+    bool hasParamSets = false;
+    hasSliceData = false;
+    size_t totalSize = 0;
+    for (const auto& nalu : nalus) {
+        bool isParamSet = Traits::isParameterSet(nalu.data[0]);
+        hasParamSets = hasParamSets || isParamSet;
+        hasSliceData = hasSliceData || !isParamSet;
+        if (!stripParamSets || !isParamSet) {
+            totalSize += nalu.size + 4; // 4字节为NALU长度前缀
+        }
+    }
+    
+    if (!hasSliceData) {
+        // 只有参数集，没有实际数据
+        return true;
+    }
+    
+    // 带内参数集模式：IDR中没有参数集时在样本前补上当前参数集
+    size_t prefixSize = (m_inbandParameterSets && isKeyFrame && !hasParamSets) ? m_paramSetPrefix.size() : 0;
+    totalSize += prefixSize;
+    
+    // 样本缓冲区按最大访问单元复用，稳态下不分配内存
+    if (!reserveSampleBuffer(totalSize)) {
+        std::cerr << "Failed to allocate sample data memory" << std::endl;
+        return false;
+    }
+    
+    sample.data = reinterpret_cast<char*>(m_sampleBuffer);
+    sample.dataLength = totalSize;
+    
+    // 填充样本数据
+    // 连续的4字节起始码NALU整段拷贝一次，再原地把起始码改写为长度前缀；
+    // 3字节起始码的NALU单独写前缀并拷贝
+    u8* ptr = m_sampleBuffer;
+    if (prefixSize > 0) {
+        memcpy(ptr, m_paramSetPrefix.data(), prefixSize);
+        ptr += prefixSize;
+    }
+    size_t i = 0;
+    while (i < nalus.size()) {
+        if (stripParamSets && Traits::isParameterSet(nalus[i].data[0])) {
+            i++;
+            continue;
+        }
+        
+        if (nalus[i].startCodeLen == 4) {
+            // 向后扩展连续区间
+            size_t j = i + 1;
+            while (j < nalus.size() && !(stripParamSets && Traits::isParameterSet(nalus[j].data[0])) && nalus[j].startCodeLen == 4 &&
+                   nalus[j].data - 4 == nalus[j - 1].data + nalus[j - 1].size) {
+                j++;
+            }
+            
+            const uint8_t* runStart = nalus[i].data - 4;
+            size_t runSize = nalus[j - 1].data + nalus[j - 1].size - runStart;
+            memcpy(ptr, runStart, runSize);
+            
+            // 起始码原地改写为4字节大端长度
+            for (size_t k = i; k < j; k++) {
+                u8* prefix = ptr + (nalus[k].data - 4 - runStart);
+                uint32_t naluSize = nalus[k].size;
+                prefix[0] = (naluSize >> 24) & 0xFF;
+                prefix[1] = (naluSize >> 16) & 0xFF;
+                prefix[2] = (naluSize >> 8) & 0xFF;
+                prefix[3] = naluSize & 0xFF;
+            }
+            
+            ptr += runSize;
+            i = j;
+        } else {
+            // 写入NALU长度前缀 (4字节大端)
+            uint32_t naluSize = nalus[i].size;
+            ptr[0] = (naluSize >> 24) & 0xFF;
+            ptr[1] = (naluSize >> 16) & 0xFF;
+            ptr[2] = (naluSize >> 8) & 0xFF;
+            ptr[3] = naluSize & 0xFF;
+            ptr += 4;
+            
+            // 写入NALU数据
+            memcpy(ptr, nalus[i].data, naluSize);
+            ptr += naluSize;
+            i++;
+        }
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::writeVideoSample(GF_ISOSample& sample, const std::vector<NALUnit>& nalus, bool isKeyFrame,
+                                     int64_t pts, int64_t dts)
+{
+    sample.IsRAP = isKeyFrame ? RAP : RAP_NO;
+    
+    // 计算时间戳（每个文件的DTS从0开始，有B帧时写入合成时间偏移）
+    bool timed = (pts != NO_TIMESTAMP || dts != NO_TIMESTAMP);
+    assignTimestamps(nalus, isKeyFrame, pts, dts);
+    
+    // 文件切换：只在IDR处切换，保证新文件从关键帧开始。早于本IDR的音频和
+    // 元数据写入旧文件，其余留在缓冲中写入新文件；切换失败时继续写当前文件，
+    // 下一个IDR再试
+    if (m_rotationEnabled && isKeyFrame && isRotationDue()) {
+        if (m_hasHeldSample && !writeHeldSample(dts - m_fileBaseTimestamp)) {
+            return false;
+        }
+        if (!m_durableEnabled || m_durableFragmentOpen) {
+            if (m_audio && !flushAudio(dts - 1)) {
+                std::cerr << "Failed to write audio samples" << std::endl;
+            }
+            if (m_metadata && !flushMetadata(dts - 1)) {
+                std::cerr << "Failed to write metadata samples" << std::endl;
+            }
+        }
+        rotateFile();
+    }
+    
+    uint64_t sampleDTS = 0;
+    int32_t ctsOffset = 0;
+    computeTimestamps(pts, dts, sampleDTS, ctsOffset);
+    sample.DTS = sampleDTS;
+    sample.CTS_Offset = ctsOffset;
+    
+    // 分片中的样本时长需在写入时给出：上一帧暂存到本帧，时长取两帧DTS之差
+    bool fragmented = m_isFragmented || m_durableEnabled;
+    if (fragmented && !writeHeldSample(static_cast<int64_t>(sample.DTS))) {
+        return false;
+    }
+    
+    // 自动分段：在写入本帧之前切分（此时m_currentDTS仍为上一个分段的结束时间）
+    if (m_autoFragmentEnabled && m_isFragmented && !cutAutoFragment(sample.DTS, isKeyFrame)) {
+        return false;
+    }
+    
+    // 防断电模式：按配置切分分片
+    if (m_durableEnabled && !cutDurableFragment(sample.DTS, isKeyFrame)) {
+        return false;
+    }
+    
+    // 低延迟直播：上一个块已写出，先开始新的块再写入本帧及之前的音频和元数据
+    if (m_liveChunkPending) {
+        m_liveChunkPending = false;
+        GF_Err chunkErr = gf_isom_start_fragment(m_mp4File, GF_TRUE);
+        if (chunkErr != GF_OK) {
+            std::cerr << "Failed to start live chunk: " << gf_error_to_string(chunkErr) << std::endl;
+            return false;
+        }
+        applyCompactFragmentOptions();
+        m_liveMarkDecodeTime = true;
+        if (m_audio) {
+            m_audio->markFragmentStart();
+        }
+        if (m_metadata) {
+            m_metadata->markFragmentStart();
+        }
+    }
+    
+    // 先写入时间不晚于本帧的音频和元数据，mdat中按时间交织
+    m_lastVideoTime = m_fileBaseTimestamp + static_cast<int64_t>(sample.DTS);
+    if (m_audio) {
+        m_audio->setUseTimestamps(timed);
+        if (!flushAudio(m_lastVideoTime)) {
+            std::cerr << "Failed to write audio samples" << std::endl;
+        }
+    }
+    if (m_metadata) {
+        m_metadata->setUseTimestamps(timed);
+        if (!flushMetadata(m_lastVideoTime)) {
+            std::cerr << "Failed to write metadata samples" << std::endl;
+        }
+    }
+    
+    // 添加样本到轨道（分片模式下暂存到下一帧）
+    if (fragmented) {
+        if (!holdSample(sample)) {
+            return false;
+        }
+    } else {
+        GF_Err err = gf_isom_add_sample(m_mp4File, m_trackId, m_sampleDescIndex, &sample);
+        if (err != GF_OK) {
+            std::cerr << "Failed to add sample: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+        m_currentDTS = sample.DTS + m_sampleDuration;
+        countVideoSample(sample);
+    }
+    
+    // 低延迟直播：每N帧写出一个块
+    if (m_liveSegmentOpen && m_liveConfig.chunkFrames > 0 && ++m_liveChunkFrames >= m_liveConfig.chunkFrames) {
+        return flushLiveChunk();
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::holdSample(const GF_ISOSample& sample)
+{
+    // 样本在样本缓冲区中时与暂存缓冲区交换，直接引用帧数据时拷贝
+    if (sample.data == reinterpret_cast<char*>(m_sampleBuffer)) {
+        std::swap(m_sampleBuffer, m_heldBuffer);
+        std::swap(m_sampleBufferSize, m_heldBufferSize);
+    } else {
+        if (sample.dataLength > m_heldBufferSize) {
+            uint8_t* buffer = static_cast<uint8_t*>(gf_malloc(sample.dataLength));
+            if (!buffer) {
+                std::cerr << "Failed to allocate sample data memory" << std::endl;
+                return false;
+            }
+            if (m_heldBuffer) {
+                gf_free(m_heldBuffer);
+            }
+            m_heldBuffer = buffer;
+            m_heldBufferSize = sample.dataLength;
+            m_sampleAllocCount++;
+        }
+        memcpy(m_heldBuffer, sample.data, sample.dataLength);
+    }
+    
+    m_heldSample = sample;
+    m_heldSample.data = reinterpret_cast<char*>(m_heldBuffer);
+    m_heldDescIndex = m_sampleDescIndex;
+    m_hasHeldSample = true;
+    
+    return true;
+}
+
+bool H264MP4Writer::writeHeldSample(int64_t nextDTS)
+{
+    if (!m_hasHeldSample) {
+        return true;
+    }
+    m_hasHeldSample = false;
+    
+    GF_ISOSample& sample = m_heldSample;
+    uint64_t duration = m_lastSampleDuration;
+    if (nextDTS != NO_TIMESTAMP && nextDTS > static_cast<int64_t>(sample.DTS)) {
+        duration = static_cast<uint64_t>(nextDTS) - sample.DTS;
+    }
+    
+    // 直播：分段第一帧的DTS作为时间线起点，每个块的第一帧设置tfdt
+    if (m_liveSegmentOpen && m_liveMarkDecodeTime) {
+        if (m_liveSegmentStart < 0) {
+            m_liveSegmentStart = static_cast<int64_t>(sample.DTS);
+        }
+        gf_isom_set_traf_base_media_decode_time(m_mp4File, m_trackId, sample.DTS);
+        m_liveMarkDecodeTime = false;
+    }
+    
+    GF_Err err = gf_isom_fragment_add_sample(m_mp4File, m_trackId, &sample,
+                                             m_heldDescIndex, // StreamDescriptionIndex
+                                             static_cast<u32>(duration), // Duration
+                                             0, // PaddingBits
+                                             0, // DegradationPriority
+                                             GF_FALSE); // redundantCoding
+    if (err != GF_OK) {
+        std::cerr << "Failed to add sample: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    m_lastSampleDuration = duration;
+    m_currentDTS = sample.DTS + duration;
+    countVideoSample(sample);
+    
+    return true;
+}
+
+void H264MP4Writer::countVideoSample(const GF_ISOSample& sample)
+{
+    m_framesWritten++;
+    m_fileBytes += sample.dataLength;
+    
+    // 当前分段统计
+    if (m_fragmentOpen) {
+        if (m_fragmentInfo.frames == 0) {
+            m_fragmentInfo.firstDTS = sample.DTS;
+            m_fragmentInfo.startsWithIDR = sample.IsRAP == RAP;
+        }
+        m_fragmentInfo.frames++;
+        m_fragmentInfo.bytes += sample.dataLength;
+    }
+}
+
+void H264MP4Writer::assignTimestamps(const std::vector<NALUnit>& nalus, bool isKeyFrame, int64_t& pts, int64_t& dts)
+{
+    uint64_t frameIndex = m_frameIndex++;
+    
+    // 只有DTS时按无重排序处理
+    if (pts == NO_TIMESTAMP) {
+        pts = dts;
+    }
+    
+    // 没有时间戳：按帧率计算，可能有重排序时用POC确定显示顺序
+    if (pts == NO_TIMESTAMP) {
+        uint64_t displayIndex = frameIndex;
+        if (!m_reorderKnown || m_tsEngine.reorderDepth() > 0) {
+            int32_t poc = 0;
+            bool hasPoc = false;
+            for (const auto& nalu : nalus) {
+                if (m_pocParser.parse(nalu.data, nalu.size, poc)) {
+                    hasPoc = true;
+                    break;
+                }
+            }
+            
+            if (hasPoc) {
+                if (isKeyFrame) {
+                    m_gopPocBase = poc;
+                    m_gopIndexBase = frameIndex;
+                }
+                // H264每帧POC加2，H265加1
+                int64_t offset = static_cast<int64_t>(poc - m_gopPocBase) / m_codec.pocStep;
+                if (static_cast<int64_t>(m_gopIndexBase) + offset >= 0) {
+                    displayIndex = m_gopIndexBase + offset;
+                }
+            }
+        }
+        pts = frameIndexToTicks(displayIndex);
+    }
+    
+    if (dts == NO_TIMESTAMP) {
+        dts = m_tsEngine.assign(pts);
+    }
+}
+
+void H264MP4Writer::computeTimestamps(int64_t pts, int64_t dts, uint64_t& sampleDTS, int32_t& ctsOffset)
+{
+    // 每个文件的时间从第一个DTS开始
+    if (m_fileBaseTimestamp == NO_TIMESTAMP) {
+        m_fileBaseTimestamp = dts;
+    }
+    int64_t fileDTS = dts - m_fileBaseTimestamp;
+    if (fileDTS <= m_lastFileDTS) {
+        fileDTS = m_lastFileDTS + 1;  // DTS必须严格递增
+    }
+    
+    int64_t offset = pts - m_fileBaseTimestamp - fileDTS;
+    if (offset < 0) {
+        // 重排序深度还在学习中或调用方时间戳抖动
+        offset = 0;
+        m_ctsClampCount++;
+    } else if (offset > INT32_MAX) {
+        offset = INT32_MAX;
+    }
+    
+    m_lastFileDTS = fileDTS;
+    sampleDTS = static_cast<uint64_t>(fileDTS);
+    ctsOffset = static_cast<int32_t>(offset);
+}
+
+int64_t H264MP4Writer::frameIndexToTicks(uint64_t index) const
+{
+    return TimestampEngine::rescale(static_cast<int64_t>(index), m_frameTicksMul, m_frameTicksDiv);
+}
+
+void H264MP4Writer::updateReorderDepth(const uint8_t* sps, size_t spsSize)
+{
+    uint32_t depth = 0;
+    m_reorderKnown = PocParser::readReorderDepth(m_isH265, sps, spsSize, depth);
+    if (m_reorderKnown) {
+        m_tsEngine.setReorderDepth(depth);
+    }
+    m_pocParser.reset(m_isH265);
+}
+
+void H264MP4Writer::resetFileTimestamps()
+{
+    m_currentDTS = 0;
+    m_fileBaseTimestamp = NO_TIMESTAMP;
+    m_lastFileDTS = -1;
+    m_hasHeldSample = false;
+    m_lastSampleDuration = m_sampleDuration;
+    if (m_audio) {
+        m_audio->resetFile();
+    }
+    
+    // 元数据样本序号和事件索引按文件重新开始
+    if (m_metadata) {
+        m_metadata->resetFile();
+        int64_t startMs = std::chrono::duration_cast<std::chrono::milliseconds>(m_startTime.time_since_epoch()).count();
+        m_metaIndex = std::make_shared<MetadataIndex>(startMs);
+        m_metaIndexSaved = 0;
+    }
+}
+
+std::string H264MP4Writer::getCurrentFilePath() const
+{
+    std::lock_guard<std::mutex> lock(m_pathMutex);
+    return m_currentFilePath;
+}
+
+double H264MP4Writer::getAllocationsPerFrame() const
+{
+    if (m_framesWritten == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(m_sampleAllocCount) / static_cast<double>(m_framesWritten);
+}
+
+template <typename Traits>
+unsigned H264MP4Writer::findParameterSets(const std::vector<NALUnit>& nalus, const uint8_t* paramSets[PARAM_SET_SLOTS],
+                                          size_t paramSetSizes[PARAM_SET_SLOTS])
+{
+    unsigned found = 0;
+    for (int i = 0; i < PARAM_SET_SLOTS; i++) {
+        paramSets[i] = nullptr;
+        paramSetSizes[i] = 0;
+    }
+    
+    // 同一类型出现多次时取最后一个
+    for (const auto& nalu : nalus) {
+        int slot = Traits::paramSetSlot(nalu.data[0]);
+        if (slot >= 0) {
+            paramSets[slot] = nalu.data;
+            paramSetSizes[slot] = nalu.size;
+            found |= 1u << slot;
+        }
+    }
+    
+    return found;
+}
+
+template <typename Traits>
+H264MP4Writer::CodecOps H264MP4Writer::codecOps()
+{
+    CodecOps ops;
+    ops.name = Traits::name();
+    ops.pocStep = Traits::POC_STEP;
+    ops.requiredParamSets = Traits::REQUIRED_PARAM_SETS;
+    ops.buildSample = &H264MP4Writer::buildSample<Traits>;
+    ops.findParameterSets = &H264MP4Writer::findParameterSets<Traits>;
+    return ops;
+}
+
+void H264MP4Writer::selectCodec(bool isH265)
+{
+    m_isH265 = isH265;
+    m_codec = isH265 ? codecOps<H265Traits>() : codecOps<H264Traits>();
+}
+
+bool H264MP4Writer::reserveSampleBuffer(size_t size)
+{
+    if (size <= m_sampleBufferSize) {
+        return true;
+    }
+    
+    // 扩容到当前访问单元大小，旧数据无需保留
+    uint8_t* buffer = static_cast<uint8_t*>(gf_malloc(size));
+    if (!buffer) {
+        return false;
+    }
+    
+    if (m_sampleBuffer) {
+        gf_free(m_sampleBuffer);
+    }
+    m_sampleBuffer = buffer;
+    m_sampleBufferSize = size;
+    m_sampleAllocCount++;
+    
+    return true;
+}
+
+bool H264MP4Writer::enableDurableMode(const DurableConfig& config)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change durable mode while recording" << std::endl;
+        return false;
+    }
+    
+    if (config.fragmentDurationMs == 0 && !config.fragmentAtIDR) {
+        std::cerr << "Durable mode needs a fragment duration or IDR fragmentation" << std::endl;
+        return false;
+    }
+    
+    m_durableConfig = config;
+    m_durableEnabled = true;
+    
+    return true;
+}
+
+void H264MP4Writer::disableDurableMode()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change durable mode while recording" << std::endl;
+        return;
+    }
+    
+    m_durableEnabled = false;
+}
+
+bool H264MP4Writer::beginDurableFragments()
+{
+    // 写入ftyp和moov（此时编解码器配置已完整）
+    GF_Err err = gf_isom_finalize_for_fragment(m_mp4File, 0);
+    if (err != GF_OK) {
+        std::cerr << "Failed to finalize for fragment: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    if (m_durableConfig.syncToDisk) {
+        syncFileToDisk(m_mp4File);
+    }
+    
+    m_durableStarted = true;
+    m_durableFragmentOpen = false;
+    
+    return true;
+}
+
+bool H264MP4Writer::cutDurableFragment(uint64_t dts, bool isKeyFrame)
+{
+    bool cut = !m_durableFragmentOpen;
+    if (!cut && isKeyFrame && m_durableConfig.fragmentAtIDR) {
+        cut = true;
+    }
+    if (!cut && m_durableConfig.fragmentDurationMs > 0 &&
+        dts - m_durableFragmentDTS >= static_cast<uint64_t>(m_durableConfig.fragmentDurationMs) * 90) {
+        cut = true;
+    }
+    
+    if (!cut) {
+        return true;
+    }
+    
+    // 写入上一个分片并落盘
+    if (m_durableFragmentOpen) {
+        GF_Err err = gf_isom_flush_fragments(m_mp4File, GF_FALSE);
+        if (err != GF_OK) {
+            std::cerr << "Failed to flush fragment: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+        if (m_durableConfig.syncToDisk) {
+            syncFileToDisk(m_mp4File);
+        }
+        
+        // 事件索引随分片更新，断电后已落盘的分片仍可按事件查询
+        if (m_metaIndex && m_metaIndex->size() != m_metaIndexSaved) {
+            saveMetadataIndex(m_metaIndex, getCurrentFilePath());
+            m_metaIndexSaved = m_metaIndex->size();
+        }
+    }
+    
+    GF_Err err = gf_isom_start_fragment(m_mp4File, GF_TRUE);
+    if (err != GF_OK) {
+        std::cerr << "Failed to start fragment: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    m_durableFragmentOpen = true;
+    m_durableFragmentDTS = dts;
+    
+    return true;
+}
+
+void H264MP4Writer::flushFileBuffers(GF_ISOFile* file)
+{
+    if (!file || !file->editFileMap || file->editFileMap->type != GF_ISOM_DATA_FILE) {
+        return;
+    }
+    
+    GF_FileDataMap* fileMap = reinterpret_cast<GF_FileDataMap*>(file->editFileMap);
+    if (fileMap->bs) {
+        gf_bs_flush(fileMap->bs);
+    }
+    if (fileMap->stream) {
+        fflush(fileMap->stream);
+    }
+}
+
+void H264MP4Writer::syncFileToDisk(GF_ISOFile* file)
+{
+    flushFileBuffers(file);
+    
+    if (!file || !file->editFileMap || file->editFileMap->type != GF_ISOM_DATA_FILE) {
+        return;
+    }
+    
+    GF_FileDataMap* fileMap = reinterpret_cast<GF_FileDataMap*>(file->editFileMap);
+    if (fileMap->stream) {
+        #ifdef _WIN32
+        _commit(_fileno(fileMap->stream));
+        #else
+        fdatasync(fileno(fileMap->stream));
+        #endif
+    }
+}
+
+bool H264MP4Writer::defragmentFile(const std::string& path)
+{
+    // 以编辑模式打开时GPAC会把所有moof合并进moov的样本表
+    GF_ISOFile* file = gf_isom_open(path.c_str(), GF_ISOM_OPEN_EDIT, NULL);
+    if (!file) {
+        std::cerr << "Failed to open fragmented file: " << path << std::endl;
+        return false;
+    }
+    
+    // moov前置，一次顺序写出
+    std::string tmpPath = path + ".defrag";
+    gf_isom_set_final_name(file, const_cast<char*>(tmpPath.c_str()));
+    gf_isom_set_storage_mode(file, GF_ISOM_STORE_STREAMABLE);
+    
+    GF_Err err = gf_isom_close(file);
+    if (err != GF_OK) {
+        std::cerr << "Failed to defragment file: " << gf_error_to_string(err) << std::endl;
+        remove(tmpPath.c_str());
+        return false;
+    }
+    
+    // 转换成功后替换原文件
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace fragmented file: " << path << std::endl;
+        remove(tmpPath.c_str());
+        return false;
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::finalizeFile(const ClosingFile& closing)
+{
+    GF_Err err = GF_OK;
+    
+    // 防断电模式：写入最后一个分片
+    if (closing.durableStarted && closing.fragmentOpen) {
+        err = gf_isom_flush_fragments(closing.file, GF_TRUE);
+        if (err != GF_OK) {
+            std::cerr << "Failed to flush fragments: " << gf_error_to_string(err) << std::endl;
+        }
+        if (m_durableConfig.syncToDisk) {
+            syncFileToDisk(closing.file);
+        }
+    }
+    
+    err = gf_isom_close(closing.file);
+    if (err != GF_OK) {
+        std::cerr << "Failed to close MP4 file: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    // 样本序号在转换前后不变，索引可以先写
+    saveMetadataIndex(closing.index, closing.path);
+    
+    // 转换为moov前置的普通MP4
+    if (closing.durableStarted && m_durableConfig.defragmentOnStop) {
+        return defragmentFile(closing.path);
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::setRotationPolicy(const RotationPolicy& policy)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change rotation policy while recording" << std::endl;
+        return false;
+    }
+    
+    m_rotationPolicy = policy;
+    m_rotationEnabled = policy.intervalMinutes > 0 || policy.alignMinutes > 0 || policy.maxBytes > 0;
+    
+    return true;
+}
+
+bool H264MP4Writer::isRotationDue() const
+{
+    if (m_fileBytes == 0) {
+        return false;
+    }
+    
+    if (m_rotationPolicy.maxBytes > 0 && m_fileBytes >= m_rotationPolicy.maxBytes) {
+        return true;
+    }
+    
+    if (m_rotationPolicy.intervalMinutes == 0 && m_rotationPolicy.alignMinutes == 0) {
+        return false;
+    }
+    
+    auto now = std::chrono::system_clock::now();
+    if (m_rotationPolicy.intervalMinutes > 0 &&
+        now - m_startTime >= std::chrono::minutes(m_rotationPolicy.intervalMinutes)) {
+        return true;
+    }
+    
+    return m_rotationPolicy.alignMinutes > 0 && now >= m_nextAlignedTime;
+}
+
+std::chrono::system_clock::time_point H264MP4Writer::expectedRotationTime() const
+{
+    auto now = std::chrono::system_clock::now();
+    auto due = std::chrono::system_clock::time_point::max();
+    
+    // 按大小切换：按当前文件的平均码率估算写满的时间
+    if (m_rotationPolicy.maxBytes > 0 && m_fileBytes > 0) {
+        double remaining = static_cast<double>(m_rotationPolicy.maxBytes) - static_cast<double>(m_fileBytes);
+        double elapsed = std::chrono::duration<double>(now - m_startTime).count();
+        double seconds = std::max(0.0, elapsed * remaining / static_cast<double>(m_fileBytes));
+        if (seconds < 86400.0) {
+            due = now + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(seconds));
+        }
+    }
+    
+    if (m_rotationPolicy.intervalMinutes > 0) {
+        due = std::min(due, m_startTime + std::chrono::minutes(m_rotationPolicy.intervalMinutes));
+    }
+    if (m_rotationPolicy.alignMinutes > 0) {
+        due = std::min(due, m_nextAlignedTime);
+    }
+    
+    return std::max(due, now);
+}
+
+std::chrono::system_clock::time_point H264MP4Writer::nextAlignedRotation(std::chrono::system_clock::time_point now) const
+{
+    if (m_rotationPolicy.alignMinutes == 0) {
+        return std::chrono::system_clock::time_point::max();
+    }
+    
+    // 按本地时间从当天0点起对齐
+    std::time_t time = std::chrono::system_clock::to_time_t(now);
+    std::tm tm = *std::localtime(&time);
+    long secondsOfDay = tm.tm_hour * 3600L + tm.tm_min * 60L + tm.tm_sec;
+    long period = m_rotationPolicy.alignMinutes * 60L;
+    
+    return std::chrono::system_clock::from_time_t(time + (period - secondsOfDay % period));
+}
+
+std::string H264MP4Writer::uniqueFilePath(std::chrono::system_clock::time_point time) const
+{
+    std::string name = generateFileName(time);
+    std::string path = m_outputDir + "/" + name;
+    
+    // 同一秒内切换多次时追加序号
+    struct stat st;
+    std::string base = name.substr(0, name.size() - 4);
+    for (int i = 1; stat(path.c_str(), &st) == 0; i++) {
+        path = m_outputDir + "/" + base + "_" + std::to_string(i) + ".mp4";
+    }
+    
+    return path;
+}
+
+bool H264MP4Writer::prepareNextFile()
+{
+    if (m_nextFile) {
+        return true;
+    }
+    
+    // 直接以预计切换时间命名，切换时无需重命名已打开的文件
+    std::string path = uniqueFilePath(expectedRotationTime());
+    GF_ISOFile* file = openRecordingFile(path, m_nextTrackId, m_nextAudioTrackId, m_nextMetaTrackId);
+    if (!file) {
+        return false;
+    }
+    
+    // 参数集沿用当前文件
+    if (!applyParameterSets(file, m_nextTrackId, 1)) {
+        gf_isom_delete(file);
+        remove(path.c_str());
+        return false;
+    }
+    
+    m_nextFile = file;
+    m_nextFilePath = path;
+    
+    return true;
+}
+
+bool H264MP4Writer::rotateFile()
+{
+    // 没能提前创建（如全I帧码流）时在此同步创建
+    if (!prepareNextFile()) {
+        std::cerr << "Failed to prepare next file, keep writing current file" << std::endl;
+        return false;
+    }
+    
+    std::string path = m_nextFilePath;
+    
+    // 旧文件交给后台线程关闭
+    ClosingFile closing = { m_mp4File, getCurrentFilePath(), m_durableEnabled && m_durableStarted, m_durableFragmentOpen, m_metaIndex };
+    {
+        std::lock_guard<std::mutex> lock(m_finalizeMutex);
+        m_finalizeQueue.push_back(closing);
+    }
+    m_finalizeCond.notify_one();
+    
+    m_mp4File = m_nextFile;
+    m_trackId = m_nextTrackId;
+    m_audioTrackId = m_nextAudioTrackId;
+    m_metaTrackId = m_nextMetaTrackId;
+    m_sampleDescIndex = 1;
+    m_nextFile = nullptr;
+    m_nextFilePath.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_pathMutex);
+        m_currentFilePath = path;
+    }
+    
+    m_startTime = std::chrono::system_clock::now();
+    m_nextAlignedTime = nextAlignedRotation(m_startTime);
+    m_fileBytes = 0;
+    m_rotationCount++;
+    resetFileTimestamps();
+    
+    // 防断电模式：新文件的moov此时即可写入
+    m_durableStarted = false;
+    m_durableFragmentOpen = false;
+    if (m_durableEnabled && !beginDurableFragments()) {
+        return false;
+    }
+    
+    return true;
+}
+
+void H264MP4Writer::discardNextFile()
+{
+    if (!m_nextFile) {
+        return;
+    }
+    
+    gf_isom_delete(m_nextFile);
+    remove(m_nextFilePath.c_str());
+    m_nextFile = nullptr;
+    m_nextFilePath.clear();
+}
+
+void H264MP4Writer::startFinalizeThread()
+{
+    if (m_finalizeRunning) {
+        return;
+    }
+    
+    m_finalizeRunning = true;
+    m_finalizeThread = std::thread(&H264MP4Writer::finalizeThreadLoop, this);
+}
+
+void H264MP4Writer::stopFinalizeThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_finalizeMutex);
+        if (!m_finalizeRunning) {
+            return;
+        }
+        m_finalizeRunning = false;
+    }
+    m_finalizeCond.notify_one();
+    
+    if (m_finalizeThread.joinable()) {
+        m_finalizeThread.join();
+    }
+}
+
+void H264MP4Writer::finalizeThreadLoop()
+{
+    std::unique_lock<std::mutex> lock(m_finalizeMutex);
+    while (true) {
+        m_finalizeCond.wait(lock, [this] { return !m_finalizeRunning || !m_finalizeQueue.empty(); });
+        
+        // 停止时先关闭完所有文件
+        if (m_finalizeQueue.empty()) {
+            break;
+        }
+        
+        ClosingFile closing = m_finalizeQueue.front();
+        m_finalizeQueue.pop_front();
+        lock.unlock();
+        
+        finalizeFile(closing);
+        
+        lock.lock();
+    }
+}
+
+bool H264MP4Writer::enablePreRecord(uint32_t durationMs, size_t maxBytes)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change pre-record mode while recording" << std::endl;
+        return false;
+    }
+    
+    if (durationMs == 0 || maxBytes == 0) {
+        std::cerr << "Invalid pre-record duration or buffer size" << std::endl;
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_preRecordMutex);
+    m_preRecord.reset(new PreRecordBuffer(maxBytes, durationMs, 90000));
+    
+    return true;
+}
+
+void H264MP4Writer::disablePreRecord()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change pre-record mode while recording" << std::endl;
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_preRecordMutex);
+    m_preRecord.reset();
+}
+
+PreRecordBuffer::Stats H264MP4Writer::getPreRecordStats() const
+{
+    std::lock_guard<std::mutex> lock(m_preRecordMutex);
+    if (!m_preRecord) {
+        PreRecordBuffer::Stats stats;
+        memset(&stats, 0, sizeof(stats));
+        return stats;
+    }
+    
+    return m_preRecord->stats();
+}
+
+void H264MP4Writer::flushPreRecord()
+{
+    std::lock_guard<std::mutex> lock(m_preRecordMutex);
+    if (!m_preRecord) {
+        return;
+    }
+    
+    // 按原时间戳写入，缓冲区总是从关键帧开始（写入帧数计入framesFlushed统计）
+    m_preRecord->drain([this](const PreRecordBuffer::Frame& frame) {
+        if (!muxFrame(frame.data, frame.size, frame.isKeyFrame, frame.pts, frame.dts)) {
+            std::cerr << "Failed to write pre-record frame" << std::endl;
+        }
+    });
+}
+
+bool H264MP4Writer::enableAsync(size_t queueCapacity, OverflowPolicy policy)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change async mode while recording" << std::endl;
+        return false;
+    }
+    
+    if (queueCapacity == 0) {
+        std::cerr << "Invalid async queue capacity" << std::endl;
+        return false;
+    }
+    
+    m_frameQueue.reset(new FrameQueue(queueCapacity));
+    m_overflowPolicy = policy;
+    m_asyncEnabled = true;
+    
+    return true;
+}
+
+void H264MP4Writer::disableAsync()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change async mode while recording" << std::endl;
+        return;
+    }
+    
+    m_asyncEnabled = false;
+    m_frameQueue.reset();
+}
+
+H264MP4Writer::AsyncStats H264MP4Writer::getAsyncStats() const
+{
+    AsyncStats stats;
+    stats.queueDepth = m_frameQueue ? m_frameQueue->size() : 0;
+    stats.maxQueueDepth = m_maxQueueDepth;
+    stats.queueCapacity = m_frameQueue ? m_frameQueue->capacity() : 0;
+    stats.framesQueued = m_framesQueued;
+    stats.framesDropped = m_framesDropped;
+    
+    uint64_t count = m_latencyCount;
+    stats.lastLatencyMs = m_lastLatencyUs / 1000.0;
+    stats.avgLatencyMs = count ? (m_latencySumUs / 1000.0) / count : 0.0;
+    stats.maxLatencyMs = m_maxLatencyUs / 1000.0;
+    
+    return stats;
+}
+
+void H264MP4Writer::startMuxThread()
+{
+    if (m_muxRunning || !m_frameQueue) {
+        return;
+    }
+    
+    m_dropUntilIDR = false;
+    // 自动检测时由生产者线程从第一个关键帧重新确定（封装线程的检测结果不在生产者线程读取）
+    m_producerCodec = m_configuredCodec;
+    m_maxQueueDepth = 0;
+    m_framesQueued = 0;
+    m_framesDropped = 0;
+    m_lastLatencyUs = 0;
+    m_maxLatencyUs = 0;
+    m_latencySumUs = 0;
+    m_latencyCount = 0;
+    
+    m_muxRunning = true;
+    m_muxThread = std::thread(&H264MP4Writer::muxThreadLoop, this);
+}
+
+void H264MP4Writer::stopMuxThread()
+{
+    if (!m_muxRunning) {
+        return;
+    }
+    
+    m_muxRunning = false;
+    m_dataCond.notify_one();
+    if (m_muxThread.joinable()) {
+        m_muxThread.join();
+    }
+}
+
+void H264MP4Writer::muxThreadLoop()
+{
+    while (true) {
+        FrameQueue::Entry* entry = m_frameQueue->front();
+        if (!entry) {
+            // 停止时队列已经写完
+            if (!m_muxRunning) {
+                break;
+            }
+            
+            // 生产者通知不加锁，用超时兜底避免丢失唤醒
+            std::unique_lock<std::mutex> lock(m_asyncMutex);
+            m_dataCond.wait_for(lock, std::chrono::milliseconds(5));
+            continue;
+        }
+        
+        switch (entry->type) {
+        case FrameQueue::ENTRY_FRAME:
+            if (entry->frame) {
+                // 尽早释放引用，分发端可以回收帧对象
+                if (!muxParsedFrame(*entry->frame)) {
+                    std::cerr << "Failed to write queued frame" << std::endl;
+                }
+                entry->frame.reset();
+            } else if (entry->buffer) {
+                if (!muxFrame(entry->buffer.data(), entry->buffer.size(), entry->isKeyFrame, entry->pts, entry->dts)) {
+                    std::cerr << "Failed to write queued frame" << std::endl;
+                }
+                entry->buffer.reset();
+            } else if (!muxFrame(entry->data.data(), entry->data.size(), entry->isKeyFrame, entry->pts, entry->dts)) {
+                std::cerr << "Failed to write queued frame" << std::endl;
+            }
+            break;
+        case FrameQueue::ENTRY_FRAGMENT_START:
+            doStartFragment(entry->param);
+            break;
+        case FrameQueue::ENTRY_FRAGMENT_END:
+            doEndFragment();
+            break;
+        case FrameQueue::ENTRY_AUDIO:
+            if (!muxAudio(entry->data.data(), entry->data.size(), entry->pts)) {
+                std::cerr << "Failed to write queued audio frame" << std::endl;
+            }
+            break;
+        case FrameQueue::ENTRY_METADATA:
+            if (!muxMetadata(entry->data.data(), entry->data.size(), entry->param, entry->pts)) {
+                std::cerr << "Failed to write queued metadata" << std::endl;
+            }
+            break;
+        }
+        
+        if (entry->type == FrameQueue::ENTRY_FRAME) {
+            uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - entry->enqueueTime).count();
+            m_lastLatencyUs = latencyUs;
+            m_latencySumUs += latencyUs;
+            m_latencyCount++;
+            if (latencyUs > m_maxLatencyUs) {
+                m_maxLatencyUs = latencyUs;
+            }
+        }
+        
+        m_frameQueue->pop();
+        m_spaceCond.notify_one();
+    }
+}
+
+FrameQueue::Entry* H264MP4Writer::waitForSlot()
+{
+    FrameQueue::Entry* entry = m_frameQueue->beginWrite();
+    while (!entry && m_muxRunning) {
+        std::unique_lock<std::mutex> lock(m_asyncMutex);
+        m_spaceCond.wait_for(lock, std::chrono::milliseconds(5));
+        lock.unlock();
+        entry = m_frameQueue->beginWrite();
+    }
+    return entry;
+}
+
+bool H264MP4Writer::enqueueFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    if (!frameData || frameSize == 0) {
+        return false;
+    }
+    
+    detectProducerCodec(frameData, frameSize, isKeyFrame);
+    
+    bool dropped = false;
+    FrameQueue::Entry* entry = acquireFrameSlot(isKeyFrame, [&]() { return isReferenceFrame(frameData, frameSize); }, dropped);
+    if (!entry) {
+        return dropped;
+    }
+    
+    // 槽位缓冲区复用，容量不足时才会分配
+    entry->type = FrameQueue::ENTRY_FRAME;
+    entry->data.assign(frameData, frameData + frameSize);
+    entry->isKeyFrame = isKeyFrame;
+    entry->pts = pts;
+    entry->dts = dts;
+    entry->param = 0;
+    entry->enqueueTime = std::chrono::steady_clock::now();
+    m_frameQueue->commitWrite();
+    m_dataCond.notify_one();
+    
+    m_framesQueued++;
+    size_t depth = m_frameQueue->size();
+    if (depth > m_maxQueueDepth) {
+        m_maxQueueDepth = depth;
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::enqueueParsedFrame(const std::shared_ptr<const ParsedFrame>& frame)
+{
+    bool dropped = false;
+    FrameQueue::Entry* entry = acquireFrameSlot(frame->isKeyFrame(), [&]() { return frame->isReference(); }, dropped);
+    if (!entry) {
+        return dropped;
+    }
+    
+    // 只保存引用，帧数据不拷贝
+    entry->type = FrameQueue::ENTRY_FRAME;
+    entry->data.clear();
+    entry->frame = frame;
+    entry->isKeyFrame = frame->isKeyFrame();
+    entry->pts = frame->pts();
+    entry->dts = frame->dts();
+    entry->param = 0;
+    entry->enqueueTime = std::chrono::steady_clock::now();
+    m_frameQueue->commitWrite();
+    m_dataCond.notify_one();
+    
+    m_framesQueued++;
+    size_t depth = m_frameQueue->size();
+    if (depth > m_maxQueueDepth) {
+        m_maxQueueDepth = depth;
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::enqueueFrameBuffer(const FrameBuffer& buffer, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    detectProducerCodec(buffer.data(), buffer.size(), isKeyFrame);
+    
+    bool dropped = false;
+    FrameQueue::Entry* entry = acquireFrameSlot(isKeyFrame, [&]() { return isReferenceFrame(buffer.data(), buffer.size()); }, dropped);
+    if (!entry) {
+        return dropped;
+    }
+    
+    // 只增加引用计数，帧数据不拷贝
+    entry->type = FrameQueue::ENTRY_FRAME;
+    entry->data.clear();
+    entry->buffer = buffer;
+    entry->isKeyFrame = isKeyFrame;
+    entry->pts = pts;
+    entry->dts = dts;
+    entry->param = 0;
+    entry->enqueueTime = std::chrono::steady_clock::now();
+    m_frameQueue->commitWrite();
+    m_dataCond.notify_one();
+    
+    m_framesQueued++;
+    size_t depth = m_frameQueue->size();
+    if (depth > m_maxQueueDepth) {
+        m_maxQueueDepth = depth;
+    }
+    
+    return true;
+}
+
+FrameQueue::Entry* H264MP4Writer::acquireFrameSlot(bool isKeyFrame, const std::function<bool()>& isReference, bool& dropped)
+{
+    dropped = false;
+    
+    // 丢帧直到下一个IDR
+    if (m_dropUntilIDR && !isKeyFrame) {
+        m_framesDropped++;
+        dropped = true;
+        return nullptr;
+    }
+    
+    FrameQueue::Entry* entry = m_frameQueue->beginWrite();
+    if (!entry) {
+        switch (m_overflowPolicy) {
+        case OVERFLOW_DROP_TO_IDR:
+            m_dropUntilIDR = true;
+            m_framesDropped++;
+            dropped = true;
+            return nullptr;
+        case OVERFLOW_DROP_NON_REFERENCE:
+            if (!isKeyFrame && !isReference()) {
+                m_framesDropped++;
+                dropped = true;
+                return nullptr;
+            }
+            entry = waitForSlot();
+            break;
+        case OVERFLOW_BLOCK:
+        default:
+            entry = waitForSlot();
+            break;
+        }
+        
+        if (!entry) {
+            return nullptr;
+        }
+    }
+    
+    m_dropUntilIDR = false;
+    
+    return entry;
+}
+
+bool H264MP4Writer::enqueueSideData(FrameQueue::EntryType type, const uint8_t* data, size_t size, uint32_t param, int64_t timestamp)
+{
+    // 音频帧和元数据很小，队列满时只在阻塞策略下等待，否则直接丢弃
+    FrameQueue::Entry* entry = m_frameQueue->beginWrite();
+    if (!entry && m_overflowPolicy == OVERFLOW_BLOCK) {
+        entry = waitForSlot();
+    }
+    if (!entry) {
+        m_framesDropped++;
+        return m_overflowPolicy != OVERFLOW_BLOCK;
+    }
+    
+    entry->type = type;
+    entry->data.assign(data, data + size);
+    entry->isKeyFrame = false;
+    entry->pts = timestamp;
+    entry->dts = NO_TIMESTAMP;
+    entry->param = param;
+    entry->enqueueTime = std::chrono::steady_clock::now();
+    m_frameQueue->commitWrite();
+    m_dataCond.notify_one();
+    
+    return true;
+}
+
+bool H264MP4Writer::enqueueControl(FrameQueue::EntryType type, uint32_t param)
+{
+    FrameQueue::Entry* entry = waitForSlot();
+    if (!entry) {
+        return false;
+    }
+    
+    entry->type = type;
+    entry->data.clear();
+    entry->isKeyFrame = false;
+    entry->pts = NO_TIMESTAMP;
+    entry->dts = NO_TIMESTAMP;
+    entry->param = param;
+    entry->enqueueTime = std::chrono::steady_clock::now();
+    m_frameQueue->commitWrite();
+    m_dataCond.notify_one();
+    
+    return true;
+}
+
+bool H264MP4Writer::isReferenceFrame(const uint8_t* frameData, size_t frameSize)
+{
+    // 编码未确定时不能按H264规则判断（H265的TRAIL_R会被当成nal_ref_idc为0的非参考帧），都按参考帧处理
+    if (m_producerCodec < 0) {
+        return true;
+    }
+    
+    int result = (m_producerCodec == 1) ? scanReference<H265Traits>(frameData, frameSize)
+                                        : scanReference<H264Traits>(frameData, frameSize);
+    
+    // 无法判断时按参考帧处理
+    return result != 0;
+}
+
+void H264MP4Writer::detectProducerCodec(const uint8_t* frameData, size_t frameSize, bool isKeyFrame)
+{
+    // 编码确定后不再扫描；参数集随关键帧到达
+    if (m_producerCodec >= 0 || !isKeyFrame) {
+        return;
+    }
+    m_producerCodec = detectAnnexBCodec(frameData, frameSize);
+}
+
+int H264MP4Writer::detectAnnexBCodec(const uint8_t* frameData, size_t frameSize)
+{
+    const uint8_t* end = frameData + frameSize;
+    int startCodeLen = 0;
+    int codec = -1;
+    for (const uint8_t* p = StartCodeScanner::find(frameData, end, &startCodeLen);
+         p != end && p + startCodeLen < end;
+         p = StartCodeScanner::find(p + startCodeLen, end, &startCodeLen)) {
+        uint8_t header = p[startCodeLen];
+        
+        // 只有H265有VPS；H265的其他NALU头按H264解读时可能与SPS相同，找到VPS为准
+        if (H265Traits::isVPS(header)) {
+            return 1;
+        }
+        if (H264Traits::nalType(header) == H264Traits::SPS) {
+            codec = 0;
+        }
+    }
+    
+    return codec;
+}
+
+template <typename Traits>
+int H264MP4Writer::scanReference(const uint8_t* frameData, size_t frameSize)
+{
+    const uint8_t* end = frameData + frameSize;
+    int startCodeLen = 0;
+    const uint8_t* p = StartCodeScanner::find(frameData, end, &startCodeLen);
+    while (p != end && p + startCodeLen + Traits::NAL_HEADER_SIZE <= end) {
+        uint8_t header = p[startCodeLen];
+        if (Traits::isVCL(header)) {
+            return Traits::isReference(header) ? 1 : 0;
+        }
+        
+        p = StartCodeScanner::find(p + startCodeLen, end, &startCodeLen);
+    }
+    
+    return -1;
+}
+
+bool H264MP4Writer::initFragmentedMP4(int width, int height, float frameRate, int isH265, const std::string& outputDir)
+{
+    if (m_isRecording) {
+        std::cerr << "Already recording" << std::endl;
+        return false;
+    }
+    
+    // 防断电模式和文件切换只用于startRecording的单文件录制
+    if (m_durableEnabled) {
+        std::cerr << "Durable mode is not supported for fragmented DASH output" << std::endl;
+        return false;
+    }
+    if (m_rotationEnabled) {
+        std::cerr << "File rotation is not supported for fragmented DASH output" << std::endl;
+        return false;
+    }
+    
+    // 初始化基本参数
+    if (!init(width, height, frameRate, isH265)) {
+        return false;
+    }
+    
+    // 设置分段MP4标志
+    m_isFragmented = true;
+    m_fragmentCount = 0;
+    m_fragmentOpen = false;
+    {
+        std::lock_guard<std::mutex> lock(m_overheadMutex);
+        m_fragmentOverhead = MoofInspector::Totals();
+    }
+    m_dashOutputDir = outputDir;
+    m_inbandParameterSets = true;
+    m_sampleDescIndex = 1;
+    m_paramSetChangeCount = 0;
+    
+    // 确保输出目录存在
+    struct stat st;
+    if (stat(outputDir.c_str(), &st) != 0) {
+        // 目录不存在，创建目录
+        #ifdef _WIN32
+        // Windows平台
+        if (system(("mkdir \"" + outputDir + "\"").c_str()) != 0) {
+            std::cerr << "Failed to create output directory: " << outputDir << std::endl;
+            return false;
+        }
+        #else
+        // Linux/Unix平台
+        if (system(("mkdir -p \"" + outputDir + "\"").c_str()) != 0) {
+            std::cerr << "Failed to create output directory: " << outputDir << std::endl;
+            return false;
+        }
+        #endif
+    }
+    
+    // 生成文件名（直播模式下为初始化分段）
+    {
+        std::lock_guard<std::mutex> lock(m_pathMutex);
+        m_currentFilePath = outputDir + "/" + (m_liveEnabled ? std::string("init.mp4") : generateFileName());
+    }
+    
+    // 直播：本次录制的输出端
+    if (m_liveEnabled) {
+        m_liveSinks.clear();
+        if (m_liveConfig.writeToDisk) {
+            m_liveSinks.push_back(std::make_shared<FileSink>(outputDir));
+        }
+        m_liveSinks.insert(m_liveSinks.end(), m_outputSinks.begin(), m_outputSinks.end());
+        if (m_liveSinks.empty()) {
+            std::cerr << "No live DASH output sink" << std::endl;
+            return false;
+        }
+    }
+    
+    // 创建分段MP4文件
+    m_mp4File = gf_isom_open(m_currentFilePath.c_str(), GF_ISOM_OPEN_WRITE, NULL);
+    GF_Err err = m_mp4File ? GF_OK : GF_IO_ERR;
+    if (err != GF_OK) {
+        std::cerr << "Failed to create fragmented MP4 file: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    // 直播：分片在内存中组装，再交给各输出端
+    if (m_liveEnabled && !redirectToMemory(m_mp4File)) {
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    
+    // 设置为分段模式
+    // 注意：gf_isom_set_fragmented函数在当前GPAC版本中不存在
+    // 我们使用GF_ISOM_WRITE_EDIT标志来创建可编辑的MP4文件，这是分段MP4所必需的
+    // GF_ISOM_OPEN_WRITE和GF_ISOM_WRITE_EDIT是互斥的文件打开模式，不应该通过位运算组合使用
+    /*err = gf_isom_set_fragmented(m_mp4File, 1);*/
     /*if (err != GF_OK) {
         std::cerr << "Failed to set fragmented mode: " << gf_error_to_string(err) << std::endl;
         gf_isom_delete(m_mp4File);
@@ -498,137 +2228,653 @@ bool H264MP4Writer::initFragmentedMP4(int width, int height, float frameRate, in
         return false;
     }*/
     
-    // 添加视频轨道
-    m_trackId = gf_isom_new_track(m_mp4File, 0, GF_ISOM_MEDIA_VISUAL, 90000);
-    if (!m_trackId) {
-        std::cerr << "Failed to create video track" << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
+    // 添加视频轨道
+    if (!setupVideoTrack(m_mp4File, m_trackId)) {
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    gf_isom_set_sync_table(m_mp4File, m_trackId);
+    if (err != GF_OK) {
+        std::cerr << "Failed gf_isom_set_sync_table: " << gf_error_to_string(err) << std::endl;
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    // 准备分段 - 使用正确的参数数量（紧凑编码时默认时长取一帧，trun中不再写每个样本的时长）
+    err = gf_isom_setup_track_fragment(m_mp4File, m_trackId, 
+                                      1,  // DefaultStreamDescriptionIndex
+                                      m_compactFragments ? static_cast<u32>(m_sampleDuration) : 1,  // DefaultSampleDuration
+                                      0,  // DefaultSampleSize
+                                      0,  // DefaultSampleIsSync
+                                      0,  // DefaultSamplePadding
+                                      0); // DefaultDegradationPriority
+    if (err != GF_OK) {
+        std::cerr << "Failed to setup track fragment: " << gf_error_to_string(err) << std::endl;
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    
+    // 添加音频轨道（每个moof同时包含音视频）
+    m_audioTrackId = 0;
+    if (m_audio && !m_audio->createTrack(m_mp4File, true, m_audioTrackId)) {
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    
+    // 添加元数据轨道
+    m_metaTrackId = 0;
+    if (m_metadata && !m_metadata->createTrack(m_mp4File, true, m_metaTrackId)) {
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    
+    // 初始化分段（直播模式下moov单独写入init.mp4，媒体分段各自成文件）
+    err = gf_isom_finalize_for_fragment(m_mp4File, m_liveEnabled ? 1 : m_trackId);
+    if (err != GF_OK) {
+        std::cerr << "Failed to finalize for fragment: " << gf_error_to_string(err) << std::endl;
+        gf_isom_delete(m_mp4File);
+        m_mp4File = nullptr;
+        return false;
+    }
+    
+    if (!m_liveEnabled) {
+        err = gf_isom_start_segment(m_mp4File,m_currentFilePath.c_str(), GF_TRUE);
+        if (err != GF_OK) {
+            std::cerr << "Failed gf_isom_start_segment: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+    }
+
+    // 记录开始时间
+    m_startTime = std::chrono::system_clock::now();
+    
+    // 直播：时间线0点为录制开始时间
+    if (m_liveEnabled) {
+        dispatchLiveInit();
+        
+        LiveDashManifest::Config manifestConfig;
+        manifestConfig.initName = "init.mp4";
+        manifestConfig.mediaTemplate = "segment_$Number$.m4s";
+        manifestConfig.timescale = 90000;
+        manifestConfig.timeShiftBufferMs = m_liveConfig.timeShiftBufferMs;
+        manifestConfig.minBufferMs = m_liveConfig.minBufferMs;
+        manifestConfig.availabilityStartMs =
+            std::chrono::duration_cast<std::chrono::milliseconds>(m_startTime.time_since_epoch()).count();
+        if (m_liveConfig.chunkFrames > 0) {
+            float frameRate = m_frameRate > 0 ? m_frameRate : 25.0f;
+            manifestConfig.chunkDurationMs = static_cast<uint32_t>(m_liveConfig.chunkFrames * 1000 / frameRate);
+            manifestConfig.targetLatencyMs = m_liveConfig.targetLatencyMs;
+        }
+        manifestConfig.utcTimingUrl = m_liveConfig.utcTimingUrl;
+        m_liveManifest.reset(new LiveDashManifest(manifestConfig));
+        m_liveSegmentNumber = 0;
+        m_liveSegmentOpen = false;
+        m_liveSegmentStart = -1;
+    }
+    m_frameIndex = 0;
+    // 时间线按录制重新开始，切换文件时保持连续
+    m_tsEngine = TimestampEngine();
+    m_tsEngine.reset(static_cast<int64_t>(m_sampleDuration));
+    m_reorderKnown = false;
+    m_ctsClampCount = 0;
+    if (m_audio) {
+        m_audio->reset();
+    }
+    if (m_metadata) {
+        m_metadata->reset();
+    }
+    m_lastVideoTime = NO_TIMESTAMP;
+    resetFileTimestamps();
+    m_isRecording = true;
+    
+    if (m_asyncEnabled) {
+        startMuxThread();
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::startFragment(uint32_t fragmentDuration)
+{
+    if (m_autoFragmentEnabled) {
+        std::cerr << "Fragments are cut automatically" << std::endl;
+        return false;
+    }
+    
+    // 异步模式下按顺序在封装线程中执行
+    if (m_muxRunning) {
+        return enqueueControl(FrameQueue::ENTRY_FRAGMENT_START, fragmentDuration);
+    }
+    
+    return doStartFragment(fragmentDuration);
+}
+
+bool H264MP4Writer::endFragment()
+{
+    if (m_autoFragmentEnabled) {
+        std::cerr << "Fragments are cut automatically" << std::endl;
+        return false;
+    }
+    
+    if (m_muxRunning) {
+        return enqueueControl(FrameQueue::ENTRY_FRAGMENT_END, 0);
+    }
+    
+    return doEndFragment();
+}
+
+bool H264MP4Writer::doStartFragment(uint32_t fragmentDuration)
+{
+    if (!m_isRecording || !m_isFragmented || !m_mp4File) {
+        std::cerr << "Not in fragmented recording mode" << std::endl;
+        return false;
+    }
+    
+    m_fragmentDuration = fragmentDuration;
+    
+    // 直播：每个分段作为独立的segment_$Number$.m4s交给输出端（在内存中组装，结束时一次交出；
+    // 分块模式下每个块写出后即交出）
+    if (m_liveEnabled) {
+        if (m_liveSegmentOpen && !publishLiveSegment(false)) {
+            return false;
+        }
+        reportFragment();
+        
+        bool chunked = m_liveConfig.chunkFrames > 0;
+        GF_Err err = gf_isom_start_segment(m_mp4File, NULL, chunked ? GF_FALSE : GF_TRUE);
+        if (err == GF_OK) {
+            err = gf_isom_start_fragment(m_mp4File, GF_TRUE);
+        }
+        if (err != GF_OK) {
+            std::cerr << "Failed to start live segment: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+        applyCompactFragmentOptions();
+        
+        // 各轨道的第一个样本设置tfdt
+        m_liveSegmentNumber++;
+        m_liveSegmentOpen = true;
+        m_liveSegmentStart = -1;
+        m_liveMarkDecodeTime = true;
+        m_liveChunkFrames = 0;
+        m_liveChunkCount = 0;
+        m_liveChunkPending = false;
+        m_liveSegmentBytes = 0;
+        if (m_audio) {
+            m_audio->markFragmentStart();
+        }
+        if (m_metadata) {
+            m_metadata->markFragmentStart();
+        }
+        m_fragmentCount++;
+        m_fragmentOpen = true;
+        m_fragmentInfo = FragmentInfo();
+        m_fragmentInfo.index = m_liveSegmentNumber;
+        return true;
+    }
+    
+    // 开始新的分段（上一个分段随之结束）
+    if (!writeHeldSample(NO_TIMESTAMP)) {
+        return false;
+    }
+    reportFragment();
+    GF_Err err = gf_isom_start_fragment(m_mp4File, GF_TRUE);
+    if (err != GF_OK) {
+        std::cerr << "Failed to start fragment: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    applyCompactFragmentOptions();
+    
+    // 设置分段持续时间
+    err = gf_isom_set_fragment_reference_time(m_mp4File, m_trackId, m_currentDTS, 0);
+    if (err != GF_OK) {
+        std::cerr << "Failed to set fragment reference time: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    m_fragmentCount++;
+    m_fragmentOpen = true;
+    m_fragmentInfo = FragmentInfo();
+    m_fragmentInfo.index = m_fragmentCount;
+    return true;
+}
+
+bool H264MP4Writer::doEndFragment()
+{
+    if (!m_isRecording || !m_isFragmented || !m_mp4File) {
+        std::cerr << "Not in fragmented recording mode" << std::endl;
+        return false;
+    }
+    
+    // 直播：立即发布分段并更新MPD
+    if (m_liveEnabled) {
+        if (!publishLiveSegment(false)) {
+            return false;
+        }
+        reportFragment();
+        return true;
+    }
+    
+    // 结束当前分段
+    if (!writeHeldSample(NO_TIMESTAMP)) {
+        return false;
+    }
+    GF_Err err = gf_isom_flush_fragments(m_mp4File, GF_TRUE);
+    if (err != GF_OK) {
+        std::cerr << "Failed to flush fragment: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    reportFragment();
+    return true;
+}
+
+bool H264MP4Writer::cutAutoFragment(uint64_t dts, bool isKeyFrame)
+{
+    bool cut = !m_fragmentOpen;
+    if (!cut && m_fragmentInfo.frames > 0) {
+        uint64_t duration = dts > m_fragmentInfo.firstDTS ? dts - m_fragmentInfo.firstDTS : 0;
+        bool bytesReached = m_fragmentPolicy.maxBytes > 0 && m_fragmentInfo.bytes >= m_fragmentPolicy.maxBytes;
+        
+        // 达到目标时长或字节数后在IDR处切分
+        if (isKeyFrame && (bytesReached || (m_fragmentPolicy.targetDurationMs > 0 &&
+                                            duration >= static_cast<uint64_t>(m_fragmentPolicy.targetDurationMs) * 90))) {
+            cut = true;
+        }
+        
+        // 超过硬上限时不再等待IDR
+        if (m_fragmentPolicy.cutMode == CUT_AT_IDR_OR_MAX) {
+            uint64_t maxMs = m_fragmentPolicy.maxDurationMs > 0 ? m_fragmentPolicy.maxDurationMs
+                                                              : static_cast<uint64_t>(m_fragmentPolicy.targetDurationMs) * 2;
+            if (bytesReached || (maxMs > 0 && duration >= maxMs * 90)) {
+                cut = true;
+            }
+        }
+    }
+    
+    if (!cut) {
+        return true;
+    }
+    
+    if (m_fragmentOpen && !doEndFragment()) {
+        return false;
+    }
+    return doStartFragment(m_fragmentPolicy.targetDurationMs);
+}
+
+void H264MP4Writer::reportFragment()
+{
+    if (!m_fragmentOpen) {
+        return;
+    }
+    m_fragmentOpen = false;
+    
+    // 没有视频帧的分段（如直播中被丢弃的空分段）不回调
+    if (m_fragmentInfo.frames == 0 || !m_onFragment) {
+        return;
+    }
+    m_fragmentInfo.duration = m_currentDTS > m_fragmentInfo.firstDTS ? m_currentDTS - m_fragmentInfo.firstDTS : 0;
+    m_onFragment(m_fragmentInfo);
+}
+
+bool H264MP4Writer::enableAutoFragment(const FragmentPolicy& policy)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot enable auto fragmentation while recording" << std::endl;
+        return false;
+    }
+    
+    if (policy.targetDurationMs == 0 && policy.maxBytes == 0 &&
+        (policy.cutMode != CUT_AT_IDR_OR_MAX || policy.maxDurationMs == 0)) {
+        std::cerr << "Invalid fragment policy" << std::endl;
+        return false;
+    }
+    
+    m_fragmentPolicy = policy;
+    m_autoFragmentEnabled = true;
+    
+    return true;
+}
+
+void H264MP4Writer::disableAutoFragment()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot disable auto fragmentation while recording" << std::endl;
+        return;
+    }
+    
+    m_autoFragmentEnabled = false;
+}
+
+bool H264MP4Writer::enableCompactFragments()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change fragment encoding while recording" << std::endl;
+        return false;
+    }
+    
+    m_compactFragments = true;
+    
+    return true;
+}
+
+void H264MP4Writer::disableCompactFragments()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot change fragment encoding while recording" << std::endl;
+        return;
+    }
+    
+    m_compactFragments = false;
+}
+
+MoofInspector::Totals H264MP4Writer::getFragmentOverhead() const
+{
+    std::lock_guard<std::mutex> lock(m_overheadMutex);
+    return m_fragmentOverhead;
+}
+
+void H264MP4Writer::applyCompactFragmentOptions()
+{
+    if (!m_compactFragments) {
+        return;
+    }
+    
+    // GPAC检测分片中的IDR：只有第一个样本是同步样本时写入first_sample_flags，其余样本使用trex默认标志
+    GF_Err err = gf_isom_set_fragment_option(m_mp4File, m_trackId, GF_ISOM_TRAF_RANDOM_ACCESS, 1);
+    if (err != GF_OK) {
+        std::cerr << "Failed to set fragment option: " << gf_error_to_string(err) << std::endl;
+    }
+}
+
+void H264MP4Writer::inspectFragments(const std::string& path)
+{
+    MoofInspector::Totals totals;
+    if (MoofInspector::scan(path, totals)) {
+        addFragmentOverhead(totals);
+    }
+}
+
+void H264MP4Writer::addFragmentOverhead(const MoofInspector::Totals& totals)
+{
+    std::lock_guard<std::mutex> lock(m_overheadMutex);
+    m_fragmentOverhead.fragments += totals.fragments;
+    m_fragmentOverhead.samples += totals.samples;
+    m_fragmentOverhead.headerBytes += totals.headerBytes;
+    m_fragmentOverhead.mediaBytes += totals.mediaBytes;
+}
+
+void H264MP4Writer::setFragmentCallback(const FragmentCallback& callback)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot set fragment callback while recording" << std::endl;
+        return;
+    }
+    
+    m_onFragment = callback;
+}
+
+bool H264MP4Writer::publishLiveSegment(bool ended)
+{
+    if (!m_liveManifest) {
+        return false;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    if (m_liveSegmentOpen) {
+        if (!writeHeldSample(NO_TIMESTAMP)) {
+            return false;
+        }
+        m_liveSegmentOpen = false;
+        m_liveChunkPending = false;
+        
+        // 写出moof/mdat（不生成sidx）
+        GF_Err err = gf_isom_close_segment(m_mp4File, -1, m_trackId, m_liveSegmentStart < 0 ? 0 : m_liveSegmentStart, 0,
+                                           m_currentDTS, GF_FALSE, ended ? GF_TRUE : GF_FALSE, 0, NULL, NULL);
+        if (err != GF_OK) {
+            std::cerr << "Failed to close live segment: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+        flushFileBuffers(m_mp4File);
+        
+        if (m_liveSegmentStart < 0) {
+            // 没有视频帧的分段不发布，序号留给下一个分段
+            m_liveStream->consume();
+            m_liveSegmentNumber--;
+        } else {
+            dispatchLiveMedia(true);
+            
+            uint64_t segmentStart = static_cast<uint64_t>(m_liveSegmentStart);
+            uint64_t duration = m_currentDTS > segmentStart ? m_currentDTS - segmentStart : m_sampleDuration;
+            
+            std::vector<uint32_t> expired;
+            m_liveManifest->addSegment(m_liveSegmentNumber, segmentStart, duration, m_liveSegmentBytes, expired);
+            for (uint32_t number : expired) {
+                std::string name = m_liveManifest->segmentName(number);
+                for (const auto& sink : m_liveSinks) {
+                    sink->onExpire(name);
+                }
+            }
+        }
+    }
+    
+    if (!dispatchLiveManifest(ended)) {
         return false;
     }
-    gf_isom_set_track_enabled(m_mp4File, m_trackId, 1);
     
-    // 设置编解码器类型
-    if (m_isH265) {
-        // 使用临时空配置，后续会更新
-        GF_HEVCConfig *hevc_cfg = gf_odf_hevc_cfg_new();
-        u32 trackId = m_trackId;
-        err = gf_isom_hevc_config_new(m_mp4File, m_trackId, hevc_cfg, NULL, NULL, &trackId);
-        m_trackId = trackId;
-        gf_odf_hevc_cfg_del(hevc_cfg);
-    } else {
-        // 使用临时空配置，后续会更新
-        GF_AVCConfig *avc_cfg = gf_odf_avc_cfg_new();
-        u32 trackId = m_trackId;
-        err = gf_isom_avc_config_new(m_mp4File, m_trackId, avc_cfg, NULL, NULL, &trackId);
-        m_trackId = trackId;
-        gf_odf_avc_cfg_del(avc_cfg);
+    m_lastPublishUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    return true;
+}
+
+bool H264MP4Writer::flushLiveChunk()
+{
+    m_liveChunkFrames = 0;
+    
+    // 块的最后一帧不等下一帧，沿用上一帧的时长，避免增加一帧延迟
+    if (!writeHeldSample(NO_TIMESTAMP)) {
+        return false;
     }
     
+    // 写出当前块的moof/mdat并交给输出端，DashServer即可读到
+    GF_Err err = gf_isom_flush_fragments(m_mp4File, GF_FALSE);
     if (err != GF_OK) {
-        std::cerr << "Failed to set codec config: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
+        std::cerr << "Failed to flush live chunk: " << gf_error_to_string(err) << std::endl;
         return false;
     }
+    flushFileBuffers(m_mp4File);
+    dispatchLiveMedia(false);
+    m_liveChunkPending = true;
+    
+    // 第一个块写出后分段加入MPD，播放器可以开始请求
+    if (m_liveChunkCount++ == 0) {
+        auto start = std::chrono::steady_clock::now();
+        
+        uint64_t expectedDuration = static_cast<uint64_t>(m_fragmentDuration) * 90;
+        m_liveManifest->announceSegment(m_liveSegmentNumber, static_cast<uint64_t>(m_liveSegmentStart), expectedDuration);
+        if (!dispatchLiveManifest(false)) {
+            return false;
+        }
+        
+        m_lastPublishUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+    
+    return true;
+}
 
-    // 设置视频参数
-    err = gf_isom_set_visual_info(m_mp4File, m_trackId, 1, m_width, m_height);
-    if (err != GF_OK) {
-        std::cerr << "Failed to set visual info: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
+bool H264MP4Writer::redirectToMemory(GF_ISOFile* file)
+{
+    if (!MemoryStream::supported()) {
+        std::cerr << "Live DASH output requires memory streams, not supported on this platform" << std::endl;
         return false;
     }
-    gf_isom_set_sync_table(m_mp4File, m_trackId);
-    if (err != GF_OK) {
-        std::cerr << "Failed gf_isom_set_sync_table: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
+    if (!file->editFileMap || file->editFileMap->type != GF_ISOM_DATA_FILE) {
+        std::cerr << "Unexpected data map for live DASH output" << std::endl;
         return false;
     }
-    // 准备分段 - 使用正确的参数数量
-    err = gf_isom_setup_track_fragment(m_mp4File, m_trackId, 
-                                      1,  // DefaultStreamDescriptionIndex
-                                      1,  // DefaultSampleDuration
-                                      0,  // DefaultSampleSize
-                                      0,  // DefaultSampleIsSync
-                                      0,  // DefaultSamplePadding
-                                      0); // DefaultDegradationPriority
-    if (err != GF_OK) {
-        std::cerr << "Failed to setup track fragment: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
+    
+    std::unique_ptr<MemoryStream> stream(new MemoryStream());
+    FILE* memoryFile = stream->open();
+    if (!memoryFile) {
+        std::cerr << "Failed to create memory stream" << std::endl;
         return false;
     }
     
-    // 初始化分段
-    err = gf_isom_finalize_for_fragment(m_mp4File, m_trackId);
-    if (err != GF_OK) {
-        std::cerr << "Failed to finalize for fragment: " << gf_error_to_string(err) << std::endl;
-        gf_isom_delete(m_mp4File);
-        m_mp4File = nullptr;
-        return false;
+    // 还没有写入任何数据，关闭并删除gf_isom_open创建的文件，之后的写入都进入内存流
+    // （原文件用fclose关闭，内存流最终由GPAC以gf_fclose关闭，打开计数保持平衡）
+    GF_FileDataMap* fileMap = reinterpret_cast<GF_FileDataMap*>(file->editFileMap);
+    if (fileMap->bs) {
+        gf_bs_flush(fileMap->bs);
     }
+    if (fileMap->stream) {
+        fclose(fileMap->stream);
+    }
+    remove(getCurrentFilePath().c_str());
     
-    err = gf_isom_start_segment(m_mp4File,m_currentFilePath.c_str(), GF_TRUE);
-    if (err != GF_OK) {
-        std::cerr << "Failed gf_isom_start_segment: " << gf_error_to_string(err) << std::endl;
-        return false;
+    fileMap->stream = memoryFile;
+    if (fileMap->bs) {
+        gf_bs_reassign(fileMap->bs, memoryFile);
     }
-
-    // 记录开始时间
-    m_startTime = std::chrono::system_clock::now();
-    m_currentDTS = 0;
-    m_isRecording = true;
+    m_liveStream = std::move(stream);
     
     return true;
 }
 
-bool H264MP4Writer::startFragment(uint32_t fragmentDuration)
+void H264MP4Writer::dispatchLiveInit()
 {
-    if (!m_isRecording || !m_isFragmented || !m_mp4File) {
-        std::cerr << "Not in fragmented recording mode" << std::endl;
-        return false;
+    flushFileBuffers(m_mp4File);
+    
+    for (const auto& sink : m_liveSinks) {
+        if (!sink->onInit("init.mp4", m_liveStream->pendingData(), m_liveStream->pendingSize())) {
+            std::cerr << "Live output sink failed to take init segment" << std::endl;
+        }
     }
+    m_liveStream->consume();
+}
+
+void H264MP4Writer::dispatchLiveMedia(bool segmentEnd)
+{
+    const uint8_t* data = m_liveStream->pendingData();
+    size_t size = m_liveStream->pendingSize();
+    std::string name = m_liveManifest->segmentName(m_liveSegmentNumber);
     
-    m_fragmentDuration = fragmentDuration;
+    for (const auto& sink : m_liveSinks) {
+        if (!sink->onMedia(name, data, size, segmentEnd)) {
+            std::cerr << "Live output sink failed to take " << name << std::endl;
+        }
+    }
     
-    // 开始新的分段
-    GF_Err err = gf_isom_start_fragment(m_mp4File, GF_TRUE);
-    if (err != GF_OK) {
-        std::cerr << "Failed to start fragment: " << gf_error_to_string(err) << std::endl;
+    // 块和分段都由完整的moof/mdat组成，可以直接统计
+    MoofInspector::Totals totals;
+    MoofInspector::scanBuffer(data, size, totals);
+    addFragmentOverhead(totals);
+    
+    m_liveSegmentBytes += size;
+    m_liveStream->consume();
+}
+
+bool H264MP4Writer::dispatchLiveManifest(bool ended)
+{
+    // 视频编码字符串来自最近一次解析的SPS，参数集变化后随下一次发布更新
+    m_liveManifest->setRepresentation(liveCodecs(), m_width, m_height, m_frameRate);
+    std::string mpd = m_liveManifest->build(ended);
+    
+    bool ok = true;
+    for (const auto& sink : m_liveSinks) {
+        if (!sink->onManifest(m_liveConfig.mpdName, mpd)) {
+            std::cerr << "Failed to write live MPD" << std::endl;
+            ok = false;
+        }
+    }
+    
+    return ok;
+}
+
+bool H264MP4Writer::addOutputSink(const std::shared_ptr<OutputSink>& sink)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot add output sink while recording" << std::endl;
         return false;
     }
     
-    // 设置分段持续时间
-    err = gf_isom_set_fragment_reference_time(m_mp4File, m_trackId, m_currentDTS, 0);
-    if (err != GF_OK) {
-        std::cerr << "Failed to set fragment reference time: " << gf_error_to_string(err) << std::endl;
+    if (!sink) {
+        std::cerr << "Invalid output sink" << std::endl;
         return false;
     }
     
-    m_fragmentCount++;
+    m_outputSinks.push_back(sink);
     return true;
 }
 
-bool H264MP4Writer::endFragment()
+void H264MP4Writer::clearOutputSinks()
 {
-    if (!m_isRecording || !m_isFragmented || !m_mp4File) {
-        std::cerr << "Not in fragmented recording mode" << std::endl;
+    if (m_isRecording) {
+        std::cerr << "Cannot clear output sinks while recording" << std::endl;
+        return;
+    }
+    
+    m_outputSinks.clear();
+}
+
+std::string H264MP4Writer::liveCodecs() const
+{
+    // 分片模式不把参数集写进样本描述（avcC/hvcC为空），视频编码字符串从解析出的SPS生成
+    std::string codecs;
+    if (m_isH265 && m_hevcConfig) {
+        codecs = hevcCodecString(*m_hevcConfig, m_inbandParameterSets);
+    } else if (!m_isH265 && m_avcConfig) {
+        codecs = avcCodecString(*m_avcConfig, m_inbandParameterSets);
+    }
+    
+    if (m_audioTrackId) {
+        char codec[256] = { 0 };
+        u32 track = gf_isom_get_track_by_id(m_mp4File, m_audioTrackId);
+        if (gf_media_get_rfc_6381_codec_name(m_mp4File, track, codec, GF_FALSE, GF_FALSE) == GF_OK && codec[0]) {
+            if (!codecs.empty()) {
+                codecs += ",";
+            }
+            codecs += codec;
+        }
+    }
+    
+    return codecs;
+}
+
+bool H264MP4Writer::enableLiveDash(const LiveDashConfig& config)
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot enable live DASH while recording" << std::endl;
         return false;
     }
     
-    // 结束当前分段
-    GF_Err err = gf_isom_flush_fragments(m_mp4File, GF_TRUE);
-    if (err != GF_OK) {
-        std::cerr << "Failed to flush fragment: " << gf_error_to_string(err) << std::endl;
+    if (config.mpdName.empty()) {
+        std::cerr << "Invalid live DASH config" << std::endl;
         return false;
     }
     
+    m_liveConfig = config;
+    m_liveEnabled = true;
+    
     return true;
 }
 
+void H264MP4Writer::disableLiveDash()
+{
+    if (m_isRecording) {
+        std::cerr << "Cannot disable live DASH while recording" << std::endl;
+        return;
+    }
+    
+    m_liveEnabled = false;
+}
+
 bool H264MP4Writer::generateMPD(const std::string& streamName, float segmentDuration)
 {
 
@@ -638,6 +2884,11 @@ bool H264MP4Writer::generateMPD(const std::string& streamName, float segmentDura
         stopRecording();
     }
     
+    // 直播模式下MPD随分段实时更新，停止录制时已写入最终版本
+    if (m_liveEnabled) {
+        return true;
+    }
+    
     // 创建流目录
     std::string streamDir = m_dashOutputDir + "/" + streamName;
     struct stat st;
@@ -649,23 +2900,18 @@ bool H264MP4Writer::generateMPD(const std::string& streamName, float segmentDura
         #endif
     }
     
-    // 使用GPAC的MP4Box工具进行DASH分段
-    std::string cmd = "MP4Box -dash " + std::to_string((int)(segmentDuration * 1000)) +
-                     " -frag " + std::to_string((int)(segmentDuration * 1000)) +
-                     " -rap -segment-name segment_ -out \"" + streamDir + "/manifest.mpd\" \"" +
-                     m_currentFilePath + "\"";
-    
-    std::cout << "Executing command: " << cmd << std::endl;
-    int result = system(cmd.c_str());
-    if (result != 0) {
-        std::cerr << "Failed to segment MP4 file: " << m_currentFilePath << std::endl;
+    // 进程内调用GPAC的DASH分段，不再依赖MP4Box命令行
+    DashPackager::Options options;
+    options.segmentDuration = segmentDuration;
+    if (!DashPackager::package(getCurrentFilePath(), streamDir + "/manifest.mpd", options)) {
+        std::cerr << "Failed to segment MP4 file: " << getCurrentFilePath() << std::endl;
         return false;
     }
     
     return true;
 }
 
-bool H264MP4Writer::parseNALU(const uint8_t* data, size_t size, std::vector<std::pair<const uint8_t*, size_t>>& nalus)
+bool H264MP4Writer::parseNALU(const uint8_t* data, size_t size, std::vector<NALUnit>& nalus)
 {
     if (!data || size < 4) {
         return false;
@@ -673,37 +2919,30 @@ bool H264MP4Writer::parseNALU(const uint8_t* data, size_t size, std::vector<std:
     
     nalus.clear();
     
-    // 查找起始码并解析NALU
-    const uint8_t* start = nullptr;
-    size_t i = 0;
+    // 查找起始码并解析NALU（起始码查找使用SIMD实现）
+    const uint8_t* end = data + size;
+    int startCodeLen = 0;
+    const uint8_t* startCode = StartCodeScanner::find(data, end, &startCodeLen);
     
-    // 查找第一个起始码
-    while (i + 3 < size) {
-        // 检查起始码 (0x00 0x00 0x00 0x01 或 0x00 0x00 0x01)
-        if ((data[i] == 0 && data[i+1] == 0 && data[i+2] == 0 && data[i+3] == 1) ||
-            (data[i] == 0 && data[i+1] == 0 && data[i+2] == 1)) {
-            
-            // 确定起始码长度
-            int startCodeLen = (data[i+2] == 0 && data[i+3] == 1) ? 4 : 3;
-            
-            // 如果已经找到了一个NALU，添加到列表
-            if (start) {
-                nalus.push_back(std::make_pair(start, data + i - start));
-            }
-            
-            // 更新起始位置为当前NALU的开始
-            start = data + i + startCodeLen;
-            i += startCodeLen;
-        } else {
-            i++;
+    while (startCode != end) {
+        // 当前NALU的开始
+        const uint8_t* start = startCode + startCodeLen;
+        uint8_t startLen = static_cast<uint8_t>(startCodeLen);
+        
+        // 下一个起始码即当前NALU的结束
+        startCode = StartCodeScanner::find(start, end, &startCodeLen);
+        
+        // 跳过空NALU
+        if (startCode > start) {
+            NALUnit nalu = { start, static_cast<size_t>(startCode - start), startLen };
+            nalus.push_back(nalu);
+        } else if (startCode == end && start < end) {
+            // 最后一个NALU
+            NALUnit nalu = { start, static_cast<size_t>(end - start), startLen };
+            nalus.push_back(nalu);
         }
     }
     
-    // 添加最后一个NALU
-    if (start && start < data + size) {
-        nalus.push_back(std::make_pair(start, data + size - start));
-    }
-    
     return !nalus.empty();
 }
 
@@ -714,7 +2953,7 @@ bool H264MP4Writer::processH264ParameterSets(const uint8_t* sps, size_t spsSize,
     }
     
     // 创建AVC配置
-    m_avcConfig = std::unique_ptr<GF_AVCConfig>(gf_odf_avc_cfg_new());
+    m_avcConfig.reset(gf_odf_avc_cfg_new());
     if (!m_avcConfig) {
         return false;
     }
@@ -734,6 +2973,7 @@ bool H264MP4Writer::processH264ParameterSets(const uint8_t* sps, size_t spsSize,
     
     memcpy(spsSlot->data, sps, spsSize);
     gf_list_add(m_avcConfig->sequenceParameterSets, spsSlot);
+    updateReorderDepth(sps, spsSize);
     
     // 添加PPS
     GF_AVCConfigSlot* ppsSlot = (GF_AVCConfigSlot*)gf_malloc(sizeof(GF_AVCConfigSlot));
@@ -751,7 +2991,7 @@ bool H264MP4Writer::processH264ParameterSets(const uint8_t* sps, size_t spsSize,
     memcpy(ppsSlot->data, pps, ppsSize);
     gf_list_add(m_avcConfig->pictureParameterSets, ppsSlot);
     
-    // 设置AVC配置参数
+    // 设置AVC配置参数（档次和级别直接取自SPS头部）
     m_avcConfig->AVCProfileIndication = sps[1];
     m_avcConfig->profile_compatibility = sps[2];
     m_avcConfig->AVCLevelIndication = sps[3];
@@ -759,14 +2999,27 @@ bool H264MP4Writer::processH264ParameterSets(const uint8_t* sps, size_t spsSize,
     m_avcConfig->luma_bit_depth = 8;
     m_avcConfig->chroma_bit_depth = 8;
     
-    // 更新MP4文件的AVC配置
-    u32 flags = m_mp4File->FragmentsFlags;
-    m_mp4File->FragmentsFlags = 0;
-    GF_Err err = gf_isom_avc_config_update(m_mp4File, m_trackId, 1, m_avcConfig.get());
-    m_mp4File->FragmentsFlags = flags;
-    if (err != GF_OK) {
-        std::cerr << "Failed to update AVC config: " << gf_error_to_string(err) << std::endl;
-        return false;
+    // 色度格式和位深从SPS解析（解析状态较大，临时分配）
+    AVCState* state = static_cast<AVCState*>(gf_malloc(sizeof(AVCState)));
+    if (state) {
+        memset(state, 0, sizeof(AVCState));
+        state->sps_active_idx = -1;
+        s32 spsId = gf_media_avc_read_sps(reinterpret_cast<const char*>(sps), static_cast<u32>(spsSize), state, 0, NULL);
+        if (spsId >= 0 && spsId < 32) {
+            m_avcConfig->chroma_format = state->sps[spsId].chroma_format;
+            m_avcConfig->luma_bit_depth = 8 + state->sps[spsId].luma_bit_depth_m8;
+            m_avcConfig->chroma_bit_depth = 8 + state->sps[spsId].chroma_bit_depth_m8;
+        }
+        gf_free(state);
+    }
+    
+    // 分辨率以SPS为准（调用方传入的只作为收到SPS前的初始值）
+    u32 spsId = 0, width = 0, height = 0;
+    s32 parNum = 0, parDen = 0;
+    if (gf_avc_get_sps_info(reinterpret_cast<char*>(const_cast<uint8_t*>(sps)), static_cast<u32>(spsSize),
+                            &spsId, &width, &height, &parNum, &parDen) == GF_OK && width > 0 && height > 0) {
+        m_width = static_cast<int>(width);
+        m_height = static_cast<int>(height);
     }
     
     return true;
@@ -779,7 +3032,7 @@ bool H264MP4Writer::processH265ParameterSets(const uint8_t* vps, size_t vpsSize,
     }
     
     // 创建HEVC配置
-    m_hevcConfig = std::unique_ptr<GF_HEVCConfig>(gf_odf_hevc_cfg_new());
+    m_hevcConfig.reset(gf_odf_hevc_cfg_new());
     if (!m_hevcConfig) {
         return false;
     }
@@ -838,6 +3091,7 @@ bool H264MP4Writer::processH265ParameterSets(const uint8_t* vps, size_t vpsSize,
     
     memcpy(spsSlot->data, sps, spsSize);
     gf_list_add(spsArray->nalus, spsSlot);
+    updateReorderDepth(sps, spsSize);
     gf_list_add(m_hevcConfig->param_array, spsArray);
     
     // 添加PPS
@@ -868,7 +3122,7 @@ bool H264MP4Writer::processH265ParameterSets(const uint8_t* vps, size_t vpsSize,
     gf_list_add(ppsArray->nalus, ppsSlot);
     gf_list_add(m_hevcConfig->param_array, ppsArray);
     
-    // 设置HEVC配置参数
+    // 设置HEVC配置参数（解析失败时按Main档次填写）
     m_hevcConfig->configurationVersion = 1;
     m_hevcConfig->profile_space = 0;
     m_hevcConfig->tier_flag = 0;
@@ -878,49 +3132,278 @@ bool H264MP4Writer::processH265ParameterSets(const uint8_t* vps, size_t vpsSize,
     m_hevcConfig->interlaced_source_flag = 0;
     m_hevcConfig->non_packed_constraint_flag = 0;
     m_hevcConfig->frame_only_constraint_flag = 0;
-    m_hevcConfig->level_idc = 51; // Level 5.1
+    m_hevcConfig->level_idc = 51 * 3; // Level 5.1
+    m_hevcConfig->chromaFormat = 1; // 4:2:0
+    m_hevcConfig->luma_bit_depth = 8;
+    m_hevcConfig->chroma_bit_depth = 8;
+    
+    // 档次、层级、级别、色度格式和位深从SPS解析（解析状态较大，临时分配）
+    HEVCState* state = static_cast<HEVCState*>(gf_malloc(sizeof(HEVCState)));
+    if (state) {
+        memset(state, 0, sizeof(HEVCState));
+        state->sps_active_idx = -1;
+        gf_media_hevc_read_vps(reinterpret_cast<char*>(const_cast<uint8_t*>(vps)), static_cast<u32>(vpsSize), state);
+        s32 spsId = gf_media_hevc_read_sps(reinterpret_cast<char*>(const_cast<uint8_t*>(sps)), static_cast<u32>(spsSize), state);
+        if (spsId >= 0 && spsId < 16) {
+            const HEVC_SPS& info = state->sps[spsId];
+            m_hevcConfig->profile_space = info.ptl.profile_space;
+            m_hevcConfig->tier_flag = info.ptl.tier_flag;
+            m_hevcConfig->profile_idc = info.ptl.profile_idc;
+            m_hevcConfig->general_profile_compatibility_flags = info.ptl.profile_compatibility_flag;
+            m_hevcConfig->progressive_source_flag = info.ptl.general_progressive_source_flag;
+            m_hevcConfig->interlaced_source_flag = info.ptl.general_interlaced_source_flag;
+            m_hevcConfig->non_packed_constraint_flag = info.ptl.general_non_packed_constraint_flag;
+            m_hevcConfig->frame_only_constraint_flag = info.ptl.general_frame_only_constraint_flag;
+            m_hevcConfig->constraint_indicator_flags = info.ptl.general_reserved_44bits;
+            m_hevcConfig->level_idc = info.ptl.level_idc;
+            m_hevcConfig->chromaFormat = info.chroma_format_idc;
+            m_hevcConfig->luma_bit_depth = info.bit_depth_luma;
+            m_hevcConfig->chroma_bit_depth = info.bit_depth_chroma;
+        }
+        gf_free(state);
+    }
+    
+    // 分辨率以SPS为准（调用方传入的只作为收到SPS前的初始值）
+    u32 spsId = 0, width = 0, height = 0;
+    s32 parNum = 0, parDen = 0;
+    if (gf_hevc_get_sps_info(reinterpret_cast<char*>(const_cast<uint8_t*>(sps)), static_cast<u32>(spsSize),
+                             &spsId, &width, &height, &parNum, &parDen) == GF_OK && width > 0 && height > 0) {
+        m_width = static_cast<int>(width);
+        m_height = static_cast<int>(height);
+    }
+    
+    return true;
+}
+
+bool H264MP4Writer::applyParameterSets(GF_ISOFile* file, int trackId, u32 descIndex)
+{
+    GF_Err err;
+    if (m_isH265) {
+        err = m_hevcConfig ? gf_isom_hevc_config_update(file, trackId, descIndex, m_hevcConfig.get()) : GF_BAD_PARAM;
+    } else {
+        err = m_avcConfig ? gf_isom_avc_config_update(file, trackId, descIndex, m_avcConfig.get()) : GF_BAD_PARAM;
+    }
+    
+    // 分辨率以SPS为准
+    if (err == GF_OK) {
+        err = gf_isom_set_visual_info(file, trackId, descIndex, m_width, m_height);
+    }
     
-    // 更新MP4文件的HEVC配置
-    u32 flags = m_mp4File->FragmentsFlags;
-    m_mp4File->FragmentsFlags = 0;
-    GF_Err err = gf_isom_hevc_config_update(m_mp4File, m_trackId, 1, m_hevcConfig.get());
-    m_mp4File->FragmentsFlags = flags;
+    // moov在录制过程中不再改写时，改为avc3/hev1，参数集随IDR样本带内传输
+    if (err == GF_OK && m_inbandParameterSets) {
+        err = m_isH265 ? gf_isom_hevc_set_inband_config(file, trackId, descIndex)
+                       : gf_isom_avc_set_inband_config(file, trackId, descIndex);
+    }
     if (err != GF_OK) {
-        std::cerr << "Failed to update HEVC config: " << gf_error_to_string(err) << std::endl;
+        std::cerr << "Failed to update " << (m_isH265 ? "HEVC" : "AVC") << " config: " << gf_error_to_string(err) << std::endl;
         return false;
     }
     
     return true;
 }
 
-std::string H264MP4Writer::generateFileName() const
+bool H264MP4Writer::updateParameterSets(const std::vector<NALUnit>& nalus)
 {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&time);
+    // 查找VPS(H265)、SPS、PPS
+    const uint8_t* paramSets[PARAM_SET_SLOTS];
+    size_t paramSetSizes[PARAM_SET_SLOTS];
+    unsigned found = m_codec.findParameterSets(nalus, paramSets, paramSetSizes);
+    if ((found & m_codec.requiredParamSets) != m_codec.requiredParamSets) {
+        return true;
+    }
+    const uint8_t* vps = paramSets[PARAM_SET_VPS];
+    size_t vpsSize = paramSetSizes[PARAM_SET_VPS];
+    const uint8_t* sps = paramSets[PARAM_SET_SPS];
+    size_t spsSize = paramSetSizes[PARAM_SET_SPS];
+    const uint8_t* pps = paramSets[PARAM_SET_PPS];
+    size_t ppsSize = paramSetSizes[PARAM_SET_PPS];
+    
+    // 参数集通常每个IDR重复一次，内容不变时只需比较哈希
+    uint64_t hash = hashParameterSet(hashParameterSet(hashParameterSet(14695981039346656037ULL, vps, vpsSize),
+                                                      sps, spsSize), pps, ppsSize);
+    if (m_hasParameterSets && hash == m_paramSetHash) {
+        return true;
+    }
     
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y%m%d_%H%M%S.mp4");
+    bool ok = m_isH265 ? processH265ParameterSets(vps, vpsSize, sps, spsSize, pps, ppsSize)
+                       : processH264ParameterSets(sps, spsSize, pps, ppsSize);
+    if (!ok) {
+        std::cerr << "Failed to process " << m_codec.name << " parameter sets" << std::endl;
+        return false;
+    }
     
-    return oss.str();
+    m_paramSetHash = hash;
+    
+    // 带内参数集模式下补到IDR样本前的数据（长度前缀格式，按槽位顺序）
+    m_paramSetPrefix.clear();
+    for (int i = 0; i < PARAM_SET_SLOTS; i++) {
+        if (!paramSets[i]) {
+            continue;
+        }
+        uint32_t size = static_cast<uint32_t>(paramSetSizes[i]);
+        uint8_t prefix[4] = { static_cast<uint8_t>(size >> 24), static_cast<uint8_t>(size >> 16),
+                              static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size) };
+        m_paramSetPrefix.insert(m_paramSetPrefix.end(), prefix, prefix + 4);
+        m_paramSetPrefix.insert(m_paramSetPrefix.end(), paramSets[i], paramSets[i] + size);
+    }
+    
+    // 首次收到参数集：写入当前样本描述（分段MP4的moov在初始化时已写出，
+    // 样本描述为avc3/hev1，参数集只随IDR样本带内传输）
+    if (!m_hasParameterSets) {
+        if (!m_isFragmented && !applyParameterSets(m_mp4File, m_trackId, m_sampleDescIndex)) {
+            return false;
+        }
+        m_hasParameterSets = true;
+        
+        // 防断电模式：参数集就绪，写入moov
+        if (m_durableEnabled && !m_durableStarted && !beginDurableFragments()) {
+            return false;
+        }
+        
+        return true;
+    }
+    
+    // 新分辨率已由SPS更新，通过getWidth/getHeight读取
+    m_paramSetChangeCount++;
+    
+    // 提前创建的下一个文件还是旧参数集，丢弃后按新参数集重新创建
+    discardNextFile();
+    
+    // 带内参数集模式：新参数集已随本IDR写入样本
+    if (m_inbandParameterSets) {
+        return true;
+    }
+    
+    return addSampleDescription();
+}
+
+bool H264MP4Writer::addSampleDescription()
+{
+    GF_Err err;
+    u32 descIndex = 0;
+    if (m_isH265) {
+        err = gf_isom_hevc_config_new(m_mp4File, m_trackId, m_hevcConfig.get(), NULL, NULL, &descIndex);
+    } else {
+        err = gf_isom_avc_config_new(m_mp4File, m_trackId, m_avcConfig.get(), NULL, NULL, &descIndex);
+    }
+    if (err == GF_OK) {
+        err = gf_isom_set_visual_info(m_mp4File, m_trackId, descIndex, m_width, m_height);
+    }
+    if (err != GF_OK) {
+        std::cerr << "Failed to add sample description: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    // 之后的样本使用新的样本描述
+    m_sampleDescIndex = descIndex;
+    
+    return true;
 }
 
-bool H264MP4Writer::detectCodecType(const uint8_t* frameData, size_t frameSize)
+GF_ISOFile* H264MP4Writer::openRecordingFile(const std::string& path, int& trackId, int& audioTrackId, int& metaTrackId)
 {
-    if (!frameData || frameSize < 4) {
-        return false; // 默认为H264
+    GF_ISOFile* file = gf_isom_open(path.c_str(), GF_ISOM_OPEN_WRITE, NULL);
+    if (!file) {
+        std::cerr << "Failed to create MP4 file: " << gf_error_to_string(GF_IO_ERR) << std::endl;
+        return nullptr;
     }
     
-    // 解析NALU
-    std::vector<std::pair<const uint8_t*, size_t>> nalus;
-    if (!parseNALU(frameData, frameSize, nalus) || nalus.empty()) {
-        return false; // 默认为H264
+    // 添加视频轨道
+    if (!setupVideoTrack(file, trackId)) {
+        gf_isom_delete(file);
+        return nullptr;
+    }
+    
+    // 防断电模式：设置分片参数，moov在收到参数集后写入
+    if (m_durableEnabled) {
+        GF_Err err = gf_isom_setup_track_fragment(file, trackId, 1, m_sampleDuration, 0, 0, 0, 0);
+        if (err != GF_OK) {
+            std::cerr << "Failed to setup track fragment: " << gf_error_to_string(err) << std::endl;
+            gf_isom_delete(file);
+            return nullptr;
+        }
+    }
+    
+    // 添加音频轨道
+    audioTrackId = 0;
+    if (m_audio && !m_audio->createTrack(file, m_durableEnabled, audioTrackId)) {
+        gf_isom_delete(file);
+        return nullptr;
+    }
+    
+    // 添加元数据轨道
+    metaTrackId = 0;
+    if (m_metadata && !m_metadata->createTrack(file, m_durableEnabled, metaTrackId)) {
+        gf_isom_delete(file);
+        return nullptr;
+    }
+    
+    return file;
+}
+
+bool H264MP4Writer::setupVideoTrack(GF_ISOFile* file, int& trackId)
+{
+    trackId = gf_isom_new_track(file, 0, GF_ISOM_MEDIA_VISUAL, 90000);
+    if (!trackId) {
+        std::cerr << "Failed to create video track" << std::endl;
+        return false;
+    }
+    gf_isom_set_track_enabled(file, trackId, 1);
+    
+    // 设置编解码器类型（使用临时空配置，收到参数集后更新）
+    GF_Err err;
+    u32 descIndex = 0;
+    if (m_isH265) {
+        GF_HEVCConfig *hevc_cfg = gf_odf_hevc_cfg_new();
+        err = gf_isom_hevc_config_new(file, trackId, hevc_cfg, NULL, NULL, &descIndex);
+        gf_odf_hevc_cfg_del(hevc_cfg);
+    } else {
+        GF_AVCConfig *avc_cfg = gf_odf_avc_cfg_new();
+        err = gf_isom_avc_config_new(file, trackId, avc_cfg, NULL, NULL, &descIndex);
+        gf_odf_avc_cfg_del(avc_cfg);
+    }
+    
+    if (err != GF_OK) {
+        std::cerr << "Failed to set codec config: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    // 设置视频参数
+    err = gf_isom_set_visual_info(file, trackId, 1, m_width, m_height);
+    if (err != GF_OK) {
+        std::cerr << "Failed to set visual info: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+    
+    // 带内参数集模式：moov可能在收到参数集之前写出，样本描述先设为avc3/hev1
+    if (m_inbandParameterSets) {
+        err = m_isH265 ? gf_isom_hevc_set_inband_config(file, trackId, 1)
+                       : gf_isom_avc_set_inband_config(file, trackId, 1);
+        if (err != GF_OK) {
+            std::cerr << "Failed to set inband config: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
     }
     
+    return true;
+}
+
+std::string H264MP4Writer::generateFileName(std::chrono::system_clock::time_point when) const
+{
+    auto time = std::chrono::system_clock::to_time_t(when);
+    std::tm tm = *std::localtime(&time);
+    
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y%m%d_%H%M%S.mp4");
+    
+    return oss.str();
+}
+
+bool H264MP4Writer::detectCodecType(const std::vector<NALUnit>& nalus) const
+{
     // 检查是否有VPS (只有H265有VPS)
     for (const auto& nalu : nalus) {
-        uint8_t naluType = (nalu.first[0] & 0x7E) >> 1;
-        if (naluType == 32) { // VPS
+        if (H265Traits::isVPS(nalu.data[0])) {
             return true; // 是H265
         }
     }
@@ -7,10 +7,30 @@
 #include <chrono>
 #include <cstdint>
 #include <cstddef>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 
 
 #include "gpac/isomedia.h"
 #include "gpac/dash.h"
+#include "FrameQueue.h"
+#include "PreRecordBuffer.h"
+#include "TimestampEngine.h"
+#include "PocParser.h"
+#include "AudioTrack.h"
+#include "MetadataTrack.h"
+#include "MetadataIndex.h"
+#include "LiveDashManifest.h"
+#include "MoofInspector.h"
+#include "MemoryStream.h"
+#include "OutputSink.h"
+#include "ParsedFrame.h"
+#include "FramePool.h"
+#include "CodecTraits.h"
 
 
 /**
@@ -20,14 +40,102 @@
  */
 class H264MP4Writer {
 public:
+    // 未提供时间戳（writeFrameTimed使用）
+    static const int64_t NO_TIMESTAMP = INT64_MIN;
+
+    // 异步模式下队列满时的处理策略
+    enum OverflowPolicy {
+        OVERFLOW_BLOCK = 0,             // 阻塞等待队列空出位置
+        OVERFLOW_DROP_NON_REFERENCE,    // 丢弃非参考帧，参考帧仍阻塞等待
+        OVERFLOW_DROP_TO_IDR            // 丢弃当前帧及后续帧，直到下一个IDR
+    };
+
+    // 防断电录制配置
+    struct DurableConfig {
+        uint32_t fragmentDurationMs;    // 分片最长时长（毫秒），0表示不按时长切分
+        bool fragmentAtIDR;             // 在每个IDR处开始新分片
+        bool syncToDisk;                // 每个分片写入后调用fdatasync
+        bool defragmentOnStop;          // 停止录制时转换为moov前置的普通MP4
+
+        DurableConfig()
+            : fragmentDurationMs(2000), fragmentAtIDR(true), syncToDisk(false), defragmentOnStop(false) {}
+    };
+
+    // 文件切换策略（各条件任一满足后在下一个IDR处切换，0表示不启用该条件）
+    struct RotationPolicy {
+        uint32_t intervalMinutes;       // 每个文件最长录制分钟数
+        uint32_t alignMinutes;          // 按本地时间整点对齐切换，如60表示每个整点
+        uint64_t maxBytes;              // 单个文件最大字节数
+
+        RotationPolicy()
+            : intervalMinutes(0), alignMinutes(0), maxBytes(0) {}
+    };
+
+    // 直播DASH配置
+    struct LiveDashConfig {
+        uint32_t timeShiftBufferMs;     // 时移窗口（毫秒），窗口外的分段从MPD和磁盘删除，0表示全部保留
+        uint32_t minBufferMs;           // MPD的minBufferTime（毫秒）
+        std::string mpdName;            // MPD文件名（与分段在同一目录）
+        uint32_t chunkFrames;           // CMAF分块：每N帧写出一个moof/mdat块，0表示整个分段一次写出
+        uint32_t targetLatencyMs;       // 分块模式下MPD中的目标延迟（毫秒）
+        std::string utcTimingUrl;       // 播放器时钟同步地址，如DashServer的http://host:port/time
+        bool writeToDisk;               // 是否写入输出目录（关闭后只交给addOutputSink添加的输出端）
+
+        LiveDashConfig()
+            : timeShiftBufferMs(30000), minBufferMs(2000), mpdName("live.mpd"),
+              chunkFrames(0), targetLatencyMs(1500), writeToDisk(true) {}
+    };
+
+    // 自动分段的切分方式
+    enum FragmentCutMode {
+        CUT_AT_IDR = 0,                 // 只在IDR处切分，每个分段都从随机访问点开始
+        CUT_AT_IDR_OR_MAX               // 在IDR处切分，超过最长时长或最大字节数时在任意帧强制切分
+    };
+
+    // 自动分段策略（分片MP4模式，writeFrame自行开始和结束分段）
+    struct FragmentPolicy {
+        uint32_t targetDurationMs;      // 目标时长（毫秒），达到后在下一个IDR切分，0表示不按时长
+        uint32_t maxDurationMs;         // 强制切分时长（毫秒，只用于CUT_AT_IDR_OR_MAX），0表示目标时长的2倍
+        uint64_t maxBytes;              // 最大字节数，达到后在下一个IDR切分（CUT_AT_IDR_OR_MAX下立即切分），0表示不限制
+        FragmentCutMode cutMode;        // 切分方式
+
+        FragmentPolicy()
+            : targetDurationMs(2000), maxDurationMs(0), maxBytes(0), cutMode(CUT_AT_IDR) {}
+    };
+
+    // 已结束分段的信息
+    struct FragmentInfo {
+        uint32_t index;                 // 分段序号（从1开始，直播模式下与$Number$一致）
+        uint64_t firstDTS;              // 第一个视频样本的DTS（时间基90000，每个文件从0开始）
+        uint64_t duration;              // 时长（时间基90000）
+        uint64_t bytes;                 // 视频样本字节数（不含moof及音频、元数据）
+        uint32_t frames;                // 视频帧数
+        bool startsWithIDR;             // 是否从IDR开始
+    };
+
+    // 分段结束回调（在封装线程中调用，异步模式下为后台线程）
+    typedef std::function<void(const FragmentInfo& info)> FragmentCallback;
+
+    // 异步模式统计信息
+    struct AsyncStats {
+        size_t queueDepth;          // 当前队列深度
+        size_t maxQueueDepth;       // 队列深度峰值
+        size_t queueCapacity;       // 队列容量
+        uint64_t framesQueued;      // 已入队帧数
+        uint64_t framesDropped;     // 因队列满丢弃的帧数
+        double lastLatencyMs;       // 最近一帧从入队到写入完成的延迟（毫秒）
+        double avgLatencyMs;        // 平均延迟（毫秒）
+        double maxLatencyMs;        // 最大延迟（毫秒）
+    };
+
     H264MP4Writer();
     ~H264MP4Writer();
 
     /**
      * 初始化视频参数
      * 
-     * @param width 视频宽度
-     * @param height 视频高度
+     * @param width 视频宽度（收到SPS后以SPS为准）
+     * @param height 视频高度（收到SPS后以SPS为准）
      * @param frameRate 帧率
      * @param isH265 是否为H265编码（默认为-1，表示自动检测编码类型）
      * @return 是否初始化成功
@@ -55,11 +163,142 @@ public:
      * @param frameData 帧数据（包含起始码 0x00 0x00 0x00 0x01）
      * @param frameSize 数据大小
      * @param isKeyFrame 是否是关键帧
-     * @param timestamp 时间戳（毫秒，可选）
+     * @param timestamp 显示时间戳（毫秒，可选，-1表示按帧率计算）
      * @return 是否成功写入
      */
     bool writeFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp = -1);
 
+    /**
+     * 按显示/解码时间戳写入帧（支持B帧）
+     * 
+     * 时间戳单位由setTimebase指定。只提供PTS时按SPS声明（或从码流中观察到）
+     * 的重排序深度推算DTS；都不提供时按帧率计算，并用POC确定显示顺序。
+     * 帧必须按解码顺序写入。
+     * 
+     * @param frameData 帧数据（包含起始码）
+     * @param frameSize 数据大小
+     * @param isKeyFrame 是否是关键帧
+     * @param pts 显示时间戳（NO_TIMESTAMP表示未提供）
+     * @param dts 解码时间戳（NO_TIMESTAMP表示未提供）
+     * @return 是否成功写入
+     */
+    bool writeFrameTimed(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts = NO_TIMESTAMP);
+
+    /**
+     * 写入已解析的帧（通常由FrameFanout分发，同一帧被多个写入器共享）
+     * 
+     * 不再查找起始码和拷贝帧数据：去掉参数集后的样本直接取自帧的缓冲区。
+     * 异步模式下队列只保存帧的引用。未录制时返回false，预录像由FrameFanout
+     * 统一缓冲。
+     * 
+     * @param frame 已解析的帧（时间戳为90kHz轨道时间）
+     * @return 是否成功写入
+     */
+    bool writeParsedFrame(const std::shared_ptr<const ParsedFrame>& frame);
+
+    /**
+     * 写入池中的帧缓冲区（FramePool分配，与writeFrame等价）
+     * 
+     * 异步模式下队列只持有缓冲区的引用，不再拷贝帧数据，封装完成后
+     * 缓冲区归还到池中。调用方写入后不能再修改缓冲区内容。
+     * 
+     * @param buffer 帧数据（包含起始码）
+     * @param isKeyFrame 是否是关键帧
+     * @param timestamp 时间戳（毫秒，可选）
+     * @return 是否成功写入
+     */
+    bool writeFrameBuffer(const FrameBuffer& buffer, bool isKeyFrame, int64_t timestamp = -1);
+
+    /**
+     * 设置writeFrameTimed时间戳的时间基（需在开始录制前调用，默认1/1000秒）
+     * 
+     * 换算到轨道时间（90kHz）使用精确的有理数运算，长时间录制不漂移
+     * 
+     * @param num 时间基分子
+     * @param den 时间基分母（如90kHz时间戳为1/90000）
+     * @return 是否设置成功
+     */
+    bool setTimebase(uint32_t num, uint32_t den);
+
+    /**
+     * 获取当前使用的重排序深度（0表示没有B帧）
+     * 
+     * @return 最大重排序帧数
+     */
+    uint32_t getReorderDepth() const { return m_tsEngine.reorderDepth(); }
+
+    /**
+     * 启用音频轨道（需在开始录制前调用）
+     * 
+     * 音频帧按时间与视频交织写入同一mdat；分段和防断电模式下
+     * 每个moof同时包含音视频两个轨道
+     * 
+     * @param config 音频编码、采样率和声道数
+     * @return 是否启用成功
+     */
+    bool enableAudio(const AudioTrack::Config& config);
+
+    /**
+     * 关闭音频轨道（需在停止录制后调用）
+     */
+    void disableAudio();
+
+    /**
+     * 写入音频帧（只在录制中写入，预录像不缓冲音频）
+     * 
+     * 需与writeFrame在同一线程调用。时间戳与writeFrame的时间戳使用同一时钟；
+     * 视频不带时间戳时音频按采样数计算时间。
+     * 
+     * @param frameData 帧数据（G.711/PCM裸数据，AAC为ADTS或裸帧）
+     * @param frameSize 数据大小
+     * @param timestamp 时间戳（毫秒，可选，-1表示按采样数计算）
+     * @return 是否成功写入
+     */
+    bool writeAudioFrame(const uint8_t* frameData, size_t frameSize, int64_t timestamp = -1);
+
+    /**
+     * 检查是否启用了音频轨道
+     * 
+     * @return 是否启用音频
+     */
+    bool hasAudio() const { return m_audio != nullptr; }
+
+    /**
+     * 启用智能分析元数据轨道（需在开始录制前调用）
+     * 
+     * 元数据按时间与视频交织写入定时元数据轨道，每个录像文件
+     * 同时生成同名.idx事件索引，可用MetadataIndex::query按类型和时间检索
+     * 
+     * @return 是否启用成功
+     */
+    bool enableMetadata();
+
+    /**
+     * 关闭元数据轨道（需在停止录制后调用）
+     */
+    void disableMetadata();
+
+    /**
+     * 写入一条元数据（如DHAV辅助帧、IVS扩展字段，只在录制中写入）
+     * 
+     * 需与writeFrame在同一线程调用。时间戳与writeFrame的时间戳使用同一时钟；
+     * 不带时间戳或视频不带时间戳时，元数据归属最近写入的视频帧。
+     * 
+     * @param data 负载数据（原样写入样本）
+     * @param size 数据大小
+     * @param eventType 事件类型（写入索引，用于检索）
+     * @param timestamp 时间戳（毫秒，可选，-1表示使用最近一帧视频的时间）
+     * @return 是否成功写入
+     */
+    bool writeMetadata(const uint8_t* data, size_t size, uint32_t eventType, int64_t timestamp = -1);
+
+    /**
+     * 检查是否启用了元数据轨道
+     * 
+     * @return 是否启用元数据
+     */
+    bool hasMetadata() const { return m_metadata != nullptr; }
+
 
     /**
      * 获取当前文件路径
@@ -88,7 +327,7 @@ public:
     bool initFragmentedMP4(int width, int height, float frameRate, int isH265 = -1, const std::string& outputDir = "./dash");
 
     /**
-     * 开始新的分段
+     * 开始新的分段（启用自动分段时不可用）
      * 
      * @param fragmentDuration 分段时长（毫秒）
      * @return 是否成功开始分段
@@ -96,12 +335,74 @@ public:
     bool startFragment(uint32_t fragmentDuration = 1000);
 
     /**
-     * 结束当前分段
+     * 结束当前分段（启用自动分段时不可用）
      * 
      * @return 是否成功结束分段
      */
     bool endFragment();
 
+    /**
+     * 启用自动分段（需在initFragmentedMP4前调用）
+     * 
+     * 启用后writeFrame按策略自行开始和结束分段，不再调用startFragment/endFragment；
+     * 切分在写入新帧之前进行，CUT_AT_IDR下每个分段都从IDR开始
+     * 
+     * @param policy 切分策略
+     * @return 是否启用成功
+     */
+    bool enableAutoFragment(const FragmentPolicy& policy = FragmentPolicy());
+
+    /**
+     * 关闭自动分段（需在停止录制后调用）
+     */
+    void disableAutoFragment();
+
+    /**
+     * 检查是否启用了自动分段
+     * 
+     * @return 是否为自动分段
+     */
+    bool isAutoFragment() const { return m_autoFragmentEnabled; }
+
+    /**
+     * 启用紧凑的分片编码（需在initFragmentedMP4前调用）
+     * 
+     * trex中写入按帧率计算的默认样本时长和非同步样本标志，每个分片开始时
+     * 启用随机访问点检测：固定帧率下trun只保留样本大小（有B帧时加上合成时间偏移），
+     * 分片第一个IDR的标志写入first_sample_flags，不再为每个样本写时长和标志
+     * 
+     * @return 是否启用成功
+     */
+    bool enableCompactFragments();
+
+    /**
+     * 关闭紧凑的分片编码（需在停止录制后调用）
+     */
+    void disableCompactFragments();
+
+    /**
+     * 检查是否启用了紧凑的分片编码
+     * 
+     * @return 是否为紧凑编码
+     */
+    bool isCompactFragments() const { return m_compactFragments; }
+
+    /**
+     * 获取本次分片录制的头部开销（文件关闭或直播分段发布后统计）
+     * 
+     * @return moof个数、样本数、头部字节数和媒体字节数
+     */
+    MoofInspector::Totals getFragmentOverhead() const;
+
+    /**
+     * 设置分段结束回调（需在开始录制前调用，自动和手动分段都会回调）
+     * 
+     * 回调给出分段的时长、字节数和第一个样本的时间，下游打包无需重新扫描文件
+     * 
+     * @param callback 回调函数，为空表示不回调
+     */
+    void setFragmentCallback(const FragmentCallback& callback);
+
     /**
      * 生成DASH MPD文件
      * 
@@ -111,6 +412,58 @@ public:
      */
     bool generateMPD(const std::string& streamName, float segmentDuration = 4.0f);
     
+    /**
+     * 启用直播DASH输出（需在initFragmentedMP4前调用）
+     * 
+     * 启用后initFragmentedMP4只写初始化分段init.mp4，每对startFragment/endFragment
+     * 生成一个独立的segment_$Number$.m4s；每个分段写完后立即重写动态MPD，
+     * 不再需要停止录制后调用generateMPD
+     * 
+     * 设置chunkFrames后为低延迟CMAF分块模式：写入中的分段以segment_N.m4s.part命名，
+     * 每N帧追加一个块，第一个块写出后即加入MPD（带availabilityTimeOffset），
+     * 分段结束后改名为segment_N.m4s；DashServer对写入中的分段以chunked编码边写边发
+     * 
+     * 分片在内存中组装，每个分段（分块模式下每个块）作为一段连续数据交给
+     * 输出端：writeToDisk为true时写入输出目录，另可用addOutputSink添加内存、
+     * 文件描述符或回调输出端
+     * 
+     * @param config 时移窗口和MPD配置
+     * @return 是否启用成功
+     */
+    bool enableLiveDash(const LiveDashConfig& config = LiveDashConfig());
+
+    /**
+     * 关闭直播DASH输出（需在停止录制后调用）
+     */
+    void disableLiveDash();
+
+    /**
+     * 添加直播DASH输出端（需在开始录制前调用）
+     * 
+     * @param sink 输出端，如交给DashServer直接从内存发送的MemorySink
+     * @return 是否添加成功
+     */
+    bool addOutputSink(const std::shared_ptr<OutputSink>& sink);
+
+    /**
+     * 移除全部直播DASH输出端（需在开始录制前调用）
+     */
+    void clearOutputSinks();
+
+    /**
+     * 检查是否启用了直播DASH输出
+     * 
+     * @return 是否为直播模式
+     */
+    bool isLiveDash() const { return m_liveEnabled; }
+
+    /**
+     * 获取最近一次直播MPD更新的耗时（从结束分段，或分块模式下分段的第一个块写出，到MPD改名完成）
+     * 
+     * @return 耗时（毫秒）
+     */
+    double getLastSegmentPublishMs() const { return m_lastPublishUs / 1000.0; }
+
     /**
      * 检查是否为分段MP4模式
      * 
@@ -118,47 +471,439 @@ public:
      */
     bool isFragmented() const { return m_isFragmented; }
 
+    /**
+     * 获取样本缓冲区的堆分配次数
+     * 
+     * 样本缓冲区按目前见过的最大访问单元扩容并复用，稳态下不再分配
+     * 
+     * @return 累计堆分配次数
+     */
+    uint64_t getSampleAllocCount() const { return m_sampleAllocCount; }
+
+    /**
+     * 获取平均每帧的堆分配次数
+     * 
+     * @return 堆分配次数 / 已写入帧数
+     */
+    double getAllocationsPerFrame() const;
+
+    /**
+     * 启用防断电录制模式（需在开始录制前调用）
+     * 
+     * 收到参数集后立即写入moov，之后按配置周期性写入moof/mdat分片，
+     * 异常断电或进程被杀时最多丢失最后一个分片
+     * 
+     * @param config 分片和落盘配置
+     * @return 是否启用成功
+     */
+    bool enableDurableMode(const DurableConfig& config = DurableConfig());
+
+    /**
+     * 关闭防断电录制模式（需在停止录制后调用）
+     */
+    void disableDurableMode();
+
+    /**
+     * 检查是否为防断电录制模式
+     * 
+     * @return 是否为防断电录制模式
+     */
+    bool isDurable() const { return m_durableEnabled; }
+
+    /**
+     * 设置文件切换策略（需在开始录制前调用，只用于startRecording的单文件录制）
+     * 
+     * 切换总在IDR处进行：下一个文件提前创建并写好参数集，
+     * 旧文件在后台线程中关闭，切换过程不丢帧、不阻塞写入
+     * 
+     * @param policy 切换策略，全部为0表示不切换
+     * @return 是否设置成功
+     */
+    bool setRotationPolicy(const RotationPolicy& policy);
+
+    /**
+     * 获取本次录制已切换的文件数
+     * 
+     * @return 切换次数
+     */
+    uint64_t getRotationCount() const { return m_rotationCount; }
+
+    /**
+     * 获取本次录制中参数集变化的次数
+     * 
+     * 每个IDR都会比较参数集哈希：普通MP4新增样本描述继续写入，
+     * 分片和防断电模式下使用avc3/hev1带内参数集，无需重新开始录制
+     * 
+     * @return 变化次数
+     */
+    uint64_t getParameterSetChangeCount() const { return m_paramSetChangeCount; }
+
+    /**
+     * 获取当前视频分辨率
+     * 
+     * 收到SPS后以SPS为准，参数集变化时随之更新
+     * 
+     * @return 宽度/高度（像素）
+     */
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    /**
+     * 启用预录像（需在开始录制前调用）
+     * 
+     * 未录制时writeFrame写入的帧保存在固定大小的内存环中，保留最近
+     * durationMs毫秒的完整GOP；startRecording时先按原时间戳写入这些帧，
+     * 再写入实时帧
+     * 
+     * @param durationMs 预录时长（毫秒）
+     * @param maxBytes 缓冲区大小上限（字节），决定每个通道的内存占用
+     * @return 是否启用成功
+     */
+    bool enablePreRecord(uint32_t durationMs, size_t maxBytes);
+
+    /**
+     * 关闭预录像并释放缓冲区（需在停止录制后调用）
+     */
+    void disablePreRecord();
+
+    /**
+     * 获取预录像缓冲区的内存占用、缓冲时长和已写入录像的帧数
+     * 
+     * @return 统计信息（未启用时全为0）
+     */
+    PreRecordBuffer::Stats getPreRecordStats() const;
+
+    /**
+     * 启用异步录制模式（需在开始录制前调用）
+     * 
+     * 启用后writeFrame只把帧拷贝到无锁队列后立即返回，
+     * 解析、封装和文件写入在独立的封装线程中完成
+     * 
+     * @param queueCapacity 队列容量（帧数）
+     * @param policy 队列满时的处理策略
+     * @return 是否启用成功
+     */
+    bool enableAsync(size_t queueCapacity = 64, OverflowPolicy policy = OVERFLOW_BLOCK);
+
+    /**
+     * 关闭异步录制模式（需在停止录制后调用）
+     */
+    void disableAsync();
+
+    /**
+     * 检查是否为异步录制模式
+     * 
+     * @return 是否为异步录制模式
+     */
+    bool isAsync() const { return m_asyncEnabled; }
+
+    /**
+     * 获取异步模式的队列深度和延迟统计
+     * 
+     * @return 统计信息
+     */
+    AsyncStats getAsyncStats() const;
+
 private:
+    // 按录制状态把帧送入预录像缓冲、异步队列或直接封装（时间戳为轨道时间）
+    bool dispatchFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    // 写入一帧（解析并封装，异步模式下在封装线程中调用；时间戳为轨道时间）
+    bool muxFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    // 写入已解析的帧（异步模式下在封装线程中调用）
+    bool muxParsedFrame(const ParsedFrame& frame);
+
+    // 帧序号对应的轨道时间
+    int64_t frameIndexToTicks(uint64_t index) const;
+
+    // 从SPS读取重排序深度并重置POC解析
+    void updateReorderDepth(const uint8_t* sps, size_t spsSize);
+
+    // 每个文件开始时重置时间戳状态
+    void resetFileTimestamps();
+
+    // 创建视频轨道并设置编解码器和分辨率
+    bool setupVideoTrack(GF_ISOFile* file, int& trackId);
+
+    // 创建录像文件并添加视频、音频和元数据轨道（防断电模式下同时设置分片参数）
+    GF_ISOFile* openRecordingFile(const std::string& path, int& trackId, int& audioTrackId, int& metaTrackId);
+
+    // 写入一个音频帧（异步模式下在封装线程中调用；时间戳为90kHz）
+    bool muxAudio(const uint8_t* frameData, size_t frameSize, int64_t timestamp);
+
+    // 写入时间不晚于until（90kHz流时间）的缓冲音频
+    bool flushAudio(int64_t until);
+
+    // 写入一条元数据（异步模式下在封装线程中调用；时间戳为90kHz）
+    bool muxMetadata(const uint8_t* data, size_t size, uint32_t eventType, int64_t timestamp);
+
+    // 写入时间不晚于until（90kHz流时间）的缓冲元数据
+    bool flushMetadata(int64_t until);
+
+    // 保存文件的事件索引（没有事件时不生成）
+    void saveMetadataIndex(const std::shared_ptr<MetadataIndex>& index, const std::string& mp4Path);
+
+    // 把当前参数集写入文件的指定样本描述（同时按SPS设置分辨率）
+    bool applyParameterSets(GF_ISOFile* file, int trackId, u32 descIndex);
+
+    // 参数集变化：为当前文件新增样本描述，之后的样本使用它
+    bool addSampleDescription();
+
+    // 防断电模式：参数集就绪后写入moov并开始分片
+    bool beginDurableFragments();
+
+    // 防断电模式：按配置在写入样本前切分分片
+    bool cutDurableFragment(uint64_t dts, bool isKeyFrame);
+
+    // 把已写入的数据刷到磁盘
+    void syncFileToDisk(GF_ISOFile* file);
+
+    // 待关闭的录像文件
+    struct ClosingFile {
+        GF_ISOFile* file;
+        std::string path;
+        bool durableStarted;    // 是否已写入moov（防断电模式）
+        bool fragmentOpen;      // 是否有未写入的分片（防断电模式）
+        std::shared_ptr<MetadataIndex> index;   // 事件索引（未启用元数据时为空）
+    };
+
+    // 写入剩余数据并关闭文件，按配置转换为普通MP4
+    bool finalizeFile(const ClosingFile& closing);
+
+    // 文件切换：是否到了切换时间/大小
+    bool isRotationDue() const;
+
+    // 文件切换：估算下一次切换的时间（按大小切换时由当前码率推算）
+    std::chrono::system_clock::time_point expectedRotationTime() const;
+
+    // 文件切换：计算下一个整点对齐的切换时间
+    std::chrono::system_clock::time_point nextAlignedRotation(std::chrono::system_clock::time_point now) const;
+
+    // 文件切换：提前创建下一个文件并写好参数集
+    bool prepareNextFile();
+
+    // 文件切换：切换到下一个文件，旧文件交给后台线程关闭
+    bool rotateFile();
+
+    // 文件切换：删除提前创建但未使用的文件
+    void discardNextFile();
+
+    // 后台关闭线程
+    void startFinalizeThread();
+    void stopFinalizeThread();
+    void finalizeThreadLoop();
+
+    // 生成不与已有文件重名的录像文件路径（按给定时间命名）
+    std::string uniqueFilePath(std::chrono::system_clock::time_point time = std::chrono::system_clock::now()) const;
+
+    // 预录像：开始录制时写入缓冲的GOP
+    void flushPreRecord();
+
+    // 把分片MP4转换为moov前置的普通MP4（原地替换）
+    bool defragmentFile(const std::string& path);
+
+    // 开始/结束分段的实际实现
+    bool doStartFragment(uint32_t fragmentDuration);
+    bool doEndFragment();
+
+    // 直播DASH：把当前分段写入独立文件并更新MPD
+    bool publishLiveSegment(bool ended);
+
+    // 自动分段：按策略在写入本帧之前切分
+    bool cutAutoFragment(uint64_t dts, bool isKeyFrame);
+
+    // 分段已结束：回调分段信息
+    void reportFragment();
+
+    // 紧凑分片编码：每个分片开始时设置的选项
+    void applyCompactFragmentOptions();
+
+    // 统计已写完文件或分段的头部开销
+    void inspectFragments(const std::string& path);
+
+    // 累加头部开销统计
+    void addFragmentOverhead(const MoofInspector::Totals& totals);
+
+    // 直播DASH：把文件映射的输出流替换为内存流
+    bool redirectToMemory(GF_ISOFile* file);
+
+    // 直播DASH：把内存中已写出的数据交给输出端
+    void dispatchLiveInit();
+    void dispatchLiveMedia(bool segmentEnd);
+    bool dispatchLiveManifest(bool ended);
+
+    // 直播DASH：写出当前CMAF块并开始下一个块
+    bool flushLiveChunk();
+
+    // 直播DASH：RFC 6381编码字符串（视频和音频轨道）
+    std::string liveCodecs() const;
+
+    // 把文件缓冲写入操作系统（不等待落盘）
+    void flushFileBuffers(GF_ISOFile* file);
+
+    // 异步模式：帧入队
+    bool enqueueFrame(const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    // 异步模式：已解析的帧入队（只保存引用）
+    bool enqueueParsedFrame(const std::shared_ptr<const ParsedFrame>& frame);
+
+    // 异步模式：池中的帧缓冲区入队（只保存引用）
+    bool enqueueFrameBuffer(const FrameBuffer& buffer, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    // 异步模式：为视频帧获取槽位，按溢出策略丢帧（dropped为true表示已丢弃）
+    FrameQueue::Entry* acquireFrameSlot(bool isKeyFrame, const std::function<bool()>& isReference, bool& dropped);
+
+    // 异步模式：音频帧/元数据入队
+    bool enqueueSideData(FrameQueue::EntryType type, const uint8_t* data, size_t size, uint32_t param, int64_t timestamp);
+
+    // 异步模式：控制命令入队（不会被丢弃）
+    bool enqueueControl(FrameQueue::EntryType type, uint32_t param);
+
+    // 异步模式：等待队列空出槽位
+    FrameQueue::Entry* waitForSlot();
+
+    // 启动/停止封装线程（停止时先写完队列中剩余的帧）
+    void startMuxThread();
+    void stopMuxThread();
+
+    // 封装线程主循环
+    void muxThreadLoop();
+
+    // 判断帧是否被其他帧参考（用于丢帧策略；编码尚未确定时总是返回true）
+    bool isReferenceFrame(const uint8_t* frameData, size_t frameSize);
+
+    // 自动检测编码时，在生产者线程中按关键帧的参数集确定编码类型
+    void detectProducerCodec(const uint8_t* frameData, size_t frameSize, bool isKeyFrame);
+
+    // 按参数集判断编码类型：有VPS为H265（1），没有VPS但有H264的SPS为H264（0），否则-1
+    static int detectAnnexBCodec(const uint8_t* frameData, size_t frameSize);
+
+    // 按已确定的编码查找第一个VCL NALU判断是否为参考帧（1是，0否，-1无法判断）
+    template <typename Traits>
+    static int scanReference(const uint8_t* frameData, size_t frameSize);
+
+    // NALU描述，指向帧数据内部，不做拷贝
+    typedef ParsedFrame::NALUnit NALUnit;
+
     // 解析NALU数据
-    bool parseNALU(const uint8_t* data, size_t size, std::vector<std::pair<const uint8_t*, size_t>>& nalus);
+    bool parseNALU(const uint8_t* data, size_t size, std::vector<NALUnit>& nalus);
+
+    // 写入样本前的处理：编码检测、参数集和文件切换（ready为false表示还没有参数集，跳过本帧）
+    bool prepareFrame(const std::vector<NALUnit>& nalus, bool isKeyFrame, bool& ready);
+
+    // 把NALU转换为长度前缀格式写入样本缓冲区（hasSliceData为false表示只有参数集）
+    template <typename Traits>
+    bool buildSample(const std::vector<NALUnit>& nalus, bool isKeyFrame, GF_ISOSample& sample, bool& hasSliceData);
+
+    // 按PARAM_SET_*槽位取出帧中的参数集（没有的为nullptr），返回找到的槽位掩码
+    template <typename Traits>
+    static unsigned findParameterSets(const std::vector<NALUnit>& nalus, const uint8_t* paramSets[PARAM_SET_SLOTS],
+                                      size_t paramSetSizes[PARAM_SET_SLOTS]);
+
+    // 按编码实例化的NALU处理函数，确定编码类型后选择一次
+    struct CodecOps {
+        const char* name;
+        int pocStep;                        // 相邻帧的POC差
+        unsigned requiredParamSets;         // 配置轨道需要的参数集（PARAM_SET_*槽位掩码）
+        bool (H264MP4Writer::*buildSample)(const std::vector<NALUnit>&, bool, GF_ISOSample&, bool&);
+        unsigned (*findParameterSets)(const std::vector<NALUnit>&, const uint8_t* [PARAM_SET_SLOTS], size_t [PARAM_SET_SLOTS]);
+    };
+
+    template <typename Traits>
+    static CodecOps codecOps();
+
+    // 设置编码类型并选择对应的NALU处理函数
+    void selectCodec(bool isH265);
+
+    // 计算时间戳并把样本写入视频轨道
+    bool writeVideoSample(GF_ISOSample& sample, const std::vector<NALUnit>& nalus, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    // 分片模式：暂存样本，等下一帧的DTS确定其时长
+    bool holdSample(const GF_ISOSample& sample);
+
+    // 分片模式：写入暂存的样本，时长取到nextDTS的间隔（NO_TIMESTAMP时沿用上一个样本的时长）
+    bool writeHeldSample(int64_t nextDTS);
+
+    // 统计已写入的视频样本（帧数、文件大小、当前分段）
+    void countVideoSample(const GF_ISOSample& sample);
+
+    // 计算帧的绝对PTS/DTS（调用方未提供时按帧率、POC和重排序深度推算）
+    void assignTimestamps(const std::vector<NALUnit>& nalus, bool isKeyFrame, int64_t& pts, int64_t& dts);
+
+    // 计算样本在当前文件中的DTS和合成时间偏移
+    void computeTimestamps(int64_t pts, int64_t dts, uint64_t& sampleDTS, int32_t& ctsOffset);
+
+    // 提取帧中的参数集：首次收到时配置轨道，之后内容变化时更新
+    bool updateParameterSets(const std::vector<NALUnit>& nalus);
+
+    // 确保样本缓冲区至少有size字节
+    bool reserveSampleBuffer(size_t size);
     
-    // 处理H264的SPS/PPS
+    // 由H264的SPS/PPS生成编解码器配置（分辨率、档次、级别取自SPS）
     bool processH264ParameterSets(const uint8_t* sps, size_t spsSize, const uint8_t* pps, size_t ppsSize);
     
-    // 处理H265的VPS/SPS/PPS
+    // 由H265的VPS/SPS/PPS生成编解码器配置（分辨率、档次、级别取自SPS）
     bool processH265ParameterSets(const uint8_t* vps, size_t vpsSize, const uint8_t* sps, size_t spsSize, const uint8_t* pps, size_t ppsSize);
     
-    // 生成文件名
-    std::string generateFileName() const;
+    // 按给定时间生成文件名
+    std::string generateFileName(std::chrono::system_clock::time_point when = std::chrono::system_clock::now()) const;
     
     /**
      * 自动检测视频编码类型（H264/H265）
      * 
-     * @param frameData 帧数据（包含起始码 0x00 0x00 0x00 0x01）
-     * @param frameSize 数据大小
+     * @param nalus 已由parseNALU解析的NALU列表（不再重复解析帧数据）
      * @return 是否为H265编码
      */
-    bool detectCodecType(const uint8_t* frameData, size_t frameSize);
+    bool detectCodecType(const std::vector<NALUnit>& nalus) const;
 
 private:
     int m_width;
     int m_height;
     float m_frameRate;
     bool m_isH265;
+    int m_configuredCodec;           // init指定的编码类型（0 H264，1 H265，-1 自动检测）
+    CodecOps m_codec;                // 当前编码的NALU处理函数（随m_isH265由selectCodec设置）
     bool m_isRecording;
     bool m_hasParameterSets;
     
     std::string m_outputDir;
     std::string m_currentFilePath;
+    mutable std::mutex m_pathMutex;  // 保护m_currentFilePath（切换文件时在写入线程中修改）
     
     GF_ISOFile* m_mp4File;
     int m_trackId;
+    u32 m_sampleDescIndex;           // 当前样本使用的样本描述（参数集变化时新增）
     uint64_t m_sampleDuration;
     uint64_t m_currentDTS;
     
-    // 参数集配置
-    std::unique_ptr<GF_AVCConfig> m_avcConfig;
-    std::unique_ptr<GF_HEVCConfig> m_hevcConfig;
+    // 时间戳相关（轨道时间基为1/90000）
+    uint64_t m_timebaseMul;          // 调用方时间基 -> 轨道时间：乘数
+    uint64_t m_timebaseDiv;          // 调用方时间基 -> 轨道时间：除数
+    uint64_t m_frameTicksMul;        // 帧序号 -> 轨道时间：乘数（90000 * 帧率分母）
+    uint64_t m_frameTicksDiv;        // 帧序号 -> 轨道时间：除数（帧率分子）
+    uint64_t m_frameIndex;           // 按帧率计算时间戳时的帧序号
+    TimestampEngine m_tsEngine;      // PTS -> DTS推算
+    PocParser m_pocParser;           // 未提供时间戳时确定显示顺序
+    bool m_reorderKnown;             // SPS是否声明了重排序深度
+    int32_t m_gopPocBase;            // 当前GOP关键帧的POC
+    uint64_t m_gopIndexBase;         // 当前GOP关键帧的帧序号
+    int64_t m_lastFileDTS;           // 当前文件上一个样本的DTS（-1表示没有）
+    uint64_t m_ctsClampCount;        // PTS早于DTS被截断的帧数
+
+    // 参数集配置（其中的参数集列表需由GPAC释放）
+    struct AVCConfigDeleter {
+        void operator()(GF_AVCConfig* cfg) const { gf_odf_avc_cfg_del(cfg); }
+    };
+    struct HEVCConfigDeleter {
+        void operator()(GF_HEVCConfig* cfg) const { gf_odf_hevc_cfg_del(cfg); }
+    };
+    std::unique_ptr<GF_AVCConfig, AVCConfigDeleter> m_avcConfig;
+    std::unique_ptr<GF_HEVCConfig, HEVCConfigDeleter> m_hevcConfig;
+    uint64_t m_paramSetHash;                 // 当前参数集的哈希
+    bool m_inbandParameterSets;              // moov提前写出时参数集随样本带内传输（avc3/hev1）
+    std::vector<uint8_t> m_paramSetPrefix;   // 带内模式下补到IDR样本前的参数集（长度前缀格式）
+    uint64_t m_paramSetChangeCount;          // 录制过程中参数集变化次数
     
     // 记录开始时间
     std::chrono::system_clock::time_point m_startTime;
@@ -168,6 +913,103 @@ private:
     std::string m_dashOutputDir; // DASH输出目录
     int m_fragmentCount;         // 分段计数
     uint32_t m_fragmentDuration;  // 分段时长（毫秒）
+    bool m_autoFragmentEnabled;         // 是否启用自动分段
+    FragmentPolicy m_fragmentPolicy;    // 自动分段策略
+    FragmentCallback m_onFragment;      // 分段结束回调
+    bool m_fragmentOpen;                // 是否有已开始、尚未回调的分段
+    FragmentInfo m_fragmentInfo;        // 当前分段的统计
+    bool m_compactFragments;            // 是否启用紧凑的分片编码
+    MoofInspector::Totals m_fragmentOverhead;   // 头部开销统计
+    mutable std::mutex m_overheadMutex;         // 保护m_fragmentOverhead
+
+    // 直播DASH相关
+    bool m_liveEnabled;                             // 是否启用直播DASH
+    LiveDashConfig m_liveConfig;                    // 直播配置
+    std::unique_ptr<LiveDashManifest> m_liveManifest;   // 动态MPD
+    uint32_t m_liveSegmentNumber;                   // 当前分段序号（$Number$）
+    bool m_liveSegmentOpen;                         // 是否有未发布的分段
+    int64_t m_liveSegmentStart;                     // 当前分段第一帧的DTS（-1表示还没有帧）
+    bool m_liveMarkDecodeTime;                      // 下一个视频样本是否为块的第一个样本（设置tfdt）
+    uint32_t m_liveChunkFrames;                     // 当前块已写入的帧数
+    uint32_t m_liveChunkCount;                      // 当前分段已写出的块数
+    bool m_liveChunkPending;                        // 上一个块已写出，下一帧前开始新的块
+    uint64_t m_liveSegmentBytes;                    // 当前分段已交给输出端的字节数
+    std::unique_ptr<MemoryStream> m_liveStream;     // 组装分片的内存流
+    std::vector<std::shared_ptr<OutputSink>> m_outputSinks;    // 用户添加的输出端
+    std::vector<std::shared_ptr<OutputSink>> m_liveSinks;      // 本次录制的输出端（含写入磁盘）
+    std::atomic<uint64_t> m_lastPublishUs;          // 最近一个分段的发布耗时（微秒）
+
+    // 样本缓冲区（按最大访问单元复用）
+    std::vector<NALUnit> m_nalus;    // 当前帧的NALU列表，容量跨帧复用
+    uint8_t* m_sampleBuffer;         // 长度前缀格式的样本数据
+    size_t m_sampleBufferSize;       // 样本缓冲区容量
+    uint8_t* m_heldBuffer;           // 暂存样本的数据（与样本缓冲区交换复用）
+    size_t m_heldBufferSize;         // 暂存缓冲区容量
+    GF_ISOSample m_heldSample;       // 分片模式下等待下一帧确定时长的样本
+    bool m_hasHeldSample;            // 是否有暂存样本
+    u32 m_heldDescIndex;             // 暂存样本的样本描述
+    uint64_t m_lastSampleDuration;   // 上一个分片样本的时长
+    uint64_t m_sampleAllocCount;     // 样本缓冲区及NALU列表的堆分配次数
+    uint64_t m_framesWritten;        // 已写入帧数
+
+    // 防断电录制相关
+    bool m_durableEnabled;           // 是否启用防断电模式
+    DurableConfig m_durableConfig;   // 防断电模式配置
+    bool m_durableStarted;           // moov是否已写入
+    bool m_durableFragmentOpen;      // 是否有未写入的分片
+    uint64_t m_durableFragmentDTS;   // 当前分片第一个样本的DTS
+
+    // 文件切换相关
+    RotationPolicy m_rotationPolicy;            // 切换策略
+    bool m_rotationEnabled;                     // 是否启用切换
+    uint64_t m_rotationCount;                   // 已切换的文件数
+    uint64_t m_fileBytes;                       // 当前文件已写入的样本字节数
+    int64_t m_fileBaseTimestamp;                // 当前文件第一帧的DTS（轨道时间，NO_TIMESTAMP表示未收到）
+    std::chrono::system_clock::time_point m_nextAlignedTime;   // 下一个整点对齐的切换时间
+    GF_ISOFile* m_nextFile;                     // 提前创建的下一个文件
+    std::string m_nextFilePath;                 // 下一个文件的路径（按预计切换时间命名）
+    int m_nextTrackId;                          // 下一个文件的视频轨道ID
+    int m_nextAudioTrackId;                     // 下一个文件的音频轨道ID
+    int m_nextMetaTrackId;                      // 下一个文件的元数据轨道ID
+    std::thread m_finalizeThread;               // 后台关闭旧文件的线程
+    std::mutex m_finalizeMutex;                 // 保护以下成员
+    std::condition_variable m_finalizeCond;
+    std::deque<ClosingFile> m_finalizeQueue;    // 待关闭的文件
+    bool m_finalizeRunning;
+
+    // 音频相关
+    std::unique_ptr<AudioTrack> m_audio;        // 音频参数和交织缓冲（未启用时为空）
+    int m_audioTrackId;                         // 当前文件的音频轨道ID
+
+    // 元数据相关
+    std::unique_ptr<MetadataTrack> m_metadata;  // 元数据交织缓冲（未启用时为空）
+    int m_metaTrackId;                          // 当前文件的元数据轨道ID
+    std::shared_ptr<MetadataIndex> m_metaIndex; // 当前文件的事件索引
+    size_t m_metaIndexSaved;                    // 防断电模式下已写入索引文件的事件数
+    int64_t m_lastVideoTime;                    // 最近写入的视频帧时间（90kHz流时间，NO_TIMESTAMP表示没有）
+
+    // 预录像相关
+    std::unique_ptr<PreRecordBuffer> m_preRecord;   // 未录制时的GOP缓冲
+    mutable std::mutex m_preRecordMutex;            // 保护m_preRecord（统计可在其他线程读取）
+
+    // 异步录制相关
+    bool m_asyncEnabled;                        // 是否启用异步模式
+    OverflowPolicy m_overflowPolicy;            // 队列满时的处理策略
+    std::unique_ptr<FrameQueue> m_frameQueue;   // 采集线程 -> 封装线程的帧队列
+    std::thread m_muxThread;                    // 封装线程
+    std::atomic<bool> m_muxRunning;             // 封装线程运行状态
+    std::mutex m_asyncMutex;                    // 仅用于线程休眠/唤醒
+    std::condition_variable m_dataCond;         // 队列有新数据
+    std::condition_variable m_spaceCond;        // 队列有空闲槽位
+    bool m_dropUntilIDR;                        // 丢帧直到下一个IDR（生产者线程使用）
+    int m_producerCodec;                        // 生产者线程已确定的编码类型（0 H264，1 H265，-1 尚未确定）
+    std::atomic<size_t> m_maxQueueDepth;
+    std::atomic<uint64_t> m_framesQueued;
+    std::atomic<uint64_t> m_framesDropped;
+    std::atomic<uint64_t> m_lastLatencyUs;
+    std::atomic<uint64_t> m_maxLatencyUs;
+    std::atomic<uint64_t> m_latencySumUs;
+    std::atomic<uint64_t> m_latencyCount;
 };
 
 #endif // H264MP4_WRITER_H
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "HttpParser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+// 请求头数量上限
+const size_t MAX_HEADERS = 100;
+
+// token字符（方法名和请求头名称）
+bool isTokenChar(unsigned char c)
+{
+    return std::isalnum(c) || strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+bool isToken(const char* text, size_t length)
+{
+    if (length == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isTokenChar(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string toLower(const char* text, size_t length)
+{
+    std::string result(text, length);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+// 逗号分隔的列表（如Connection）中是否有指定的值（不区分大小写）
+bool hasToken(const std::string& list, const char* token)
+{
+    size_t tokenLength = strlen(token);
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        size_t begin = pos;
+        while (begin < end && (list[begin] == ' ' || list[begin] == '\t')) {
+            begin++;
+        }
+        size_t last = end;
+        while (last > begin && (list[last - 1] == ' ' || list[last - 1] == '\t')) {
+            last--;
+        }
+        if (last - begin == tokenLength &&
+            std::equal(token, token + tokenLength, list.begin() + begin,
+                       [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); })) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+}
+
+std::string HttpRequest::header(const std::string& name) const
+{
+    auto it = headers.find(toLower(name.data(), name.size()));
+    return it != headers.end() ? it->second : std::string();
+}
+
+HttpParser::HttpParser(size_t maxRequestSize)
+    : m_maxRequestSize(maxRequestSize)
+{
+    reset();
+}
+
+void HttpParser::reset()
+{
+    m_phase = PHASE_REQUEST_LINE;
+    m_status = INCOMPLETE;
+    m_lineStart = 0;
+    m_scanned = 0;
+    m_headerCount = 0;
+    m_contentLength = 0;
+    m_consumed = 0;
+    m_request = HttpRequest();
+}
+
+HttpParser::Status HttpParser::parse(const char* data, size_t size)
+{
+    if (m_status != INCOMPLETE) {
+        return m_status;
+    }
+
+    // 请求行和请求头：逐行切分，只查找上次之后新到的数据
+    while (m_phase == PHASE_REQUEST_LINE || m_phase == PHASE_HEADERS) {
+        const char* newline = static_cast<const char*>(memchr(data + m_scanned, '\n', size - m_scanned));
+        if (!newline) {
+            m_scanned = size;
+            if (m_scanned > m_maxRequestSize) {
+                return m_status = HEADERS_TOO_LARGE;
+            }
+            return INCOMPLETE;
+        }
+
+        size_t end = static_cast<size_t>(newline - data);
+        m_scanned = end + 1;
+        if (m_scanned > m_maxRequestSize) {
+            return m_status = HEADERS_TOO_LARGE;
+        }
+
+        // 行尾为CRLF，也接受单独的LF
+        const char* line = data + m_lineStart;
+        size_t length = end - m_lineStart;
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+        m_lineStart = m_scanned;
+
+        if (m_phase == PHASE_REQUEST_LINE) {
+            // 忽略请求行之前的空行（上一个请求正文后多发的CRLF）
+            if (length == 0) {
+                continue;
+            }
+            if (!parseRequestLine(line, length)) {
+                return m_status = BAD_REQUEST;
+            }
+            m_phase = PHASE_HEADERS;
+            continue;
+        }
+
+        if (length == 0) {
+            Status status = finishHeaders();
+            if (status != INCOMPLETE) {
+                return m_status = status;
+            }
+            m_phase = PHASE_BODY;
+            break;
+        }
+        Status status = parseHeaderLine(line, length);
+        if (status != INCOMPLETE) {
+            return m_status = status;
+        }
+    }
+
+    // 正文：m_lineStart为正文起始位置
+    if (size - m_lineStart < m_contentLength) {
+        return INCOMPLETE;
+    }
+    m_request.body.assign(data + m_lineStart, static_cast<size_t>(m_contentLength));
+    m_consumed = m_lineStart + static_cast<size_t>(m_contentLength);
+    m_phase = PHASE_DONE;
+    return m_status = COMPLETE;
+}
+
+bool HttpParser::parseRequestLine(const char* line, size_t length)
+{
+    // 方法 SP 请求目标 SP 版本
+    const char* end = line + length;
+    const char* space1 = static_cast<const char*>(memchr(line, ' ', length));
+    if (!space1) {
+        return false;
+    }
+    const char* target = space1 + 1;
+    const char* space2 = static_cast<const char*>(memchr(target, ' ', static_cast<size_t>(end - target)));
+    if (!space2) {
+        return false;
+    }
+    const char* version = space2 + 1;
+
+    if (!isToken(line, static_cast<size_t>(space1 - line)) || space2 == target) {
+        return false;
+    }
+    for (const char* p = target; p < space2; p++) {
+        if (static_cast<unsigned char>(*p) <= ' ' || *p == 0x7f) {
+            return false;
+        }
+    }
+    size_t versionLength = static_cast<size_t>(end - version);
+    if (versionLength != 8 || (memcmp(version, "HTTP/1.1", 8) != 0 && memcmp(version, "HTTP/1.0", 8) != 0)) {
+        return false;
+    }
+
+    m_request.method.assign(line, space1);
+    m_request.path.assign(target, space2);
+    m_request.version.assign(version, end);
+    return true;
+}
+
+HttpParser::Status HttpParser::parseHeaderLine(const char* line, size_t length)
+{
+    // 不支持折行（以空白开头的续行），名称和冒号之间不能有空白
+    const char* colon = static_cast<const char*>(memchr(line, ':', length));
+    if (!colon || !isToken(line, static_cast<size_t>(colon - line))) {
+        return BAD_REQUEST;
+    }
+    if (++m_headerCount > MAX_HEADERS) {
+        return HEADERS_TOO_LARGE;
+    }
+
+    const char* value = colon + 1;
+    const char* end = line + length;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+
+    std::string name = toLower(line, static_cast<size_t>(colon - line));
+    auto it = m_request.headers.find(name);
+    if (it == m_request.headers.end()) {
+        m_request.headers[name].assign(value, end);
+    } else if (name == "content-length") {
+        // 重复的Content-Length必须一致，否则无法确定请求边界
+        if (it->second.compare(0, std::string::npos, value, static_cast<size_t>(end - value)) != 0) {
+            return BAD_REQUEST;
+        }
+    } else {
+        it->second.append(", ");
+        it->second.append(value, end);
+    }
+    return INCOMPLETE;
+}
+
+HttpParser::Status HttpParser::finishHeaders()
+{
+    // 不接受chunked请求正文：无法确定边界时不能继续解析后面的流水线请求
+    if (m_request.headers.count("transfer-encoding")) {
+        return BAD_REQUEST;
+    }
+
+    auto it = m_request.headers.find("content-length");
+    if (it != m_request.headers.end()) {
+        const std::string& text = it->second;
+        if (text.empty() || text.size() > 18 || text.find_first_not_of("0123456789") != std::string::npos) {
+            return BAD_REQUEST;
+        }
+        m_contentLength = std::stoull(text);
+        if (m_contentLength > m_maxRequestSize - m_scanned) {
+            return BODY_TOO_LARGE;
+        }
+    }
+
+    std::string connection = m_request.header("connection");
+    if (m_request.version == "HTTP/1.1") {
+        m_request.keepAlive = !hasToken(connection, "close");
+    } else {
+        m_request.keepAlive = hasToken(connection, "keep-alive");
+    }
+    return INCOMPLETE;
+}
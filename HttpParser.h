@@ -0,0 +1,98 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// HTTP请求（请求头名称已转为小写，重复的请求头以", "合并）
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string version;
+    std::map<std::string, std::string> headers;
+    std::string body;               // Content-Length指定的正文
+    bool keepAlive;                 // 客户端允许保持连接（HTTP/1.1默认，HTTP/1.0需Connection: keep-alive）
+
+    HttpRequest() : keepAlive(false) {}
+
+    // 请求头的值，不存在时返回空字符串
+    std::string header(const std::string& name) const;
+};
+
+/**
+ * HttpParser - 增量式HTTP/1.1请求解析器
+ *
+ * 每次收到数据后对连接的接收缓冲区调用parse()，解析器只记录偏移量，
+ * 从上次停下的位置继续，每个字节只检查一次；请求行和请求头在缓冲区中
+ * 原地切分，只把最终的字段复制到HttpRequest中。请求头可以分多次到达
+ * （包括CRLF被拆开），解析完成后consumed()给出该请求的长度，缓冲区中
+ * 剩余的数据属于下一个（流水线）请求。
+ */
+class HttpParser {
+public:
+    enum Status {
+        INCOMPLETE,                 // 请求未收完
+        COMPLETE,                   // 请求已完整，可通过request()取得
+        BAD_REQUEST,                // 格式错误（400）
+        HEADERS_TOO_LARGE,          // 请求头超过长度或数量上限（431）
+        BODY_TOO_LARGE              // 正文超过长度上限（413）
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param maxRequestSize 请求行、请求头和正文的总长度上限
+     */
+    explicit HttpParser(size_t maxRequestSize = 16 * 1024);
+
+    /**
+     * 解析缓冲区开头的请求
+     *
+     * 两次调用之间缓冲区只能在末尾追加数据（可以重新分配），
+     * 返回COMPLETE或错误后需要reset()才能解析下一个请求。
+     *
+     * @param data 从当前请求开头起的全部已收数据
+     * @param size 数据长度
+     * @return 解析状态
+     */
+    Status parse(const char* data, size_t size);
+
+    // 开始解析下一个请求
+    void reset();
+
+    // 已解析完成的请求
+    HttpRequest& request() { return m_request; }
+
+    // 已完成请求的长度（请求头和正文），之后的数据属于下一个请求
+    size_t consumed() const { return m_consumed; }
+
+private:
+    enum Phase {
+        PHASE_REQUEST_LINE,
+        PHASE_HEADERS,
+        PHASE_BODY,
+        PHASE_DONE
+    };
+
+    // 解析一行（不含行尾），返回false表示格式错误
+    bool parseRequestLine(const char* line, size_t length);
+    Status parseHeaderLine(const char* line, size_t length);
+
+    // 请求头收完后检查Content-Length/Transfer-Encoding/Connection
+    Status finishHeaders();
+
+private:
+    size_t m_maxRequestSize;
+    Phase m_phase;
+    Status m_status;                // 已得出结果后重复调用直接返回
+    size_t m_lineStart;             // 当前行的起始偏移
+    size_t m_scanned;               // 已检查过的偏移（从这里继续查找行尾）
+    size_t m_headerCount;
+    uint64_t m_contentLength;
+    size_t m_consumed;
+    HttpRequest m_request;
+};
+
+#endif // HTTP_PARSER_H
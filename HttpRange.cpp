@@ -0,0 +1,133 @@
+#include "HttpRange.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+// 间隔小于多部分响应中一个部分的头部时，合并为一个范围比分开发送更省
+const uint64_t MERGE_GAP = 80;
+
+// 解析的范围数上限（合并前），防止超长的请求头占用排序时间
+const size_t MAX_SPECS = 256;
+
+// 十进制非负整数，溢出时返回false
+bool parseNumber(const std::string& text, size_t begin, size_t end, uint64_t& value)
+{
+    if (begin >= end) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = begin; i < end; i++) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+        uint64_t digit = static_cast<uint64_t>(text[i] - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+}
+
+HttpRange::Result HttpRange::parse(const std::string& header, uint64_t size, std::vector<Span>& spans)
+{
+    spans.clear();
+
+    // 单位不区分大小写，只支持bytes
+    const char* unit = "bytes=";
+    if (header.size() < 6 ||
+        !std::equal(unit, unit + 6, header.begin(),
+                    [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); })) {
+        return IGNORED;
+    }
+
+    // 逗号分隔的范围列表，允许空白和空元素，至少有一个范围
+    size_t specs = 0;
+    size_t pos = 6;
+    while (pos <= header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+        size_t begin = pos;
+        pos = end + 1;
+        while (begin < end && (header[begin] == ' ' || header[begin] == '\t')) {
+            begin++;
+        }
+        while (end > begin && (header[end - 1] == ' ' || header[end - 1] == '\t')) {
+            end--;
+        }
+        if (begin == end) {
+            continue;
+        }
+        if (++specs > MAX_SPECS) {
+            spans.clear();
+            return IGNORED;
+        }
+
+        size_t dash = header.find('-', begin);
+        if (dash == std::string::npos || dash >= end) {
+            spans.clear();
+            return IGNORED;
+        }
+
+        Span span;
+        if (dash == begin) {
+            // 后缀范围：最后N个字节，N为0时不可满足
+            uint64_t suffix;
+            if (!parseNumber(header, dash + 1, end, suffix)) {
+                spans.clear();
+                return IGNORED;
+            }
+            if (suffix == 0 || size == 0) {
+                continue;
+            }
+            span.length = std::min(suffix, size);
+            span.first = size - span.length;
+        } else {
+            uint64_t first;
+            uint64_t last = UINT64_MAX;
+            if (!parseNumber(header, begin, dash, first) ||
+                (dash + 1 < end && !parseNumber(header, dash + 1, end, last)) || last < first) {
+                spans.clear();
+                return IGNORED;
+            }
+            // 起始位置在文件之外时不可满足，结尾超出时截断
+            if (first >= size) {
+                continue;
+            }
+            span.first = first;
+            span.length = std::min(last, size - 1) - first + 1;
+        }
+        spans.push_back(span);
+    }
+
+    if (specs == 0) {
+        return IGNORED;
+    }
+    if (spans.empty()) {
+        return UNSATISFIABLE;
+    }
+
+    // 排序后合并重叠或相邻的范围
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.first < b.first; });
+    size_t count = 0;
+    for (size_t i = 1; i < spans.size(); i++) {
+        Span& merged = spans[count];
+        uint64_t mergedEnd = merged.first + merged.length;
+        if (spans[i].first <= mergedEnd + MERGE_GAP) {
+            merged.length = std::max(mergedEnd, spans[i].first + spans[i].length) - merged.first;
+        } else {
+            spans[++count] = spans[i];
+        }
+    }
+    spans.resize(count + 1);
+
+    if (spans.size() > MAX_SPANS) {
+        spans.clear();
+        return IGNORED;
+    }
+    return SATISFIABLE;
+}
@@ -0,0 +1,45 @@
+#ifndef HTTP_RANGE_H
+#define HTTP_RANGE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * HttpRange - Range请求头（bytes单位）的解析
+ *
+ * 按文件长度把Range请求头解析为若干字节范围：后缀范围（-500）和开放范围
+ * （9500-）换算为实际位置，超出文件的结尾截断到文件末尾，重叠或间隔很小
+ * 的范围按起始位置排序后合并（每个部分都带Content-Range，客户端按它定位）。
+ * 语法错误、不是bytes单位或范围过多时忽略请求头，发送整个文件。
+ */
+class HttpRange {
+public:
+    // 一个字节范围
+    struct Span {
+        uint64_t first;             // 起始位置
+        uint64_t length;            // 长度（大于0）
+    };
+
+    enum Result {
+        IGNORED,                    // 没有或忽略Range请求头，发送整个文件（200）
+        SATISFIABLE,                // 发送spans中的范围（206）
+        UNSATISFIABLE               // 所有范围都在文件之外（416）
+    };
+
+    // 合并后最多的范围数，更多时忽略请求头
+    static const size_t MAX_SPANS = 16;
+
+    /**
+     * 解析Range请求头
+     *
+     * @param header Range请求头的值（空表示没有）
+     * @param size 文件长度
+     * @param spans 返回SATISFIABLE时输出按起始位置排序、互不重叠的范围
+     * @return 解析结果
+     */
+    static Result parse(const std::string& header, uint64_t size, std::vector<Span>& spans);
+};
+
+#endif // HTTP_RANGE_H
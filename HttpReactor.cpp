@@ -0,0 +1,925 @@
+#include "HttpReactor.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// 每次epoll_wait最多处理的事件数
+const int MAX_EVENTS = 256;
+
+// 检查接收请求头超时的间隔（毫秒）
+const int SWEEP_INTERVAL_MS = 1000;
+
+// 一次sendmsg最多合并的内存数据块数
+const int MAX_IOVECS = 64;
+
+// 一次sendfile最多发送的字节数（Linux的上限）
+const uint64_t MAX_SENDFILE_SIZE = 0x7ffff000;
+
+// 延迟关闭时等待客户端关闭的最长时间（毫秒）
+const int LINGER_TIMEOUT_MS = 2000;
+
+const char* RESPONSE_400 = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const char* RESPONSE_413 = "HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const char* RESPONSE_431 = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+}
+
+// I/O线程：epoll实例、跨线程任务队列和定时器
+struct HttpExchange::Loop {
+    HttpReactor* reactor;
+    int epollFd;
+    int wakeFd;                                 // eventfd，投递任务时唤醒epoll_wait
+    int spareFd;                                // 文件描述符用完时腾出一个，接受并关闭新连接
+    std::thread thread;
+
+    // 以下由mutex保护
+    std::mutex mutex;
+    std::vector<std::function<void()>> tasks;
+    std::thread::id threadId;
+    bool alive;                                 // 线程退出后不再接受任务
+    bool wakePending;                           // 已写eventfd，线程尚未取走任务
+
+    // 以下只在I/O线程中访问
+    std::map<int, std::shared_ptr<Connection>> connections;
+    std::vector<std::shared_ptr<Connection>> dirty;     // 本轮任务中追加了数据、待发送的连接
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> timers;
+    std::chrono::steady_clock::time_point nextSweep;
+
+    Loop() : reactor(nullptr), epollFd(-1), wakeFd(-1), spareFd(-1), alive(true), wakePending(false) {}
+};
+
+// 连接状态（只在所属I/O线程中访问）
+struct HttpExchange::Connection {
+    enum State {
+        READING_REQUEST,                        // 接收请求（可能仍在发送上一个响应）
+        PROCESSING,                             // 请求已交给处理函数，发送响应
+        LINGERING,                              // 响应已发完并关闭发送方向，丢弃客户端后续数据直到对方关闭
+        CLOSED
+    };
+
+    // 发送队列中的一项：内存数据，共享缓冲区中的一段（buffer非空），或文件中的一段（file非空）
+    struct Output {
+        std::string data;
+        std::shared_ptr<const std::string> buffer;
+        std::shared_ptr<HttpFile> file;
+        uint64_t offset;                        // 共享缓冲区或文件中下一个要发送的位置
+        uint64_t length;                        // 共享缓冲区或文件中剩余要发送的长度
+
+        Output() : offset(0), length(0) {}
+        explicit Output(std::string text) : data(std::move(text)), offset(0), length(0) {}
+
+        // 内存数据（data或buffer中的一段）
+        const char* bytes() const { return buffer ? buffer->data() + offset : data.data(); }
+        size_t size() const { return buffer ? static_cast<size_t>(length) : data.size(); }
+    };
+
+    int fd;
+    State state;
+    uint32_t events;                            // 当前在epoll中关注的事件
+    std::string input;                          // 已收到、尚未处理的请求数据（可能包含多个流水线请求）
+    HttpParser parser;
+    std::deque<Output> output;                  // 待发送数据
+    size_t outputOffset;                        // output.front()为内存数据时已发送的字节数
+    bool closing;                               // 不再处理新请求，发送完后关闭
+    bool linger;                                // 客户端可能还在发送（服务器主动关闭或请求出错），关闭前先延迟
+    bool peerClosed;                            // 客户端已关闭发送方向
+    bool flushPending;                          // 已在Loop::dirty中
+    uint64_t exchangeId;                        // 当前请求的序号
+    size_t requests;                            // 已处理的请求数
+    std::vector<std::function<void()>> drainCallbacks;
+    std::weak_ptr<HttpExchange> exchange;
+    std::chrono::steady_clock::time_point since;    // 开始等待请求的时间
+
+    Connection(int socket, size_t maxRequestSize)
+        : fd(socket), state(READING_REQUEST), events(0), parser(maxRequestSize), outputOffset(0), closing(false),
+          linger(false), peerClosed(false), flushPending(false), exchangeId(0), requests(0), since(std::chrono::steady_clock::now()) {}
+
+    // 是否仍在处理序号为id的请求（响应结束后旧请求的数据和回调都被丢弃）
+    bool accepts(uint64_t id) const { return state == PROCESSING && !closing && exchangeId == id; }
+
+    // 更新在epoll中关注的事件：读取请求时关注可读，writable表示等待可写
+    void watch(int epollFd, bool writable);
+};
+
+HttpExchange::HttpExchange(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection, uint64_t id, bool keepAlive,
+                           bool chunkedAllowed)
+    : m_loop(loop)
+    , m_connection(connection)
+    , m_id(id)
+    , m_keepAlive(keepAlive)
+    , m_chunkedAllowed(chunkedAllowed)
+    , m_closed(false)
+{
+}
+
+HttpExchange::~HttpExchange()
+{
+    // 处理函数不再持有时响应必然已完整
+    finish();
+}
+
+#ifdef __linux__
+
+void HttpExchange::send(std::string data)
+{
+    if (m_closed || data.empty()) {
+        return;
+    }
+    std::shared_ptr<Loop> loop = m_loop;
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    HttpReactor::post(loop, std::bind([loop, connection, id](std::string& payload) {
+        if (!connection->accepts(id)) {
+            return;
+        }
+        connection->output.push_back(Connection::Output(std::move(payload)));
+        HttpReactor::schedule(loop, connection);
+    }, std::move(data)));
+}
+
+void HttpExchange::send(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t length)
+{
+    if (m_closed || !buffer || length == 0) {
+        return;
+    }
+    std::shared_ptr<Loop> loop = m_loop;
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    HttpReactor::post(loop, [loop, connection, id, buffer, offset, length]() {
+        if (!connection->accepts(id)) {
+            return;
+        }
+        Connection::Output item;
+        item.buffer = buffer;
+        item.offset = offset;
+        item.length = length;
+        connection->output.push_back(std::move(item));
+        HttpReactor::schedule(loop, connection);
+    });
+}
+
+void HttpExchange::sendFile(const std::shared_ptr<HttpFile>& file, uint64_t offset, uint64_t length)
+{
+    if (m_closed || !file || length == 0) {
+        return;
+    }
+    std::shared_ptr<Loop> loop = m_loop;
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    HttpReactor::post(loop, [loop, connection, id, file, offset, length]() {
+        if (!connection->accepts(id)) {
+            return;
+        }
+        Connection::Output item;
+        item.file = file;
+        item.offset = offset;
+        item.length = length;
+        connection->output.push_back(std::move(item));
+        HttpReactor::schedule(loop, connection);
+    });
+}
+
+void HttpExchange::finish()
+{
+    if (m_closed) {
+        return;
+    }
+    std::shared_ptr<Loop> loop = m_loop;
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    bool keepAlive = m_keepAlive;
+    HttpReactor::post(loop, [loop, connection, id, keepAlive]() {
+        if (!connection->accepts(id)) {
+            return;
+        }
+        if (!keepAlive) {
+            connection->closing = true;
+            HttpReactor::schedule(loop, connection);
+            return;
+        }
+
+        // 保持连接：发送本次响应，同时处理已收到的流水线请求或等待下一个请求
+        connection->state = Connection::READING_REQUEST;
+        connection->since = std::chrono::steady_clock::now();
+        connection->drainCallbacks.clear();
+        connection->exchange.reset();
+        HttpReactor::schedule(loop, connection);
+        loop->reactor->processRequest(loop, connection);
+    });
+}
+
+void HttpExchange::abort()
+{
+    if (m_closed) {
+        return;
+    }
+    std::shared_ptr<Loop> loop = m_loop;
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    HttpReactor::post(loop, [loop, connection, id]() {
+        if (connection->state == Connection::PROCESSING && connection->exchangeId == id) {
+            loop->reactor->closeConnection(loop, connection);
+        }
+    });
+}
+
+void HttpExchange::whenDrained(std::function<void()> callback)
+{
+    if (m_closed) {
+        return;
+    }
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    HttpReactor::post(m_loop, std::bind([connection, id](std::function<void()>& callback) {
+        if (!connection->accepts(id)) {
+            return;
+        }
+        if (connection->output.empty()) {
+            callback();
+        } else {
+            connection->drainCallbacks.push_back(std::move(callback));
+        }
+    }, std::move(callback)));
+}
+
+void HttpExchange::after(int delayMs, std::function<void()> callback)
+{
+    if (m_closed) {
+        return;
+    }
+    std::shared_ptr<Loop> loop = m_loop;
+    std::shared_ptr<Connection> connection = m_connection;
+    uint64_t id = m_id;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+    HttpReactor::post(loop, std::bind([loop, connection, id, deadline](std::function<void()>& callback) {
+        if (!connection->accepts(id)) {
+            return;
+        }
+        loop->timers.insert(std::make_pair(deadline, std::bind([connection, id](std::function<void()>& callback) {
+            if (connection->accepts(id)) {
+                callback();
+            }
+        }, std::move(callback))));
+    }, std::move(callback)));
+}
+
+HttpFile::~HttpFile()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+HttpReactor::HttpReactor()
+    : m_listenSocket(-1)
+    , m_running(false)
+    , m_accepted(0)
+    , m_rejected(0)
+    , m_requests(0)
+    , m_badRequests(0)
+    , m_connections(0)
+{
+}
+
+HttpReactor::~HttpReactor()
+{
+    stop();
+}
+
+bool HttpReactor::start(int listenSocket, const Handler& handler, const Config& config)
+{
+    if (m_running) {
+        std::cerr << "HttpReactor已经在运行" << std::endl;
+        return false;
+    }
+
+    // 监听套接字设为非阻塞：多个线程被唤醒时没抢到连接的直接返回
+    int flags = fcntl(listenSocket, F_GETFL, 0);
+    if (flags < 0 || fcntl(listenSocket, F_SETFL, flags | O_NONBLOCK) < 0) {
+        std::cerr << "设置监听套接字为非阻塞失败: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_listenSocket = listenSocket;
+    m_handler = handler;
+    m_config = config;
+    if (m_config.ioThreads == 0) {
+        m_config.ioThreads = 1;
+    }
+
+    for (size_t i = 0; i < m_config.ioThreads; i++) {
+        std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+        loop->reactor = this;
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        loop->spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        m_loops.push_back(loop);
+        if (loop->epollFd < 0 || loop->wakeFd < 0) {
+            std::cerr << "创建epoll实例失败: " << strerror(errno) << std::endl;
+            stop();
+            return false;
+        }
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = loop->wakeFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &event);
+
+        // 每个新连接只唤醒一个线程，由它接受并负责该连接
+        event.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+        event.events |= EPOLLEXCLUSIVE;
+#endif
+        event.data.fd = listenSocket;
+        if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, listenSocket, &event) < 0) {
+            std::cerr << "监听套接字加入epoll失败: " << strerror(errno) << std::endl;
+            stop();
+            return false;
+        }
+    }
+
+    m_running = true;
+    for (auto& loop : m_loops) {
+        loop->thread = std::thread(&HttpReactor::loopThread, this, loop);
+    }
+
+    return true;
+}
+
+void HttpReactor::stop()
+{
+    m_running = false;
+
+    // 唤醒各线程，由它们关闭自己的连接后退出
+    for (auto& loop : m_loops) {
+        if (loop->wakeFd >= 0) {
+            uint64_t one = 1;
+            ssize_t written = write(loop->wakeFd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+    for (auto& loop : m_loops) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+        if (loop->epollFd >= 0) {
+            close(loop->epollFd);
+            loop->epollFd = -1;
+        }
+        if (loop->wakeFd >= 0) {
+            close(loop->wakeFd);
+            loop->wakeFd = -1;
+        }
+        if (loop->spareFd >= 0) {
+            close(loop->spareFd);
+            loop->spareFd = -1;
+        }
+    }
+    m_loops.clear();
+}
+
+HttpReactor::Stats HttpReactor::stats() const
+{
+    Stats stats;
+    stats.accepted = m_accepted;
+    stats.rejected = m_rejected;
+    stats.requests = m_requests;
+    stats.badRequests = m_badRequests;
+    stats.connections = m_connections;
+    return stats;
+}
+
+void HttpReactor::post(const std::shared_ptr<Loop>& loop, std::function<void()> task)
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        if (!loop->alive) {
+            return;
+        }
+        loop->tasks.push_back(std::move(task));
+        // I/O线程自己投递的任务在本轮循环末尾执行，不需要唤醒
+        if (!loop->wakePending && loop->threadId != std::this_thread::get_id()) {
+            loop->wakePending = true;
+            wake = true;
+        }
+    }
+    if (wake) {
+        uint64_t one = 1;
+        ssize_t written = write(loop->wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void HttpReactor::loopThread(const std::shared_ptr<Loop>& loop)
+{
+    {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        loop->threadId = std::this_thread::get_id();
+    }
+    loop->nextSweep = std::chrono::steady_clock::now() + std::chrono::milliseconds(SWEEP_INTERVAL_MS);
+
+    // sendfile没有MSG_NOSIGNAL，对端关闭时在本线程屏蔽SIGPIPE，按EPIPE处理
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    struct epoll_event events[MAX_EVENTS];
+    std::vector<std::function<void()>> tasks;
+    while (m_running) {
+        // 有待执行的任务时不等待，否则等到最近的定时器
+        auto now = std::chrono::steady_clock::now();
+        auto wakeAt = loop->nextSweep;
+        if (!loop->timers.empty() && loop->timers.begin()->first < wakeAt) {
+            wakeAt = loop->timers.begin()->first;
+        }
+        int timeout = static_cast<int>(std::max<int64_t>(0,
+            std::chrono::duration_cast<std::chrono::milliseconds>(wakeAt - now).count() + 1));
+        {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            if (!loop->tasks.empty()) {
+                timeout = 0;
+            }
+        }
+
+        int count = epoll_wait(loop->epollFd, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "epoll_wait失败: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == loop->wakeFd) {
+                uint64_t value;
+                ssize_t bytes = read(loop->wakeFd, &value, sizeof(value));
+                (void)bytes;
+                continue;
+            }
+            if (fd == m_listenSocket) {
+                acceptConnections(loop);
+                continue;
+            }
+
+            auto it = loop->connections.find(fd);
+            if (it == loop->connections.end()) {
+                continue;
+            }
+            std::shared_ptr<Connection> connection = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(loop, connection);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && connection->state == Connection::READING_REQUEST) {
+                readRequest(loop, connection);
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && connection->state == Connection::LINGERING) {
+                drainLingering(loop, connection);
+            }
+            // 持久连接在等待下一个请求时也可能还在发送上一个响应
+            if ((events[i].events & EPOLLOUT) &&
+                (connection->state == Connection::READING_REQUEST || connection->state == Connection::PROCESSING)) {
+                flush(loop, connection);
+            }
+        }
+
+        // 到期的定时器
+        now = std::chrono::steady_clock::now();
+        while (!loop->timers.empty() && loop->timers.begin()->first <= now) {
+            std::function<void()> timer = std::move(loop->timers.begin()->second);
+            loop->timers.erase(loop->timers.begin());
+            timer();
+        }
+
+        // 其他线程投递的任务（执行中新投递的留到下一轮）
+        {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            tasks.swap(loop->tasks);
+            loop->wakePending = false;
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+        tasks.clear();
+
+        // 本轮追加的数据一起发送：响应头和正文合并写出
+        std::vector<std::shared_ptr<Connection>> dirty;
+        dirty.swap(loop->dirty);
+        for (auto& connection : dirty) {
+            connection->flushPending = false;
+            if (connection->state != Connection::CLOSED) {
+                flush(loop, connection);
+            }
+        }
+
+        if (now >= loop->nextSweep) {
+            sweepIdle(loop);
+            loop->nextSweep = now + std::chrono::milliseconds(SWEEP_INTERVAL_MS);
+        }
+    }
+
+    // 关闭本线程的连接，之后投递的任务直接丢弃
+    std::vector<std::shared_ptr<Connection>> connections;
+    for (auto& entry : loop->connections) {
+        connections.push_back(entry.second);
+    }
+    for (auto& connection : connections) {
+        closeConnection(loop, connection);
+    }
+    {
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        loop->alive = false;
+        tasks.swap(loop->tasks);
+    }
+    // 任务和定时器中持有的HttpExchange析构时会再投递，必须在锁外释放
+    tasks.clear();
+    loop->timers.clear();
+}
+
+void HttpReactor::acceptConnections(const std::shared_ptr<Loop>& loop)
+{
+    while (m_running) {
+        int fd = accept4(m_listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && loop->spareFd >= 0) {
+                // 文件描述符用完：腾出备用描述符接受并关闭连接，避免监听套接字一直可读
+                close(loop->spareFd);
+                fd = accept(m_listenSocket, nullptr, nullptr);
+                if (fd >= 0) {
+                    close(fd);
+                }
+                loop->spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                m_rejected++;
+                std::cerr << "文件描述符不足，拒绝新连接" << std::endl;
+                continue;
+            }
+            // EAGAIN：其他线程已取走或队列已空
+            break;
+        }
+
+        if (m_connections >= m_config.maxConnections) {
+            close(fd);
+            m_rejected++;
+            continue;
+        }
+
+        // 响应通常一次写出，关闭Nagle算法减少小响应的延迟
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        std::shared_ptr<Connection> connection = std::make_shared<Connection>(fd, m_config.maxRequestSize);
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+        connection->events = event.events;
+        loop->connections[fd] = connection;
+        m_connections++;
+        m_accepted++;
+    }
+}
+
+void HttpReactor::readRequest(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection)
+{
+    // 缓冲区超过请求长度上限时不再读取，由解析器判断请求是否过大
+    char buffer[4096];
+    while (connection->input.size() <= m_config.maxRequestSize) {
+        ssize_t bytes = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (bytes > 0) {
+            connection->input.append(buffer, static_cast<size_t>(bytes));
+            continue;
+        }
+        if (bytes == 0) {
+            connection->peerClosed = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        closeConnection(loop, connection);
+        return;
+    }
+
+    processRequest(loop, connection);
+}
+
+void HttpReactor::processRequest(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection)
+{
+    if (connection->state != Connection::READING_REQUEST) {
+        return;
+    }
+
+    HttpParser::Status status = connection->parser.parse(connection->input.data(), connection->input.size());
+    if (status == HttpParser::INCOMPLETE) {
+        if (connection->peerClosed) {
+            // 客户端不会再发送请求：发送完已有的响应后关闭
+            connection->state = Connection::PROCESSING;
+            connection->closing = true;
+            flush(loop, connection);
+            return;
+        }
+        connection->watch(loop->epollFd, (connection->events & EPOLLOUT) != 0);
+        return;
+    }
+
+    // 请求已完整（或无法处理），处理期间不再读取，流水线中后面的请求留在缓冲区
+    connection->state = Connection::PROCESSING;
+    connection->watch(loop->epollFd, (connection->events & EPOLLOUT) != 0);
+    if (status != HttpParser::COMPLETE) {
+        m_badRequests++;
+        connection->closing = true;
+        connection->linger = true;
+        const char* response = status == HttpParser::HEADERS_TOO_LARGE ? RESPONSE_431 :
+                               status == HttpParser::BODY_TOO_LARGE ? RESPONSE_413 : RESPONSE_400;
+        connection->output.push_back(Connection::Output(response));
+        flush(loop, connection);
+        return;
+    }
+
+    HttpRequest request = std::move(connection->parser.request());
+    connection->input.erase(0, connection->parser.consumed());
+    connection->parser.reset();
+    connection->requests++;
+    m_requests++;
+
+    // 服务器停止或达到请求数上限时本次响应后关闭
+    bool keepAlive = request.keepAlive && m_running && connection->requests < m_config.maxKeepAliveRequests;
+    connection->linger = request.keepAlive && !keepAlive;
+    std::shared_ptr<HttpExchange> exchange(new HttpExchange(loop, connection, ++connection->exchangeId, keepAlive,
+                                                            request.version == "HTTP/1.1"));
+    connection->exchange = exchange;
+    m_handler(request, exchange);
+}
+
+void HttpReactor::schedule(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection)
+{
+    if (!connection->flushPending) {
+        connection->flushPending = true;
+        loop->dirty.push_back(connection);
+    }
+}
+
+void HttpReactor::flush(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection)
+{
+    while (!connection->output.empty()) {
+        Connection::Output& front = connection->output.front();
+        ssize_t sent;
+        if (front.file) {
+            // 文件数据：sendfile直接从页缓存发送到套接字
+            off_t offset = static_cast<off_t>(front.offset);
+            sent = sendfile(connection->fd, front.file->fd(), &offset,
+                            static_cast<size_t>(std::min(front.length, MAX_SENDFILE_SIZE)));
+            if (sent > 0) {
+                front.offset += static_cast<uint64_t>(sent);
+                front.length -= static_cast<uint64_t>(sent);
+                if (front.length == 0) {
+                    connection->output.pop_front();
+                }
+                continue;
+            }
+            if (sent == 0) {
+                std::cerr << "发送的文件已被截断，关闭连接" << std::endl;
+                closeConnection(loop, connection);
+                return;
+            }
+        } else {
+            // 相邻的内存数据合并为一次sendmsg；后面紧跟文件数据时带MSG_MORE，
+            // 响应头不单独成包，和正文开头一起发出
+            struct iovec iov[MAX_IOVECS];
+            int count = 0;
+            bool more = false;
+            for (auto it = connection->output.begin(); it != connection->output.end() && count < MAX_IOVECS; ++it) {
+                if (it->file) {
+                    more = true;
+                    break;
+                }
+                size_t skip = count == 0 ? connection->outputOffset : 0;
+                iov[count].iov_base = const_cast<char*>(it->bytes()) + skip;
+                iov[count].iov_len = it->size() - skip;
+                count++;
+            }
+
+            struct msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+            sent = sendmsg(connection->fd, &message, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+            if (sent > 0) {
+                size_t remaining = static_cast<size_t>(sent);
+                while (remaining > 0) {
+                    size_t available = connection->output.front().size() - connection->outputOffset;
+                    if (remaining < available) {
+                        connection->outputOffset += remaining;
+                        break;
+                    }
+                    remaining -= available;
+                    connection->output.pop_front();
+                    connection->outputOffset = 0;
+                }
+                continue;
+            }
+        }
+
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满，等待可写
+            connection->watch(loop->epollFd, true);
+            return;
+        }
+        closeConnection(loop, connection);
+        return;
+    }
+
+    connection->watch(loop->epollFd, false);
+    if (connection->closing) {
+        // 客户端可能还在发送（如流水线中后面的请求）时直接close会发出RST，
+        // 客户端可能因此丢掉尚未读取的响应：先关闭发送方向，等客户端关闭
+        if (!connection->peerClosed && (connection->linger || !connection->input.empty())) {
+            shutdown(connection->fd, SHUT_WR);
+            connection->state = Connection::LINGERING;
+            connection->since = std::chrono::steady_clock::now();
+            connection->input.clear();
+            connection->watch(loop->epollFd, false);
+            drainLingering(loop, connection);
+            return;
+        }
+        closeConnection(loop, connection);
+        return;
+    }
+
+    // 回调中发送的数据经任务队列投递，不会在这里重入
+    std::vector<std::function<void()>> callbacks;
+    callbacks.swap(connection->drainCallbacks);
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
+
+void HttpReactor::drainLingering(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection)
+{
+    char buffer[4096];
+    while (true) {
+        ssize_t bytes = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (bytes > 0) {
+            continue;
+        }
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        // 客户端已关闭或出错
+        closeConnection(loop, connection);
+        return;
+    }
+}
+
+void HttpReactor::closeConnection(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection)
+{
+    if (connection->state == Connection::CLOSED) {
+        return;
+    }
+    // 参数可能引用连接表中的元素，先持有再删除
+    std::shared_ptr<Connection> self = connection;
+
+    epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, self->fd, nullptr);
+    close(self->fd);
+    loop->connections.erase(self->fd);
+    m_connections--;
+
+    self->state = Connection::CLOSED;
+    self->fd = -1;
+    self->input.clear();
+    self->output.clear();
+    self->drainCallbacks.clear();
+
+    std::shared_ptr<HttpExchange> exchange = self->exchange.lock();
+    if (exchange) {
+        exchange->m_closed = true;
+    }
+}
+
+void HttpReactor::sweepIdle(const std::shared_ptr<Loop>& loop)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto requestDeadline = now - std::chrono::milliseconds(m_config.requestTimeoutMs);
+    auto idleDeadline = now - std::chrono::milliseconds(m_config.keepAliveTimeoutMs);
+    auto lingerDeadline = now - std::chrono::milliseconds(LINGER_TIMEOUT_MS);
+    std::vector<std::shared_ptr<Connection>> expired;
+    std::vector<std::shared_ptr<Connection>> lingering;
+    for (auto& entry : loop->connections) {
+        const Connection& connection = *entry.second;
+        if (connection.state == Connection::LINGERING && connection.since < lingerDeadline) {
+            lingering.push_back(entry.second);
+            continue;
+        }
+        if (connection.state != Connection::READING_REQUEST || !connection.output.empty()) {
+            continue;
+        }
+        // 处理过请求、还没收到下一个请求的数据时按持久连接空闲计时
+        bool idle = connection.requests > 0 && connection.input.empty();
+        if (connection.since < (idle ? idleDeadline : requestDeadline)) {
+            expired.push_back(entry.second);
+        }
+    }
+    for (auto& connection : expired) {
+        if (connection->requests == 0 || !connection->input.empty()) {
+            m_badRequests++;
+        }
+        closeConnection(loop, connection);
+    }
+    for (auto& connection : lingering) {
+        closeConnection(loop, connection);
+    }
+}
+
+void HttpExchange::Connection::watch(int epollFd, bool writable)
+{
+    uint32_t wanted = 0;
+    if (state == READING_REQUEST || state == LINGERING) {
+        wanted |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (writable) {
+        wanted |= EPOLLOUT;
+    }
+    if (events == wanted) {
+        return;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = wanted;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+    events = wanted;
+}
+
+#else
+
+// 其他平台没有epoll，DashServer无法启动
+HttpFile::~HttpFile() {}
+
+void HttpExchange::send(std::string) {}
+void HttpExchange::send(const std::shared_ptr<const std::string>&, size_t, size_t) {}
+void HttpExchange::sendFile(const std::shared_ptr<HttpFile>&, uint64_t, uint64_t) {}
+void HttpExchange::finish() {}
+void HttpExchange::abort() {}
+void HttpExchange::whenDrained(std::function<void()>) {}
+void HttpExchange::after(int, std::function<void()>) {}
+
+HttpReactor::HttpReactor()
+    : m_listenSocket(-1), m_running(false), m_accepted(0), m_rejected(0), m_requests(0), m_badRequests(0), m_connections(0)
+{
+}
+
+HttpReactor::~HttpReactor()
+{
+}
+
+bool HttpReactor::start(int, const Handler&, const Config&)
+{
+    std::cerr << "HttpReactor需要epoll（仅支持Linux）" << std::endl;
+    return false;
+}
+
+void HttpReactor::stop()
+{
+}
+
+HttpReactor::Stats HttpReactor::stats() const
+{
+    Stats stats = Stats();
+    return stats;
+}
+
+#endif
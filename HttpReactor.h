@@ -0,0 +1,225 @@
+#ifndef HTTP_REACTOR_H
+#define HTTP_REACTOR_H
+
+#include "HttpParser.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+class HttpReactor;
+
+/**
+ * HttpFile - 以sendfile发送的已打开文件
+ *
+ * 持有文件描述符，最后一个引用释放时关闭。同一个文件可以分多段发送
+ * （如写入中的直播分段每次发送新增的部分）。
+ */
+class HttpFile {
+public:
+    explicit HttpFile(int fd) : m_fd(fd) {}
+    ~HttpFile();
+
+    int fd() const { return m_fd; }
+
+private:
+    HttpFile(const HttpFile&);
+    HttpFile& operator=(const HttpFile&);
+
+    int m_fd;
+};
+
+/**
+ * HttpExchange - 一次请求的响应通道
+ *
+ * 处理函数通过它发送响应数据。所有方法都是线程安全的：可以在I/O线程中
+ * 直接响应，也可以交给文件线程池读完文件后再发送。数据先进入连接的
+ * 发送队列，由所属I/O线程以非阻塞方式写出；回调（whenDrained/after）
+ * 总是在所属I/O线程中执行，连接关闭或响应结束后不再执行。
+ */
+class HttpExchange {
+public:
+    // 处理函数不再持有时结束响应（等同于finish）
+    ~HttpExchange();
+
+    // 追加响应数据（状态行、响应头和正文都通过它发送）
+    void send(std::string data);
+
+    /**
+     * 追加共享的只读数据中的一段（如缓存的分段），发送完之前持有引用，不拷贝
+     *
+     * @param buffer 数据
+     * @param offset 起始位置
+     * @param length 长度
+     */
+    void send(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t length);
+
+    /**
+     * 追加文件中的一段数据，由I/O线程以sendfile直接从页缓存发送
+     *
+     * 发送时文件长度不足（被截断）会关闭连接。
+     *
+     * @param file 文件
+     * @param offset 起始位置
+     * @param length 长度
+     */
+    void sendFile(const std::shared_ptr<HttpFile>& file, uint64_t offset, uint64_t length);
+
+    // 响应已完整：保持连接时接着处理下一个请求，否则发送完后关闭连接
+    void finish();
+
+    // 立即关闭连接（未完成的chunked响应，播放器按请求失败处理）
+    void abort();
+
+    // 发送队列清空后执行回调（流式发送用于背压）
+    void whenDrained(std::function<void()> callback);
+
+    // 延迟执行回调（毫秒）
+    void after(int delayMs, std::function<void()> callback);
+
+    // 连接是否已关闭（客户端断开或服务器停止）
+    bool closed() const { return m_closed; }
+
+    // 响应后是否保持连接（决定响应头中的Connection，不保持时响应必须以连接关闭结尾）
+    bool keepAlive() const { return m_keepAlive; }
+
+    // 客户端是否支持chunked编码（HTTP/1.1）
+    bool chunkedAllowed() const { return m_chunkedAllowed; }
+
+    // 本次响应后关闭连接（正文以连接关闭表示结束时，在发送响应头之前调用）
+    void closeAfterResponse() { m_keepAlive = false; }
+
+private:
+    friend class HttpReactor;
+    struct Loop;
+    struct Connection;
+
+    HttpExchange(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection, uint64_t id, bool keepAlive,
+                 bool chunkedAllowed);
+
+    std::shared_ptr<Loop> m_loop;
+    std::shared_ptr<Connection> m_connection;
+    uint64_t m_id;                  // 连接上的请求序号，响应结束后旧的HttpExchange不再影响连接
+    bool m_keepAlive;
+    bool m_chunkedAllowed;
+    std::atomic<bool> m_closed;
+};
+
+/**
+ * HttpReactor - 基于epoll的HTTP/1.1连接处理
+ *
+ * 固定数量的I/O线程，每个线程一个epoll实例，共同监听同一个套接字
+ * （EPOLLEXCLUSIVE，每个新连接只唤醒一个线程）。连接为非阻塞状态机：
+ * 读取请求 -> 处理中（等待处理函数发送响应）-> 响应结束后回到读取请求
+ * （HTTP/1.1持久连接），客户端要求或达到上限时发送完毕后关闭（客户端可能
+ * 还在发送时先关闭发送方向，等客户端关闭，避免RST冲掉未读的响应）。
+ * 流水线请求按顺序逐个交给处理函数，上一个响应结束前不读取新数据。
+ * I/O线程中不做阻塞操作，读文件等工作由处理函数交给单独的线程池。
+ * 发送队列中相邻的内存数据以一次sendmsg（scatter-gather）写出，
+ * 文件数据以sendfile发送，正文不经过用户态拷贝。
+ *
+ * 仅支持Linux（epoll/eventfd）。
+ */
+class HttpReactor {
+public:
+    // 处理函数：在I/O线程中调用，必须尽快返回
+    typedef std::function<void(const HttpRequest& request, const std::shared_ptr<HttpExchange>& exchange)> Handler;
+
+    struct Config {
+        size_t ioThreads;           // I/O线程数
+        size_t maxConnections;      // 最大连接数，超出时直接关闭新连接
+        size_t maxRequestSize;      // 请求（请求头和正文）最大长度
+        int requestTimeoutMs;       // 接收请求头的超时时间（毫秒）
+        int keepAliveTimeoutMs;     // 持久连接等待下一个请求的超时时间（毫秒）
+        size_t maxKeepAliveRequests;    // 一个连接上最多处理的请求数
+
+        Config()
+            : ioThreads(2), maxConnections(4096), maxRequestSize(16 * 1024), requestTimeoutMs(10000),
+              keepAliveTimeoutMs(15000), maxKeepAliveRequests(1000) {}
+    };
+
+    struct Stats {
+        uint64_t accepted;          // 接受的连接数
+        uint64_t rejected;          // 超出连接数上限被关闭的连接数
+        uint64_t requests;          // 处理的请求数
+        uint64_t badRequests;       // 无法解析或超时的请求数
+        size_t connections;         // 当前连接数
+    };
+
+    HttpReactor();
+    ~HttpReactor();
+
+    /**
+     * 启动I/O线程
+     *
+     * @param listenSocket 已绑定并监听的套接字（停止后由调用方关闭）
+     * @param handler 请求处理函数
+     * @param config 配置
+     * @return 是否启动成功
+     */
+    bool start(int listenSocket, const Handler& handler, const Config& config = Config());
+
+    // 停止I/O线程并关闭所有连接（之后交给HttpExchange的数据和回调都被丢弃）
+    void stop();
+
+    // 统计信息
+    Stats stats() const;
+
+private:
+    typedef HttpExchange::Loop Loop;
+    typedef HttpExchange::Connection Connection;
+    friend class HttpExchange;
+
+    // I/O线程主循环
+    void loopThread(const std::shared_ptr<Loop>& loop);
+
+    // 接受新连接直到队列为空
+    void acceptConnections(const std::shared_ptr<Loop>& loop);
+
+    // 读取请求数据
+    void readRequest(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection);
+
+    // 解析已收到的数据，请求完整时交给处理函数，否则等待更多数据
+    void processRequest(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection);
+
+    // 尽量写出发送队列（内存数据合并为iovec，文件数据用sendfile），写不完时等待可写事件
+    void flush(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection);
+
+    // 延迟关闭：丢弃客户端发来的数据，对方关闭后关闭连接
+    void drainLingering(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection);
+
+    // 关闭连接
+    void closeConnection(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection);
+
+    // 关闭接收请求头超时和持久连接空闲超时的连接
+    void sweepIdle(const std::shared_ptr<Loop>& loop);
+
+    // 向I/O线程投递任务
+    static void post(const std::shared_ptr<Loop>& loop, std::function<void()> task);
+
+    // 本轮任务执行完后发送连接的数据（只在I/O线程中调用）
+    static void schedule(const std::shared_ptr<Loop>& loop, const std::shared_ptr<Connection>& connection);
+
+private:
+    std::vector<std::shared_ptr<Loop>> m_loops;
+    Handler m_handler;
+    Config m_config;
+    int m_listenSocket;
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_accepted;
+    std::atomic<uint64_t> m_rejected;
+    std::atomic<uint64_t> m_requests;
+    std::atomic<uint64_t> m_badRequests;
+    std::atomic<size_t> m_connections;
+};
+
+#endif // HTTP_REACTOR_H
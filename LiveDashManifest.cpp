@@ -0,0 +1,194 @@
+#include "LiveDashManifest.h"
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+// 毫秒 -> ISO 8601时长
+std::string formatDuration(uint64_t ms)
+{
+    std::ostringstream out;
+    out << "PT" << ms / 1000 << "." << std::setw(3) << std::setfill('0') << ms % 1000 << "S";
+    return out.str();
+}
+
+// Unix毫秒 -> UTC时间
+std::string formatTime(int64_t ms)
+{
+    std::time_t seconds = static_cast<std::time_t>(ms / 1000);
+    std::tm tm;
+    #ifdef _WIN32
+    gmtime_s(&tm, &seconds);
+    #else
+    gmtime_r(&seconds, &tm);
+    #endif
+
+    char buffer[32];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::ostringstream out;
+    out << buffer << "." << std::setw(3) << std::setfill('0') << ms % 1000 << "Z";
+    return out.str();
+}
+
+} // namespace
+
+LiveDashManifest::LiveDashManifest(const Config& config)
+    : m_config(config)
+    , m_width(0)
+    , m_height(0)
+    , m_frameRate(0)
+    , m_maxDuration(0)
+    , m_bandwidth(0)
+{
+}
+
+void LiveDashManifest::setRepresentation(const std::string& codecs, int width, int height, float frameRate)
+{
+    m_codecs = codecs;
+    m_width = width;
+    m_height = height;
+    m_frameRate = frameRate;
+}
+
+void LiveDashManifest::announceSegment(uint32_t number, uint64_t start, uint64_t expectedDuration)
+{
+    if (expectedDuration == 0) {
+        expectedDuration = m_maxDuration;
+    }
+    if (expectedDuration == 0) {
+        expectedDuration = static_cast<uint64_t>(m_config.chunkDurationMs) * m_config.timescale / 1000;
+    }
+
+    Segment segment = { number, start, expectedDuration };
+    m_segments.push_back(segment);
+}
+
+void LiveDashManifest::addSegment(uint32_t number, uint64_t start, uint64_t duration, uint64_t bytes,
+                                  std::vector<uint32_t>& expired)
+{
+    Segment segment = { number, start, duration };
+    if (!m_segments.empty() && m_segments.back().number == number) {
+        m_segments.back() = segment;
+    } else {
+        m_segments.push_back(segment);
+    }
+
+    if (duration > 0) {
+        m_maxDuration = std::max(m_maxDuration, duration);
+        m_bandwidth = std::max(m_bandwidth, bytes * 8 * m_config.timescale / duration);
+    }
+
+    // 移出时移窗口的分段（至少保留最新的一个）
+    if (m_config.timeShiftBufferMs > 0) {
+        uint64_t window = static_cast<uint64_t>(m_config.timeShiftBufferMs) * m_config.timescale / 1000;
+        uint64_t end = start + duration;
+        while (m_segments.size() > 1 && m_segments.front().start + m_segments.front().duration + window < end) {
+            expired.push_back(m_segments.front().number);
+            m_segments.pop_front();
+        }
+    }
+}
+
+std::string LiveDashManifest::segmentName(uint32_t number) const
+{
+    std::string name = m_config.mediaTemplate;
+    size_t pos = name.find("$Number$");
+    if (pos != std::string::npos) {
+        name.replace(pos, 8, std::to_string(number));
+    }
+    return name;
+}
+
+std::string LiveDashManifest::build(bool ended) const
+{
+    int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t maxDuration = m_maxDuration;
+    for (const Segment& segment : m_segments) {
+        maxDuration = std::max(maxDuration, segment.duration);
+    }
+    uint64_t maxSegmentMs = maxDuration * 1000 / m_config.timescale;
+
+    std::ostringstream mpd;
+    mpd << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+        << " type=\"dynamic\""
+        << " availabilityStartTime=\"" << formatTime(m_config.availabilityStartMs) << "\""
+        << " publishTime=\"" << formatTime(nowMs) << "\"";
+    if (ended) {
+        uint64_t endTicks = m_segments.empty() ? 0 : m_segments.back().start + m_segments.back().duration;
+        mpd << " mediaPresentationDuration=\"" << formatDuration(endTicks * 1000 / m_config.timescale) << "\"";
+    } else {
+        // 每个分段发布时更新，按最长分段时长刷新即可
+        mpd << " minimumUpdatePeriod=\"" << formatDuration(maxSegmentMs) << "\"";
+    }
+    if (m_config.timeShiftBufferMs > 0) {
+        mpd << " timeShiftBufferDepth=\"" << formatDuration(m_config.timeShiftBufferMs) << "\"";
+    }
+    mpd << " maxSegmentDuration=\"" << formatDuration(maxSegmentMs) << "\""
+        << " minBufferTime=\"" << formatDuration(m_config.minBufferMs) << "\">\n";
+    if (m_config.targetLatencyMs > 0) {
+        mpd << " <ServiceDescription id=\"0\">\n"
+            << "  <Latency target=\"" << m_config.targetLatencyMs << "\"/>\n"
+            << " </ServiceDescription>\n";
+    }
+    mpd << " <Period id=\"0\" start=\"PT0S\">\n"
+        << "  <AdaptationSet mimeType=\"video/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">\n"
+        << "   <SegmentTemplate timescale=\"" << m_config.timescale << "\""
+        << " initialization=\"" << m_config.initName << "\""
+        << " media=\"" << m_config.mediaTemplate << "\""
+        << " startNumber=\"" << (m_segments.empty() ? 1 : m_segments.front().number) << "\"";
+    if (m_config.chunkDurationMs > 0 && !ended) {
+        // 第一个块写出后分段即可请求：提前量为分段时长减一个块
+        uint64_t offsetMs = maxSegmentMs > m_config.chunkDurationMs ? maxSegmentMs - m_config.chunkDurationMs : 0;
+        mpd << " availabilityTimeOffset=\"" << offsetMs / 1000 << "." << std::setw(3) << std::setfill('0')
+            << offsetMs % 1000 << "\" availabilityTimeComplete=\"false\"";
+    }
+    mpd << ">\n"
+        << "    <SegmentTimeline>\n";
+
+    // 连续且时长相同的分段合并为一个S（r为重复次数）
+    size_t i = 0;
+    uint64_t expected = 0;
+    while (i < m_segments.size()) {
+        size_t j = i + 1;
+        while (j < m_segments.size() && m_segments[j].duration == m_segments[i].duration &&
+               m_segments[j].start == m_segments[j - 1].start + m_segments[j - 1].duration) {
+            j++;
+        }
+
+        mpd << "     <S";
+        if (i == 0 || m_segments[i].start != expected) {
+            mpd << " t=\"" << m_segments[i].start << "\"";
+        }
+        mpd << " d=\"" << m_segments[i].duration << "\"";
+        if (j - i > 1) {
+            mpd << " r=\"" << (j - i - 1) << "\"";
+        }
+        mpd << "/>\n";
+
+        expected = m_segments[j - 1].start + m_segments[j - 1].duration;
+        i = j;
+    }
+
+    mpd << "    </SegmentTimeline>\n"
+        << "   </SegmentTemplate>\n"
+        << "   <Representation id=\"1\" codecs=\"" << m_codecs << "\""
+        << " width=\"" << m_width << "\" height=\"" << m_height << "\"";
+    if (m_frameRate > 0) {
+        mpd << " frameRate=\"" << static_cast<int>(m_frameRate * 1000 + 0.5f) << "/1000\"";
+    }
+    mpd << " bandwidth=\"" << (m_bandwidth ? m_bandwidth : 1) << "\"/>\n"
+        << "  </AdaptationSet>\n"
+        << " </Period>\n";
+    if (!m_config.utcTimingUrl.empty()) {
+        mpd << " <UTCTiming schemeIdUri=\"urn:mpeg:dash:utc:http-iso:2014\" value=\"" << m_config.utcTimingUrl << "\"/>\n";
+    }
+    mpd << "</MPD>\n";
+
+    return mpd.str();
+}
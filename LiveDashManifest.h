@@ -0,0 +1,99 @@
+#ifndef LIVE_DASH_MANIFEST_H
+#define LIVE_DASH_MANIFEST_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * LiveDashManifest - 直播DASH的动态MPD
+ *
+ * 记录已发布分段的时间线，每发布一个分段重写一次type="dynamic"的MPD
+ * （SegmentTemplate + SegmentTimeline，$Number$命名）。超出时移窗口的
+ * 分段从时间线中移除，由调用方删除对应分段。MPD内容交给输出端
+ * （OutputSink）写入磁盘或内存。
+ *
+ * CMAF分块模式下分段在第一个块写出后即按预计时长加入时间线，并通过
+ * availabilityTimeOffset告知播放器可以在分段完成前开始请求。
+ */
+class LiveDashManifest {
+public:
+    struct Config {
+        std::string initName;           // 初始化分段文件名（相对MPD）
+        std::string mediaTemplate;      // 媒体分段模板，如"segment_$Number$.m4s"
+        uint32_t timescale;             // 时间线的时间基
+        uint32_t timeShiftBufferMs;     // 时移窗口（毫秒），0表示保留全部分段
+        uint32_t minBufferMs;           // minBufferTime（毫秒）
+        int64_t availabilityStartMs;    // 时间线0点对应的Unix时间（毫秒）
+        uint32_t chunkDurationMs;       // CMAF块时长（毫秒），0表示不分块
+        uint32_t targetLatencyMs;       // 目标延迟（毫秒，写入ServiceDescription），0表示不写
+        std::string utcTimingUrl;       // 时钟同步地址（http-iso），为空表示不写UTCTiming
+
+        Config()
+            : timescale(90000), timeShiftBufferMs(30000), minBufferMs(2000), availabilityStartMs(0),
+              chunkDurationMs(0), targetLatencyMs(0) {}
+    };
+
+    explicit LiveDashManifest(const Config& config);
+
+    /**
+     * 设置Representation属性
+     *
+     * @param codecs RFC 6381编码字符串（多个轨道以逗号分隔）
+     * @param width 视频宽度
+     * @param height 视频高度
+     * @param frameRate 帧率
+     */
+    void setRepresentation(const std::string& codecs, int width, int height, float frameRate);
+
+    /**
+     * 预告正在写入的分段（分块模式，第一个块写出后调用）
+     *
+     * @param number 分段序号
+     * @param start 分段开始时间
+     * @param expectedDuration 预计时长，0表示按已发布分段的最长时长估计
+     */
+    void announceSegment(uint32_t number, uint64_t start, uint64_t expectedDuration);
+
+    /**
+     * 添加已发布的分段（已预告的分段更新为实际时长）
+     *
+     * @param number 分段序号（$Number$）
+     * @param start 分段开始时间（时间基为timescale）
+     * @param duration 分段时长
+     * @param bytes 分段文件大小（用于估算码率）
+     * @param expired 输出，移出时移窗口的分段序号
+     */
+    void addSegment(uint32_t number, uint64_t start, uint64_t duration, uint64_t bytes, std::vector<uint32_t>& expired);
+
+    /**
+     * 生成MPD内容
+     *
+     * @param ended 直播是否已结束（去掉minimumUpdatePeriod并写入总时长）
+     * @return MPD文本
+     */
+    std::string build(bool ended) const;
+
+    // 分段文件名
+    std::string segmentName(uint32_t number) const;
+
+private:
+    struct Segment {
+        uint32_t number;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    Config m_config;
+    std::string m_codecs;
+    int m_width;
+    int m_height;
+    float m_frameRate;
+    std::deque<Segment> m_segments;     // 时移窗口内的分段
+    uint64_t m_maxDuration;             // 最长分段时长
+    uint64_t m_bandwidth;               // 分段码率峰值（bps）
+};
+
+#endif // LIVE_DASH_MANIFEST_H
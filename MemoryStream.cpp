@@ -0,0 +1,175 @@
+#include "MemoryStream.h"
+#include <cstring>
+#include <iostream>
+
+MemoryStream::MemoryStream()
+    : m_base(0)
+    , m_pos(0)
+    , m_file(nullptr)
+{
+}
+
+MemoryStream::~MemoryStream()
+{
+}
+
+bool MemoryStream::supported()
+{
+    #if defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__)
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+FILE* MemoryStream::open()
+{
+    if (m_file) {
+        return nullptr;
+    }
+
+    #if defined(__GLIBC__)
+    cookie_io_functions_t functions;
+    functions.read = onRead;
+    functions.write = onWrite;
+    functions.seek = onSeek;
+    functions.close = onClose;
+    m_file = fopencookie(this, "w+", functions);
+    #elif defined(__APPLE__) || defined(__FreeBSD__)
+    m_file = funopen(this, onRead, onWrite, onSeek, onClose);
+    #else
+    std::cerr << "Memory output is not supported on this platform" << std::endl;
+    #endif
+
+    return m_file;
+}
+
+void MemoryStream::consume()
+{
+    m_base += m_buffer.size();
+    m_buffer.clear();
+    if (m_pos < m_base) {
+        m_pos = m_base;
+    }
+}
+
+size_t MemoryStream::read(char* data, size_t size)
+{
+    if (m_pos < m_base) {
+        std::cerr << "Read before consumed data in memory stream" << std::endl;
+        return 0;
+    }
+
+    size_t offset = static_cast<size_t>(m_pos - m_base);
+    if (offset >= m_buffer.size()) {
+        return 0;
+    }
+    if (size > m_buffer.size() - offset) {
+        size = m_buffer.size() - offset;
+    }
+    memcpy(data, m_buffer.data() + offset, size);
+    m_pos += size;
+
+    return size;
+}
+
+size_t MemoryStream::write(const char* data, size_t size)
+{
+    // 已取走的数据不能再修改
+    if (m_pos < m_base) {
+        std::cerr << "Write before consumed data in memory stream" << std::endl;
+        return 0;
+    }
+
+    size_t offset = static_cast<size_t>(m_pos - m_base);
+    if (offset + size > m_buffer.size()) {
+        m_buffer.resize(offset + size);
+    }
+    memcpy(m_buffer.data() + offset, data, size);
+    m_pos += size;
+
+    return size;
+}
+
+bool MemoryStream::seek(int64_t offset, int whence, uint64_t& result)
+{
+    int64_t target;
+    switch (whence) {
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = static_cast<int64_t>(m_pos) + offset;
+        break;
+    case SEEK_END:
+        target = static_cast<int64_t>(m_base + m_buffer.size()) + offset;
+        break;
+    default:
+        return false;
+    }
+
+    if (target < static_cast<int64_t>(m_base)) {
+        return false;
+    }
+    m_pos = static_cast<uint64_t>(target);
+    result = m_pos;
+
+    return true;
+}
+
+#if defined(__GLIBC__)
+
+ssize_t MemoryStream::onRead(void* cookie, char* data, size_t size)
+{
+    return static_cast<ssize_t>(static_cast<MemoryStream*>(cookie)->read(data, size));
+}
+
+ssize_t MemoryStream::onWrite(void* cookie, const char* data, size_t size)
+{
+    return static_cast<ssize_t>(static_cast<MemoryStream*>(cookie)->write(data, size));
+}
+
+int MemoryStream::onSeek(void* cookie, off64_t* offset, int whence)
+{
+    uint64_t result;
+    if (!static_cast<MemoryStream*>(cookie)->seek(*offset, whence, result)) {
+        return -1;
+    }
+    *offset = static_cast<off64_t>(result);
+    return 0;
+}
+
+int MemoryStream::onClose(void* cookie)
+{
+    static_cast<MemoryStream*>(cookie)->m_file = nullptr;
+    return 0;
+}
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+
+int MemoryStream::onRead(void* cookie, char* data, int size)
+{
+    return static_cast<int>(static_cast<MemoryStream*>(cookie)->read(data, static_cast<size_t>(size)));
+}
+
+int MemoryStream::onWrite(void* cookie, const char* data, int size)
+{
+    return static_cast<int>(static_cast<MemoryStream*>(cookie)->write(data, static_cast<size_t>(size)));
+}
+
+fpos_t MemoryStream::onSeek(void* cookie, fpos_t offset, int whence)
+{
+    uint64_t result;
+    if (!static_cast<MemoryStream*>(cookie)->seek(offset, whence, result)) {
+        return -1;
+    }
+    return static_cast<fpos_t>(result);
+}
+
+int MemoryStream::onClose(void* cookie)
+{
+    static_cast<MemoryStream*>(cookie)->m_file = nullptr;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MEMORY_STREAM_H
+#define MEMORY_STREAM_H
+
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * MemoryStream - 写入内存的FILE*
+ *
+ * GPAC只能向FILE*写文件，用fopencookie/funopen构造一个写入内存缓冲的FILE*
+ * 替换文件映射中的流，分片数据不再经过磁盘。支持在未取走的数据范围内
+ * seek、回读和回写（GPAC先写mdat再把moof移到前面、回填box大小时使用）；
+ * 位置是从创建起的绝对偏移，取走数据后不变。
+ */
+class MemoryStream {
+public:
+    MemoryStream();
+
+    // 流由GPAC关闭（关闭回调不释放缓冲），析构前需先关闭流
+    ~MemoryStream();
+
+    /**
+     * 创建FILE*（每个MemoryStream只能创建一次）
+     *
+     * @return 写入本缓冲的FILE*，当前平台不支持时返回nullptr
+     */
+    FILE* open();
+
+    // 尚未取走的数据
+    const uint8_t* pendingData() const { return m_buffer.data(); }
+    size_t pendingSize() const { return m_buffer.size(); }
+
+    // 取走全部未取走的数据
+    void consume();
+
+    // 当前写入位置（绝对偏移）
+    uint64_t position() const { return m_pos; }
+
+    // 当前平台是否支持
+    static bool supported();
+
+private:
+    MemoryStream(const MemoryStream&);
+    MemoryStream& operator=(const MemoryStream&);
+
+    // 读取/写入/定位，由FILE*回调调用
+    size_t read(char* data, size_t size);
+    size_t write(const char* data, size_t size);
+    bool seek(int64_t offset, int whence, uint64_t& result);
+
+    #if defined(__GLIBC__)
+    static ssize_t onRead(void* cookie, char* data, size_t size);
+    static ssize_t onWrite(void* cookie, const char* data, size_t size);
+    static int onSeek(void* cookie, off64_t* offset, int whence);
+    static int onClose(void* cookie);
+    #elif defined(__APPLE__) || defined(__FreeBSD__)
+    static int onRead(void* cookie, char* data, int size);
+    static int onWrite(void* cookie, const char* data, int size);
+    static fpos_t onSeek(void* cookie, fpos_t offset, int whence);
+    static int onClose(void* cookie);
+    #endif
+
+    std::vector<uint8_t> m_buffer;  // 未取走的数据
+    uint64_t m_base;                // m_buffer[0]的绝对偏移
+    uint64_t m_pos;                 // 写入位置
+    FILE* m_file;                   // 已创建的FILE*
+};
+
+#endif // MEMORY_STREAM_H
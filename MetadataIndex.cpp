@@ -0,0 +1,199 @@
+#include "MetadataIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const uint16_t INDEX_VERSION = 1;
+const size_t HEADER_SIZE = 28;      // 魔数 + 版本 + 保留 + 起止时间 + 类型数
+const size_t DIR_ENTRY_SIZE = 16;
+const size_t RECORD_SIZE = 8;
+
+void putU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(value & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void putU64(std::vector<uint8_t>& out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint32_t getU32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t getU64(const uint8_t* p)
+{
+    return getU32(p) | (static_cast<uint64_t>(getU32(p + 4)) << 32);
+}
+
+} // namespace
+
+MetadataIndex::MetadataIndex(int64_t startTimeMs)
+    : m_startTimeMs(startTimeMs)
+    , m_endOffsetMs(0)
+    , m_count(0)
+{
+}
+
+void MetadataIndex::add(uint32_t eventType, uint32_t offsetMs, uint32_t sampleNumber)
+{
+    Record record = { offsetMs, sampleNumber };
+    m_events[eventType].push_back(record);
+    m_count++;
+    m_endOffsetMs = std::max(m_endOffsetMs, offsetMs);
+}
+
+bool MetadataIndex::save(const std::string& path) const
+{
+    std::vector<uint8_t> data;
+    data.reserve(HEADER_SIZE + m_events.size() * DIR_ENTRY_SIZE);
+
+    // 文件头
+    data.push_back('M');
+    data.push_back('I');
+    data.push_back('D');
+    data.push_back('X');
+    putU16(data, INDEX_VERSION);
+    putU16(data, 0);
+    putU64(data, static_cast<uint64_t>(m_startTimeMs));
+    putU64(data, static_cast<uint64_t>(m_startTimeMs + m_endOffsetMs));
+    putU32(data, static_cast<uint32_t>(m_events.size()));
+
+    // 目录
+    uint64_t offset = HEADER_SIZE + m_events.size() * DIR_ENTRY_SIZE;
+    for (const auto& type : m_events) {
+        putU32(data, type.first);
+        putU32(data, static_cast<uint32_t>(type.second.size()));
+        putU64(data, offset);
+        offset += type.second.size() * RECORD_SIZE;
+    }
+
+    // 记录
+    for (const auto& type : m_events) {
+        for (const auto& record : type.second) {
+            putU32(data, record.offsetMs);
+            putU32(data, record.sampleNumber);
+        }
+    }
+
+    std::string tmpPath = path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool MetadataIndex::query(const std::string& path, uint32_t eventType, int64_t fromMs, int64_t toMs,
+                          std::vector<Entry>& entries)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // 文件长度，用于校验目录和记录数（损坏的索引不会导致超大分配）
+    long fileSize = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        fileSize = ftell(file);
+    }
+    if (fileSize < static_cast<long>(HEADER_SIZE) || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(fileSize);
+
+    uint8_t header[HEADER_SIZE];
+    if (fread(header, 1, HEADER_SIZE, file) != HEADER_SIZE || memcmp(header, "MIDX", 4) != 0 ||
+        (header[4] | (header[5] << 8)) != INDEX_VERSION) {
+        fclose(file);
+        return false;
+    }
+
+    // 录像时间段与查询范围不相交时不再读取
+    int64_t startMs = static_cast<int64_t>(getU64(header + 8));
+    int64_t endMs = static_cast<int64_t>(getU64(header + 16));
+    uint32_t typeCount = getU32(header + 24);
+    if (endMs < fromMs || startMs > toMs) {
+        fclose(file);
+        return true;
+    }
+
+    if (typeCount > (size - HEADER_SIZE) / DIR_ENTRY_SIZE) {
+        fclose(file);
+        return false;
+    }
+    std::vector<uint8_t> dir(typeCount * DIR_ENTRY_SIZE);
+    if (!dir.empty() && fread(dir.data(), 1, dir.size(), file) != dir.size()) {
+        fclose(file);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < typeCount; i++) {
+        const uint8_t* item = &dir[i * DIR_ENTRY_SIZE];
+        if (getU32(item) != eventType) {
+            continue;
+        }
+
+        uint32_t count = getU32(item + 4);
+        uint64_t offset = getU64(item + 8);
+        if (offset > size || count > (size - offset) / RECORD_SIZE) {
+            fclose(file);
+            return false;
+        }
+        std::vector<uint8_t> records(count * RECORD_SIZE);
+        if (fseek(file, static_cast<long>(offset), SEEK_SET) != 0 ||
+            (!records.empty() && fread(records.data(), 1, records.size(), file) != records.size())) {
+            fclose(file);
+            return false;
+        }
+
+        // 记录按时间排序，二分查找起点
+        int64_t fromOffset = fromMs - startMs;
+        uint32_t lo = 0;
+        uint32_t hi = count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (static_cast<int64_t>(getU32(&records[mid * RECORD_SIZE])) < fromOffset) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        for (uint32_t j = lo; j < count; j++) {
+            const uint8_t* record = &records[j * RECORD_SIZE];
+            uint32_t offsetMs = getU32(record);
+            if (startMs + offsetMs > toMs) {
+                break;
+            }
+            Entry entry = { eventType, startMs + offsetMs, offsetMs, getU32(record + 4) };
+            entries.push_back(entry);
+        }
+        break;
+    }
+
+    fclose(file);
+    return true;
+}
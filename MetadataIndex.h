@@ -0,0 +1,90 @@
+#ifndef METADATA_INDEX_H
+#define METADATA_INDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * MetadataIndex - 录像文件的智能事件索引（与MP4同名的.idx旁路文件）
+ *
+ * 按事件类型分组记录每个元数据样本的时间和样本序号。文件头带有录像的
+ * 起止时间，目录给出每种事件在文件中的位置，查询某类事件时只读文件头、
+ * 目录和该类事件的记录，不需要打开MP4。
+ *
+ * 文件格式（小端）：
+ *   "MIDX" | u16 版本 | u16 保留 | i64 起始时间(ms) | i64 结束时间(ms) | u32 类型数
+ *   目录：类型数 × { u32 事件类型 | u32 记录数 | u64 记录偏移 }
+ *   记录：每类按时间排序 × { u32 相对起始时间(ms) | u32 元数据样本序号 }
+ */
+class MetadataIndex {
+public:
+    // 查询结果
+    struct Entry {
+        uint32_t eventType;     // 事件类型
+        int64_t timeMs;         // 事件时间（Unix毫秒）
+        uint32_t offsetMs;      // 相对录像起始的时间（毫秒）
+        uint32_t sampleNumber;  // 元数据轨道中的样本序号（从1开始）
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param startTimeMs 录像起始时间（Unix毫秒）
+     */
+    explicit MetadataIndex(int64_t startTimeMs);
+
+    /**
+     * 记录一个事件（按时间顺序调用）
+     *
+     * @param eventType 事件类型
+     * @param offsetMs 相对录像起始的时间（毫秒）
+     * @param sampleNumber 元数据样本序号
+     */
+    void add(uint32_t eventType, uint32_t offsetMs, uint32_t sampleNumber);
+
+    // 是否没有任何事件
+    bool empty() const { return m_events.empty(); }
+
+    // 已记录的事件数
+    size_t size() const { return m_count; }
+
+    /**
+     * 写入索引文件（先写临时文件再改名，不会留下写了一半的索引）
+     *
+     * @param path 索引文件路径
+     * @return 是否成功
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * 查询索引文件中某类事件
+     *
+     * @param path 索引文件路径
+     * @param eventType 事件类型
+     * @param fromMs 起始时间（Unix毫秒，含）
+     * @param toMs 结束时间（Unix毫秒，含）
+     * @param entries 输出，追加按时间排序的结果
+     * @return 索引文件是否有效（没有匹配事件时也返回true）
+     */
+    static bool query(const std::string& path, uint32_t eventType, int64_t fromMs, int64_t toMs,
+                      std::vector<Entry>& entries);
+
+    // 录像文件对应的索引文件路径
+    static std::string pathFor(const std::string& mp4Path) { return mp4Path + ".idx"; }
+
+private:
+    struct Record {
+        uint32_t offsetMs;
+        uint32_t sampleNumber;
+    };
+
+    int64_t m_startTimeMs;
+    uint32_t m_endOffsetMs;
+    std::map<uint32_t, std::vector<Record>> m_events;
+    size_t m_count;
+};
+
+#endif // METADATA_INDEX_H
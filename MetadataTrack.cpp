@@ -0,0 +1,150 @@
+#include "MetadataTrack.h"
+#include <iostream>
+#include <cstring>
+
+namespace {
+
+// 交织缓冲最多保留的条数，视频长时间没有到达时丢弃最早的元数据
+const size_t MAX_PENDING = 256;
+
+// 分片中元数据样本的名义时长（90kHz，40毫秒）
+const u32 NOMINAL_DURATION = 3600;
+
+} // namespace
+
+MetadataTrack::MetadataTrack()
+    : m_useTimestamps(false)
+    , m_lastDTS(-1)
+    , m_sampleCount(0)
+    , m_markDecodeTime(false)
+    , m_samplesWritten(0)
+    , m_samplesDropped(0)
+{
+}
+
+bool MetadataTrack::createTrack(GF_ISOFile* file, bool fragmented, int& trackId) const
+{
+    trackId = gf_isom_new_track(file, 0, GF_ISOM_MEDIA_META, 90000);
+    if (!trackId) {
+        std::cerr << "Failed to create metadata track" << std::endl;
+        return false;
+    }
+    gf_isom_set_track_enabled(file, trackId, 1);
+
+    // 私有二进制负载，使用自定义的'dhav'样本描述
+    GF_GenericSampleDescription desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.codec_tag = GF_4CC('d', 'h', 'a', 'v');
+    u32 descIndex = 0;
+    GF_Err err = gf_isom_new_generic_sample_description(file, trackId, NULL, NULL, &desc, &descIndex);
+    if (err != GF_OK) {
+        std::cerr << "Failed to set metadata config: " << gf_error_to_string(err) << std::endl;
+        return false;
+    }
+
+    if (fragmented) {
+        err = gf_isom_setup_track_fragment(file, trackId, 1, NOMINAL_DURATION, 0, 1, 0, 0);
+        if (err != GF_OK) {
+            std::cerr << "Failed to setup metadata track fragment: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MetadataTrack::push(const uint8_t* data, size_t size, uint32_t eventType, int64_t timestamp, int64_t videoTime)
+{
+    Pending item;
+    if (!m_freeBuffers.empty()) {
+        item.data.swap(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+    }
+    item.data.assign(data, data + size);
+    item.eventType = eventType;
+    item.timestamp = timestamp;
+    item.videoTime = videoTime;
+    m_pending.push_back(std::move(item));
+
+    if (m_pending.size() > MAX_PENDING) {
+        m_freeBuffers.push_back(std::move(m_pending.front().data));
+        m_pending.pop_front();
+        m_samplesDropped++;
+    }
+}
+
+bool MetadataTrack::flush(GF_ISOFile* file, int trackId, bool fragmented, int64_t fileBase, int64_t until,
+                          MetadataIndex* index)
+{
+    while (!m_pending.empty()) {
+        Pending& item = m_pending.front();
+        int64_t time = itemTime(item);
+        if (time > until) {
+            break;
+        }
+
+        // DTS必须严格递增，早于文件第一帧的放在开头
+        int64_t dts = (time > fileBase) ? time - fileBase : 0;
+        if (dts <= m_lastDTS) {
+            dts = m_lastDTS + 1;
+        }
+
+        GF_ISOSample sample;
+        memset(&sample, 0, sizeof(GF_ISOSample));
+        sample.data = reinterpret_cast<char*>(item.data.data());
+        sample.dataLength = static_cast<u32>(item.data.size());
+        sample.DTS = static_cast<u64>(dts);
+        sample.IsRAP = RAP;
+
+        GF_Err err;
+        if (fragmented) {
+            // 分段中的第一个样本同时设置tfdt
+            if (m_markDecodeTime) {
+                gf_isom_set_traf_base_media_decode_time(file, trackId, sample.DTS);
+                m_markDecodeTime = false;
+            }
+            err = gf_isom_fragment_add_sample(file, trackId, &sample, 1, NOMINAL_DURATION, 0, 0, GF_FALSE);
+        } else {
+            err = gf_isom_add_sample(file, trackId, 1, &sample);
+        }
+        if (err != GF_OK) {
+            std::cerr << "Failed to add metadata sample: " << gf_error_to_string(err) << std::endl;
+            return false;
+        }
+
+        m_lastDTS = dts;
+        m_sampleCount++;
+        m_samplesWritten++;
+        if (index) {
+            index->add(item.eventType, static_cast<uint32_t>(dts / 90), m_sampleCount);
+        }
+
+        m_freeBuffers.push_back(std::move(item.data));
+        m_pending.pop_front();
+    }
+
+    return true;
+}
+
+void MetadataTrack::resetFile()
+{
+    m_lastDTS = -1;
+    m_sampleCount = 0;
+    m_markDecodeTime = false;
+}
+
+void MetadataTrack::reset()
+{
+    while (!m_pending.empty()) {
+        m_freeBuffers.push_back(std::move(m_pending.front().data));
+        m_pending.pop_front();
+    }
+    resetFile();
+    m_samplesWritten = 0;
+    m_samplesDropped = 0;
+}
+
+int64_t MetadataTrack::itemTime(const Pending& item) const
+{
+    return (m_useTimestamps && item.timestamp >= 0) ? item.timestamp : item.videoTime;
+}
@@ -0,0 +1,94 @@
+#ifndef METADATA_TRACK_H
+#define METADATA_TRACK_H
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+#include "gpac/isomedia.h"
+#include "MetadataIndex.h"
+
+/**
+ * MetadataTrack - 智能分析数据的定时元数据轨道
+ *
+ * DHAV辅助帧、IVS扩展字段等负载原样作为样本写入元数据轨道（时间基90kHz），
+ * 与视频一样按时间交织进mdat；每写入一个样本同时记入当前文件的事件索引。
+ */
+class MetadataTrack {
+public:
+    MetadataTrack();
+
+    /**
+     * 在文件中创建元数据轨道
+     *
+     * @param file 目标文件
+     * @param fragmented 是否为分片文件（同时设置轨道分片默认值）
+     * @param trackId 输出轨道ID
+     * @return 是否成功
+     */
+    bool createTrack(GF_ISOFile* file, bool fragmented, int& trackId) const;
+
+    /**
+     * 缓冲一条元数据
+     *
+     * @param data 负载数据
+     * @param size 数据大小
+     * @param eventType 事件类型（写入索引）
+     * @param timestamp 时间戳（90kHz流时间，负数表示未提供）
+     * @param videoTime 最近写入的视频帧时间（90kHz流时间，未使用时间戳时以此为准）
+     */
+    void push(const uint8_t* data, size_t size, uint32_t eventType, int64_t timestamp, int64_t videoTime);
+
+    /**
+     * 写入时间不晚于until的缓冲元数据，并记入索引
+     *
+     * @param file 目标文件
+     * @param trackId 元数据轨道ID
+     * @param fragmented 是否写入当前分片
+     * @param fileBase 文件起始时间（90kHz，与视频第一帧DTS相同）
+     * @param until 截止时间（90kHz）
+     * @param index 当前文件的事件索引（可为空）
+     * @return 是否成功
+     */
+    bool flush(GF_ISOFile* file, int trackId, bool fragmented, int64_t fileBase, int64_t until, MetadataIndex* index);
+
+    // 视频带时间戳时使用元数据自带的时间戳，否则归属最近的视频帧
+    void setUseTimestamps(bool use) { m_useTimestamps = use; }
+
+    // 新分段开始：下一个写入的样本同时设置分段的tfdt
+    void markFragmentStart() { m_markDecodeTime = true; }
+
+    // 开始写入新文件（样本序号和DTS重新计算）
+    void resetFile();
+
+    // 开始新的录制（清空缓冲）
+    void reset();
+
+    // 统计
+    uint64_t samplesWritten() const { return m_samplesWritten; }
+    uint64_t samplesDropped() const { return m_samplesDropped; }
+
+private:
+    struct Pending {
+        std::vector<uint8_t> data;  // 负载数据（缓冲区复用）
+        uint32_t eventType;
+        int64_t timestamp;          // 调用方提供的时间戳（90kHz，负数表示未提供）
+        int64_t videoTime;          // 写入时最近一帧视频的时间（90kHz）
+    };
+
+    // 元数据在流时间上的位置
+    int64_t itemTime(const Pending& item) const;
+
+private:
+    std::deque<Pending> m_pending;                  // 等待交织写入的元数据
+    std::vector<std::vector<uint8_t>> m_freeBuffers;// 已写入的缓冲区，供复用
+    bool m_useTimestamps;           // 是否使用元数据自带的时间戳
+    int64_t m_lastDTS;              // 当前文件上一个样本的DTS（-1表示没有）
+    uint32_t m_sampleCount;         // 当前文件已写入的样本数
+    bool m_markDecodeTime;          // 下一个样本是否为分段中的第一个
+    uint64_t m_samplesWritten;
+    uint64_t m_samplesDropped;
+};
+
+#endif // METADATA_TRACK_H
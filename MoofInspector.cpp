@@ -0,0 +1,164 @@
+#include "MoofInspector.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+namespace {
+
+uint32_t readU32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint32_t fourcc(const char* type)
+{
+    return readU32(reinterpret_cast<const uint8_t*>(type));
+}
+
+// 顺序读取的数据源（文件或内存）
+class Source {
+public:
+    virtual ~Source() {}
+    virtual bool read(uint64_t offset, uint8_t* data, size_t size) = 0;
+};
+
+class FileSource : public Source {
+public:
+    explicit FileSource(std::ifstream& in) : m_in(in) {}
+
+    bool read(uint64_t offset, uint8_t* data, size_t size) override
+    {
+        m_in.clear();
+        m_in.seekg(static_cast<std::streamoff>(offset));
+        return static_cast<bool>(m_in.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size)));
+    }
+
+private:
+    std::ifstream& m_in;
+};
+
+class BufferSource : public Source {
+public:
+    BufferSource(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool read(uint64_t offset, uint8_t* data, size_t size) override
+    {
+        if (offset > m_size || size > m_size - offset) {
+            return false;
+        }
+        memcpy(data, m_data + offset, size);
+        return true;
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+};
+
+/**
+ * 读取box头
+ *
+ * @param src 数据源
+ * @param start box开始位置
+ * @param limit 所在容器的结束位置
+ * @param type 输出box类型
+ * @param size 输出box总大小
+ * @param headerSize 输出box头大小（8或16）
+ * @return 是否读到完整的box头
+ */
+bool readBoxHeader(Source& src, uint64_t start, uint64_t limit, uint32_t& type, uint64_t& size, uint32_t& headerSize)
+{
+    if (start + 8 > limit) {
+        return false;
+    }
+
+    uint8_t header[16];
+    if (!src.read(start, header, 8)) {
+        return false;
+    }
+    size = readU32(header);
+    type = readU32(header + 4);
+    headerSize = 8;
+
+    if (size == 1) {
+        if (!src.read(start + 8, header + 8, 8)) {
+            return false;
+        }
+        size = (static_cast<uint64_t>(readU32(header + 8)) << 32) | readU32(header + 12);
+        headerSize = 16;
+    } else if (size == 0) {
+        // 延伸到容器末尾
+        size = limit - start;
+    }
+
+    return size >= headerSize && start + size <= limit;
+}
+
+// 累加容器内所有trun的sample_count（moof -> traf -> trun）
+void countSamples(Source& src, uint64_t pos, uint64_t end, uint32_t container, uint64_t& samples)
+{
+    uint32_t type;
+    uint64_t size;
+    uint32_t headerSize;
+    while (readBoxHeader(src, pos, end, type, size, headerSize)) {
+        if (container == fourcc("moof") && type == fourcc("traf")) {
+            countSamples(src, pos + headerSize, pos + size, type, samples);
+        } else if (type == fourcc("trun")) {
+            // version/flags(4) + sample_count(4)
+            uint8_t body[8];
+            if (src.read(pos + headerSize, body, sizeof(body))) {
+                samples += readU32(body + 4);
+            }
+        }
+        pos += size;
+    }
+}
+
+// 扫描顶层box
+void scanTopLevel(Source& src, uint64_t total, MoofInspector::Totals& totals)
+{
+    uint64_t pos = 0;
+    uint32_t type;
+    uint64_t size;
+    uint32_t headerSize;
+    while (readBoxHeader(src, pos, total, type, size, headerSize)) {
+        if (type == fourcc("moof")) {
+            totals.fragments++;
+            totals.headerBytes += size;
+            countSamples(src, pos + headerSize, pos + size, type, totals.samples);
+        } else if (type == fourcc("mdat")) {
+            totals.headerBytes += headerSize;
+            totals.mediaBytes += size - headerSize;
+        } else if (type == fourcc("styp") || type == fourcc("sidx") || type == fourcc("prft") ||
+                   type == fourcc("emsg")) {
+            totals.headerBytes += size;
+        }
+        pos += size;
+    }
+}
+
+} // namespace
+
+bool MoofInspector::scan(const std::string& path, Totals& totals)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    in.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+
+    FileSource src(in);
+    scanTopLevel(src, fileSize, totals);
+
+    return true;
+}
+
+void MoofInspector::scanBuffer(const uint8_t* data, size_t size, Totals& totals)
+{
+    BufferSource src(data, size);
+    scanTopLevel(src, size, totals);
+}
@@ -0,0 +1,51 @@
+#ifndef MOOF_INSPECTOR_H
+#define MOOF_INSPECTOR_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * MoofInspector - 统计分片MP4的头部开销
+ *
+ * 按顶层box扫描已写完的文件或分段：moof、styp、sidx、prft等计为头部，
+ * mdat只计8/16字节的box头，负载计为媒体数据；样本数取自各trun的
+ * sample_count。用于比较不同trex/tfhd默认值下每个样本的头部字节数。
+ */
+class MoofInspector {
+public:
+    struct Totals {
+        uint64_t fragments;     // moof个数
+        uint64_t samples;       // 样本数（所有轨道）
+        uint64_t headerBytes;   // 头部字节数
+        uint64_t mediaBytes;    // mdat负载字节数
+
+        Totals() : fragments(0), samples(0), headerBytes(0), mediaBytes(0) {}
+
+        // 平均每个样本的头部字节数
+        double headerBytesPerSample() const
+        {
+            return samples ? static_cast<double>(headerBytes) / samples : 0.0;
+        }
+    };
+
+    /**
+     * 扫描文件并累加统计（ftyp、moov等初始化部分不计入）
+     *
+     * @param path 分片MP4文件或媒体分段
+     * @param totals 累加结果
+     * @return 是否扫描成功
+     */
+    static bool scan(const std::string& path, Totals& totals);
+
+    /**
+     * 扫描内存中的媒体数据并累加统计
+     *
+     * @param data 媒体分段或分片数据
+     * @param size 数据大小
+     * @param totals 累加结果
+     */
+    static void scanBuffer(const uint8_t* data, size_t size, Totals& totals);
+};
+
+#endif // MOOF_INSPECTOR_H
@@ -0,0 +1,285 @@
+#include "OutputSink.h"
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// ---------------- FileSink ----------------
+
+FileSink::FileSink(const std::string& dir)
+    : m_dir(dir)
+    , m_segmentFile(nullptr)
+{
+}
+
+FileSink::~FileSink()
+{
+    if (m_segmentFile) {
+        fclose(m_segmentFile);
+    }
+}
+
+bool FileSink::onInit(const std::string& name, const uint8_t* data, size_t size)
+{
+    return writeAtomic(name, reinterpret_cast<const char*>(data), size);
+}
+
+bool FileSink::onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd)
+{
+    std::string path = m_dir + "/" + name;
+    std::string partPath = path + ".part";
+
+    // 上一个分段没有正常结束（写入端出错），丢弃
+    if (m_segmentFile && name != m_segmentName) {
+        fclose(m_segmentFile);
+        m_segmentFile = nullptr;
+        remove((m_dir + "/" + m_segmentName + ".part").c_str());
+    }
+
+    if (!m_segmentFile) {
+        m_segmentFile = fopen(partPath.c_str(), "wb");
+        if (!m_segmentFile) {
+            std::cerr << "Failed to create segment file: " << partPath << std::endl;
+            return false;
+        }
+        m_segmentName = name;
+    }
+
+    // 每个块写出后交给操作系统，DashServer读取.part即可拿到
+    bool ok = fwrite(data, 1, size, m_segmentFile) == size;
+    ok = (fflush(m_segmentFile) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Failed to write segment file: " << partPath << std::endl;
+    }
+
+    if (segmentEnd) {
+        ok = (fclose(m_segmentFile) == 0) && ok;
+        m_segmentFile = nullptr;
+
+        // 改名表示分段完成（已打开.part的读取方不受影响）
+        if (rename(partPath.c_str(), path.c_str()) != 0) {
+            std::cerr << "Failed to rename segment file: " << partPath << std::endl;
+            return false;
+        }
+    }
+
+    return ok;
+}
+
+bool FileSink::onManifest(const std::string& name, const std::string& mpd)
+{
+    return writeAtomic(name, mpd.data(), mpd.size());
+}
+
+void FileSink::onExpire(const std::string& name)
+{
+    remove((m_dir + "/" + name).c_str());
+}
+
+bool FileSink::writeAtomic(const std::string& name, const char* data, size_t size)
+{
+    std::string path = m_dir + "/" + name;
+    std::string tmpPath = path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to create " << tmpPath << std::endl;
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, file) == size;
+    ok = (fclose(file) == 0) && ok;
+
+    // 改名是原子的，读取方看到的总是完整的文件
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write " << path << std::endl;
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// ---------------- MemorySink ----------------
+
+MemorySink::MemorySink(size_t maxSegments)
+    : m_maxSegments(maxSegments)
+{
+}
+
+bool MemorySink::onInit(const std::string& name, const uint8_t* data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 新的录制：序号从头开始，旧的分段和MPD作废
+    m_files.clear();
+    m_segments.clear();
+
+    File& file = m_files[name];
+    file.data.assign(reinterpret_cast<const char*>(data), size);
+    file.complete = true;
+    m_cond.notify_all();
+
+    return true;
+}
+
+bool MemorySink::onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_files.find(name);
+    if (it == m_files.end()) {
+        it = m_files.insert(std::make_pair(name, File())).first;
+        it->second.complete = false;
+        m_segments.push_back(name);
+
+        // 超出上限时释放最早的分段
+        while (m_maxSegments > 0 && m_segments.size() > m_maxSegments) {
+            m_files.erase(m_segments.front());
+            m_segments.pop_front();
+        }
+    }
+
+    it->second.data.append(reinterpret_cast<const char*>(data), size);
+    if (segmentEnd) {
+        it->second.complete = true;
+    }
+    m_cond.notify_all();
+
+    return true;
+}
+
+bool MemorySink::onManifest(const std::string& name, const std::string& mpd)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    File& file = m_files[name];
+    file.data = mpd;
+    file.complete = true;
+    m_cond.notify_all();
+
+    return true;
+}
+
+void MemorySink::onExpire(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_files.erase(name)) {
+        for (auto it = m_segments.begin(); it != m_segments.end(); ++it) {
+            if (*it == name) {
+                m_segments.erase(it);
+                break;
+            }
+        }
+        m_cond.notify_all();
+    }
+}
+
+bool MemorySink::read(const std::string& name, size_t offset, std::string& out, bool& complete, uint32_t waitMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto ready = [&]() {
+        auto it = m_files.find(name);
+        return it != m_files.end() && (it->second.complete || it->second.data.size() > offset);
+    };
+    m_cond.wait_for(lock, std::chrono::milliseconds(waitMs), ready);
+
+    auto it = m_files.find(name);
+    if (it == m_files.end()) {
+        return false;
+    }
+
+    if (it->second.data.size() > offset) {
+        out.append(it->second.data, offset, std::string::npos);
+    }
+    complete = it->second.complete;
+
+    return true;
+}
+
+// ---------------- FdSink ----------------
+
+FdSink::FdSink(int fd)
+    : m_fd(fd)
+{
+}
+
+bool FdSink::onInit(const std::string& name, const uint8_t* data, size_t size)
+{
+    (void)name;
+    return writeAll(data, size);
+}
+
+bool FdSink::onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd)
+{
+    (void)name;
+    (void)segmentEnd;
+    return writeAll(data, size);
+}
+
+bool FdSink::onManifest(const std::string& name, const std::string& mpd)
+{
+    (void)name;
+    (void)mpd;
+    return true;
+}
+
+bool FdSink::writeAll(const uint8_t* data, size_t size)
+{
+    while (size > 0) {
+#ifdef _WIN32
+        int written = _write(m_fd, data, static_cast<unsigned int>(size));
+#else
+        // 套接字用send避免对端关闭时的SIGPIPE，管道和普通文件用write
+        ssize_t written = send(m_fd, data, size, SEND_FLAGS);
+        if (written < 0 && errno == ENOTSOCK) {
+            written = write(m_fd, data, size);
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (written <= 0) {
+            std::cerr << "Failed to write to fd " << m_fd << std::endl;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+// ---------------- CallbackSink ----------------
+
+CallbackSink::CallbackSink(const Callback& callback)
+    : m_callback(callback)
+{
+}
+
+bool CallbackSink::onInit(const std::string& name, const uint8_t* data, size_t size)
+{
+    return m_callback ? m_callback(name, data, size, true) : true;
+}
+
+bool CallbackSink::onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd)
+{
+    return m_callback ? m_callback(name, data, size, segmentEnd) : true;
+}
+
+bool CallbackSink::onManifest(const std::string& name, const std::string& mpd)
+{
+    return m_callback ? m_callback(name, reinterpret_cast<const uint8_t*>(mpd.data()), mpd.size(), true) : true;
+}
@@ -0,0 +1,175 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * OutputSink - 直播DASH的输出端
+ *
+ * H264MP4Writer在内存中组装分片，每写出一个分段（分块模式下每个块）
+ * 就把一段连续的数据交给所有输出端：初始化分段、媒体数据和MPD。
+ * 数据只在回调期间有效，需要保留的输出端自行复制。回调在写入线程中
+ * 执行，不应阻塞。
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() {}
+
+    /**
+     * 初始化分段（ftyp + moov），每次开始录制时调用
+     *
+     * @param name 文件名，如"init.mp4"
+     * @param data 数据
+     * @param size 数据大小
+     * @return 是否成功
+     */
+    virtual bool onInit(const std::string& name, const uint8_t* data, size_t size) = 0;
+
+    /**
+     * 媒体数据（一个完整分段，或分块模式下分段的一个块）
+     *
+     * @param name 分段文件名，如"segment_3.m4s"
+     * @param data 追加到该分段的数据
+     * @param size 数据大小
+     * @param segmentEnd 是否为分段的最后一段数据
+     * @return 是否成功
+     */
+    virtual bool onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd) = 0;
+
+    /**
+     * MPD已更新
+     *
+     * @param name MPD文件名
+     * @param mpd MPD内容
+     * @return 是否成功
+     */
+    virtual bool onManifest(const std::string& name, const std::string& mpd) = 0;
+
+    /**
+     * 分段移出时移窗口，可以释放
+     *
+     * @param name 分段文件名
+     */
+    virtual void onExpire(const std::string& name) { (void)name; }
+};
+
+/**
+ * FileSink - 写入磁盘目录
+ *
+ * 与之前直接写文件的布局相同：分段先写入<名称>.part，分段结束后改名；
+ * MPD先写临时文件再改名；过期分段删除。
+ */
+class FileSink : public OutputSink {
+public:
+    explicit FileSink(const std::string& dir);
+    ~FileSink();
+
+    bool onInit(const std::string& name, const uint8_t* data, size_t size) override;
+    bool onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd) override;
+    bool onManifest(const std::string& name, const std::string& mpd) override;
+    void onExpire(const std::string& name) override;
+
+private:
+    // 先写临时文件再改名
+    bool writeAtomic(const std::string& name, const char* data, size_t size);
+
+    std::string m_dir;
+    FILE* m_segmentFile;        // 写入中的分段
+    std::string m_segmentName;  // 写入中的分段文件名
+};
+
+/**
+ * MemorySink - 保存在内存中，供DashServer直接读取
+ *
+ * 保留初始化分段、最新的MPD和最近的maxSegments个分段。写入中的分段
+ * 可以边写边读：read在数据不足时等待新的块。
+ */
+class MemorySink : public OutputSink {
+public:
+    /**
+     * @param maxSegments 最多保留的分段数（时移窗口之外的保险），0表示只按onExpire释放
+     */
+    explicit MemorySink(size_t maxSegments = 32);
+
+    bool onInit(const std::string& name, const uint8_t* data, size_t size) override;
+    bool onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd) override;
+    bool onManifest(const std::string& name, const std::string& mpd) override;
+    void onExpire(const std::string& name) override;
+
+    /**
+     * 读取文件内容
+     *
+     * @param name 文件名（初始化分段、MPD或分段）
+     * @param offset 起始偏移
+     * @param out 追加offset之后的数据
+     * @param complete 输出，文件是否已写完
+     * @param waitMs 文件不存在或没有offset之后的新数据时最多等待的时间（毫秒）
+     * @return 文件是否存在
+     */
+    bool read(const std::string& name, size_t offset, std::string& out, bool& complete, uint32_t waitMs);
+
+private:
+    struct File {
+        std::string data;
+        bool complete;
+    };
+
+    size_t m_maxSegments;
+    std::map<std::string, File> m_files;    // 文件名 -> 内容
+    std::deque<std::string> m_segments;     // 分段按写入顺序
+    std::mutex m_mutex;
+    std::condition_variable m_cond;         // 有新数据
+};
+
+/**
+ * FdSink - 写入文件描述符（管道、套接字、标准输出）
+ *
+ * 依次写出初始化分段和媒体数据，得到一个连续的分片MP4流；MPD不写出。
+ * 写入是阻塞的，接收方过慢会拖慢录制。
+ */
+class FdSink : public OutputSink {
+public:
+    // fd由调用方负责关闭
+    explicit FdSink(int fd);
+
+    bool onInit(const std::string& name, const uint8_t* data, size_t size) override;
+    bool onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd) override;
+    bool onManifest(const std::string& name, const std::string& mpd) override;
+
+private:
+    bool writeAll(const uint8_t* data, size_t size);
+
+    int m_fd;
+};
+
+/**
+ * CallbackSink - 调用回调函数
+ *
+ * 初始化分段、媒体数据和MPD都通过同一个回调交出，complete表示该文件
+ * 是否已写完（分块模式下分段的中间块为false）。
+ */
+class CallbackSink : public OutputSink {
+public:
+    typedef std::function<bool(const std::string& name, const uint8_t* data, size_t size, bool complete)> Callback;
+
+    explicit CallbackSink(const Callback& callback);
+
+    bool onInit(const std::string& name, const uint8_t* data, size_t size) override;
+    bool onMedia(const std::string& name, const uint8_t* data, size_t size, bool segmentEnd) override;
+    bool onManifest(const std::string& name, const std::string& mpd) override;
+
+private:
+    Callback m_callback;
+};
+
+#endif // OUTPUT_SINK_H
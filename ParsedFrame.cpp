@@ -0,0 +1,118 @@
+#include "ParsedFrame.h"
+#include "StartCodeScanner.h"
+#include "CodecTraits.h"
+#include <cstring>
+
+ParsedFrame::ParsedFrame()
+    : m_paramSetBytes(0)
+    , m_isKeyFrame(false)
+    , m_isIDR(false)
+    , m_isReference(true)
+    , m_isH265(false)
+    , m_detectedCodec(-1)
+    , m_pts(NO_TIMESTAMP)
+    , m_dts(NO_TIMESTAMP)
+{
+}
+
+bool ParsedFrame::parse(const uint8_t* data, size_t size, bool isKeyFrame, int64_t pts, int64_t dts, int isH265)
+{
+    m_buffer.clear();
+    m_nalus.clear();
+    m_scan.clear();
+    m_paramSetBytes = 0;
+    m_isKeyFrame = isKeyFrame;
+    m_isIDR = false;
+    m_isReference = true;
+    m_detectedCodec = -1;
+    m_pts = pts;
+    m_dts = dts;
+
+    if (!data || size < 4) {
+        return false;
+    }
+
+    // 查找起始码（SIMD实现），只扫描一次
+    const uint8_t* end = data + size;
+    int startCodeLen = 0;
+    const uint8_t* startCode = StartCodeScanner::find(data, end, &startCodeLen);
+    bool hasVPS = false;
+    bool hasH264SPS = false;
+    size_t total = 0;
+    while (startCode != end) {
+        const uint8_t* start = startCode + startCodeLen;
+        uint8_t startLen = static_cast<uint8_t>(startCodeLen);
+        startCode = StartCodeScanner::find(start, end, &startCodeLen);
+
+        // 跳过空NALU
+        if (startCode > start) {
+            NALUnit nalu = { start, static_cast<size_t>(startCode - start), startLen };
+            m_scan.push_back(nalu);
+            hasVPS = hasVPS || H265Traits::isVPS(start[0]);
+            hasH264SPS = hasH264SPS || H264Traits::nalType(start[0]) == H264Traits::SPS;
+            total += nalu.size + 4;
+        }
+    }
+    if (m_scan.empty()) {
+        return false;
+    }
+
+    // 只有H265有VPS；没有VPS时H264的SPS说明是H264
+    m_detectedCodec = hasVPS ? 1 : (hasH264SPS ? 0 : -1);
+
+    // 未指定编码时按VPS判断（只有H265有VPS）
+    m_isH265 = (isH265 >= 0) ? (isH265 != 0) : hasVPS;
+
+    // 按编码选择一次，转换循环内不再判断编码
+    if (m_isH265) {
+        convert<H265Traits>(total);
+    } else {
+        convert<H264Traits>(total);
+    }
+
+    // 编码未确定时不能按H264规则判断参考帧（H265的TRAIL_R会被当成非参考帧）
+    if (isH265 < 0 && m_detectedCodec < 0) {
+        m_isReference = true;
+    }
+
+    return true;
+}
+
+template <typename Traits>
+void ParsedFrame::convert(size_t total)
+{
+    // 参数集在前，其余NALU在后，每个NALU前写4字节大端长度
+    m_buffer.resize(total);
+    uint8_t* ptr = m_buffer.data();
+    bool vclSeen = false;
+    for (int pass = 0; pass < 2; pass++) {
+        for (const auto& nalu : m_scan) {
+            uint8_t header = nalu.data[0];
+            bool paramSet = Traits::isParameterSet(header);
+            if (paramSet != (pass == 0)) {
+                continue;
+            }
+
+            ptr[0] = (nalu.size >> 24) & 0xFF;
+            ptr[1] = (nalu.size >> 16) & 0xFF;
+            ptr[2] = (nalu.size >> 8) & 0xFF;
+            ptr[3] = nalu.size & 0xFF;
+            memcpy(ptr + 4, nalu.data, nalu.size);
+            NALUnit copied = { ptr + 4, nalu.size, 4 };
+            m_nalus.push_back(copied);
+            ptr += nalu.size + 4;
+
+            if (paramSet) {
+                m_paramSetBytes += nalu.size + 4;
+                continue;
+            }
+
+            // 第一个VCL NALU决定IDR和参考帧标志
+            if (!vclSeen && Traits::isVCL(header)) {
+                vclSeen = true;
+                m_isIDR = Traits::isRAP(header);
+                m_isReference = Traits::isReference(header);
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef PARSED_FRAME_H
+#define PARSED_FRAME_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * ParsedFrame - 已解析的视频访问单元
+ *
+ * 一次查找起始码，把Annex-B帧转换为4字节长度前缀格式保存：参数集NALU
+ * 排在前面，其余NALU按原顺序紧随其后，去掉参数集的样本就是缓冲区的
+ * 尾部，封装时不需要再拷贝。同时记录NALU位置、编码类型、IDR和参考帧
+ * 标志。解析完成后只读，以std::shared_ptr<const ParsedFrame>在多个
+ * H264MP4Writer（录像、直播）之间共享。
+ */
+class ParsedFrame {
+public:
+    // 未提供时间戳
+    static const int64_t NO_TIMESTAMP = INT64_MIN;
+
+    // NALU描述，指向帧数据内部，不做拷贝
+    struct NALUnit {
+        const uint8_t* data;   // NALU数据（不含起始码）
+        size_t size;           // NALU长度
+        uint8_t startCodeLen;  // 起始码长度（3或4）
+    };
+
+    ParsedFrame();
+
+    /**
+     * 解析访问单元（缓冲区跨帧复用，容量不足时才会分配）
+     *
+     * @param data 帧数据（包含起始码）
+     * @param size 数据大小
+     * @param isKeyFrame 是否是关键帧
+     * @param pts 显示时间戳（轨道时间，90kHz，NO_TIMESTAMP表示未提供）
+     * @param dts 解码时间戳（轨道时间，90kHz，NO_TIMESTAMP表示未提供）
+     * @param isH265 编码类型（0 H264，1 H265，-1 未确定：按帧中是否有VPS转换，没有参数集时按参考帧处理）
+     * @return 是否解析到NALU
+     */
+    bool parse(const uint8_t* data, size_t size, bool isKeyFrame, int64_t pts, int64_t dts, int isH265);
+
+    // NALU列表（参数集在前，与data()中的顺序一致）
+    const std::vector<NALUnit>& nalus() const { return m_nalus; }
+
+    // 全部NALU（长度前缀格式）
+    const uint8_t* data() const { return m_buffer.data(); }
+    size_t size() const { return m_buffer.size(); }
+
+    // 去掉参数集后的样本数据
+    const uint8_t* sampleData() const { return m_buffer.data() + m_paramSetBytes; }
+    size_t sampleSize() const { return m_buffer.size() - m_paramSetBytes; }
+
+    bool hasParamSets() const { return m_paramSetBytes > 0; }
+    bool hasSliceData() const { return m_buffer.size() > m_paramSetBytes; }
+
+    bool isKeyFrame() const { return m_isKeyFrame; }
+    bool isIDR() const { return m_isIDR; }
+    bool isReference() const { return m_isReference; }
+    bool isH265() const { return m_isH265; }
+
+    // 按帧中的参数集判断的编码类型（1 H265，0 H264，-1 没有可判断的参数集）
+    int detectedCodec() const { return m_detectedCodec; }
+    int64_t pts() const { return m_pts; }
+    int64_t dts() const { return m_dts; }
+
+    // 缓冲区占用的内存（字节）
+    size_t capacity() const { return m_buffer.capacity() + m_nalus.capacity() * sizeof(NALUnit); }
+
+private:
+    // 转换为长度前缀格式并设置帧标志（按编码实例化）
+    template <typename Traits>
+    void convert(size_t total);
+
+    std::vector<uint8_t> m_buffer;      // 长度前缀格式的NALU
+    std::vector<NALUnit> m_nalus;       // 指向m_buffer
+    std::vector<NALUnit> m_scan;        // 解析时指向输入数据
+    size_t m_paramSetBytes;             // 参数集（含长度前缀）字节数
+    bool m_isKeyFrame;
+    bool m_isIDR;
+    bool m_isReference;
+    bool m_isH265;
+    int m_detectedCodec;
+    int64_t m_pts;
+    int64_t m_dts;
+};
+
+#endif // PARSED_FRAME_H
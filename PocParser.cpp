@@ -0,0 +1,407 @@
+#include "PocParser.h"
+#include <gpac/bitstream.h>
+// media_dev.h没有extern "C"声明
+extern "C" {
+#include <gpac/internal/media_dev.h>
+}
+#include <vector>
+#include <cstring>
+
+namespace {
+
+// RBSP位读取器（去除防竞争字节，越界后读到的都是0并置错误标志）
+class RbspReader {
+public:
+    RbspReader(const uint8_t* data, size_t size)
+        : m_pos(0)
+        , m_error(false)
+    {
+        m_data.reserve(size);
+        int zeros = 0;
+        for (size_t i = 0; i < size; i++) {
+            if (zeros >= 2 && data[i] == 0x03) {
+                zeros = 0;
+                continue;
+            }
+            zeros = (data[i] == 0) ? zeros + 1 : 0;
+            m_data.push_back(data[i]);
+        }
+    }
+
+    uint32_t bits(int n)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < n; i++) {
+            value = (value << 1) | bit();
+        }
+        return value;
+    }
+
+    void skip(int n)
+    {
+        m_pos += n;
+        if (m_pos > m_data.size() * 8) {
+            m_error = true;
+        }
+    }
+
+    uint32_t ue()
+    {
+        int leadingZeros = 0;
+        while (bit() == 0) {
+            if (m_error || ++leadingZeros > 31) {
+                m_error = true;
+                return 0;
+            }
+        }
+        return ((1u << leadingZeros) - 1) + bits(leadingZeros);
+    }
+
+    int32_t se()
+    {
+        uint32_t value = ue();
+        return (value & 1) ? static_cast<int32_t>((value + 1) / 2) : -static_cast<int32_t>(value / 2);
+    }
+
+    bool error() const { return m_error; }
+
+private:
+    uint32_t bit()
+    {
+        if (m_pos >= m_data.size() * 8) {
+            m_error = true;
+            return 0;
+        }
+        uint32_t value = (m_data[m_pos / 8] >> (7 - (m_pos % 8))) & 1;
+        m_pos++;
+        return value;
+    }
+
+private:
+    std::vector<uint8_t> m_data;
+    size_t m_pos;
+    bool m_error;
+};
+
+void skipH264ScalingList(RbspReader& reader, int size)
+{
+    int lastScale = 8;
+    int nextScale = 8;
+    for (int i = 0; i < size; i++) {
+        if (nextScale != 0) {
+            nextScale = (lastScale + reader.se() + 256) % 256;
+        }
+        lastScale = (nextScale == 0) ? lastScale : nextScale;
+    }
+}
+
+void skipH264HRD(RbspReader& reader)
+{
+    uint32_t cpbCount = reader.ue() + 1;
+    reader.skip(8); // bit_rate_scale, cpb_size_scale
+    for (uint32_t i = 0; i < cpbCount && !reader.error(); i++) {
+        reader.ue(); // bit_rate_value_minus1
+        reader.ue(); // cpb_size_value_minus1
+        reader.skip(1); // cbr_flag
+    }
+    reader.skip(20); // 4个延迟长度字段
+}
+
+} // namespace
+
+PocParser::PocParser()
+    : m_isH265(false)
+    , m_avcState(nullptr)
+    , m_hevcState(nullptr)
+{
+}
+
+PocParser::~PocParser()
+{
+    if (m_avcState) {
+        gf_free(m_avcState);
+    }
+    if (m_hevcState) {
+        gf_free(m_hevcState);
+    }
+}
+
+void PocParser::reset(bool isH265)
+{
+    m_isH265 = isH265;
+
+    // 解析状态较大（数十KB），只在需要POC时分配
+    if (m_avcState) {
+        memset(m_avcState, 0, sizeof(AVCState));
+        static_cast<AVCState*>(m_avcState)->sps_active_idx = -1;
+    }
+    if (m_hevcState) {
+        memset(m_hevcState, 0, sizeof(HEVCState));
+        static_cast<HEVCState*>(m_hevcState)->sps_active_idx = -1;
+    }
+}
+
+bool PocParser::parse(const uint8_t* nalu, size_t size, int32_t& poc)
+{
+    if (!nalu || size < 2) {
+        return false;
+    }
+
+    if (m_isH265) {
+        if (!m_hevcState) {
+            m_hevcState = gf_malloc(sizeof(HEVCState));
+            if (!m_hevcState) {
+                return false;
+            }
+            memset(m_hevcState, 0, sizeof(HEVCState));
+            static_cast<HEVCState*>(m_hevcState)->sps_active_idx = -1;
+        }
+
+        HEVCState* state = static_cast<HEVCState*>(m_hevcState);
+        u8 naluType = 0, temporalId = 0, layerId = 0;
+        s32 ret = gf_media_hevc_parse_nalu(reinterpret_cast<char*>(const_cast<uint8_t*>(nalu)), static_cast<u32>(size),
+                                           state, &naluType, &temporalId, &layerId);
+        if (ret < 0 || naluType >= 32 || !state->s_info.first_slice_segment_in_pic_flag) {
+            return false;
+        }
+        poc = state->s_info.poc;
+        return true;
+    }
+
+    if (!m_avcState) {
+        m_avcState = gf_malloc(sizeof(AVCState));
+        if (!m_avcState) {
+            return false;
+        }
+        memset(m_avcState, 0, sizeof(AVCState));
+        static_cast<AVCState*>(m_avcState)->sps_active_idx = -1;
+    }
+
+    AVCState* state = static_cast<AVCState*>(m_avcState);
+    uint8_t naluType = nalu[0] & 0x1F;
+    const char* data = reinterpret_cast<const char*>(nalu);
+    if (naluType == 7) {
+        gf_media_avc_read_sps(data, static_cast<u32>(size), state, 0, NULL);
+        return false;
+    }
+    if (naluType == 8) {
+        gf_media_avc_read_pps(data, static_cast<u32>(size), state);
+        return false;
+    }
+    if (naluType != 1 && naluType != 5) {
+        return false;
+    }
+
+    GF_BitStream* bs = gf_bs_new(data, size, GF_BITSTREAM_READ);
+    if (!bs) {
+        return false;
+    }
+    u32 header = gf_bs_read_u8(bs);
+    s32 ret = gf_media_avc_parse_nalu(bs, header, state);
+    gf_bs_del(bs);
+
+    // 返回1表示新图像的第一个slice
+    if (ret != 1) {
+        return false;
+    }
+    poc = state->s_info.poc;
+    return true;
+}
+
+bool PocParser::readReorderDepth(bool isH265, const uint8_t* sps, size_t size, uint32_t& depth)
+{
+    if (!sps || size < 4) {
+        return false;
+    }
+
+    return isH265 ? readH265ReorderDepth(sps, size, depth) : readH264ReorderDepth(sps, size, depth);
+}
+
+bool PocParser::readH264ReorderDepth(const uint8_t* sps, size_t size, uint32_t& depth)
+{
+    RbspReader reader(sps + 1, size - 1);
+
+    uint32_t profileIdc = reader.bits(8);
+    uint32_t constraintFlags = reader.bits(8);
+    reader.skip(8); // level_idc
+    reader.ue(); // seq_parameter_set_id
+
+    // Baseline及帧内档次没有B帧
+    bool intraOnly = (constraintFlags & 0x10) &&
+        (profileIdc == 44 || profileIdc == 86 || profileIdc == 100 || profileIdc == 110 ||
+         profileIdc == 122 || profileIdc == 244);
+    if (profileIdc == 66 || intraOnly) {
+        depth = 0;
+        return true;
+    }
+
+    if (profileIdc == 100 || profileIdc == 110 || profileIdc == 122 || profileIdc == 244 ||
+        profileIdc == 44 || profileIdc == 83 || profileIdc == 86 || profileIdc == 118 ||
+        profileIdc == 128 || profileIdc == 138 || profileIdc == 139 || profileIdc == 134 ||
+        profileIdc == 135) {
+        uint32_t chromaFormatIdc = reader.ue();
+        if (chromaFormatIdc == 3) {
+            reader.skip(1); // separate_colour_plane_flag
+        }
+        reader.ue(); // bit_depth_luma_minus8
+        reader.ue(); // bit_depth_chroma_minus8
+        reader.skip(1); // qpprime_y_zero_transform_bypass_flag
+        if (reader.bits(1)) { // seq_scaling_matrix_present_flag
+            int count = (chromaFormatIdc != 3) ? 8 : 12;
+            for (int i = 0; i < count; i++) {
+                if (reader.bits(1)) {
+                    skipH264ScalingList(reader, i < 6 ? 16 : 64);
+                }
+            }
+        }
+    }
+
+    reader.ue(); // log2_max_frame_num_minus4
+    uint32_t pocType = reader.ue();
+    if (pocType == 0) {
+        reader.ue(); // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pocType == 1) {
+        reader.skip(1); // delta_pic_order_always_zero_flag
+        reader.se(); // offset_for_non_ref_pic
+        reader.se(); // offset_for_top_to_bottom_field
+        uint32_t cycle = reader.ue();
+        for (uint32_t i = 0; i < cycle && !reader.error(); i++) {
+            reader.se();
+        }
+    }
+
+    // POC类型2时显示顺序与解码顺序相同
+    if (pocType == 2) {
+        depth = 0;
+        return !reader.error();
+    }
+
+    reader.ue(); // max_num_ref_frames
+    reader.skip(1); // gaps_in_frame_num_value_allowed_flag
+    reader.ue(); // pic_width_in_mbs_minus1
+    reader.ue(); // pic_height_in_map_units_minus1
+    if (!reader.bits(1)) { // frame_mbs_only_flag
+        reader.skip(1); // mb_adaptive_frame_field_flag
+    }
+    reader.skip(1); // direct_8x8_inference_flag
+    if (reader.bits(1)) { // frame_cropping_flag
+        reader.ue();
+        reader.ue();
+        reader.ue();
+        reader.ue();
+    }
+
+    if (!reader.bits(1)) { // vui_parameters_present_flag
+        return false;
+    }
+
+    if (reader.bits(1)) { // aspect_ratio_info_present_flag
+        if (reader.bits(8) == 255) {
+            reader.skip(32); // sar_width, sar_height
+        }
+    }
+    if (reader.bits(1)) { // overscan_info_present_flag
+        reader.skip(1);
+    }
+    if (reader.bits(1)) { // video_signal_type_present_flag
+        reader.skip(4);
+        if (reader.bits(1)) { // colour_description_present_flag
+            reader.skip(24);
+        }
+    }
+    if (reader.bits(1)) { // chroma_loc_info_present_flag
+        reader.ue();
+        reader.ue();
+    }
+    if (reader.bits(1)) { // timing_info_present_flag
+        reader.skip(65);
+    }
+    bool nalHrd = reader.bits(1) != 0;
+    if (nalHrd) {
+        skipH264HRD(reader);
+    }
+    bool vclHrd = reader.bits(1) != 0;
+    if (vclHrd) {
+        skipH264HRD(reader);
+    }
+    if (nalHrd || vclHrd) {
+        reader.skip(1); // low_delay_hrd_flag
+    }
+    reader.skip(1); // pic_struct_present_flag
+
+    if (!reader.bits(1)) { // bitstream_restriction_flag
+        return false;
+    }
+    reader.skip(1); // motion_vectors_over_pic_boundaries_flag
+    reader.ue(); // max_bytes_per_pic_denom
+    reader.ue(); // max_bits_per_mb_denom
+    reader.ue(); // log2_max_mv_length_horizontal
+    reader.ue(); // log2_max_mv_length_vertical
+    uint32_t reorder = reader.ue(); // max_num_reorder_frames
+    if (reader.error()) {
+        return false;
+    }
+
+    depth = reorder;
+    return true;
+}
+
+bool PocParser::readH265ReorderDepth(const uint8_t* sps, size_t size, uint32_t& depth)
+{
+    RbspReader reader(sps + 2, size - 2);
+
+    reader.skip(4); // sps_video_parameter_set_id
+    uint32_t maxSubLayersMinus1 = reader.bits(3);
+    reader.skip(1); // sps_temporal_id_nesting_flag
+
+    // profile_tier_level
+    reader.skip(96); // general profile(88) + general_level_idc(8)
+    bool subLayerProfilePresent[8] = { false };
+    bool subLayerLevelPresent[8] = { false };
+    for (uint32_t i = 0; i < maxSubLayersMinus1; i++) {
+        subLayerProfilePresent[i] = reader.bits(1) != 0;
+        subLayerLevelPresent[i] = reader.bits(1) != 0;
+    }
+    if (maxSubLayersMinus1 > 0) {
+        reader.skip(2 * (8 - maxSubLayersMinus1));
+    }
+    for (uint32_t i = 0; i < maxSubLayersMinus1; i++) {
+        if (subLayerProfilePresent[i]) {
+            reader.skip(88);
+        }
+        if (subLayerLevelPresent[i]) {
+            reader.skip(8);
+        }
+    }
+
+    reader.ue(); // sps_seq_parameter_set_id
+    if (reader.ue() == 3) { // chroma_format_idc
+        reader.skip(1); // separate_colour_plane_flag
+    }
+    reader.ue(); // pic_width_in_luma_samples
+    reader.ue(); // pic_height_in_luma_samples
+    if (reader.bits(1)) { // conformance_window_flag
+        reader.ue();
+        reader.ue();
+        reader.ue();
+        reader.ue();
+    }
+    reader.ue(); // bit_depth_luma_minus8
+    reader.ue(); // bit_depth_chroma_minus8
+    reader.ue(); // log2_max_pic_order_cnt_lsb_minus4
+
+    // 取最高子层的sps_max_num_reorder_pics
+    bool orderingInfoPresent = reader.bits(1) != 0;
+    uint32_t reorder = 0;
+    for (uint32_t i = orderingInfoPresent ? 0 : maxSubLayersMinus1; i <= maxSubLayersMinus1; i++) {
+        reader.ue(); // sps_max_dec_pic_buffering_minus1
+        reorder = reader.ue(); // sps_max_num_reorder_pics
+        reader.ue(); // sps_max_latency_increase_plus1
+    }
+    if (reader.error()) {
+        return false;
+    }
+
+    depth = reorder;
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef POC_PARSER_H
+#define POC_PARSER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * PocParser - 解析图像顺序号（POC）和重排序深度
+ *
+ * 调用方只提供显示时间戳或不提供时间戳时，用POC确定显示顺序；
+ * 重排序深度从SPS的VUI（H264 max_num_reorder_frames）或
+ * sps_max_num_reorder_pics（H265）读取。
+ */
+class PocParser {
+public:
+    PocParser();
+    ~PocParser();
+
+    /**
+     * 重新开始解析（切换编码类型或重新录制时调用）
+     *
+     * @param isH265 是否为H265
+     */
+    void reset(bool isH265);
+
+    /**
+     * 解析一个NALU（参数集更新内部状态，图像第一个slice计算POC）
+     *
+     * @param nalu NALU数据（不含起始码）
+     * @param size NALU长度
+     * @param poc 输出POC
+     * @return 是否为图像的第一个slice且已得到POC
+     */
+    bool parse(const uint8_t* nalu, size_t size, int32_t& poc);
+
+    /**
+     * 从SPS读取重排序深度
+     *
+     * @param isH265 是否为H265
+     * @param sps SPS数据（不含起始码）
+     * @param size SPS长度
+     * @param depth 输出最大重排序帧数
+     * @return SPS中是否声明了重排序深度（未声明时depth无效）
+     */
+    static bool readReorderDepth(bool isH265, const uint8_t* sps, size_t size, uint32_t& depth);
+
+private:
+    static bool readH264ReorderDepth(const uint8_t* sps, size_t size, uint32_t& depth);
+    static bool readH265ReorderDepth(const uint8_t* sps, size_t size, uint32_t& depth);
+
+    // 禁止拷贝（持有GPAC解析状态）
+    PocParser(const PocParser&);
+    PocParser& operator=(const PocParser&);
+
+private:
+    bool m_isH265;
+    void* m_avcState;     // AVCState，按需分配
+    void* m_hevcState;    // HEVCState，按需分配
+};
+
+#endif // POC_PARSER_H
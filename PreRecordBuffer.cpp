@@ -0,0 +1,145 @@
+#include "PreRecordBuffer.h"
+#include <chrono>
+#include <cstring>
+
+PreRecordBuffer::PreRecordBuffer(size_t capacityBytes, uint32_t durationMs, uint32_t timescale)
+    : m_ring(capacityBytes)
+    , m_durationMs(durationMs)
+    , m_timescale(timescale ? timescale : 1000)
+    , m_usedBytes(0)
+    , m_framesEvicted(0)
+    , m_framesRejected(0)
+    , m_framesFlushed(0)
+{
+}
+
+bool PreRecordBuffer::push(const uint8_t* data, size_t size, bool isKeyFrame, int64_t pts, int64_t dts)
+{
+    if (!data || size == 0) {
+        return false;
+    }
+
+    // 单帧超过环大小时当前GOP已不完整，丢弃全部缓冲等待下一个关键帧
+    if (size > m_ring.size()) {
+        m_framesRejected++;
+        clear();
+        return false;
+    }
+
+    // 空间不足时整GOP淘汰
+    size_t offset = 0;
+    while (!findSpace(size, offset)) {
+        evictFrontGOP();
+    }
+
+    // 缓冲区必须以关键帧开始（包括当前GOP的开头被淘汰的情况）
+    if (m_slots.empty() && !isKeyFrame) {
+        m_framesRejected++;
+        return false;
+    }
+
+    int64_t timeMs;
+    if (pts >= 0) {
+        timeMs = pts / m_timescale * 1000 + (pts % m_timescale) * 1000 / m_timescale;
+    } else {
+        timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    memcpy(&m_ring[offset], data, size);
+    Slot slot = { offset, size, isKeyFrame, pts, dts, timeMs };
+    m_slots.push_back(slot);
+    m_usedBytes += size;
+    if (isKeyFrame) {
+        m_gopStarts.push_back(timeMs);
+    }
+
+    // 去掉第一个GOP后仍满足保留时长时淘汰第一个GOP
+    while (m_gopStarts.size() >= 2 && timeMs - m_gopStarts[1] >= static_cast<int64_t>(m_durationMs)) {
+        evictFrontGOP();
+    }
+
+    return true;
+}
+
+bool PreRecordBuffer::findSpace(size_t size, size_t& offset) const
+{
+    if (m_slots.empty()) {
+        offset = 0;
+        return size <= m_ring.size();
+    }
+
+    size_t readPos = m_slots.front().offset;
+    size_t writePos = m_slots.back().offset + m_slots.back().size;
+
+    if (m_slots.back().offset >= readPos) {
+        // 未回绕：先用尾部空间，不够时回到环开头
+        if (m_ring.size() - writePos >= size) {
+            offset = writePos;
+            return true;
+        }
+        if (readPos >= size) {
+            offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // 已回绕：只能使用写位置到读位置之间的空间
+    if (readPos - writePos >= size) {
+        offset = writePos;
+        return true;
+    }
+    return false;
+}
+
+void PreRecordBuffer::evictFrontGOP()
+{
+    if (m_slots.empty()) {
+        return;
+    }
+
+    // 弹出第一帧（关键帧）及其后所有非关键帧
+    do {
+        m_usedBytes -= m_slots.front().size;
+        m_slots.pop_front();
+        m_framesEvicted++;
+    } while (!m_slots.empty() && !m_slots.front().isKeyFrame);
+
+    m_gopStarts.pop_front();
+}
+
+size_t PreRecordBuffer::drain(const std::function<void(const Frame&)>& handler)
+{
+    size_t count = m_slots.size();
+    for (const auto& slot : m_slots) {
+        Frame frame = { &m_ring[slot.offset], slot.size, slot.isKeyFrame, slot.pts, slot.dts };
+        handler(frame);
+    }
+    m_framesFlushed += count;
+    clear();
+
+    return count;
+}
+
+void PreRecordBuffer::clear()
+{
+    m_slots.clear();
+    m_gopStarts.clear();
+    m_usedBytes = 0;
+}
+
+PreRecordBuffer::Stats PreRecordBuffer::stats() const
+{
+    Stats stats;
+    stats.capacityBytes = m_ring.size();
+    stats.usedBytes = m_usedBytes;
+    stats.frames = m_slots.size();
+    stats.gops = m_gopStarts.size();
+    stats.durationMs = m_slots.empty() ? 0 : static_cast<uint32_t>(m_slots.back().timeMs - m_slots.front().timeMs);
+    stats.framesEvicted = m_framesEvicted;
+    stats.framesRejected = m_framesRejected;
+    stats.framesFlushed = m_framesFlushed;
+
+    return stats;
+}
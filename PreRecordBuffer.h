@@ -0,0 +1,103 @@
+#ifndef PRE_RECORD_BUFFER_H
+#define PRE_RECORD_BUFFER_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * PreRecordBuffer - 预录像GOP环形缓冲区
+ *
+ * 在固定大小的字节环中保存最近N秒的完整GOP，用于告警/移动侦测触发录像时
+ * 补录触发前的画面。缓冲区总是以关键帧开始，超出时长或空间不足时从头部
+ * 整GOP淘汰，内存占用在构造时确定且不再增长（帧描述队列除外）。
+ */
+class PreRecordBuffer {
+public:
+    // 缓冲的一帧（data指向环内部）
+    struct Frame {
+        const uint8_t* data;
+        size_t size;
+        bool isKeyFrame;
+        int64_t pts;            // 显示时间戳（负数表示未提供）
+        int64_t dts;            // 解码时间戳（负数表示未提供）
+    };
+
+    // 缓冲区统计信息
+    struct Stats {
+        size_t capacityBytes;   // 环大小（固定分配）
+        size_t usedBytes;       // 已缓冲帧数据字节数
+        size_t frames;          // 已缓冲帧数
+        size_t gops;            // 已缓冲GOP数
+        uint32_t durationMs;    // 已缓冲时长（毫秒）
+        uint64_t framesEvicted; // 被淘汰的帧数
+        uint64_t framesRejected;// 未能缓冲的帧数（等待关键帧或单GOP超过环大小）
+        uint64_t framesFlushed; // 触发录像时取出写入的帧数
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param capacityBytes 环大小（字节）
+     * @param durationMs 保留时长（毫秒）
+     * @param timescale 时间戳的时间单位（每秒刻度数）
+     */
+    PreRecordBuffer(size_t capacityBytes, uint32_t durationMs, uint32_t timescale = 1000);
+
+    /**
+     * 缓冲一帧
+     *
+     * @param data 帧数据
+     * @param size 数据大小
+     * @param isKeyFrame 是否是关键帧
+     * @param pts 显示时间戳（负数表示未提供，按到达时间计算时长）
+     * @param dts 解码时间戳（负数表示未提供）
+     * @return 是否已缓冲
+     */
+    bool push(const uint8_t* data, size_t size, bool isKeyFrame, int64_t pts, int64_t dts);
+
+    /**
+     * 按顺序取出所有缓冲帧并清空缓冲区
+     *
+     * @param handler 每帧的处理函数
+     * @return 取出的帧数
+     */
+    size_t drain(const std::function<void(const Frame&)>& handler);
+
+    // 清空缓冲区
+    void clear();
+
+    // 统计信息
+    Stats stats() const;
+
+private:
+    struct Slot {
+        size_t offset;      // 在环中的位置
+        size_t size;
+        bool isKeyFrame;
+        int64_t pts;
+        int64_t dts;
+        int64_t timeMs;     // 计算时长用的时间（调用方时间戳或到达时间）
+    };
+
+    // 为size字节找到连续空间，没有时返回false
+    bool findSpace(size_t size, size_t& offset) const;
+
+    // 从头部淘汰一个完整GOP
+    void evictFrontGOP();
+
+private:
+    std::vector<uint8_t> m_ring;
+    uint32_t m_durationMs;
+    uint32_t m_timescale;
+    std::deque<Slot> m_slots;
+    std::deque<int64_t> m_gopStarts;    // 每个GOP第一帧的timeMs
+    size_t m_usedBytes;
+    uint64_t m_framesEvicted;
+    uint64_t m_framesRejected;
+    uint64_t m_framesFlushed;
+};
+
+#endif // PRE_RECORD_BUFFER_H
@@ -0,0 +1,249 @@
+#include "RecorderManager.h"
+#include <iostream>
+
+namespace {
+// 每次调度最多处理的帧数，处理完后重新排队，保证各通道公平
+const size_t MAX_FRAMES_PER_DRAIN = 8;
+}
+
+RecorderManager::RecorderManager(size_t threadCount)
+    : m_pool(threadCount, WorkerPool::ORDER_FIFO)
+{
+}
+
+RecorderManager::~RecorderManager()
+{
+    std::vector<int> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        for (const auto& item : m_channels) {
+            ids.push_back(item.first);
+        }
+    }
+
+    for (int id : ids) {
+        removeChannel(id);
+    }
+}
+
+bool RecorderManager::addChannel(int channelId, const ChannelConfig& config)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        if (m_channels.find(channelId) != m_channels.end()) {
+            std::cerr << "Channel already exists: " << channelId << std::endl;
+            return false;
+        }
+    }
+
+    std::shared_ptr<Channel> channel(new Channel());
+    channel->id = channelId;
+    channel->config = config;
+
+    // 待写入帧数 + 正在写入的一帧 + 调用方正在读入的一帧
+    channel->framePool.reset(new FramePool(FramePool::forStream(config.maxFrameSize, config.maxPendingFrames + 2)));
+
+    if (!channel->writer.init(config.width, config.height, config.frameRate, config.isH265)) {
+        std::cerr << "Failed to initialize writer for channel " << channelId << std::endl;
+        return false;
+    }
+
+    if (!channel->writer.setRotationPolicy(config.rotation)) {
+        return false;
+    }
+
+    // 每个通道使用独立的子目录，避免同一秒开始录制的文件重名
+    std::string outputDir = config.outputDir + "/ch" + std::to_string(channelId);
+    if (!channel->writer.startRecording(outputDir)) {
+        std::cerr << "Failed to start recording for channel " << channelId << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    if (m_channels.find(channelId) != m_channels.end()) {
+        // 并发添加了同一通道
+        channel->writer.stopRecording();
+        return false;
+    }
+    m_channels[channelId] = channel;
+
+    return true;
+}
+
+bool RecorderManager::removeChannel(int channelId)
+{
+    std::shared_ptr<Channel> channel;
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        auto it = m_channels.find(channelId);
+        if (it == m_channels.end()) {
+            return false;
+        }
+        channel = it->second;
+        m_channels.erase(it);
+    }
+
+    // 通道已不可见，不会再有新帧提交；等待已提交的帧写完
+    {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+        channel->idleCond.wait(lock, [&channel] { return !channel->scheduled && channel->pending.empty(); });
+    }
+
+    channel->writer.stopRecording();
+
+    return true;
+}
+
+bool RecorderManager::submitFrame(int channelId, const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp)
+{
+    if (!frameData || frameSize == 0) {
+        return false;
+    }
+
+    std::shared_ptr<Channel> channel = findChannel(channelId);
+    if (!channel) {
+        return false;
+    }
+
+    return pushFrame(channel, FrameBuffer(), frameData, frameSize, isKeyFrame, timestamp);
+}
+
+bool RecorderManager::submitFrame(int channelId, const FrameBuffer& frame, bool isKeyFrame, int64_t timestamp)
+{
+    if (!frame || frame.size() == 0) {
+        return false;
+    }
+
+    std::shared_ptr<Channel> channel = findChannel(channelId);
+    if (!channel) {
+        return false;
+    }
+
+    return pushFrame(channel, frame, frame.data(), frame.size(), isKeyFrame, timestamp);
+}
+
+bool RecorderManager::pushFrame(const std::shared_ptr<Channel>& channel, const FrameBuffer& frame,
+                                const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp)
+{
+    bool needSchedule = false;
+    {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+
+        // 积压过多时丢帧直到下一个IDR，保证写入的码流可解码
+        if (channel->pending.size() >= channel->config.maxPendingFrames) {
+            channel->dropUntilIDR = true;
+        }
+        if (channel->dropUntilIDR) {
+            if (!isKeyFrame || channel->pending.size() >= channel->config.maxPendingFrames) {
+                channel->framesDropped++;
+                return true;
+            }
+            channel->dropUntilIDR = false;
+        }
+
+        // 池中的缓冲区只保存引用，其余拷贝到通道的帧缓冲池；写入后归还到池中
+        PendingFrame pending;
+        pending.data = frame ? frame : channel->framePool->copy(frameData, frameSize);
+        if (!pending.data) {
+            channel->dropUntilIDR = true;
+            channel->framesDropped++;
+            return true;
+        }
+        pending.isKeyFrame = isKeyFrame;
+        pending.timestamp = timestamp;
+        channel->pending.push_back(std::move(pending));
+
+        if (!channel->scheduled) {
+            channel->scheduled = true;
+            needSchedule = true;
+        }
+    }
+
+    if (needSchedule) {
+        m_pool.submit([this, channel] { drainChannel(channel); });
+    }
+
+    return true;
+}
+
+FrameBuffer RecorderManager::allocateFrame(int channelId, size_t size)
+{
+    std::shared_ptr<Channel> channel = findChannel(channelId);
+    if (!channel || size == 0) {
+        return FrameBuffer();
+    }
+
+    return channel->framePool->allocate(size);
+}
+
+std::shared_ptr<RecorderManager::Channel> RecorderManager::findChannel(int channelId)
+{
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    auto it = m_channels.find(channelId);
+    if (it == m_channels.end()) {
+        return std::shared_ptr<Channel>();
+    }
+    return it->second;
+}
+
+void RecorderManager::drainChannel(const std::shared_ptr<Channel>& channel)
+{
+    // scheduled标志保证同一通道同一时刻只有一个线程在这里执行
+    for (size_t n = 0; n < MAX_FRAMES_PER_DRAIN; n++) {
+        PendingFrame frame;
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            if (channel->pending.empty()) {
+                break;
+            }
+            frame = std::move(channel->pending.front());
+            channel->pending.pop_front();
+        }
+
+        if (!channel->writer.writeFrameBuffer(frame.data, frame.isKeyFrame, frame.timestamp)) {
+            std::cerr << "Failed to write frame for channel " << channel->id << std::endl;
+        }
+        frame.data.reset();
+
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        channel->framesWritten++;
+    }
+
+    bool reschedule = false;
+    {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        if (channel->pending.empty()) {
+            channel->scheduled = false;
+            channel->idleCond.notify_all();
+        } else {
+            reschedule = true;
+        }
+    }
+
+    if (reschedule) {
+        m_pool.submit([this, channel] { drainChannel(channel); });
+    }
+}
+
+bool RecorderManager::getChannelStats(int channelId, ChannelStats& stats)
+{
+    std::shared_ptr<Channel> channel = findChannel(channelId);
+    if (!channel) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    stats.framesWritten = channel->framesWritten;
+    stats.framesDropped = channel->framesDropped;
+    stats.pendingFrames = channel->pending.size();
+    stats.currentFile = channel->writer.getCurrentFilePath();
+    stats.bufferPool = channel->framePool->stats();
+
+    return true;
+}
+
+size_t RecorderManager::channelCount()
+{
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    return m_channels.size();
+}
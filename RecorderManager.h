@@ -0,0 +1,170 @@
+#ifndef RECORDER_MANAGER_H
+#define RECORDER_MANAGER_H
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+#include "H264MP4Writer.h"
+#include "WorkerPool.h"
+#include "FramePool.h"
+
+/**
+ * RecorderManager - 多通道录像管理
+ *
+ * 按通道号管理多个H264MP4Writer，所有通道的解析/封装工作在一个
+ * 固定大小的工作窃取线程池中执行。同一通道的帧严格按提交顺序写入，
+ * 且同一时刻只有一个线程在处理该通道。通道可以在运行时增删。
+ *
+ * 每个通道有独立的帧缓冲池，大小由单帧上限和待写入帧数决定，
+ * 提交的帧在池中排队直到写入，每个通道占用的内存可以预先确定。
+ */
+class RecorderManager {
+public:
+    // 通道配置
+    struct ChannelConfig {
+        int width;                  // 视频宽度
+        int height;                 // 视频高度
+        float frameRate;            // 帧率
+        int isH265;                 // 是否为H265编码（-1表示自动检测）
+        std::string outputDir;      // 输出目录
+        size_t maxPendingFrames;    // 通道待写入帧数上限，超出后丢帧直到下一个IDR
+        size_t maxFrameSize;        // 单帧最大长度，决定通道帧缓冲池的大小（超出时从堆上分配）
+        H264MP4Writer::RotationPolicy rotation; // 文件切换策略
+
+        ChannelConfig()
+            : width(1920), height(1080), frameRate(25.0f), isH265(-1)
+            , outputDir("./videos"), maxPendingFrames(64), maxFrameSize(512 * 1024) {}
+    };
+
+    // 通道统计信息
+    struct ChannelStats {
+        uint64_t framesWritten;     // 已写入帧数
+        uint64_t framesDropped;     // 丢弃帧数
+        size_t pendingFrames;       // 待写入帧数
+        std::string currentFile;    // 当前录像文件
+        FramePool::Stats bufferPool; // 帧缓冲池统计（各等级高水位等）
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param threadCount 线程池线程数（0表示使用CPU核数）
+     */
+    explicit RecorderManager(size_t threadCount = 0);
+    ~RecorderManager();
+
+    /**
+     * 添加通道并开始录制
+     *
+     * @param channelId 通道号
+     * @param config 通道配置
+     * @return 是否添加成功
+     */
+    bool addChannel(int channelId, const ChannelConfig& config);
+
+    /**
+     * 移除通道（写完已提交的帧后停止录制）
+     *
+     * @param channelId 通道号
+     * @return 是否移除成功
+     */
+    bool removeChannel(int channelId);
+
+    /**
+     * 提交一帧数据（拷贝后立即返回，在线程池中按顺序写入）
+     *
+     * @param channelId 通道号
+     * @param frameData 帧数据（包含起始码）
+     * @param frameSize 数据大小
+     * @param isKeyFrame 是否是关键帧
+     * @param timestamp 时间戳（毫秒，可选）
+     * @return 是否提交成功（通道不存在时返回false）
+     */
+    bool submitFrame(int channelId, const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp = -1);
+
+    /**
+     * 提交池中的帧缓冲区（不拷贝，写入完成后释放引用）
+     *
+     * @param channelId 通道号
+     * @param frame 帧数据（包含起始码），提交后不能再修改
+     * @param isKeyFrame 是否是关键帧
+     * @param timestamp 时间戳（毫秒，可选）
+     * @return 是否提交成功（通道不存在时返回false）
+     */
+    bool submitFrame(int channelId, const FrameBuffer& frame, bool isKeyFrame, int64_t timestamp = -1);
+
+    /**
+     * 从通道的帧缓冲池分配缓冲区，调用方直接读入帧数据后用submitFrame提交，
+     * 也可以同时交给其他环节（如网络转发）共享。缓冲区必须在移除通道前释放。
+     *
+     * @param channelId 通道号
+     * @param size 帧长度
+     * @return 缓冲区（通道不存在或分配失败时为空）
+     */
+    FrameBuffer allocateFrame(int channelId, size_t size);
+
+    /**
+     * 获取通道统计信息
+     *
+     * @param channelId 通道号
+     * @param stats 输出统计信息
+     * @return 通道是否存在
+     */
+    bool getChannelStats(int channelId, ChannelStats& stats);
+
+    // 当前通道数
+    size_t channelCount();
+
+    // 线程池线程数
+    size_t threadCount() const { return m_pool.threadCount(); }
+
+private:
+    // 待写入帧
+    struct PendingFrame {
+        FrameBuffer data;
+        bool isKeyFrame;
+        int64_t timestamp;
+    };
+
+    // 通道
+    struct Channel {
+        int id;
+        ChannelConfig config;
+        std::unique_ptr<FramePool> framePool; // 帧缓冲池（在writer之后销毁）
+        H264MP4Writer writer;
+
+        std::mutex mutex;                   // 保护以下成员
+        std::condition_variable idleCond;   // 通道处理完所有帧
+        std::deque<PendingFrame> pending;   // 待写入帧
+        bool scheduled;                     // 是否已在线程池中排队/执行
+        bool dropUntilIDR;                  // 是否丢帧直到下一个IDR
+        uint64_t framesWritten;
+        uint64_t framesDropped;
+
+        Channel() : id(0), scheduled(false), dropUntilIDR(false), framesWritten(0), framesDropped(0) {}
+    };
+
+    // 查找通道
+    std::shared_ptr<Channel> findChannel(int channelId);
+
+    // 按积压情况丢帧或加入待写入队列（frame为空时从frameData拷贝到通道的帧缓冲池）
+    bool pushFrame(const std::shared_ptr<Channel>& channel, const FrameBuffer& frame,
+                   const uint8_t* frameData, size_t frameSize, bool isKeyFrame, int64_t timestamp);
+
+    // 在线程池中处理通道的待写入帧
+    void drainChannel(const std::shared_ptr<Channel>& channel);
+
+private:
+    WorkerPool m_pool;      // 先进先出：通道重新排队后排在已等待的通道之后
+    std::map<int, std::shared_ptr<Channel>> m_channels;
+    std::mutex m_channelsMutex;
+};
+
+#endif // RECORDER_MANAGER_H
@@ -0,0 +1,241 @@
+#include "SegmentCache.h"
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// 读取的文件不被子进程继承
+#ifdef O_CLOEXEC
+const int OPEN_FLAGS = O_RDONLY | O_CLOEXEC;
+#elif defined(_O_BINARY)
+const int OPEN_FLAGS = O_RDONLY | _O_BINARY;
+#else
+const int OPEN_FLAGS = O_RDONLY;
+#endif
+
+// 修改时间（纳秒，平台不支持时精确到秒）
+int64_t modifiedTimeNs(const struct stat& st)
+{
+#if defined(__linux__)
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtime) * 1000000000;
+#endif
+}
+}
+
+double SegmentCache::Stats::hitRatio() const
+{
+    uint64_t total = hits + misses + coalesced;
+    return total > 0 ? static_cast<double>(hits + coalesced) / total : 0.0;
+}
+
+SegmentCache::SegmentCache(const Config& config)
+    : m_config(config)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_coalesced(0)
+    , m_evictions(0)
+    , m_invalidations(0)
+    , m_bytesSaved(0)
+{
+}
+
+void SegmentCache::fetch(const std::string& stream, const std::string& path, const Callback& callback)
+{
+    struct stat st;
+    bool exists = stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+
+    Identity identity;
+    identity.device = exists ? static_cast<uint64_t>(st.st_dev) : 0;
+    identity.inode = exists ? static_cast<uint64_t>(st.st_ino) : 0;
+    identity.size = exists ? static_cast<uint64_t>(st.st_size) : 0;
+    identity.mtimeNs = exists ? modifiedTimeNs(st) : 0;
+
+    std::shared_ptr<Load> load;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // 命中：文件未改变时直接使用缓存的内容
+        auto it = m_index.find(path);
+        if (it != m_index.end()) {
+            if (exists && it->second->identity == identity) {
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                Buffer data = it->second->data;
+                m_hits++;
+                m_bytesSaved += data->size();
+                lock.unlock();
+                callback(data);
+                return;
+            }
+            remove(it->second);
+            m_invalidations++;
+        }
+
+        // 文件不存在或超过上限：不缓存，由调用方处理
+        size_t limit = std::min(m_config.maxEntrySize, std::min(m_config.streamQuota, m_config.capacity));
+        if (!exists || identity.size > limit) {
+            lock.unlock();
+            callback(Buffer());
+            return;
+        }
+
+        // 同一文件正在读取：等它读完
+        auto loading = m_loading.find(path);
+        if (loading != m_loading.end() && loading->second->identity == identity) {
+            loading->second->waiters.push_back(callback);
+            m_coalesced++;
+            return;
+        }
+
+        // 本请求读盘（正在读取的是旧版本时由新版本取代，旧版本读完后不加入缓存）
+        load = std::make_shared<Load>();
+        load->identity = identity;
+        m_loading[path] = load;
+        m_misses++;
+    }
+
+    Identity actual = identity;
+    Buffer data = readFile(path, actual);
+
+    std::vector<Callback> waiters;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto loading = m_loading.find(path);
+        bool current = loading != m_loading.end() && loading->second == load;
+        if (current) {
+            m_loading.erase(loading);
+        }
+        if (current && data && data->size() <= m_config.maxEntrySize) {
+            insert(stream, path, actual, data);
+        }
+        waiters.swap(load->waiters);
+        if (data) {
+            m_bytesSaved += data->size() * waiters.size();
+        }
+    }
+
+    callback(data);
+    for (auto& waiter : waiters) {
+        waiter(data);
+    }
+}
+
+SegmentCache::Stats SegmentCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.coalesced = m_coalesced;
+    stats.evictions = m_evictions;
+    stats.invalidations = m_invalidations;
+    stats.bytesSaved = m_bytesSaved;
+    stats.bytes = m_bytes;
+    stats.entries = m_lru.size();
+    return stats;
+}
+
+SegmentCache::Buffer SegmentCache::readFile(const std::string& path, Identity& identity)
+{
+    int fd = open(path.c_str(), OPEN_FLAGS);
+    if (fd < 0) {
+        return Buffer();
+    }
+
+    // 以打开的文件为准（stat之后可能已被替换）
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return Buffer();
+    }
+    identity.device = static_cast<uint64_t>(st.st_dev);
+    identity.inode = static_cast<uint64_t>(st.st_ino);
+    identity.size = static_cast<uint64_t>(st.st_size);
+    identity.mtimeNs = modifiedTimeNs(st);
+
+    std::string content(static_cast<size_t>(st.st_size), '\0');
+    size_t total = 0;
+    while (total < content.size()) {
+        auto bytes = read(fd, &content[total], static_cast<unsigned int>(std::min<size_t>(content.size() - total, 1 << 30)));
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        total += static_cast<size_t>(bytes);
+    }
+    close(fd);
+
+    // 读取期间被截断：不使用不完整的内容
+    if (total != content.size()) {
+        std::cerr << "读取分段文件不完整: " << path << std::endl;
+        return Buffer();
+    }
+    return std::make_shared<const std::string>(std::move(content));
+}
+
+void SegmentCache::insert(const std::string& stream, const std::string& path, const Identity& identity, const Buffer& data)
+{
+    size_t size = data->size();
+    auto existing = m_index.find(path);
+    if (existing != m_index.end()) {
+        remove(existing->second);
+    }
+
+    // 先淘汰本流最久未使用的分段，再按总量淘汰
+    auto streamBytes = [this, &stream]() {
+        auto it = m_streamBytes.find(stream);
+        return it != m_streamBytes.end() ? it->second : 0;
+    };
+    for (auto it = m_lru.end(); streamBytes() + size > m_config.streamQuota && it != m_lru.begin();) {
+        --it;
+        if (it->stream == stream) {
+            remove(it++);
+            m_evictions++;
+        }
+    }
+    while (m_bytes + size > m_config.capacity && !m_lru.empty()) {
+        remove(std::prev(m_lru.end()));
+        m_evictions++;
+    }
+
+    Entry entry;
+    entry.path = path;
+    entry.stream = stream;
+    entry.identity = identity;
+    entry.data = data;
+    m_lru.push_front(std::move(entry));
+    m_index[path] = m_lru.begin();
+    m_bytes += size;
+    m_streamBytes[stream] += size;
+}
+
+void SegmentCache::remove(EntryIterator it)
+{
+    size_t size = it->data->size();
+    m_bytes -= size;
+    auto stream = m_streamBytes.find(it->stream);
+    if (stream != m_streamBytes.end()) {
+        stream->second -= size;
+        if (stream->second == 0) {
+            m_streamBytes.erase(stream);
+        }
+    }
+    m_index.erase(it->path);
+    m_lru.erase(it);
+}
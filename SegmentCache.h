@@ -0,0 +1,125 @@
+#ifndef SEGMENT_CACHE_H
+#define SEGMENT_CACHE_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * SegmentCache - 按字节数限制的分段文件LRU缓存
+ *
+ * 缓存完整的分段文件内容。内容不可变，以引用计数共享给正在发送的响应，
+ * 淘汰后仍在发送的响应不受影响。总量和每个流的占用各有上限，超出时淘汰
+ * 最久未使用的分段。每次取用时比较文件的inode、长度和修改时间，文件被
+ * 改写、替换或删除后缓存的内容失效。
+ *
+ * 同一文件同时未命中时只有第一个请求读盘，其他请求登记回调后立即返回，
+ * 由读盘的线程读完后一起回调（不占用等待的线程）。
+ */
+class SegmentCache {
+public:
+    typedef std::shared_ptr<const std::string> Buffer;
+
+    // 取得文件内容的回调：data为空表示文件不存在、读取失败或超过上限不缓存，由调用方直接发送文件
+    typedef std::function<void(const Buffer& data)> Callback;
+
+    struct Config {
+        size_t capacity;            // 缓存总字节数（0表示不缓存）
+        size_t streamQuota;         // 每个流最多占用的字节数
+        size_t maxEntrySize;        // 单个文件的上限，更大的文件不缓存
+
+        Config() : capacity(256 * 1024 * 1024), streamQuota(64 * 1024 * 1024), maxEntrySize(16 * 1024 * 1024) {}
+    };
+
+    struct Stats {
+        uint64_t hits;              // 命中次数
+        uint64_t misses;            // 未命中、读盘的次数
+        uint64_t coalesced;         // 未命中但等待同一文件的读取、没有重复读盘的次数
+        uint64_t evictions;         // 因超出上限淘汰的分段数
+        uint64_t invalidations;     // 因文件改变或删除失效的分段数
+        uint64_t bytesSaved;        // 命中和合并读取省去的读盘字节数
+        size_t bytes;               // 当前缓存的字节数
+        size_t entries;             // 当前缓存的分段数
+
+        // 不需要自己读盘的请求比例（命中和合并读取）
+        double hitRatio() const;
+    };
+
+    explicit SegmentCache(const Config& config = Config());
+
+    /**
+     * 取得文件内容
+     *
+     * 命中时在当前线程回调；未命中时当前线程读盘，读完后回调本请求和期间
+     * 合并的请求。会阻塞（stat和读文件），在文件线程池中调用。
+     *
+     * @param stream 流名称（按流限制占用）
+     * @param path 文件路径
+     * @param callback 回调（不持有锁时调用）
+     */
+    void fetch(const std::string& stream, const std::string& path, const Callback& callback);
+
+    // 统计信息
+    Stats stats() const;
+
+private:
+    // 文件标识：任何一项改变都说明文件被改写或替换
+    struct Identity {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t size;
+        int64_t mtimeNs;
+
+        bool operator==(const Identity& other) const {
+            return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+        }
+    };
+
+    struct Entry {
+        std::string path;
+        std::string stream;
+        Identity identity;
+        Buffer data;
+    };
+
+    // 正在读取的文件
+    struct Load {
+        Identity identity;
+        std::vector<Callback> waiters;
+    };
+
+    typedef std::list<Entry>::iterator EntryIterator;
+
+    // 读取整个文件，identity返回实际读取的文件标识
+    static Buffer readFile(const std::string& path, Identity& identity);
+
+    // 加入缓存，先按流配额、再按总量淘汰（调用时持有锁）
+    void insert(const std::string& stream, const std::string& path, const Identity& identity, const Buffer& data);
+
+    // 移出缓存（调用时持有锁）
+    void remove(EntryIterator it);
+
+private:
+    Config m_config;
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;                                         // 头部为最近使用
+    std::unordered_map<std::string, EntryIterator> m_index;         // <文件路径, 缓存项>
+    std::unordered_map<std::string, std::shared_ptr<Load>> m_loading;   // <文件路径, 读取中>
+    std::map<std::string, size_t> m_streamBytes;                    // <流名称, 占用字节数>
+    size_t m_bytes;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_coalesced;
+    uint64_t m_evictions;
+    uint64_t m_invalidations;
+    uint64_t m_bytesSaved;
+};
+
+#endif // SEGMENT_CACHE_H
@@ -0,0 +1,192 @@
+#include "StartCodeScanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define START_CODE_SCANNER_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define START_CODE_SCANNER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+typedef const uint8_t* (*ScanFunc)(const uint8_t*, const uint8_t*, int*);
+
+// 检查q处是否为起始码，返回起始码长度，不是则返回0
+// 与原逐字节实现保持一致：要求q+3在数据范围内
+inline int matchAt(const uint8_t* q, const uint8_t* end)
+{
+    if (q + 3 >= end || q[0] != 0 || q[1] != 0) {
+        return 0;
+    }
+    if (q[2] == 1) {
+        return 3;
+    }
+    if (q[2] == 0 && q[3] == 1) {
+        return 4;
+    }
+    return 0;
+}
+
+const uint8_t* scanScalar(const uint8_t* p, const uint8_t* end, int* startCodeLen)
+{
+    for (; p + 3 < end; p++) {
+        int len = matchAt(p, end);
+        if (len) {
+            *startCodeLen = len;
+            return p;
+        }
+    }
+    return end;
+}
+
+#ifdef START_CODE_SCANNER_X86
+// 依次校验候选位掩码中的每个位置
+inline const uint8_t* checkCandidates(const uint8_t* p, const uint8_t* end, uint32_t mask, int* startCodeLen)
+{
+    while (mask) {
+        int k = __builtin_ctz(mask);
+        int len = matchAt(p + k, end);
+        if (len) {
+            *startCodeLen = len;
+            return p + k;
+        }
+        mask &= mask - 1;
+    }
+    return nullptr;
+}
+
+const uint8_t* scanSSE2(const uint8_t* p, const uint8_t* end, int* startCodeLen)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // 每次比较p[0..15]与p[1..16]，需要17字节可读
+    while (p + 17 <= end) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i pair = _mm_and_si128(_mm_cmpeq_epi8(a, zero), _mm_cmpeq_epi8(b, zero));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(pair));
+        if (mask) {
+            const uint8_t* found = checkCandidates(p, end, mask, startCodeLen);
+            if (found) {
+                return found;
+            }
+        }
+        p += 16;
+    }
+    return scanScalar(p, end, startCodeLen);
+}
+
+__attribute__((target("avx2")))
+const uint8_t* scanAVX2(const uint8_t* p, const uint8_t* end, int* startCodeLen)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    // 每次比较p[0..31]与p[1..32]，需要33字节可读
+    while (p + 33 <= end) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        __m256i pair = _mm256_and_si256(_mm256_cmpeq_epi8(a, zero), _mm256_cmpeq_epi8(b, zero));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(pair));
+        if (mask) {
+            const uint8_t* found = checkCandidates(p, end, mask, startCodeLen);
+            if (found) {
+                return found;
+            }
+        }
+        p += 32;
+    }
+    return scanSSE2(p, end, startCodeLen);
+}
+#endif
+
+#ifdef START_CODE_SCANNER_NEON
+const uint8_t* scanNEON(const uint8_t* p, const uint8_t* end, int* startCodeLen)
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    while (p + 17 <= end) {
+        uint8x16_t a = vceqq_u8(vld1q_u8(p), zero);
+        uint8x16_t b = vceqq_u8(vld1q_u8(p + 1), zero);
+        uint64x2_t pair = vreinterpretq_u64_u8(vandq_u8(a, b));
+        if (vgetq_lane_u64(pair, 0) | vgetq_lane_u64(pair, 1)) {
+            // NEON没有movemask，命中的块很少，直接逐字节校验
+            for (int k = 0; k < 16; k++) {
+                int len = matchAt(p + k, end);
+                if (len) {
+                    *startCodeLen = len;
+                    return p + k;
+                }
+            }
+        }
+        p += 16;
+    }
+    return scanScalar(p, end, startCodeLen);
+}
+#endif
+
+ScanFunc selectScanner(const char** name)
+{
+#ifdef START_CODE_SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return scanAVX2;
+    }
+    *name = "sse2";
+    return scanSSE2;
+#elif defined(START_CODE_SCANNER_NEON)
+    *name = "neon";
+    return scanNEON;
+#else
+    *name = "scalar";
+    return scanScalar;
+#endif
+}
+
+struct ScannerDispatch {
+    ScanFunc func;
+    const char* name;
+
+    ScannerDispatch() : name("scalar") { func = selectScanner(&name); }
+};
+
+const ScannerDispatch& dispatch()
+{
+    static const ScannerDispatch instance;
+    return instance;
+}
+
+} // namespace
+
+const uint8_t* StartCodeScanner::find(const uint8_t* data, const uint8_t* end, int* startCodeLen)
+{
+    return dispatch().func(data, end, startCodeLen);
+}
+
+const uint8_t* StartCodeScanner::findScalar(const uint8_t* data, const uint8_t* end, int* startCodeLen)
+{
+    return scanScalar(data, end, startCodeLen);
+}
+
+const char* StartCodeScanner::implementationName()
+{
+    return dispatch().name;
+}
+
+std::vector<StartCodeScanner::Implementation> StartCodeScanner::implementations()
+{
+    std::vector<Implementation> result;
+    Implementation scalar = { "scalar", scanScalar };
+    result.push_back(scalar);
+#ifdef START_CODE_SCANNER_X86
+    Implementation sse2 = { "sse2", scanSSE2 };
+    result.push_back(sse2);
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        Implementation avx2 = { "avx2", scanAVX2 };
+        result.push_back(avx2);
+    }
+#elif defined(START_CODE_SCANNER_NEON)
+    Implementation neon = { "neon", scanNEON };
+    result.push_back(neon);
+#endif
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef START_CODE_SCANNER_H
+#define START_CODE_SCANNER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * StartCodeScanner - Annex-B起始码查找
+ *
+ * 用SIMD指令一次比较16/32字节，快速定位连续的两个0x00字节，
+ * 再对候选位置做标量校验。支持AVX2/SSE2（x86）和NEON（ARM），
+ * 其他平台使用标量实现。具体实现在首次调用时按CPU能力选择。
+ */
+class StartCodeScanner {
+public:
+    typedef const uint8_t* (*FindFunc)(const uint8_t* data, const uint8_t* end, int* startCodeLen);
+
+    // 一种起始码查找实现
+    struct Implementation {
+        const char* name;
+        FindFunc find;
+    };
+
+    /**
+     * 查找下一个起始码（0x00 0x00 0x00 0x01 或 0x00 0x00 0x01）
+     *
+     * @param data 查找起点
+     * @param end 数据结束位置
+     * @param startCodeLen 输出起始码长度（3或4）
+     * @return 起始码位置，找不到时返回end
+     */
+    static const uint8_t* find(const uint8_t* data, const uint8_t* end, int* startCodeLen);
+
+    /**
+     * 标量实现的起始码查找（逐字节比较，用于对照测试）
+     *
+     * @param data 查找起点
+     * @param end 数据结束位置
+     * @param startCodeLen 输出起始码长度（3或4）
+     * @return 起始码位置，找不到时返回end
+     */
+    static const uint8_t* findScalar(const uint8_t* data, const uint8_t* end, int* startCodeLen);
+
+    /**
+     * 获取当前使用的实现名称
+     *
+     * @return "avx2"、"sse2"、"neon"或"scalar"
+     */
+    static const char* implementationName();
+
+    /**
+     * 获取当前CPU支持的所有实现（第一个为标量实现，用于对照测试）
+     *
+     * @return 实现列表
+     */
+    static std::vector<Implementation> implementations();
+};
+
+#endif // START_CODE_SCANNER_H
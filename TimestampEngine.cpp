@@ -0,0 +1,90 @@
+#include "TimestampEngine.h"
+
+TimestampEngine::TimestampEngine()
+    : m_depth(0)
+    , m_count(0)
+    , m_firstPts(0)
+    , m_lastDts(0)
+    , m_frameDuration(1)
+{
+}
+
+void TimestampEngine::reset(int64_t frameDuration)
+{
+    m_pending.clear();
+    m_count = 0;
+    m_firstPts = 0;
+    m_lastDts = 0;
+    m_frameDuration = frameDuration > 0 ? frameDuration : 1;
+}
+
+void TimestampEngine::setReorderDepth(uint32_t depth)
+{
+    if (depth > m_depth) {
+        m_depth = depth;
+    }
+}
+
+int64_t TimestampEngine::assign(int64_t pts)
+{
+    if (m_count == 0) {
+        m_firstPts = pts;
+    }
+    m_pending.insert(pts);
+
+    int64_t dts;
+    if (m_pending.size() > m_depth) {
+        // 显示顺序中最早的未使用PTS
+        dts = *m_pending.begin();
+        m_pending.erase(m_pending.begin());
+    } else if (m_count < m_depth && m_count == m_pending.size() - 1) {
+        // 起始的D帧：从第一帧PTS向前外推
+        dts = m_firstPts - static_cast<int64_t>(m_depth - m_count) * m_frameDuration;
+    } else {
+        // 深度刚加大：按帧间隔前进，不超过最早的未使用PTS
+        dts = m_lastDts + m_frameDuration;
+        if (dts > *m_pending.begin()) {
+            dts = *m_pending.begin();
+        }
+    }
+
+    if (m_count > 0 && dts <= m_lastDts) {
+        // DTS回退说明重排序深度偏小
+        if (pts < m_lastDts) {
+            m_depth++;
+        }
+        dts = m_lastDts + 1;
+    }
+
+    m_lastDts = dts;
+    m_count++;
+
+    return dts;
+}
+
+int64_t TimestampEngine::rescale(int64_t value, uint64_t mul, uint64_t div)
+{
+    if (div == 0) {
+        return 0;
+    }
+
+    bool negative = value < 0;
+    uint64_t v = negative ? static_cast<uint64_t>(-(value + 1)) + 1 : static_cast<uint64_t>(value);
+
+    // v * mul / div = q * mul + r * mul / div，r < div，避免64位溢出
+    uint64_t q = v / div;
+    uint64_t r = v % div;
+    uint64_t result = q * mul + (r * mul + div / 2) / div;
+
+    return negative ? -static_cast<int64_t>(result) : static_cast<int64_t>(result);
+}
+
+uint64_t TimestampEngine::gcd(uint64_t a, uint64_t b)
+{
+    while (b != 0) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
@@ -0,0 +1,68 @@
+#ifndef TIMESTAMP_ENGINE_H
+#define TIMESTAMP_ENGINE_H
+
+#include <set>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * TimestampEngine - 根据显示时间戳推算解码时间戳
+ *
+ * 有B帧时解码顺序与显示顺序不同。重排序深度为D时，第n个解码帧的DTS取
+ * 显示顺序中第n-D个PTS，保证DTS单调递增且不大于PTS，无需缓存帧数据。
+ * 重排序深度未知或偏小时，出现DTS回退即自动加大深度。
+ *
+ * 另提供精确的有理数时间基换算（绝对时间戳直接换算，不累计误差）。
+ */
+class TimestampEngine {
+public:
+    TimestampEngine();
+
+    /**
+     * 重新开始（新文件），保留已知的重排序深度
+     *
+     * @param frameDuration 名义帧间隔（轨道时间单位），用于起始阶段外推DTS
+     */
+    void reset(int64_t frameDuration);
+
+    /**
+     * 设置重排序深度（只增不减）
+     *
+     * @param depth 最大重排序帧数
+     */
+    void setReorderDepth(uint32_t depth);
+
+    // 当前重排序深度
+    uint32_t reorderDepth() const { return m_depth; }
+
+    /**
+     * 按解码顺序输入一帧的PTS，得到其DTS
+     *
+     * @param pts 显示时间戳（轨道时间单位）
+     * @return 解码时间戳（单调递增，可能大于pts，调用方需截断合成时间偏移）
+     */
+    int64_t assign(int64_t pts);
+
+    /**
+     * 有理数换算 value * mul / div（四舍五入，中间结果不溢出）
+     *
+     * @param value 时间戳
+     * @param mul 乘数
+     * @param div 除数
+     * @return 换算结果
+     */
+    static int64_t rescale(int64_t value, uint64_t mul, uint64_t div);
+
+    // 最大公约数（用于约分时间基）
+    static uint64_t gcd(uint64_t a, uint64_t b);
+
+private:
+    std::multiset<int64_t> m_pending;   // 已输入但尚未用作DTS的PTS
+    uint32_t m_depth;                   // 重排序深度
+    uint64_t m_count;                   // 本次reset以来的帧数
+    int64_t m_firstPts;
+    int64_t m_lastDts;
+    int64_t m_frameDuration;
+};
+
+#endif // TIMESTAMP_ENGINE_H
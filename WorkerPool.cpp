@@ -0,0 +1,118 @@
+#include "WorkerPool.h"
+
+namespace {
+// 当前线程所属的线程池及序号，用于在工作线程内提交任务时放入本地队列
+thread_local const WorkerPool* t_currentPool = nullptr;
+thread_local size_t t_workerIndex = 0;
+}
+
+WorkerPool::WorkerPool(size_t threadCount, Order order)
+    : m_order(order)
+    , m_running(true)
+    , m_nextWorker(0)
+    , m_pendingTasks(0)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) {
+            threadCount = 4;
+        }
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        m_workers[i]->thread = std::thread(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_running = false;
+    }
+    m_sleepCond.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void WorkerPool::submit(Task task)
+{
+    size_t index;
+    if (t_currentPool == this) {
+        index = t_workerIndex;
+    } else {
+        index = m_nextWorker++ % m_workers.size();
+    }
+
+    // 先计数再入队，保证计数不会小于队列中的任务数
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_pendingTasks++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+    }
+    m_sleepCond.notify_one();
+}
+
+bool WorkerPool::takeTask(size_t index, Task& task)
+{
+    // 自己的队列：默认从尾部取，先进先出时从头部取
+    {
+        Worker& self = *m_workers[index];
+        std::lock_guard<std::mutex> lock(self.mutex);
+        if (!self.tasks.empty()) {
+            if (m_order == ORDER_FIFO) {
+                task = std::move(self.tasks.front());
+                self.tasks.pop_front();
+            } else {
+                task = std::move(self.tasks.back());
+                self.tasks.pop_back();
+            }
+            return true;
+        }
+    }
+
+    // 其他线程的队列：从头部窃取
+    for (size_t i = 1; i < m_workers.size(); i++) {
+        Worker& victim = *m_workers[(index + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::workerLoop(size_t index)
+{
+    t_currentPool = this;
+    t_workerIndex = index;
+
+    while (true) {
+        Task task;
+        if (takeTask(index, task)) {
+            m_pendingTasks--;
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        if (!m_running) {
+            break;
+        }
+        m_sleepCond.wait(lock, [this] { return !m_running || m_pendingTasks > 0; });
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstddef>
+
+/**
+ * WorkerPool - 固定线程数的工作窃取线程池
+ *
+ * 每个工作线程有自己的任务队列，优先处理自己的任务（默认后进先出，缓存友好），
+ * 自己的队列为空时从其他线程队列的头部窃取任务。
+ */
+class WorkerPool {
+public:
+    typedef std::function<void()> Task;
+
+    // 工作线程处理自己队列的顺序
+    enum Order {
+        ORDER_LIFO,     // 后进先出：任务之间有数据依赖时缓存友好
+        ORDER_FIFO      // 先进先出：相互独立的请求按到达顺序处理，排队时间有上限
+    };
+
+    /**
+     * 构造函数
+     *
+     * @param threadCount 工作线程数（0表示使用CPU核数）
+     * @param order 处理自己队列的顺序
+     */
+    explicit WorkerPool(size_t threadCount = 0, Order order = ORDER_LIFO);
+    ~WorkerPool();
+
+    /**
+     * 提交任务
+     *
+     * 在工作线程内提交时放入当前线程的队列，否则轮流分配到各线程队列
+     *
+     * @param task 任务
+     */
+    void submit(Task task);
+
+    // 工作线程数
+    size_t threadCount() const { return m_workers.size(); }
+
+private:
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+        std::thread thread;
+    };
+
+    // 工作线程主循环
+    void workerLoop(size_t index);
+
+    // 取出一个任务：先取自己的队列，再从其他队列窃取
+    bool takeTask(size_t index, Task& task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    Order m_order;
+    std::atomic<bool> m_running;
+    std::atomic<size_t> m_nextWorker;    // 外部提交时的轮转位置
+    std::atomic<size_t> m_pendingTasks;  // 所有队列中的任务总数
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCond;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,402 @@
+// DASH服务器压测工具：保持固定数量的并发客户端反复请求同一个URL，
+// 统计吞吐量和延迟分布。默认每个请求新建连接（延迟从发起连接算起）；
+// 指定流水线深度时在持久连接上保持相应数量的在途请求（延迟从请求入队算起，
+// 响应必须带Content-Length）。
+// 仅支持Linux（epoll）。
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// 单个客户端连接
+struct Client {
+    int fd;
+    std::string output;             // 待发送的请求
+    size_t outputSent;              // output中已发送的字节数
+    std::string header;             // 正在接收的响应头
+    bool inBody;                    // 响应头已收完，正在接收正文
+    long long contentLength;        // -1表示没有Content-Length，读到连接关闭为止
+    long long bodyBytes;
+    bool closing;                   // 服务器在响应中要求关闭连接
+    std::deque<Clock::time_point> pending;      // 已发出、尚未收到响应的请求的开始时间
+
+    Client() : fd(-1), outputSent(0), inBody(false), contentLength(-1), bodyBytes(0), closing(false) {}
+};
+
+// 每个压测线程的结果
+struct Result {
+    std::vector<uint32_t> latenciesUs;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t connections;
+
+    Result() : bytes(0), errors(0), connections(0) {}
+};
+
+struct Options {
+    sockaddr_storage address;
+    socklen_t addressLength;
+    std::string request;
+    size_t clients;
+    int seconds;
+    size_t pipeline;                // 0：每个请求一个连接；>0：持久连接上同时在途的请求数
+};
+
+std::atomic<bool> g_running(true);
+
+void watch(int epollFd, Client& client, uint32_t events)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = &client;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+}
+
+// 追加一个请求（开始计时）
+void queueRequest(const Options& options, Client& client)
+{
+    client.output.append(options.request);
+    client.pending.push_back(Clock::now());
+}
+
+// 发起新连接（非阻塞connect），并放入要发送的请求
+bool connectClient(int epollFd, const Options& options, Client& client, Result& result)
+{
+    client = Client();
+    client.fd = socket(options.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (client.fd < 0) {
+        return false;
+    }
+    if (connect(client.fd, reinterpret_cast<const sockaddr*>(&options.address), options.addressLength) < 0 &&
+        errno != EINPROGRESS) {
+        close(client.fd);
+        client.fd = -1;
+        return false;
+    }
+    result.connections++;
+
+    for (size_t i = 0; i < std::max<size_t>(options.pipeline, 1); i++) {
+        queueRequest(options, client);
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.ptr = &client;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+    return true;
+}
+
+// 关闭连接，ok为false时记一次失败
+void closeClient(int epollFd, Client& client, bool ok, Result& result)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+    close(client.fd);
+    client.fd = -1;
+    if (!ok) {
+        result.errors++;
+    }
+}
+
+// 记录收完的响应
+void completeResponse(Client& client, Result& result)
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - client.pending.front()).count();
+    result.latenciesUs.push_back(static_cast<uint32_t>(std::min<long long>(elapsed, UINT32_MAX)));
+    result.bytes += static_cast<uint64_t>(client.bodyBytes);
+    client.pending.pop_front();
+    client.header.clear();
+    client.inBody = false;
+    client.contentLength = -1;
+    client.bodyBytes = 0;
+}
+
+// 解析响应头：状态码必须为2xx
+bool parseHeader(Client& client)
+{
+    if (client.header.compare(0, 9, "HTTP/1.1 ") != 0 && client.header.compare(0, 9, "HTTP/1.0 ") != 0) {
+        return false;
+    }
+    if (client.header[9] != '2') {
+        return false;
+    }
+
+    std::string lower = client.header;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    size_t pos = lower.find("\r\ncontent-length:");
+    if (pos != std::string::npos) {
+        client.contentLength = atoll(lower.c_str() + pos + 17);
+    }
+    if (lower.find("\r\nconnection: close") != std::string::npos) {
+        client.closing = true;
+    }
+    return true;
+}
+
+// 处理收到的数据：返回1表示收完一个响应（data/size指向剩余数据），0表示需要更多数据，-1表示响应无效
+int consumeResponse(Client& client, bool keepAlive, const char*& data, size_t& size)
+{
+    if (!client.inBody) {
+        size_t previous = client.header.size();
+        client.header.append(data, size);
+        size_t end = client.header.find("\r\n\r\n", previous >= 3 ? previous - 3 : 0);
+        if (end == std::string::npos) {
+            data += size;
+            size = 0;
+            return 0;
+        }
+        // 响应头之后的数据属于正文（或下一个响应）
+        size_t used = end + 4 - previous;
+        data += used;
+        size -= used;
+        client.header.resize(end + 4);
+        if (!parseHeader(client) || (keepAlive && client.contentLength < 0)) {
+            return -1;
+        }
+        client.inBody = true;
+    }
+
+    if (client.contentLength < 0) {
+        client.bodyBytes += static_cast<long long>(size);
+        data += size;
+        size = 0;
+        return 0;
+    }
+    size_t take = static_cast<size_t>(std::min<long long>(static_cast<long long>(size), client.contentLength - client.bodyBytes));
+    client.bodyBytes += static_cast<long long>(take);
+    data += take;
+    size -= take;
+    return client.bodyBytes >= client.contentLength ? 1 : 0;
+}
+
+// 压测线程：管理若干个并发客户端
+void benchThread(const Options& options, size_t clientCount, Result& result)
+{
+    bool keepAlive = options.pipeline > 0;
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Client> clients(clientCount);
+    for (auto& client : clients) {
+        if (!connectClient(epollFd, options, client, result)) {
+            result.errors++;
+        }
+    }
+
+    std::vector<struct epoll_event> events(256);
+    char buffer[64 * 1024];
+    while (g_running) {
+        int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 100);
+        for (int i = 0; i < count; i++) {
+            Client& client = *static_cast<Client*>(events[i].data.ptr);
+            if (client.fd < 0) {
+                continue;
+            }
+            if (events[i].events & EPOLLERR) {
+                closeClient(epollFd, client, false, result);
+                continue;
+            }
+
+            // 发送请求
+            if (client.outputSent < client.output.size()) {
+                ssize_t sent = send(client.fd, client.output.data() + client.outputSent,
+                                    client.output.size() - client.outputSent, MSG_NOSIGNAL);
+                if (sent < 0 && errno != EAGAIN) {
+                    closeClient(epollFd, client, false, result);
+                    continue;
+                }
+                if (sent > 0) {
+                    client.outputSent += static_cast<size_t>(sent);
+                }
+                if (client.outputSent == client.output.size()) {
+                    client.output.clear();
+                    client.outputSent = 0;
+                    watch(epollFd, client, EPOLLIN);
+                }
+            }
+
+            // 接收响应：持久连接按Content-Length切分响应，否则收够或读到连接关闭即结束
+            bool done = false;
+            bool ok = true;
+            while (!done) {
+                ssize_t bytes = recv(client.fd, buffer, sizeof(buffer), 0);
+                if (bytes > 0) {
+                    const char* data = buffer;
+                    size_t size = static_cast<size_t>(bytes);
+                    while (size > 0) {
+                        int status = consumeResponse(client, keepAlive, data, size);
+                        if (status < 0 || (status > 0 && client.pending.empty())) {
+                            ok = false;
+                            done = true;
+                            break;
+                        }
+                        if (status == 0) {
+                            break;
+                        }
+                        completeResponse(client, result);
+                        if (!keepAlive || client.closing) {
+                            // 服务器关闭持久连接时，尚未响应的流水线请求在新连接上重新发送
+                            done = true;
+                            break;
+                        }
+                        if (g_running) {
+                            bool idle = client.output.empty();
+                            queueRequest(options, client);
+                            if (idle) {
+                                watch(epollFd, client, EPOLLIN | EPOLLOUT);
+                            }
+                        }
+                    }
+                    continue;
+                }
+                if (bytes == 0) {
+                    // 服务器关闭连接：没有Content-Length的响应到此结束，其他情况下有未完成的请求即为失败
+                    if (client.inBody && client.contentLength < 0) {
+                        completeResponse(client, result);
+                    }
+                    ok = client.pending.empty();
+                    done = true;
+                } else if (errno != EAGAIN && errno != EINTR) {
+                    ok = false;
+                    done = true;
+                }
+                break;
+            }
+
+            if (done) {
+                closeClient(epollFd, client, ok, result);
+                if (g_running && !connectClient(epollFd, options, client, result)) {
+                    result.errors++;
+                }
+            }
+        }
+
+        // 连接失败的客户端重新发起
+        for (auto& client : clients) {
+            if (client.fd < 0 && g_running && !connectClient(epollFd, options, client, result)) {
+                result.errors++;
+            }
+        }
+    }
+
+    for (auto& client : clients) {
+        if (client.fd >= 0) {
+            close(client.fd);
+        }
+    }
+    close(epollFd);
+}
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4) {
+        std::cout << "用法: " << argv[0] << " <主机> <端口> <路径> [并发数] [时长(秒)] [线程数] [流水线深度]" << std::endl;
+        std::cout << "示例: " << argv[0] << " 127.0.0.1 8080 /video/manifest.mpd 1000 10 4" << std::endl;
+        std::cout << "      " << argv[0] << " 127.0.0.1 8080 /video/manifest.mpd 1 10 1 16（单个持久连接，16个请求在途）" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    std::string host = argv[1];
+    std::string port = argv[2];
+    std::string path = argv[3];
+    options.clients = (argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 1000;
+    options.seconds = (argc > 5) ? std::atoi(argv[5]) : 10;
+    size_t threads = (argc > 6) ? std::strtoul(argv[6], nullptr, 10) : 4;
+    options.pipeline = (argc > 7) ? std::strtoul(argv[7], nullptr, 10) : 0;
+    if (options.clients == 0 || options.seconds <= 0 || threads == 0) {
+        std::cerr << "无效的参数" << std::endl;
+        return 1;
+    }
+    threads = std::min(threads, options.clients);
+
+    // 解析服务器地址
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* info = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0 || !info) {
+        std::cerr << "无法解析地址: " << host << ":" << port << std::endl;
+        return 1;
+    }
+    memcpy(&options.address, info->ai_addr, info->ai_addrlen);
+    options.addressLength = info->ai_addrlen;
+    freeaddrinfo(info);
+
+    options.request = "GET " + path + " HTTP/1.1\r\nHost: " + host + ":" + port + "\r\n" +
+                      (options.pipeline > 0 ? "" : "Connection: close\r\n") + "\r\n";
+
+    std::cout << "压测 http://" << host << ":" << port << path << "，并发 " << options.clients
+              << "，" << options.seconds << " 秒，" << threads << " 个线程，";
+    if (options.pipeline > 0) {
+        std::cout << "持久连接（流水线深度 " << options.pipeline << "）" << std::endl;
+    } else {
+        std::cout << "每个请求一个连接" << std::endl;
+    }
+
+    std::vector<Result> results(threads);
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (size_t i = 0; i < threads; i++) {
+        size_t count = options.clients / threads + (i < options.clients % threads ? 1 : 0);
+        workers.push_back(std::thread(benchThread, std::cref(options), count, std::ref(results[i])));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    g_running = false;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // 汇总
+    std::vector<uint32_t> latencies;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    uint64_t connections = 0;
+    for (auto& result : results) {
+        latencies.insert(latencies.end(), result.latenciesUs.begin(), result.latenciesUs.end());
+        bytes += result.bytes;
+        errors += result.errors;
+        connections += result.connections;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "完成请求: " << latencies.size() << "，失败: " << errors << "，连接数: " << connections << std::endl;
+    std::cout << "吞吐量: " << static_cast<uint64_t>(latencies.size() / elapsed) << " 请求/秒，"
+              << (bytes / elapsed / (1024 * 1024)) << " MB/秒" << std::endl;
+    std::cout << "延迟(ms): p50 " << percentile(latencies, 0.50) / 1000.0
+              << "  p90 " << percentile(latencies, 0.90) / 1000.0
+              << "  p99 " << percentile(latencies, 0.99) / 1000.0
+              << "  max " << (latencies.empty() ? 0 : latencies.back()) / 1000.0 << std::endl;
+
+    return errors > 0 && latencies.empty() ? 1 : 0;
+}
@@ -10,6 +10,7 @@ int main(int argc, char* argv[]) {
     // 检查命令行参数
     if (argc < 2) {
         std::cout << "用法: " << argv[0] << " <MP4文件路径> [端口号] [流名称]" << std::endl;
+        std::cout << "      " << argv[0] << " --live [端口号] [流名称]  （发布H264MP4Writer直播DASH输出的./dash/<流名称>）" << std::endl;
         std::cout << "示例: " << argv[0] << " ./videos/test.mp4 8080 video1" << std::endl;
         return 1;
     }
@@ -17,10 +18,13 @@ int main(int argc, char* argv[]) {
     // 解析命令行参数
     std::string mp4FilePath = argv[1];
     uint16_t port = (argc > 2) ? std::stoi(argv[2]) : 8080;
-    std::string streamName = (argc > 3) ? argv[3] : "video";
+    bool live = (mp4FilePath == "--live");
+    std::string streamName = (argc > 3) ? argv[3] : (live ? "live" : "video");
 
     std::cout << "=== DASH流媒体服务器示例 ===" << std::endl;
-    std::cout << "MP4文件: " << mp4FilePath << std::endl;
+    if (!live) {
+        std::cout << "MP4文件: " << mp4FilePath << std::endl;
+    }
     std::cout << "端口号: " << port << std::endl;
     std::cout << "流名称: " << streamName << std::endl;
 
@@ -35,13 +39,34 @@ int main(int argc, char* argv[]) {
     }
     std::cout << "服务器初始化成功，输出目录: ./dash" << std::endl;
 
-    // 添加MP4文件
-    std::cout << "\n[2] 添加MP4文件..." << std::endl;
-    if (!server.addMP4File(mp4FilePath, streamName)) {
-        std::cerr << "添加MP4文件失败: " << mp4FilePath << std::endl;
-        return 1;
+    if (live) {
+        // 直播流：由H264MP4Writer实时写入，无需分段
+        std::cout << "\n[2] 添加直播流..." << std::endl;
+        if (!server.addLiveStream(streamName)) {
+            std::cerr << "添加直播流失败: " << streamName << std::endl;
+            return 1;
+        }
+    } else {
+        // 添加MP4文件
+        std::cout << "\n[2] 添加MP4文件..." << std::endl;
+        if (!server.addMP4File(mp4FilePath, streamName)) {
+            std::cerr << "添加MP4文件失败: " << mp4FilePath << std::endl;
+            return 1;
+        }
+
+        // 等待后台分段完成
+        double progress;
+        while ((progress = server.getPackagingProgress(streamName)) >= 0 && progress < 1.0) {
+            std::cout << "\r分段进度: " << (int)(progress * 100) << "%" << std::flush;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        std::cout << std::endl;
+        if (!server.waitForStream(streamName)) {
+            std::cerr << "分段MP4文件失败: " << mp4FilePath << std::endl;
+            return 1;
+        }
+        std::cout << "MP4文件添加成功: " << mp4FilePath << std::endl;
     }
-    std::cout << "MP4文件添加成功: " << mp4FilePath << std::endl;
 
     // 启动服务器
     std::cout << "\n[3] 启动服务器..." << std::endl;
@@ -53,13 +78,18 @@ int main(int argc, char* argv[]) {
     // 显示访问信息
     std::cout << "\n=== 服务器已启动 ===" << std::endl;
     std::cout << "主页: http://localhost:" << port << "/" << std::endl;
-    std::cout << "MPD文件: http://localhost:" << port << "/" << streamName << "/manifest.mpd" << std::endl;
+    std::cout << "MPD文件: http://localhost:" << port << "/" << streamName << (live ? "/live.mpd" : "/manifest.mpd") << std::endl;
     std::cout << "HTML播放器: ./dash/player.html" << std::endl;
     std::cout << "\n按Enter键停止服务器..." << std::endl;
 
     // 等待用户输入
     std::cin.get();
 
+    // 分段缓存统计
+    SegmentCache::Stats cache = server.getCacheStats();
+    std::cout << "分段缓存: 命中率 " << (int)(cache.hitRatio() * 100) << "%, 淘汰 " << cache.evictions
+              << ", 省去读盘 " << cache.bytesSaved / (1024 * 1024) << "MB" << std::endl;
+
     // 停止服务器
     std::cout << "\n[4] 停止服务器..." << std::endl;
     server.stop();
@@ -0,0 +1,82 @@
+#include "HttpParser.h"
+#include "TestCheck.h"
+#include <vector>
+
+namespace {
+
+// 按连接的方式解析缓冲区：每解析出一个请求就从缓冲区移除，剩余数据留给下一个请求
+void drain(HttpParser& parser, std::string& buffer, std::vector<HttpRequest>& requests)
+{
+    while (true) {
+        HttpParser::Status status = parser.parse(buffer.data(), buffer.size());
+        if (status == HttpParser::INCOMPLETE) {
+            return;
+        }
+        CHECK(status == HttpParser::COMPLETE);
+        if (status != HttpParser::COMPLETE) {
+            return;
+        }
+        requests.push_back(parser.request());
+        buffer.erase(0, parser.consumed());
+        parser.reset();
+    }
+}
+
+// 三个流水线请求在任意位置拆成两次到达，结果都相同
+void testSplitAndPipelined()
+{
+    const std::string data =
+        "\r\nGET /a?x=1 HTTP/1.1\r\nHost: h\r\nX-A: 1\r\nx-a: 2\r\nConnection: Upgrade, Close\r\n\r\n"
+        "POST /b HTTP/1.0\nContent-Length: 3\nConnection: keep-alive\n\nxyz"
+        "GET /c HTTP/1.1\r\n\r\n";
+
+    for (size_t split = 0; split <= data.size(); split++) {
+        HttpParser parser(1024);
+        std::string buffer = data.substr(0, split);
+        std::vector<HttpRequest> requests;
+        drain(parser, buffer, requests);
+        buffer.append(data, split, std::string::npos);
+        drain(parser, buffer, requests);
+
+        CHECK(buffer.empty());
+        CHECK(requests.size() == 3);
+        if (requests.size() != 3) {
+            continue;
+        }
+        CHECK(requests[0].method == "GET" && requests[0].path == "/a?x=1");
+        CHECK(requests[0].header("X-A") == "1, 2");
+        CHECK(!requests[0].keepAlive);
+        CHECK(requests[1].method == "POST" && requests[1].version == "HTTP/1.0");
+        CHECK(requests[1].body == "xyz" && requests[1].keepAlive);
+        CHECK(requests[2].path == "/c" && requests[2].keepAlive);
+    }
+}
+
+// 格式错误和超限的请求
+void testMalformed()
+{
+    HttpParser tooLarge(64);
+    std::string longLine = "GET /" + std::string(100, 'a');
+    CHECK(tooLarge.parse(longLine.data(), longLine.size()) == HttpParser::HEADERS_TOO_LARGE);
+
+    HttpParser duplicateLength(1024);
+    std::string dup = "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n";
+    CHECK(duplicateLength.parse(dup.data(), dup.size()) == HttpParser::BAD_REQUEST);
+
+    HttpParser spaceBeforeColon(1024);
+    std::string space = "GET / HTTP/1.1\r\nHost : x\r\n\r\n";
+    CHECK(spaceBeforeColon.parse(space.data(), space.size()) == HttpParser::BAD_REQUEST);
+
+    HttpParser badVersion(1024);
+    std::string version = "GET / HTTP/2.0\r\n\r\n";
+    CHECK(badVersion.parse(version.data(), version.size()) == HttpParser::BAD_REQUEST);
+}
+
+} // namespace
+
+int main()
+{
+    testSplitAndPipelined();
+    testMalformed();
+    return TEST_RESULT();
+}
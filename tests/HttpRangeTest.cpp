@@ -0,0 +1,95 @@
+#include "HttpRange.h"
+#include "TestCheck.h"
+
+namespace {
+
+// 解析结果的文本形式："I"忽略，"U"不可满足，"S 起始+长度 ..."
+std::string parse(const std::string& header, uint64_t size)
+{
+    std::vector<HttpRange::Span> spans;
+    HttpRange::Result result = HttpRange::parse(header, size, spans);
+    std::string text = result == HttpRange::IGNORED ? "I" : result == HttpRange::SATISFIABLE ? "S" : "U";
+    for (const auto& span : spans) {
+        text += " " + std::to_string(span.first) + "+" + std::to_string(span.length);
+    }
+    return text;
+}
+
+void testSingleRanges()
+{
+    CHECK(parse("", 1000) == "I");
+    CHECK(parse("bytes=0-499", 1000) == "S 0+500");
+    CHECK(parse("BYTES=0-0", 1000) == "S 0+1");
+    CHECK(parse("bytes=900-5000", 1000) == "S 900+100");
+    CHECK(parse("bytes=0-18446744073709551615", 1000) == "S 0+1000");
+}
+
+// 开放范围和后缀范围
+void testOpenAndSuffix()
+{
+    CHECK(parse("bytes=500-", 1000) == "S 500+500");
+    CHECK(parse("bytes=-200", 1000) == "S 800+200");
+    CHECK(parse("bytes=-2000", 1000) == "S 0+1000");
+}
+
+// 所有范围都在文件之外时返回416
+void testUnsatisfiable()
+{
+    CHECK(parse("bytes=1000-", 1000) == "U");
+    CHECK(parse("bytes=-0", 1000) == "U");
+    CHECK(parse("bytes=0-", 0) == "U");
+    CHECK(parse("bytes=-5", 0) == "U");
+    CHECK(parse("bytes=2000-3000,5000-", 1000) == "U");
+}
+
+// 语法错误时忽略请求头，发送整个文件
+void testMalformed()
+{
+    CHECK(parse("bytes=5-2", 1000) == "I");
+    CHECK(parse("bytes=abc", 1000) == "I");
+    CHECK(parse("bytes=1-2-3", 1000) == "I");
+    CHECK(parse("bytes=", 1000) == "I");
+    CHECK(parse("bytes= , ", 1000) == "I");
+    CHECK(parse("items=0-1", 1000) == "I");
+    CHECK(parse("bytes=99999999999999999999-", 1000) == "I");
+    CHECK(parse("bytes=0-99999999999999999999", 1000) == "I");
+}
+
+// 多个范围排序，重叠或间隔很小的合并
+void testMultipleAndMerge()
+{
+    CHECK(parse("bytes=0-99, 500-599", 1000) == "S 0+100 500+100");
+    CHECK(parse("bytes=500-599,0-99", 1000) == "S 0+100 500+100");
+    CHECK(parse("bytes=0-99,150-199", 1000) == "S 0+200");
+    CHECK(parse("bytes=0-499,100-199,-100", 1000) == "S 0+500 900+100");
+    CHECK(parse("bytes=0-1,,5000-", 1000) == "S 0+2");
+    CHECK(parse("bytes=2000-3000, 0-1", 1000) == "S 0+2");
+}
+
+// 合并后超过MAX_SPANS个范围时忽略
+void testTooMany()
+{
+    std::string header = "bytes=0-0";
+    for (size_t i = 1; i < HttpRange::MAX_SPANS; i++) {
+        header += "," + std::to_string(i * 1000) + "-" + std::to_string(i * 1000);
+    }
+    std::vector<HttpRange::Span> spans;
+    CHECK(HttpRange::parse(header, 100000, spans) == HttpRange::SATISFIABLE);
+    CHECK(spans.size() == HttpRange::MAX_SPANS);
+
+    header += "," + std::to_string(HttpRange::MAX_SPANS * 1000) + "-";
+    CHECK(parse(header, 100000) == "I");
+}
+
+} // namespace
+
+int main()
+{
+    testSingleRanges();
+    testOpenAndSuffix();
+    testUnsatisfiable();
+    testMalformed();
+    testMultipleAndMerge();
+    testTooMany();
+    return TEST_RESULT();
+}
@@ -0,0 +1,143 @@
+#include "SegmentCache.h"
+#include "TestCheck.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 测试文件写在当前目录（ctest在构建目录中运行）
+std::string testPath(const std::string& name)
+{
+    return "segment_cache_test_" + name;
+}
+
+void writeFile(const std::string& path, size_t size, char fill)
+{
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file << std::string(size, fill);
+}
+
+// 同步取得文件内容（命中和读盘都在当前线程回调）
+SegmentCache::Buffer fetch(SegmentCache& cache, const std::string& stream, const std::string& path)
+{
+    SegmentCache::Buffer result;
+    cache.fetch(stream, path, [&result](const SegmentCache::Buffer& data) { result = data; });
+    return result;
+}
+
+// 命中、文件改写和删除后失效、超过单个上限不缓存
+void testHitAndInvalidate()
+{
+    SegmentCache::Config config;
+    config.capacity = 1000;
+    config.streamQuota = 600;
+    config.maxEntrySize = 500;
+    SegmentCache cache(config);
+    std::string path = testPath("a");
+
+    writeFile(path, 200, 'a');
+    SegmentCache::Buffer data = fetch(cache, "s1", path);
+    CHECK(data && data->size() == 200);
+    data = fetch(cache, "s1", path);
+    CHECK(data && (*data)[0] == 'a');
+    SegmentCache::Stats stats = cache.stats();
+    CHECK(stats.hits == 1 && stats.misses == 1 && stats.entries == 1);
+
+    // 改写后长度变化，缓存的内容失效
+    writeFile(path, 300, 'b');
+    SegmentCache::Buffer old = data;
+    data = fetch(cache, "s1", path);
+    CHECK(data && data->size() == 300 && (*data)[0] == 'b');
+    CHECK(old && old->size() == 200);
+    stats = cache.stats();
+    CHECK(stats.invalidations == 1 && stats.bytes == 300);
+
+    remove(path.c_str());
+    CHECK(!fetch(cache, "s1", path));
+    stats = cache.stats();
+    CHECK(stats.entries == 0 && stats.bytes == 0);
+
+    std::string big = testPath("big");
+    writeFile(big, 501, 'x');
+    CHECK(!fetch(cache, "s1", big));
+    remove(big.c_str());
+}
+
+// 先按流的配额淘汰，再按总量淘汰最久未使用的分段
+void testEviction()
+{
+    SegmentCache::Config config;
+    config.capacity = 1000;
+    config.streamQuota = 600;
+    config.maxEntrySize = 500;
+    SegmentCache cache(config);
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < 3; i++) {
+        paths.push_back(testPath("q" + std::to_string(i)));
+        writeFile(paths.back(), 250, 'q');
+        CHECK(fetch(cache, "s1", paths.back()));
+    }
+    SegmentCache::Stats stats = cache.stats();
+    CHECK(stats.evictions == 1 && stats.bytes == 500);
+
+    for (int i = 0; i < 2; i++) {
+        paths.push_back(testPath("r" + std::to_string(i)));
+        writeFile(paths.back(), 300, 'r');
+        CHECK(fetch(cache, "s2", paths.back()));
+    }
+    stats = cache.stats();
+    CHECK(stats.evictions == 2 && stats.bytes <= 1000);
+
+    // 最早的分段已被淘汰，再次取用需要读盘
+    uint64_t misses = stats.misses;
+    CHECK(fetch(cache, "s1", paths[0]));
+    CHECK(cache.stats().misses == misses + 1);
+
+    for (const auto& path : paths) {
+        remove(path.c_str());
+    }
+}
+
+// 同一文件同时未命中时只读一次盘
+void testCoalescing()
+{
+    SegmentCache cache;
+    std::string path = testPath("c");
+    const size_t size = 8 << 20;
+    writeFile(path, size, 'c');
+
+    std::atomic<int> received(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 16; i++) {
+        threads.emplace_back([&cache, &path, &received, size]() {
+            cache.fetch("s", path, [&received, size](const SegmentCache::Buffer& data) {
+                if (data && data->size() == size) {
+                    received++;
+                }
+            });
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    SegmentCache::Stats stats = cache.stats();
+    CHECK(received == 16);
+    CHECK(stats.misses == 1);
+    CHECK(stats.hits + stats.coalesced == 15);
+    remove(path.c_str());
+}
+
+} // namespace
+
+int main()
+{
+    testHitAndInvalidate();
+    testEviction();
+    testCoalescing();
+    return TEST_RESULT();
+}
@@ -0,0 +1,131 @@
+#include "StartCodeScanner.h"
+#include "TestCheck.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Match {
+    size_t offset;
+    int length;
+
+    bool operator==(const Match& other) const { return offset == other.offset && length == other.length; }
+};
+
+// 从头到尾查找所有起始码
+std::vector<Match> findAll(StartCodeScanner::FindFunc find, const uint8_t* data, size_t size)
+{
+    std::vector<Match> matches;
+    const uint8_t* end = data + size;
+    const uint8_t* p = data;
+    while (p < end) {
+        int length = 0;
+        const uint8_t* found = find(p, end, &length);
+        if (found == end) {
+            break;
+        }
+        Match match = { static_cast<size_t>(found - data), length };
+        matches.push_back(match);
+        p = found + length;
+    }
+    return matches;
+}
+
+// 各实现与标量实现的结果逐个比较
+void checkAgainstScalar(const uint8_t* data, size_t size, const std::string& what)
+{
+    std::vector<StartCodeScanner::Implementation> impls = StartCodeScanner::implementations();
+    std::vector<Match> expected = findAll(impls[0].find, data, size);
+    for (size_t i = 1; i < impls.size(); i++) {
+        std::vector<Match> actual = findAll(impls[i].find, data, size);
+        if (!(actual == expected)) {
+            std::cerr << impls[i].name << " differs from scalar: " << what << std::endl;
+        }
+        CHECK(actual == expected);
+    }
+}
+
+void plant(std::vector<uint8_t>& buffer, size_t offset, int length)
+{
+    static const uint8_t code4[] = { 0, 0, 0, 1 };
+    static const uint8_t code3[] = { 0, 0, 1 };
+    const uint8_t* code = length == 4 ? code4 : code3;
+    for (int i = 0; i < length && offset + i < buffer.size(); i++) {
+        buffer[offset + i] = code[i];
+    }
+}
+
+// 已知位置：跨16/32字节块边界和尾部的起始码都能被标量实现找到
+void testKnownPositions()
+{
+    const size_t offsets[] = { 0, 14, 15, 16, 29, 30, 31, 32, 46, 47, 62, 63 };
+    for (size_t offset : offsets) {
+        for (int length = 3; length <= 4; length++) {
+            std::vector<uint8_t> buffer(100, 0xAA);
+            plant(buffer, offset, length);
+            std::vector<Match> matches = findAll(StartCodeScanner::findScalar, buffer.data(), buffer.size());
+            CHECK(matches.size() == 1);
+            CHECK(!matches.empty() && matches[0].offset == offset && matches[0].length == length);
+            checkAgainstScalar(buffer.data(), buffer.size(), "known position " + std::to_string(offset));
+        }
+    }
+
+    // 尾部：与逐字节实现一致，起始码之后至少还要有一个字节
+    for (size_t size = 4; size <= 70; size++) {
+        for (int length = 3; length <= 4; length++) {
+            for (size_t back = 3; back <= 5; back++) {
+                if (back > size) {
+                    continue;
+                }
+                std::vector<uint8_t> buffer(size, 0xAA);
+                plant(buffer, size - back, length);
+                checkAgainstScalar(buffer.data(), buffer.size(), "tail size " + std::to_string(size));
+            }
+        }
+    }
+}
+
+// 随机数据：零字节较多以产生大量候选位置（00 00 02、00 00 00 00 01等）
+void testRandomBuffers()
+{
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<size_t> size(0, 300);
+
+    for (int round = 0; round < 5000; round++) {
+        std::vector<uint8_t> buffer(size(rng) + 16);
+        int zeroPercent = round % 4 == 0 ? 60 : 20;
+        for (auto& b : buffer) {
+            b = percent(rng) < zeroPercent ? 0 : static_cast<uint8_t>(byte(rng));
+        }
+
+        // 在块边界前后和尾部放置起始码
+        size_t count = buffer.size() / 32 + 1;
+        for (size_t i = 0; i < count; i++) {
+            size_t base = (i + 1) * (percent(rng) < 50 ? 16 : 32);
+            size_t offset = base - 1 - static_cast<size_t>(percent(rng) % 4);
+            if (offset < buffer.size()) {
+                plant(buffer, offset, 3 + percent(rng) % 2);
+            }
+        }
+        if (buffer.size() >= 5) {
+            plant(buffer, buffer.size() - 4 - percent(rng) % 2, 3 + percent(rng) % 2);
+        }
+
+        // 起点不对齐：从不同偏移开始查找
+        for (size_t skip = 0; skip < 16; skip += 5) {
+            checkAgainstScalar(buffer.data() + skip, buffer.size() - skip, "random round " + std::to_string(round));
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testKnownPositions();
+    testRandomBuffers();
+    return TEST_RESULT();
+}
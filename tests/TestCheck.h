@@ -0,0 +1,21 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <iostream>
+
+// 测试断言：失败时打印位置并计数，不受NDEBUG影响
+static int g_testFailures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond    \
+                      << std::endl;                                                 \
+            g_testFailures++;                                                       \
+        }                                                                           \
+    } while (0)
+
+// 测试结果作为进程退出码
+#define TEST_RESULT() (g_testFailures == 0 ? 0 : 1)
+
+#endif // TEST_CHECK_H
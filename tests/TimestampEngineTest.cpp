@@ -0,0 +1,147 @@
+#include "TimestampEngine.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int64_t FRAME = 3000;    // 90kHz下30fps的帧间隔
+
+// IPBB GOP的解码顺序PTS：I0 P3 B1 B2 P6 B4 B5 ...
+std::vector<int64_t> ipbbDecodeOrder(int gops)
+{
+    std::vector<int64_t> pts;
+    pts.push_back(0);
+    for (int g = 0; g < gops; g++) {
+        int64_t base = g * 3 * FRAME;
+        pts.push_back(base + 3 * FRAME);
+        pts.push_back(base + 1 * FRAME);
+        pts.push_back(base + 2 * FRAME);
+    }
+    return pts;
+}
+
+std::vector<int64_t> assignAll(TimestampEngine& engine, const std::vector<int64_t>& pts)
+{
+    std::vector<int64_t> dts;
+    for (int64_t p : pts) {
+        dts.push_back(engine.assign(p));
+    }
+    return dts;
+}
+
+// DTS严格递增
+bool increasing(const std::vector<int64_t>& dts)
+{
+    for (size_t i = 1; i < dts.size(); i++) {
+        if (dts[i] <= dts[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 深度为D时：第n帧DTS等于显示顺序第n-D个PTS，起始D帧按帧间隔外推，且都不大于PTS
+void testIpbbDepth2()
+{
+    std::vector<int64_t> pts = ipbbDecodeOrder(10);
+    TimestampEngine engine;
+    engine.reset(FRAME);
+    engine.setReorderDepth(2);
+    std::vector<int64_t> dts = assignAll(engine, pts);
+
+    std::vector<int64_t> sorted = pts;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(dts[0] == -2 * FRAME);
+    CHECK(dts[1] == -1 * FRAME);
+    for (size_t n = 2; n < dts.size(); n++) {
+        CHECK(dts[n] == sorted[n - 2]);
+    }
+    for (size_t n = 0; n < dts.size(); n++) {
+        CHECK(dts[n] <= pts[n]);
+    }
+    CHECK(increasing(dts));
+    CHECK(engine.reorderDepth() == 2);
+}
+
+// 深度0：无B帧时DTS等于PTS
+void testDepth0WithoutReorder()
+{
+    TimestampEngine engine;
+    engine.reset(FRAME);
+    for (int64_t n = 0; n < 20; n++) {
+        CHECK(engine.assign(n * FRAME) == n * FRAME);
+    }
+    CHECK(engine.reorderDepth() == 0);
+}
+
+// 深度0但输入IPBB：DTS回退时自动加大深度，DTS保持严格递增
+void testDepth0GrowsOnIpbb()
+{
+    std::vector<int64_t> pts = ipbbDecodeOrder(10);
+    TimestampEngine engine;
+    engine.reset(FRAME);
+    std::vector<int64_t> dts = assignAll(engine, pts);
+
+    CHECK(increasing(dts));
+    CHECK(engine.reorderDepth() >= 1);
+
+    // reset保留已学到的深度，新文件从一开始就不再回退
+    uint32_t depth = engine.reorderDepth();
+    engine.reset(FRAME);
+    dts = assignAll(engine, pts);
+    CHECK(increasing(dts));
+    CHECK(engine.reorderDepth() == depth);
+    for (size_t n = 0; n < dts.size(); n++) {
+        CHECK(dts[n] <= pts[n]);
+    }
+}
+
+// 精确换算：大时间戳下value * mul会溢出64位，按q * mul + r * mul / div计算
+void testRescaleLargeTimestamps()
+{
+    // 9e16（90kHz约31万年）换算到毫秒：直接相乘为9e19，超过int64范围
+    int64_t value = 90000LL * 1000000000000LL;
+    CHECK(TimestampEngine::rescale(value, 1000, 90000) == 1000000000000000LL);
+    CHECK(TimestampEngine::rescale(-value, 1000, 90000) == -1000000000000000LL);
+    CHECK(TimestampEngine::rescale(INT64_MAX, 1, 1) == INT64_MAX);
+    CHECK(TimestampEngine::rescale(INT64_MIN + 1, 1, 1) == INT64_MIN + 1);
+
+    // 四舍五入（负数对称）
+    CHECK(TimestampEngine::rescale(1, 1, 2) == 1);
+    CHECK(TimestampEngine::rescale(-1, 1, 2) == -1);
+    CHECK(TimestampEngine::rescale(1, 1, 3) == 0);
+    CHECK(TimestampEngine::rescale(2, 1, 3) == 1);
+    CHECK(TimestampEngine::rescale(5, 7, 0) == 0);
+
+    // 与128位整数结果对照（1001/30000等NTSC时间基）
+    std::mt19937_64 rng(42);
+    const uint64_t bases[][2] = { { 90000, 1000 }, { 1000, 90000 }, { 30000, 1001 }, { 1001, 30000 }, { 48000, 90000 } };
+    for (int i = 0; i < 10000; i++) {
+        int64_t v = static_cast<int64_t>(rng() >> (i % 2 ? 8 : 24));
+        for (const auto& base : bases) {
+            unsigned __int128 exact = (static_cast<unsigned __int128>(v) * base[0] + base[1] / 2) / base[1];
+            CHECK(TimestampEngine::rescale(v, base[0], base[1]) == static_cast<int64_t>(exact));
+        }
+    }
+}
+
+void testGcd()
+{
+    CHECK(TimestampEngine::gcd(90000, 1000) == 1000);
+    CHECK(TimestampEngine::gcd(30000, 1001) == 1);
+    CHECK(TimestampEngine::gcd(0, 5) == 5);
+}
+
+} // namespace
+
+int main()
+{
+    testIpbbDepth2();
+    testDepth0WithoutReorder();
+    testDepth0GrowsOnIpbb();
+    testRescaleLargeTimestamps();
+    testGcd();
+    return TEST_RESULT();
+}
@@ -0,0 +1,72 @@
+#include "WorkerPool.h"
+#include "TestCheck.h"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+// 模拟RecorderManager的通道：每次调度最多处理batch帧，还有剩余时重新提交自己
+struct Channel {
+    char name;
+    int remaining;
+};
+
+const int BATCH = 8;
+
+void drain(WorkerPool& pool, Channel& channel, std::string& order, std::mutex& mutex)
+{
+    for (int i = 0; i < BATCH && channel.remaining > 0; i++) {
+        channel.remaining--;
+        std::lock_guard<std::mutex> lock(mutex);
+        order += channel.name;
+    }
+    if (channel.remaining > 0) {
+        pool.submit([&pool, &channel, &order, &mutex] { drain(pool, channel, order, mutex); });
+    }
+}
+
+// 单线程先进先出：两个积压的通道在工作线程内重新排队后轮流前进
+void testChannelsInterleave()
+{
+    std::mutex mutex;
+    std::string order;
+    Channel a = { 'a', BATCH * 4 };
+    Channel b = { 'b', BATCH * 4 };
+    {
+        WorkerPool pool(1, WorkerPool::ORDER_FIFO);
+
+        // 第一个任务占住工作线程，保证两个通道在开始处理前都已排队
+        std::mutex gate;
+        gate.lock();
+        pool.submit([&gate] { std::lock_guard<std::mutex> lock(gate); });
+        pool.submit([&pool, &a, &order, &mutex] { drain(pool, a, order, mutex); });
+        pool.submit([&pool, &b, &order, &mutex] { drain(pool, b, order, mutex); });
+        gate.unlock();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (order.size() == static_cast<size_t>(BATCH * 8)) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // 每批之后切换到另一个通道：aaaaaaaabbbbbbbbaaaaaaaa...
+    std::string expected;
+    for (int i = 0; i < 4; i++) {
+        expected += std::string(BATCH, 'a') + std::string(BATCH, 'b');
+    }
+    CHECK(order == expected);
+}
+
+} // namespace
+
+int main()
+{
+    testChannelsInterleave();
+    return TEST_RESULT();
+}